@@ -0,0 +1,115 @@
+/**
+ * Mikro-Benchmarks für den Sender (nur native-Build)
+ *
+ * Die Firmware wird direkt eingebunden, damit auch Klassen und Funktionen
+ * aus src/main.cpp ohne eigenen Header erreichbar sind. Hardware-Zugriffe
+ * laufen gegen NativeShim (lib/NativeShim).
+ *
+ * Aufruf:  pio run -e native -t exec
+ *          (Optionen: --rounds=N --min-round-ms=N)
+ */
+
+#include "../src/main.cpp"
+
+#include "MicroBench.h"
+
+int main(int argc, char **argv) {
+  bench::Suite suite("sender");
+  suite.parseArgs(argc, argv);
+
+  shim::setAnalog(BATTERY_ADC_PIN, 2280);
+  setup();
+
+  // Kein Taster gedrückt (häufigster Fall in der Hauptschleife): keine
+  // Flanken, keine Sperrzeit -> kein Pin wird gelesen
+  suite.run("ButtonReader::readButtons/idle", [&] {
+    shim::advanceMillis(LOOP_DELAY);
+    bench::doNotOptimize(buttons.readButtons());
+  });
+
+  // Interrupt (Flanke in die Warteschlange, Hauptschleife wecken) und
+  // Abholen der Flanke in readButtons()
+  suite.run("onButtonEdge+readButtons", [&] {
+    onButtonEdge((void *)(intptr_t)0);
+    bench::doNotOptimize(buttons.readButtons());
+  });
+
+  // Taster 1 wird abwechselnd gedrückt und losgelassen; die Flanken kommen
+  // über den Interrupt (shim::setInput), danach läuft die Entprellung
+  uint32_t step = 0;
+  suite.run("ButtonReader::readButtons/press", [&] {
+    if ((step++ % 8) == 0) {
+      if ((step / 8) & 1) {
+        shim::setInput(buttonPins[0], LOW);
+      } else {
+        shim::releaseInput(buttonPins[0]);
+      }
+    }
+    shim::advanceMillis(LOOP_DELAY);
+    bench::doNotOptimize(buttons.readButtons());
+  });
+  shim::releaseInput(buttonPins[0]);
+  shim::advanceMillis(DEBOUNCE_DELAY + 1);
+  buttons.readButtons();
+
+  // Ganze Hauptschleife: Tastendruck -> START, Loslassen -> STOP
+  // (enthält Serial-Ausgaben und Warten auf der virtuellen Uhr)
+  suite.run("loop/press+release", [&] {
+    shim::setInput(buttonPins[0], LOW);
+    loop();
+    shim::releaseInput(buttonPins[0]);
+    shim::advanceMillis(DEBOUNCE_DELAY + 1);
+    loop();
+  });
+
+  ButtonFrame encodeInput = {CMD_RENEW, 0x01, 7, COMMAND_LEASE_MS, 3920, 2280, -61, 12345, MARKISE_PROTOCOL_VERSION, 0};
+  suite.run("encodeFrame", [&] {
+    uint8_t buffer[MARKISE_FRAME_SIZE];
+    bench::doNotOptimize(encodeFrame(encodeInput, buffer, sizeof(buffer)));
+    bench::doNotOptimize(buffer);
+  });
+
+  // Signierter Frame (LINK_AUTH): Kodieren plus SipHash über 22 Bytes
+  LinkKey key;
+  linkKeyFromHex("000102030405060708090a0b0c0d0e0f", key);
+  uint32_t counter = 1;
+  suite.run("encodeAuthFrame", [&] {
+    uint8_t buffer[MARKISE_AUTH_FRAME_SIZE];
+    bench::doNotOptimize(encodeAuthFrame(encodeInput, counter++, key, buffer, sizeof(buffer)));
+    bench::doNotOptimize(buffer);
+  });
+
+  suite.run("sendButtonStatus", [&] {
+    shim::advanceMillis(HOLD_SEND_INTERVAL);
+    sendButtonStatus(0x01, CMD_RENEW);
+  });
+
+  // Eine Messung des Batterie-Samplers (läuft im eigenen Task) und deren
+  // Übernahme in loop()
+  suite.run("BatterySampler::sample", [&] {
+    bench::doNotOptimize(batterySampler.sample());
+    serviceBattery();
+  });
+
+  // Nächster Datensatz der Energiebilanz (jeder ENERGY_REPORT_EVERY-te Frame)
+  ButtonFrame energyFrame = encodeInput;
+  suite.run("energyRecord", [&] {
+    shim::advanceMicros(100);
+    energyRecord(energyFrame);
+    bench::doNotOptimize(energyFrame);
+  });
+
+  // Echo eines Empfängers auswerten (Uhrenabgleich, Histogramme)
+  uint8_t echoBuffer[MARKISE_ECHO_SIZE];
+  EchoFrame echoInput = {ECHO_FLAG_OUTPUTS_CHANGED | ECHO_FLAG_RSSI, 0, 0, 1000, 1040, 1100, -60};
+  suite.run("OnEchoRecv", [&] {
+    uint32_t nowUs = (uint32_t)esp_timer_get_time();
+    rememberCommand(echoInput.sequence, CMD_START, nowUs, nowUs);
+    encodeEcho(echoInput, echoBuffer, sizeof(echoBuffer));
+    OnEchoRecv(receivers[0].mac, echoBuffer, sizeof(echoBuffer));
+    echoInput.sequence++;
+  });
+
+  suite.report();
+  return 0;
+}
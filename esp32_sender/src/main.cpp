@@ -1,51 +1,4 @@
 /**
- * ESP32-Sender für Markisensteuerung
- * LILYGO T-Energy-S3 mit 6 Tastern und RGB-LED
- *
- * LED-Logik:
- * - Batterie OK:
- *     - Taster erkannt: kurz GRÜN
- *     - Taster gehalten: GRÜN dauerhaft
- * - Batterie LOW:
- *     - Taster erkannt: kurz GRÜN
- *     - Taster gehalten: BLAU/ROT im Wechsel (blinken) als "bitte laden"
- *
- * Batterie-Überwachung:
- * - nur Info + batteryLow-Flag
- * - KEIN Einfluss auf ESP-NOW-Logik
- */
-
-#include <esp_now.h>
-#include <WiFi.h>
-#include "esp_sleep.h"
-
-// =================== KONFIGURATION ===================
-
-// Inaktivitäts-Timeout (Sekunden ohne Tastendruck bis Deep Sleep)
-#define INACTIVITY_TIMEOUT 30
-
-// Entprellzeit für Taster (ms)
-#define DEBOUNCE_DELAY 50
-
-// Maximale Taster-Haltezeit (ms) – Sicherheitslimit
-#define BUTTON_HOLD_TIMEOUT 10000  // 10 s
-
-// Wie oft bei gehaltenem Taster gesendet wird (Motor EIN solange Pakete kommen)
-#define HOLD_SEND_INTERVAL 50  // ms
-
-// Batterie-Logik: Schwelle für "low" anhand ADC-Rohwert
-#define BATTERY_LOW_RAW_THRESHOLD 1900  // vorläufiger Wert, anpassbar
-
-// =================== GPIO DEFINITIONEN ===================
-
-// Taster GPIOs (alle als Wake-Quelle, Pull-Up, gegen GND)
-const int buttonPins[6] = {1, 2, 4, 5, 6, 7};
-const uint64_t buttonBitMask =
-    (1ULL << 1) | (1ULL << 2) | (1ULL << 4) |
-    (1ULL << 5) | (1ULL << 6) | (1ULL << 7);
-
-// RGB-LED GPIOs (gemeinsame Kathode: HIGH = EIN, LOW = AUS)
-#define LED_RED_PIN   10/**
  * ESP32-Sender für Markisensteuerung - OPTIMIERTE VERSION
  * LILYGO T-Energy-S3 mit 6 Tastern und RGB-LED
  * 
@@ -63,41 +16,195 @@ const uint64_t buttonBitMask =
 #include <esp_now.h>
 #include <WiFi.h>
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp32s3/rtc.h"
+#include "driver/gpio.h"
+#include <Preferences.h>
+#include "MarkiseProtocol.h"
+#include "LinkAuth.h"
+#include "LogHistogram.h"
+
+#include <atomic>
 
 // =================== KONFIGURATION ===================
 // Diese Werte können nach Bedarf angepasst werden
 
 // Inaktivitäts-Timeout: Nach 30 Sekunden ohne Tastendruck geht der ESP in den Tiefschlaf
+#ifndef INACTIVITY_TIMEOUT
 #define INACTIVITY_TIMEOUT 30  // Sekunden
+#endif
 
 // Entprellzeit: Verhindert, dass ein Taster mehrfach auslöst
 // VON 50ms AUF 10ms REDUZIERT für schnellere Reaktion
+#ifndef DEBOUNCE_DELAY
 #define DEBOUNCE_DELAY 10  // Millisekunden
+#endif
 
 // Maximale Haltezeit: Sicherheit, falls Taster klemmt
+#ifndef BUTTON_HOLD_TIMEOUT
 #define BUTTON_HOLD_TIMEOUT 10000  // 10 Sekunden
+#endif
+
+// Lease: So lange führt der Empfänger einen Befehl ohne Erneuerung aus.
+// Das ist zugleich die maximale Nachlaufzeit, falls der Sender ausfällt
+// (entspricht dem bisherigen Empfänger-Timeout von 150 ms).
+#ifndef COMMAND_LEASE_MS
+#define COMMAND_LEASE_MS 150  // Millisekunden
+#endif
+
+// Sende-Intervall: Wann wird die Lease bei gehaltenem Taster erneuert?
+// Anteil der Lease in Prozent – 60% lässt Zeit für Wiederholungen
+// (statt bisher fest alle 25ms: ca. 3,6x weniger Pakete)
+#ifndef LEASE_RENEW_PERCENT
+#define LEASE_RENEW_PERCENT 60
+#endif
+#define HOLD_SEND_INTERVAL (COMMAND_LEASE_MS * LEASE_RENEW_PERCENT / 100)  // Millisekunden
+
+// Meldet OnDataSent einen Fehler, wird nach dieser Zeit erneut gesendet
+#ifndef SEND_RETRY_INTERVAL
+#define SEND_RETRY_INTERVAL 10  // Millisekunden
+#endif
+
+// So oft wird ein STOP (oder Fahrbefehl) wiederholt, wenn er nicht zugestellt wurde
+#ifndef STOP_RETRIES
+#define STOP_RETRIES 3
+#endif
+
+// Kurzer Tastendruck: Wird der Taster vor Ablauf dieser Zeit losgelassen,
+// schickt der Sender statt STOP einen Fahrbefehl (CMD_MOVE) und der
+// Empfänger fährt den Motor selbst bis in die Endlage. Längeres Halten
+// fährt wie bisher nur, solange der Taster gedrückt ist. 0 = aus (ein
+// kurzer Druck tippt den Motor nur kurz an). Einschalten z.B. per
+// -DTAP_TRAVEL_MS=400 in build_flags.
+// Braucht Empfänger mit Fahrbefehlen; ein älterer Empfänger verwirft den
+// Frame und hält den Motor nach Ablauf der Lease an.
+#ifndef TAP_TRAVEL_MS
+#define TAP_TRAVEL_MS 0  // Millisekunden
+#endif
+
+// Aufwecken aus dem Tiefschlaf: ROM und Bootloader laufen, bevor esp_timer
+// zu zählen beginnt. Diese Zeit wird der Reaktionszeit nach dem Aufwecken
+// zugeschlagen; auf dem ESP32-S3 etwa 30 ms. Einmal nachmessen (Oszilloskop
+// an Taster und ersten Frame bzw. LED) und hier eintragen.
+#ifndef WAKE_BOOT_MS
+#define WAKE_BOOT_MS 30  // Millisekunden
+#endif
+
+// Kürzeste Lease, die der Empfänger annimmt (LEASE_MIN_MS dort). Ist der
+// Taster nach dem Aufwecken schon wieder los und bleibt weniger Lease übrig,
+// geht kein START hinaus.
+#define LEASE_MIN_MS 20  // Millisekunden
+
+// Taktung der Hauptschleife, solange etwas läuft (LED blinkt, Taster gehalten).
+// Sonst schläft die Schleife bis zum nächsten Taster-Interrupt oder zur
+// nächsten Frist (Lease-Erneuerung, Batterie-Prüfung, Tiefschlaf).
+#define LOOP_DELAY 5  // Millisekunden
 
-// Sende-Intervall: Wie oft wird bei gehaltenem Taster gesendet?
-// VON 50ms AUF 25ms REDUZIERT für flüssigeren Motorlauf
-#define HOLD_SEND_INTERVAL 25  // Millisekunden
+// Längste Wartezeit der Hauptschleife ohne Ereignis
+#define LOOP_MAX_WAIT 1000  // Millisekunden
 
-// Hauptschleifen-Delay: Kurze Pause zur Entlastung der CPU
-// VON 50ms AUF 5ms REDUZIERT für schnellere Reaktion
-#define LOOP_DELAY 5  // Millisekunden
+// Light Sleep statt Warten, solange nichts läuft (siehe LIGHT SLEEP).
+// Über USB-CDC kann der serielle Monitor dabei die Verbindung verlieren –
+// zum Debuggen per -DLIGHT_SLEEP_IDLE=0 abschalten
+#ifndef LIGHT_SLEEP_IDLE
+#define LIGHT_SLEEP_IDLE 1
+#endif
+#define LIGHT_SLEEP_MIN_MS 20      // kürzere Wartezeiten ohne Schlaf (Millisekunden)
+#define LIGHT_SLEEP_AFTER_SEND 50  // nach dem Senden wach bleiben (Bestätigung, Echo)
+
+// Plätze in der Warteschlange für Taster-Flanken (Zweierpotenz)
+#define BUTTON_EVENT_QUEUE_SIZE 32
 
 // Batterie-Schwelle: ADC-Wert unter diesem Wert = Batterie schwach
 #define BATTERY_LOW_RAW_THRESHOLD 1900
 
+// Echo-Modus: Jeder Befehl bittet den Empfänger um ein Echo mit seinen
+// Empfangs- und Schaltzeiten. Daraus entsteht die Zeit Tastendruck -> Relais.
+// Kostet ein Funkpaket je Befehl zurück; alle Empfänger müssen das Echo
+// kennen (sonst verwerfen sie die Befehle). Einschalten z.B. per
+// -DECHO_MODE=1 in build_flags
+#ifndef ECHO_MODE
+#define ECHO_MODE 0
+#endif
+
+// Signierte Befehle (lib/LinkAuth): Jeder Frame trägt einen Zähler und eine
+// SipHash-Signatur mit LINK_KEY. Der Empfänger braucht denselben Schlüssel
+// für diesen Sender und nimmt dann nur noch signierte Frames an. Kostet
+// 12 Bytes mehr je Frame und einige µs Rechenzeit (Ausgabe beim Kaltstart).
+// Einschalten z.B. per -DLINK_AUTH=1 in build_flags
+#ifndef LINK_AUTH
+#define LINK_AUTH 0
+#endif
+
+// Schlüssel dieses Senders: 32 Hex-Zeichen, für jeden Sender ein eigener
+// Zufallswert (openssl rand -hex 16). Steht bewusst nicht im Code, sondern
+// kommt als Build-Flag: -DLINK_KEY=\"<32 Hex-Zeichen>\"
+#if LINK_AUTH && !defined(LINK_KEY)
+#error "LINK_AUTH braucht einen Schlüssel in LINK_KEY (siehe README)"
+#endif
+#ifndef LINK_KEY
+#define LINK_KEY nullptr
+#endif
+
+// Sendeleistung (siehe SENDELEISTUNG): nach so vielen bestätigten Frames in
+// Folge eine Stufe leiser, beim ersten Fehler so viele Stufen lauter
+#define TXPOWER_STEP_DOWN_AFTER 20
+#define TXPOWER_STEP_UP 2
+// Eine Stufe, bei der ein Frame verloren ging, wird erst nach so vielen
+// bestätigten Frames wieder versucht
+#define TXPOWER_RETRY_AFTER 200
+// Empfangspegel beim Empfänger (nur im Echo-Modus bekannt), unter den die
+// Regelung nicht gehen soll (dBm)
+#define TXPOWER_MIN_RSSI -80
+
+// Kalibrierungsfaktor ADC-Rohwert -> Volt (muss an Ihre Hardware angepasst werden)
+#define BATTERY_CALIBRATION_K 0.00172f
+
+// Nach dem Aufwecken wird die Batterie nur bei jedem n-ten Mal gleich
+// gemessen, sonst gilt zunächst der gefilterte Wert aus dem RTC-Speicher
+#define BATTERY_MEASURE_EVERY_WAKES 10
+
+// Batterie-Sampler (eigener Task, siehe BATTERIE-FUNKTIONEN)
+#define BATTERY_SAMPLE_INTERVAL 10000  // Millisekunden zwischen zwei Messungen
+#define BATTERY_OVERSAMPLE 16          // ADC-Wandlungen je Messung
+#define BATTERY_SETTLE_MS 10           // Wartezeit nach dem Konfigurieren des Pins
+#define BATTERY_TASK_PRIORITY 1
+
+// Energiebilanz (siehe ENERGIEBILANZ): Stromaufnahme je Zustand in µA.
+// Schätzwerte für den ESP32-S3 – mit einem Strommessgerät nachmessen und
+// hier eintragen. TX und LED kommen zum Wachstrom dazu.
+#define ENERGY_CURRENT_BOOT_UA        45000   // Start bis Ende von setup()
+#define ENERGY_CURRENT_AWAKE_UA       95000   // CPU an, Funk empfangsbereit (kein Power-Save)
+#define ENERGY_CURRENT_TX_UA          190000  // zusätzlich, solange ein Frame unterwegs ist
+#define ENERGY_CURRENT_LED_UA         10000   // zusätzlich, solange die LED leuchtet
+#define ENERGY_CURRENT_LIGHT_SLEEP_UA 2000
+#define ENERGY_CURRENT_DEEP_SLEEP_UA  20      // ESP32-S3 mit RTC-Speicher, ohne Board
+
+// Jeder ENERGY_REPORT_EVERY-te Frame trägt einen Datensatz der
+// Energiebilanz an den Empfänger (statt adcRaw/rssi). 0 = nie.
+// Wie beim Echo müssen alle Empfänger das Flag kennen (ältere verwerfen
+// auch START/STOP mit dem Flag). Einschalten z.B. per
+// -DENERGY_REPORT_EVERY=4 in build_flags
+#ifndef ENERGY_REPORT_EVERY
+#define ENERGY_REPORT_EVERY 0
+#endif
+
 // =================== GPIO DEFINITIONEN ===================
 // Hier werden die Pins für Taster und LED festgelegt
 
 // Taster an GPIO 1,2,4,5,6,7 (alle mit internem Pull-Up-Widerstand)
-const int buttonPins[6] = {1, 2, 4, 5, 6, 7};
+// Taster 1/2 = Motor 1 Links/Rechts, Taster 3/4 = Motor 2, usw. Weitere
+// Taster einfach anhängen (höchstens 8: buttonMask im Frame hat 8 Bit)
+constexpr int buttonPins[] = {1, 2, 4, 5, 6, 7};
+constexpr int BUTTON_COUNT = sizeof(buttonPins) / sizeof(buttonPins[0]);
+static_assert(BUTTON_COUNT <= 8, "höchstens 8 Taster (buttonMask im Frame hat 8 Bit)");
 
 // Bitmaske für die Wake-Quellen (welche Taster können den ESP wecken)
-const uint64_t buttonBitMask =
-    (1ULL << 1) | (1ULL << 2) | (1ULL << 4) |
-    (1ULL << 5) | (1ULL << 6) | (1ULL << 7);
+constexpr uint64_t wakeBitsFrom(int i) {
+  return i == BUTTON_COUNT ? 0 : (1ULL << buttonPins[i]) | wakeBitsFrom(i + 1);
+}
+const uint64_t buttonBitMask = wakeBitsFrom(0);
 
 // RGB-LED Pins (gemeinsame Kathode: HIGH = LED an, LOW = aus)
 #define LED_RED_PIN   10
@@ -108,29 +215,389 @@ const uint64_t buttonBitMask =
 #define BATTERY_ADC_PIN 3
 
 // =================== ESP-NOW KONFIGURATION ===================
-// MAC-Adresse des Empfängers (muss an Ihre Hardware angepasst werden!)
-uint8_t receiverMac[] = {0xFC, 0xF5, 0xC4, 0x67, 0xA8, 0xE4};
-
-// Diese Struktur wird per Funk übertragen
-// Wichtig: MUSS exakt mit der Empfänger-Seite übereinstimmen!
-typedef struct struct_message {
-  uint8_t buttonMask;      // Bit 0-5: Welche Taster sind gedrückt?
-  float   batteryVoltage;  // Batteriespannung (nur zur Information)
-  uint8_t sequence;        // Sequenznummer (erkennt doppelte Pakete)
-  int16_t adcRaw;          // Rohwert vom ADC (für Diagnose)
-  int8_t  rssi;            // Signalstärke (NEU: für Diagnose)
-  uint32_t timestamp;      // Zeitstempel (NEU: für Laufzeitanalyse)
-} struct_message;
-
-struct_message myData;  // Hier wird die zu sendende Nachricht gespeichert
+// Empfänger-Gruppe (MAC-Adressen müssen an Ihre Hardware angepasst werden!)
+// buttonMask: welche Taster dieser Empfänger bedient (muss zu
+// SERVED_BUTTON_MASK im Empfänger passen). channel: WiFi-Kanal des
+// Empfängers, 0 = gleicher Kanal wie der Sender.
+//
+// Pro Sendung geht EIN Frame je Kanal hinaus: ein einzelner Empfänger
+// bekommt ihn direkt (mit Zustellbestätigung), mehrere Empfänger auf
+// demselben Kanal bekommen ihn gemeinsam per Broadcast (ohne Bestätigung).
+struct ReceiverPeer {
+  uint8_t mac[6];
+  const char *name;
+  uint8_t channel;
+  uint8_t buttonMask;
+
+  // Zustellstatus (aus OnDataSent, nur bei Direktsendung)
+  uint32_t delivered;
+  uint32_t failed;
+  bool lastFailed;
+};
+
+ReceiverPeer receivers[] = {
+  {{0xFC, 0xF5, 0xC4, 0x67, 0xA8, 0xE4}, "Empfänger 1", 0, 0x3F, 0, 0, false},
+  // {{0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF}, "Empfänger 2", 0, 0x30, 0, 0, false},
+};
+
+const int RECEIVER_COUNT = sizeof(receivers) / sizeof(receivers[0]);
+static_assert(RECEIVER_COUNT <= 8, "höchstens 8 Empfänger (Bitmaske uint8_t)");
+
+const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Nach einem Kanalwechsel so lange auf OnDataSent des vorigen Frames warten
+#define CHANNEL_SWITCH_WAIT 5  // Millisekunden
+
+// Diese Nachricht wird per Funk übertragen
+// Das Frame-Format ist in lib/MarkiseProtocol festgelegt (gemeinsam mit dem Empfänger)
+ButtonFrame myData;  // Hier wird die zu sendende Nachricht gespeichert
 
 // =================== GLOBALE VARIABLEN ===================
 // Diese Variablen sind im ganzen Programm sichtbar
 
 unsigned long lastButtonPressTime = 0;   // Wann wurde zuletzt ein Taster gedrückt?
 float batteryVoltage = 0.0;              // Aktuelle Batteriespannung
-uint8_t sequenceNumber = 0;              // Zähler für gesendete Pakete
+uint16_t sequenceNumber = 0;             // Zähler für gesendete Pakete
 bool batteryLow = false;                 // TRUE = Batterie ist schwach
+volatile bool lastSendFailed = false;    // TRUE = letztes Paket nicht zugestellt (OnDataSent)
+bool lastSendUnconfirmed = false;        // TRUE = letztes Paket (auch) per Broadcast, ohne Bestätigung
+volatile uint8_t sendsPending = 0;       // gesendete Frames ohne OnDataSent
+uint8_t activeReceivers = 0;             // Empfänger des laufenden Befehls (für den STOP)
+TaskHandle_t loopTaskHandle = nullptr;   // Task von setup()/loop(), wird von Interrupts geweckt
+
+// Schneller Start nach dem Aufwecken: setup() hat den START schon gesendet,
+// loop() übernimmt den Taster beim ersten Durchlauf
+uint8_t wakeCommandMask = 0;             // 0 = kein START aus setup()
+unsigned long wakeCommandTime = 0;       // millis() beim Senden
+bool wakeChord = false;                  // mehrere Taster beim Start: erst nach dem Loslassen wieder
+
+// Vor Serial.begin() (schneller Weg nach dem Aufwecken) geht nichts auf
+// die UART: Fehler bis dahin werden gezählt, setup() gibt sie danach aus
+bool serialReady = false;
+const char *bootError = nullptr;         // letzte Meldung vor Serial.begin()
+uint8_t bootErrorCount = 0;
+
+// Fehlermeldung auf Serial oder, solange Serial noch nicht läuft, für später
+void reportError(const char *message) {
+  if (serialReady) {
+    Serial.println(message);
+  } else {
+    bootError = message;
+    bootErrorCount++;
+  }
+}
+
+// =================== RTC-SITZUNG ===================
+// Dieser Block liegt im RTC-Speicher und übersteht den Tiefschlaf (nicht
+// aber einen Stromausfall). Damit laufen die Sequenznummern über den Schlaf
+// hinweg weiter (der Empfänger hält sonst das erste Paket für doppelt), und
+// setup() spart sich die Batteriemessung und die Kanalsuche.
+// Gültig nur mit passender Kennung, Version und Prüfsumme.
+
+#define SESSION_MAGIC 0x4D53  // "MS"
+#define SESSION_VERSION 3
+
+struct SenderSession {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t channel;            // WiFi-Kanal beim letzten Betrieb (0 = unbekannt)
+  uint16_t sequence;          // nächste Sequenznummer
+  uint16_t batteryRawX16;     // gefilterter ADC-Rohwert, x16 (Festkomma)
+  float calibrationK;         // ADC-Rohwert -> Volt
+  uint32_t bootCount;         // Starts seit dem letzten Kaltstart
+  uint8_t wakesSinceBattery;  // Aufwecken seit der letzten Batteriemessung
+  uint8_t txPowerLevel;       // Stufe in txPowerLevels[] (0 = volle Leistung)
+  uint8_t txPowerBlocked;     // Stufe mit verlorenem Frame (0 = keine)
+  uint8_t txPowerStreak;      // bestätigte Frames seit der letzten Änderung
+  uint8_t txPowerProbe;       // bestätigte Frames seit der Sperre
+  uint8_t reserved[3];        // Füllbytes (mit in der Prüfsumme)
+  uint32_t authCounter;       // nächster Zähler für signierte Frames
+  uint32_t authReserved;      // im NVS reserviert bis (ausschließlich), 0 = noch nicht gelesen
+  uint16_t checksum;          // CRC-16 über alle Bytes davor
+};
+
+static_assert(offsetof(SenderSession, authCounter) == 24, "SenderSession: keine versteckten Füllbytes");
+
+RTC_DATA_ATTR SenderSession session;
+bool sessionRestored = false;  // TRUE = gültiger Block aus dem RTC-Speicher übernommen
+
+// Echo-Latenzen über alle Tastendrücke (siehe ECHO: TASTER -> RELAIS),
+// werden zusammen mit der Sitzung zurückgesetzt
+struct EchoStats {
+  uint32_t echoes;                    // passende Echos
+  uint32_t unmatched;                 // Echo ohne wartenden Befehl (zu spät)
+  LogHistogram<18> pressToRelayUs;    // Taster gedrückt -> Ausgang EIN
+  LogHistogram<18> releaseToRelayUs;  // Taster losgelassen -> Ausgang AUS
+  LogHistogram<16> roundTripUs;       // Funk hin und zurück (ohne Empfänger-Laufzeit)
+  LogHistogram<14> receiverUs;        // Empfang -> Schalten im Empfänger
+};
+
+RTC_DATA_ATTR EchoStats echoStats;
+
+// Energiebilanz seit dem Kaltstart (siehe ENERGIEBILANZ), wird ebenfalls
+// mit der Sitzung zurückgesetzt
+struct EnergyLedger {
+  uint64_t us[ENERGY_STATE_COUNT];  // Zeit je Zustand
+  uint64_t sleepStartUs;            // RTC-Zeit beim Einschlafen (0 = nicht geschlafen)
+  uint16_t reportHigh;              // obere Hälfte zum zuletzt gesendeten Datensatz
+  uint8_t reportIndex;              // nächster Datensatz (0 .. ENERGY_RECORD_COUNT-1)
+};
+
+RTC_DATA_ATTR EnergyLedger energy;
+
+uint16_t sessionChecksum() {
+  return crc16((const uint8_t *)&session, offsetof(SenderSession, checksum));
+}
+
+// Prüft den RTC-Block; ist er ungültig (Kaltstart), wird er neu angelegt
+bool restoreSession() {
+  bool valid = session.magic == SESSION_MAGIC && session.version == SESSION_VERSION &&
+               session.checksum == sessionChecksum();
+  if (!valid) {
+    memset(&session, 0, sizeof(session));
+    memset(&echoStats, 0, sizeof(echoStats));
+    memset(&energy, 0, sizeof(energy));
+    session.magic = SESSION_MAGIC;
+    session.version = SESSION_VERSION;
+    session.calibrationK = BATTERY_CALIBRATION_K;
+  }
+  session.bootCount++;
+  sequenceNumber = session.sequence;
+  return valid;
+}
+
+// Schreibt den aktuellen Zustand zurück (vor dem Tiefschlaf)
+void saveSession() {
+  session.sequence = sequenceNumber;
+  session.checksum = sessionChecksum();
+}
+
+// =================== SENDELEISTUNG ===================
+// Funken ist der größte Verbraucher des Senders. Meist liegt der Empfänger
+// nur wenige Meter entfernt, volle Leistung ist dann unnötig. Geregelt wird
+// über die Zustellbestätigung (OnDataSent):
+// - nach TXPOWER_STEP_DOWN_AFTER bestätigten Frames in Folge eine Stufe leiser
+// - beim ersten verlorenen Frame TXPOWER_STEP_UP Stufen lauter; die Stufe,
+//   bei der es nicht reichte, bleibt für TXPOWER_RETRY_AFTER Frames gesperrt
+//   (sonst läuft die Regelung immer wieder in denselben Fehler)
+// - im Echo-Modus meldet der Empfänger seinen Empfangspegel: Liegt er unter
+//   TXPOWER_MIN_RSSI, eine Stufe lauter; leiser nur, solange danach noch
+//   TXPOWER_MIN_RSSI erreicht wird
+// Broadcasts (mehrere Empfänger) haben keine Bestätigung und gehen mit voller
+// Leistung. Die Stufe liegt in der RTC-Sitzung und gilt nach dem Aufwecken
+// schon für den ersten Frame.
+
+// Stufen, laut -> leise (Viertel-dBm, etwa 2 dB Abstand)
+const wifi_power_t txPowerLevels[] = {
+  WIFI_POWER_19_5dBm, WIFI_POWER_17dBm, WIFI_POWER_15dBm, WIFI_POWER_13dBm, WIFI_POWER_11dBm,
+  WIFI_POWER_8_5dBm, WIFI_POWER_7dBm, WIFI_POWER_5dBm, WIFI_POWER_2dBm,
+};
+
+const int TXPOWER_LEVELS = sizeof(txPowerLevels) / sizeof(txPowerLevels[0]);
+static_assert(TXPOWER_STEP_DOWN_AFTER <= 255 && TXPOWER_RETRY_AFTER <= 255,
+              "Zähler der Sendeleistung sind uint8_t");
+
+wifi_power_t txPowerApplied = WIFI_POWER_19_5dBm;  // zuletzt eingestellt
+uint32_t txPowerRaised = 0;                        // Erhöhungen seit dem Start
+int8_t txPowerReportedRssi = 0;                    // Empfangspegel aus dem letzten Echo
+bool txPowerRssiKnown = false;
+
+// Stellt die Leistung für den nächsten Frame ein (aus setup()/loop(),
+// nicht aus Callbacks). full = volle Leistung (Broadcast)
+void applyTxPower(bool full) {
+  if (session.txPowerLevel >= TXPOWER_LEVELS) session.txPowerLevel = 0;
+  wifi_power_t power = txPowerLevels[full ? 0 : session.txPowerLevel];
+  if (power == txPowerApplied) return;
+  WiFi.setTxPower(power);
+  txPowerApplied = power;
+}
+
+// Eine Stufe leiser, falls erlaubt
+void txPowerStepDown() {
+  int next = session.txPowerLevel + 1;
+  if (next >= TXPOWER_LEVELS) return;
+  if (session.txPowerBlocked != 0 && next >= session.txPowerBlocked) return;
+  if (txPowerRssiKnown) {
+    int stepDb = (txPowerLevels[next - 1] - txPowerLevels[next] + 3) / 4;
+    if (txPowerReportedRssi - stepDb < TXPOWER_MIN_RSSI) return;
+  }
+  session.txPowerLevel = (uint8_t)next;
+  txPowerRssiKnown = false;  // Pegel gilt für die alte Stufe
+}
+
+// Zustellstatus eines direkt gesendeten Frames (aus OnDataSent)
+void txPowerResult(bool delivered) {
+  if (!delivered) {
+    if (session.txPowerLevel > 0) {
+      session.txPowerBlocked = session.txPowerLevel;
+      session.txPowerLevel = session.txPowerLevel > TXPOWER_STEP_UP ? session.txPowerLevel - TXPOWER_STEP_UP : 0;
+      txPowerRaised++;
+    }
+    session.txPowerStreak = 0;
+    session.txPowerProbe = 0;
+    txPowerRssiKnown = false;
+    return;
+  }
+  
+  if (session.txPowerBlocked != 0 && ++session.txPowerProbe >= TXPOWER_RETRY_AFTER) {
+    session.txPowerBlocked = 0;
+    session.txPowerProbe = 0;
+  }
+  if (++session.txPowerStreak >= TXPOWER_STEP_DOWN_AFTER) {
+    session.txPowerStreak = 0;
+    txPowerStepDown();
+  }
+}
+
+// Empfangspegel, den ein Empfänger gemeldet hat (aus dem Echo)
+void txPowerReport(int8_t rssi) {
+  txPowerReportedRssi = rssi;
+  txPowerRssiKnown = true;
+  if (rssi < TXPOWER_MIN_RSSI && session.txPowerLevel > 0) {
+    session.txPowerLevel--;
+    session.txPowerStreak = 0;
+    txPowerRaised++;
+    txPowerRssiKnown = false;
+  }
+}
+
+void printTxPower() {
+  Serial.printf("Sendeleistung: %.1f dBm (Stufe %u von %d), %lu-mal erhöht",
+                txPowerLevels[session.txPowerLevel] / 4.0f, session.txPowerLevel, TXPOWER_LEVELS - 1,
+                (unsigned long)txPowerRaised);
+  if (session.txPowerBlocked != 0) Serial.printf(", Stufe %u gesperrt", session.txPowerBlocked);
+  Serial.println();
+}
+
+// =================== ENERGIEBILANZ ===================
+// Wie viel Zeit verbringt der Sender in welchem Zustand, und was kostet das?
+// Die Zeiten laufen über den Tiefschlaf hinweg im RTC-Speicher weiter. Die
+// Ladung wird daraus mit den ENERGY_CURRENT_*-Werten geschätzt.
+//
+// - Start: esp_timer beim Ende von setup() (ohne ROM und Bootloader)
+// - Wach: verbucht bis energyMarkUs, abzüglich Light Sleep
+// - TX: vom ersten Frame ohne Bestätigung bis die letzte da ist
+// - LED: solange eine Farbe leuchtet
+// - Tiefschlaf: RTC-Zähler beim Aufwachen minus beim Einschlafen (der
+//   Zähler läuft im Tiefschlaf weiter; ROM und Bootloader zählen mit)
+
+int64_t energyMarkUs = -1;           // esp_timer bis hier wach verbucht, -1 = setup() läuft
+int64_t energyTxStartUs = 0;         // erster Frame ohne Bestätigung
+std::atomic<uint32_t> energyTxUs(0); // aus OnDataSent (WiFi-Task), übernimmt energyUpdate()
+int64_t energyLedOnUs = -1;          // LED an seit, -1 = aus
+
+// Nach dem Aufwachen: Tiefschlaf verbuchen
+void energyWake() {
+  if (energy.sleepStartUs == 0) return;
+  uint64_t bootRtcUs = esp_rtc_get_time_us() - (uint64_t)esp_timer_get_time();
+  if (bootRtcUs > energy.sleepStartUs) energy.us[ENERGY_DEEP_SLEEP] += bootRtcUs - energy.sleepStartUs;
+  energy.sleepStartUs = 0;
+}
+
+// Ende von setup(): Startzeit verbuchen, ab hier zählt wach
+void energyBootDone() {
+  energyMarkUs = esp_timer_get_time();
+  energy.us[ENERGY_BOOT] += (uint64_t)energyMarkUs;
+}
+
+// Verbucht die Wachzeit, TX und LED bis jetzt
+void energyUpdate() {
+  int64_t now = esp_timer_get_time();
+  if (energyMarkUs >= 0) {
+    energy.us[ENERGY_AWAKE] += (uint64_t)(now - energyMarkUs);
+    energyMarkUs = now;
+  }
+  energy.us[ENERGY_TX] += energyTxUs.exchange(0);
+  if (energyLedOnUs >= 0) {
+    energy.us[ENERGY_LED] += (uint64_t)(now - energyLedOnUs);
+    energyLedOnUs = now;
+  }
+}
+
+// Vor esp_now_send(), solange noch kein Frame unterwegs ist
+void energyTxBegin() {
+  energyTxStartUs = esp_timer_get_time();
+}
+
+// Letzter Frame bestätigt (OnDataSent) oder nicht mehr abgewartet
+void energyTxDone() {
+  energyTxUs += (uint32_t)(esp_timer_get_time() - energyTxStartUs);
+}
+
+void energyLed(bool on) {
+  if (on == (energyLedOnUs >= 0)) return;
+  int64_t now = esp_timer_get_time();
+  if (on) {
+    energyLedOnUs = now;
+  } else {
+    energy.us[ENERGY_LED] += (uint64_t)(now - energyLedOnUs);
+    energyLedOnUs = -1;
+  }
+}
+
+// Light Sleep von startUs bis wakeUs (die Zeit davor ist schon verbucht)
+void energyLightSleep(int64_t startUs, int64_t wakeUs) {
+  energy.us[ENERGY_LIGHT_SLEEP] += (uint64_t)(wakeUs - startUs);
+  if (energyMarkUs >= 0) energyMarkUs = wakeUs;
+}
+
+// Direkt vor esp_deep_sleep_start()
+void energyDeepSleep() {
+  energyUpdate();
+  energyMarkUs = -1;
+  energy.sleepStartUs = esp_rtc_get_time_us();
+}
+
+uint32_t energyCurrentUa(int state) {
+  switch (state) {
+    case ENERGY_BOOT:        return ENERGY_CURRENT_BOOT_UA;
+    case ENERGY_AWAKE:       return ENERGY_CURRENT_AWAKE_UA;
+    case ENERGY_TX:          return ENERGY_CURRENT_TX_UA;
+    case ENERGY_LED:         return ENERGY_CURRENT_LED_UA;
+    case ENERGY_LIGHT_SLEEP: return ENERGY_CURRENT_LIGHT_SLEEP_UA;
+    default:                 return ENERGY_CURRENT_DEEP_SLEEP_UA;
+  }
+}
+
+// Geschätzte Ladung in µAh (ms · µA / 3 600 000)
+uint32_t energyChargeUah(int state) {
+  return (uint32_t)(energy.us[state] / 1000 * energyCurrentUa(state) / 3600000ULL);
+}
+
+// Legt den nächsten Datensatz in adcRaw/rssi (siehe MarkiseProtocol.h)
+void energyRecord(ButtonFrame &frame) {
+  uint8_t index = energy.reportIndex;
+  uint8_t state = index / 4;
+  uint8_t field = index % 4;
+  if (field == ENERGY_SECONDS_LO || field == ENERGY_CHARGE_LO) {
+    energyUpdate();
+    uint32_t value = field == ENERGY_SECONDS_LO ? (uint32_t)(energy.us[state] / 1000000ULL)
+                                                 : energyChargeUah(state);
+    energy.reportHigh = (uint16_t)(value >> 16);
+    frame.adcRaw = (uint16_t)value;
+  } else {
+    frame.adcRaw = energy.reportHigh;
+  }
+  frame.rssi = (int8_t)energyTag(field, state);
+  frame.flags |= FRAME_FLAG_ENERGY;
+  energy.reportIndex = (uint8_t)((index + 1) % ENERGY_RECORD_COUNT);
+}
+
+void printEnergy() {
+  static const char *const names[ENERGY_STATE_COUNT] = {
+    "Start", "Wach", "Senden", "LED", "Light Sleep", "Tiefschlaf"};
+  energyUpdate();
+  uint32_t totalUah = 0;
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) totalUah += energyChargeUah(i);
+  Serial.printf("Energiebilanz seit Kaltstart (%lu Starts): %lu.%03lu mAh geschätzt\n",
+                (unsigned long)session.bootCount, (unsigned long)(totalUah / 1000),
+                (unsigned long)(totalUah % 1000));
+  for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+    uint32_t uah = energyChargeUah(i);
+    Serial.printf("  %-11s %9lu ms  %7lu uAh  %3lu %%\n", names[i], (unsigned long)(energy.us[i] / 1000),
+                  (unsigned long)uah, (unsigned long)(totalUah == 0 ? 0 : (uint64_t)uah * 100 / totalUah));
+  }
+}
 
 // =================== LED-CONTROLLER KLASSE ===================
 // Diese Klasse kümmert sich um die LED-Anzeige, OHNE die Programmausführung zu blockieren
@@ -149,6 +616,7 @@ private:
     digitalWrite(LED_RED_PIN,   red   ? HIGH : LOW);
     digitalWrite(LED_GREEN_PIN, green ? HIGH : LOW);
     digitalWrite(LED_BLUE_PIN,  blue  ? HIGH : LOW);
+    energyLed(red || green || blue);
   }
   
 public:
@@ -162,6 +630,11 @@ public:
     blinkState = false;        // Blinkzustand zurücksetzen
   }
   
+  // TRUE = LED ändert sich von selbst (Blink-Modi), update() regelmäßig aufrufen
+  bool isAnimating() const {
+    return currentMode == 1 || currentMode == 3;
+  }
+  
   // Diese Funktion MUSS regelmäßig aufgerufen werden (z.B. in der loop)
   // Sie aktualisiert die LED, ohne die Programmausführung zu blockieren
   void update() {
@@ -201,106 +674,605 @@ public:
 };
 
 // =================== TASTER-CONTROLLER KLASSE ===================
-// Diese Klasse liest die Taster aus, OHNE die Programmausführung zu blockieren
-// Verwendet ein "State Machine" Prinzip (Zustandsautomat)
+// Die Taster lösen bei jeder Flanke einen Interrupt aus. Der Interrupt legt
+// nur (Taster, Pegel, Zeitstempel) in eine Warteschlange und weckt die
+// Hauptschleife; die Entprellung läuft danach in readButtons().
+//
+// Entprellung "an der ersten Flanke": Die erste Flanke zählt sofort (ein
+// Tastendruck ist damit nach wenigen Mikrosekunden bekannt), danach werden
+// Flanken ignoriert, bis DEBOUNCE_DELAY lang keine mehr kam. Nach Ablauf der
+// Sperrzeit wird der echte Pegel einmal gelesen, falls die letzte Flanke im
+// Prellen unterging.
+
+// Eine Taster-Flanke, wie sie der Interrupt aufzeichnet
+struct ButtonEvent {
+  uint8_t index;    // Taster 0-5
+  uint8_t level;    // Pegel nach der Flanke (LOW = gedrückt)
+  uint32_t timeUs;  // micros() im Interrupt
+};
+
+// Ringpuffer ohne Sperren: Schreiber sind die Taster-Interrupts (laufen
+// nicht verschachtelt), Leser ist die Hauptschleife
+class ButtonEventQueue {
+private:
+  ButtonEvent events[BUTTON_EVENT_QUEUE_SIZE];
+  std::atomic<uint32_t> head{0};  // nur Interrupt schreibt
+  std::atomic<uint32_t> tail{0};  // nur Hauptschleife schreibt
+  std::atomic<bool> overflow{false};
+
+public:
+  // Aus dem Interrupt: false = Warteschlange voll, Flanke verloren
+  bool IRAM_ATTR push(uint8_t index, uint8_t level, uint32_t timeUs) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= BUTTON_EVENT_QUEUE_SIZE) {
+      overflow.store(true, std::memory_order_relaxed);
+      return false;
+    }
+    ButtonEvent &e = events[h & (BUTTON_EVENT_QUEUE_SIZE - 1)];
+    e.index = index;
+    e.level = level;
+    e.timeUs = timeUs;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Aus der Hauptschleife: false = keine Flanke vorhanden
+  bool pop(ButtonEvent &e) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    e = events[t & (BUTTON_EVENT_QUEUE_SIZE - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Liefert true, wenn seit dem letzten Aufruf Flanken verloren gingen
+  bool takeOverflow() { return overflow.exchange(false, std::memory_order_relaxed); }
+
+  static_assert((BUTTON_EVENT_QUEUE_SIZE & (BUTTON_EVENT_QUEUE_SIZE - 1)) == 0,
+                "BUTTON_EVENT_QUEUE_SIZE muss eine Zweierpotenz sein");
+};
 
 class ButtonReader {
 private:
-  // Zustandsvariablen für jeden Taster
-  bool lastState[6] = {false};      // Letzter gemessener Zustand
-  bool stableState[6] = {false};    // Entprellter, stabiler Zustand
-  unsigned long debounceTime[6] = {0};  // Wann wurde der Zustand zuletzt geändert?
+  ButtonEventQueue events;
+  bool stableState[BUTTON_COUNT] = {false};   // Entprellter, stabiler Zustand (true = gedrückt)
+  uint32_t changeTimeUs[BUTTON_COUNT] = {0};  // Wann hat sich der stabile Zustand geändert?
+  uint32_t pressTimeUs[BUTTON_COUNT] = {0};   // Zeitstempel der Flanke, die den Druck ausgelöst hat
+  uint32_t lockoutUs[BUTTON_COUNT] = {0};     // Beginn der Sperrzeit
+  uint8_t lockoutMask = 0;              // Taster in der Entprell-Sperrzeit
+  uint8_t pressedMask = 0;              // Bitmaske aus stableState
+  
+  // Übernimmt einen neuen stabilen Zustand und startet die Sperrzeit
+  void accept(int i, bool pressed, uint32_t timeUs) {
+    stableState[i] = pressed;
+    changeTimeUs[i] = timeUs;
+    if (pressed) {
+      pressTimeUs[i] = timeUs;
+      pressedMask |= (1 << i);
+    } else {
+      pressedMask &= ~(1 << i);
+    }
+    lockout(i, timeUs);
+  }
+  
+  // Startet die Sperrzeit für Taster i
+  void lockout(int i, uint32_t timeUs) {
+    lockoutUs[i] = timeUs;
+    lockoutMask |= (1 << i);
+  }
+  
+  // Gleicht einen Taster mit dem echten Pegel ab
+  void resync(int i, uint32_t nowUs) {
+    bool pressed = (digitalRead(buttonPins[i]) == LOW);
+    if (pressed != stableState[i]) accept(i, pressed, nowUs);
+  }
   
 public:
-  // Liest alle Taster aus und gibt eine Bitmaske zurück
-  // Bit 0 = Taster 1, Bit 1 = Taster 2, usw.
+  // Liest den Anfangszustand und meldet die Interrupts an. Alle Taster
+  // starten in der Sperrzeit: wurde einer schon während des Bootens
+  // losgelassen, prellt er vielleicht noch nach
+  void begin(void (*isr)(void *)) {
+    resyncAll(micros(), true);
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+      attachInterruptArg(digitalPinToInterrupt(buttonPins[i]), isr, (void *)(intptr_t)i, CHANGE);
+    }
+  }
+  
+  // Aus dem Interrupt: Flanke aufzeichnen
+  bool IRAM_ATTR recordEdge(int index) {
+    return events.push((uint8_t)index, (uint8_t)digitalRead(buttonPins[index]), (uint32_t)micros());
+  }
+  
+  // Verarbeitet die aufgezeichneten Flanken und gibt die Bitmaske der
+  // gedrückten Taster zurück. Bit 0 = Taster 1, Bit 1 = Taster 2, usw.
+  // Ohne Flanken und ohne laufende Sperrzeit wird kein Pin gelesen.
   uint8_t readButtons() {
-    uint8_t mask = 0;
-    unsigned long now = millis();
+    ButtonEvent e;
+    while (events.pop(e)) {
+      // Prellen innerhalb der Sperrzeit ignorieren; jede Flanke verlängert
+      // sie, damit das Nachprellen eines ungesehenen Loslassens nicht als
+      // neuer Tastendruck durchkommt
+      if (lockoutMask & (1 << e.index)) {
+        lockoutUs[e.index] = e.timeUs;
+        continue;
+      }
+      bool pressed = (e.level == LOW);
+      if (pressed != stableState[e.index]) accept(e.index, pressed, e.timeUs);
+    }
     
-    // Alle 6 Taster einzeln prüfen
-    for (int i = 0; i < 6; i++) {
-      bool currentState = (digitalRead(buttonPins[i]) == LOW);
-      
-      // Wurde der Zustand geändert?
-      if (currentState != lastState[i]) {
-        // Ja -> Entprell-Zeit zurücksetzen
-        debounceTime[i] = now;
+    uint32_t nowUs = micros();
+    
+    // Flanken verloren (Warteschlange voll) -> alle Pegel neu lesen
+    if (events.takeOverflow()) {
+      for (int i = 0; i < BUTTON_COUNT; i++) {
+        if (!(lockoutMask & (1 << i))) resync(i, nowUs);
       }
-      
-      // Ist die Entprell-Zeit abgelaufen?
-      if ((now - debounceTime[i]) > DEBOUNCE_DELAY) {
-        // Ja -> Zustand ist stabil
-        if (currentState != stableState[i]) {
-          // Zustand hat sich wirklich geändert
-          stableState[i] = currentState;
-          if (currentState) {
-            // Taster wurde gedrückt -> Bit setzen
-            mask |= (1 << i);
-          }
+    }
+    
+    // Abgelaufene Sperrzeiten beenden und den Pegel einmal prüfen
+    if (lockoutMask != 0) {
+      for (int i = 0; i < BUTTON_COUNT; i++) {
+        if ((lockoutMask & (1 << i)) && nowUs - lockoutUs[i] >= DEBOUNCE_DELAY * 1000UL) {
+          lockoutMask &= ~(1 << i);
+          resync(i, nowUs);
         }
       }
-      
-      // Aktuellen Zustand für nächsten Durchlauf merken
-      lastState[i] = currentState;
     }
     
-    return mask;
+    return pressedMask;
   }
   
+  // Gleicht alle Taster außerhalb der Sperrzeit mit dem echten Pegel ab
+  // (nach dem Light Sleep: eine Flanke im Schlaf löst keinen Interrupt aus).
+  // lockAll: Sperrzeit für jeden Taster starten, auch ohne Pegelwechsel – ein
+  // Loslassen, das kein Interrupt gesehen hat, kann noch prellen, und die
+  // erste LOW-Flanke davon wäre sonst ein neuer Tastendruck
+  void resyncAll(uint32_t nowUs, bool lockAll = false) {
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+      if (!(lockoutMask & (1 << i))) resync(i, nowUs);
+      if (lockAll) lockout(i, nowUs);
+    }
+  }
+  
+  // TRUE = mindestens ein Taster in der Sperrzeit (readButtons bald wieder aufrufen)
+  bool debouncePending() const { return lockoutMask != 0; }
+  
+  // Zeitstempel (micros) der Flanke, mit der Taster index gedrückt wurde
+  uint32_t pressTime(int index) const { return pressTimeUs[index]; }
+  
+  // Zeitstempel (micros) der letzten Zustandsänderung von Taster index
+  // (nach dem Loslassen: die Flanke des Loslassens)
+  uint32_t changeTime(int index) const { return changeTimeUs[index]; }
+  
   // Prüft, ob genau ein Taster gedrückt ist
   bool isSingleButton(uint8_t mask) {
     return (mask != 0 && (mask & (mask - 1)) == 0);
   }
   
-  // Gibt den Index des gedrückten Tasters zurück (0-5)
+  // Gibt den Index des gedrückten Tasters zurück (0 bis BUTTON_COUNT-1)
   int getButtonIndex(uint8_t mask) {
-    for (int i = 0; i < 6; i++) {
+    for (int i = 0; i < BUTTON_COUNT; i++) {
       if (mask & (1 << i)) return i;
     }
     return -1;  // Kein Taster gedrückt
   }
 };
 
+ButtonReader buttons;  // Taster-Logik (global, weil die Interrupts darauf zugreifen)
+
+// Interrupt für alle Taster; arg = Index des Tasters
+void IRAM_ATTR onButtonEdge(void *arg) {
+  buttons.recordEdge((int)(intptr_t)arg);
+  BaseType_t woken = pdFALSE;
+  if (loopTaskHandle != nullptr) vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+// =================== REAKTIONSZEIT ===================
+// Zeit von der Taster-Flanke (Interrupt) bis der erste Frame gesendet ist
+
+struct PressLatencyStats {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+PressLatencyStats pressLatency = {0, UINT32_MAX, 0, 0};
+
+void recordPressLatency(uint32_t us) {
+  pressLatency.count++;
+  pressLatency.sumUs += us;
+  if (us < pressLatency.minUs) pressLatency.minUs = us;
+  if (us > pressLatency.maxUs) pressLatency.maxUs = us;
+}
+
+void printPressLatency() {
+  if (pressLatency.count == 0) return;
+  Serial.printf("Reaktionszeit Taster->Frame: min %lu us, Mittel %lu us, max %lu us (%lu Tastendrücke)\n",
+                (unsigned long)pressLatency.minUs,
+                (unsigned long)(pressLatency.sumUs / pressLatency.count),
+                (unsigned long)pressLatency.maxUs,
+                (unsigned long)pressLatency.count);
+}
+
+// =================== ECHO: TASTER -> RELAIS ===================
+// Mit ECHO_MODE antwortet der Empfänger auf jeden Befehl mit seinen Zeiten
+// (Empfang, Schalten, Antwort – Empfänger-Uhr). Wie bei NTP ergibt sich
+// aus Senden (t1), Empfang (t2), Antwort (t3) und Eintreffen des Echos (t4):
+//   Umlaufzeit = (t4 - t1) - (t3 - t2)
+//   Versatz    = ((t2 - t1) + (t3 - t4)) / 2   (Empfänger-Uhr - Sender-Uhr)
+// Der Versatz ist höchstens um die halbe Umlaufzeit falsch; verwendet wird
+// daher der Wert mit der kürzesten Umlaufzeit der letzten Echos. Damit
+// lässt sich die Schaltzeit des Empfängers in Sender-Zeit umrechnen und
+// mit der Taster-Flanke vergleichen.
+// Alle Zeiten sind die unteren 32 Bit von esp_timer/micros (µs).
+
+#define ECHO_PENDING 8        // Befehle, auf deren Echo gewartet wird (Zweierpotenz)
+#define ECHO_CLOCK_WINDOW 8   // Echos je Empfänger für die Versatz-Schätzung
+
+static_assert((ECHO_PENDING & (ECHO_PENDING - 1)) == 0, "ECHO_PENDING muss eine Zweierpotenz sein");
+
+// Gesendeter Befehl, der auf Echos wartet
+struct EchoPending {
+  uint16_t sequence;
+  uint8_t command;
+  bool valid;
+  bool hasEvent;       // Taster-Flanke bekannt (START/STOP durch den Benutzer)
+  uint8_t answered;    // Empfänger (Bitmaske), deren Schaltzeit schon gezählt ist
+  uint32_t sentUs;     // t1
+  uint32_t eventUs;    // Taster-Flanke
+};
+
+EchoPending echoPending[ECHO_PENDING];
+
+// Letzte Messungen je Empfänger (die Sender-Uhr beginnt nach jedem
+// Aufwecken neu, daher nur im RAM)
+struct ClockSync {
+  uint32_t offsetUs[ECHO_CLOCK_WINDOW];
+  uint32_t roundTripUs[ECHO_CLOCK_WINDOW];
+  uint8_t next;
+  uint8_t count;
+};
+
+ClockSync clockSync[RECEIVER_COUNT];
+
+// Merkt sich einen gesendeten Befehl. eventUs < 0: keine Taster-Flanke
+void rememberCommand(uint16_t sequence, uint8_t command, uint32_t sentUs, int64_t eventUs) {
+  EchoPending &p = echoPending[sequence & (ECHO_PENDING - 1)];
+  p.sequence = sequence;
+  p.command = command;
+  p.valid = true;
+  p.hasEvent = eventUs >= 0;
+  p.answered = 0;
+  p.sentUs = sentUs;
+  p.eventUs = (uint32_t)eventUs;
+}
+
+// Neue Messung eintragen, Rückgabe: Versatz mit der kürzesten Umlaufzeit
+uint32_t updateClockSync(ClockSync &sync, uint32_t offsetUs, uint32_t roundTripUs) {
+  sync.offsetUs[sync.next] = offsetUs;
+  sync.roundTripUs[sync.next] = roundTripUs;
+  sync.next = (uint8_t)((sync.next + 1) % ECHO_CLOCK_WINDOW);
+  if (sync.count < ECHO_CLOCK_WINDOW) sync.count++;
+  
+  int best = 0;
+  for (int i = 1; i < sync.count; i++) {
+    if (sync.roundTripUs[i] < sync.roundTripUs[best]) best = i;
+  }
+  return sync.offsetUs[best];
+}
+
+// Echo eines Empfängers (läuft im WiFi-Task, keine Serial-Ausgaben)
+void OnEchoRecv(const uint8_t *mac, const uint8_t *data, int len) {
+  uint32_t arrivalUs = (uint32_t)esp_timer_get_time();  // t4
+  EchoFrame echo;
+  if (!decodeEcho(data, len, echo)) return;
+  
+  int receiver = -1;
+  for (int i = 0; i < RECEIVER_COUNT; i++) {
+    if (memcmp(mac, receivers[i].mac, 6) == 0) receiver = i;
+  }
+  EchoPending &p = echoPending[echo.sequence & (ECHO_PENDING - 1)];
+  if (receiver < 0 || !p.valid || p.sequence != echo.sequence) {
+    echoStats.unmatched++;
+    return;
+  }
+  echoStats.echoes++;
+  if (echo.flags & ECHO_FLAG_RSSI) txPowerReport(echo.rssi);
+  
+  // Umlaufzeit und Versatz (modulo 2^32, die Differenzen sind klein)
+  uint32_t roundTrip = (arrivalUs - p.sentUs) - (echo.replyUs - echo.receiveUs);
+  uint32_t forward = echo.receiveUs - p.sentUs;   // Versatz + Hinweg
+  uint32_t backward = echo.replyUs - arrivalUs;   // Versatz - Rückweg
+  uint32_t offset = forward + (uint32_t)((int32_t)(backward - forward) / 2);
+  uint32_t bestOffset = updateClockSync(clockSync[receiver], offset, roundTrip);
+  echoStats.roundTripUs.add(roundTrip);
+  
+  // Taster -> Relais, je Befehl und Empfänger einmal
+  uint8_t bit = (uint8_t)(1 << receiver);
+  if (!p.hasEvent || !(echo.flags & ECHO_FLAG_OUTPUTS_CHANGED) || (p.answered & bit)) return;
+  p.answered |= bit;
+  echoStats.receiverUs.add(echo.commitUs - echo.receiveUs);
+  int32_t latency = (int32_t)(echo.commitUs - bestOffset - p.eventUs);
+  if (latency < 0) latency = 0;  // Schätzfehler des Versatzes
+  if (p.command == CMD_STOP || p.command == CMD_MOVE) {
+    echoStats.releaseToRelayUs.add((uint32_t)latency);
+  } else {
+    echoStats.pressToRelayUs.add((uint32_t)latency);
+  }
+}
+
+// Gibt eine Latenz-Verteilung aus
+template <typename Histogram>
+void printLatency(const char *title, const Histogram &h) {
+  if (h.count == 0) return;
+  Serial.printf("%s (%lu): p50 %lu us, p90 %lu us, p99 %lu us, max %lu us\n", title,
+                (unsigned long)h.count, (unsigned long)h.percentile(500),
+                (unsigned long)h.percentile(900), (unsigned long)h.percentile(990),
+                (unsigned long)h.max);
+}
+
+void printEchoLatency() {
+  if (echoStats.echoes == 0) return;
+  printLatency("Taster->Relais EIN", echoStats.pressToRelayUs);
+  printLatency("Loslassen->Relais AUS", echoStats.releaseToRelayUs);
+  printLatency("  davon im Empfänger", echoStats.receiverUs);
+  printLatency("  Funk-Umlaufzeit", echoStats.roundTripUs);
+  Serial.printf("  %lu Echos, %lu ohne Befehl; Uhrenabgleich auf +/- halbe Umlaufzeit genau\n",
+                (unsigned long)echoStats.echoes, (unsigned long)echoStats.unmatched);
+}
+
+// =================== START-ZEITLEISTE ===================
+// Zeitpunkte der Init-Schritte seit dem Start (esp_timer, µs). Wird nach
+// dem ersten Frame ausgegeben, damit die Ausgabe selbst nichts verzögert.
+
+#define BOOT_STAGE_MAX 10
+
+struct BootStage {
+  const char *name;
+  uint32_t us;
+};
+
+BootStage bootStages[BOOT_STAGE_MAX];
+uint8_t bootStageCount = 0;
+
+void bootMark(const char *name) {
+  if (bootStageCount < BOOT_STAGE_MAX) {
+    bootStages[bootStageCount].name = name;
+    bootStages[bootStageCount].us = (uint32_t)esp_timer_get_time();
+    bootStageCount++;
+  }
+}
+
+void printBootTimeline() {
+  Serial.println("Start-Zeitleiste (us seit Start, +Dauer des Schritts):");
+  uint32_t previous = 0;
+  for (uint8_t i = 0; i < bootStageCount; i++) {
+    Serial.printf("  %8lu  +%7lu  %s\n", (unsigned long)bootStages[i].us,
+                  (unsigned long)(bootStages[i].us - previous), bootStages[i].name);
+    previous = bootStages[i].us;
+  }
+}
+
 // =================== BATTERIE-FUNKTIONEN ===================
 
 // Rechnet ADC-Rohwert in Spannung um
 float getBatteryVoltageFromRaw(int raw) {
-  const float K = 0.00172f;  // Kalibrierungsfaktor (muss an Ihre Hardware angepasst werden)
-  return raw * K;
+  return raw * session.calibrationK;  // Kalibrierungsfaktor aus der RTC-Sitzung
+}
+
+// Setzt batteryVoltage und batteryLow aus dem gefilterten Wert der Sitzung
+void applyBatteryFilter() {
+  int filteredRaw = (session.batteryRawX16 + 8) / 16;
+  batteryVoltage = getBatteryVoltageFromRaw(filteredRaw);
+  batteryLow = (filteredRaw < BATTERY_LOW_RAW_THRESHOLD);
 }
 
-// Misst die Batteriespannung und setzt das batteryLow-Flag
-void logBatteryStatus() {
-  // ADC-Pin als Eingang mit Pulldown konfigurieren
-  pinMode(BATTERY_ADC_PIN, INPUT_PULLDOWN);
-  delay(10);  // Kurze Wartezeit für Stabilisierung
+// Misst die Batterie im Hintergrund (eigener Task mit niedriger Priorität),
+// damit weder der Sendepfad noch loop() auf den ADC warten:
+// - alle BATTERY_SAMPLE_INTERVAL ms BATTERY_OVERSAMPLE Wandlungen; kleinster
+//   und größter Wert fallen weg (Ausreißer, z.B. Einbruch während eines
+//   Funkpakets), der Rest wird gemittelt
+// - danach der gleitende Mittelwert wie bisher (1/4 neu, x16 Festkomma)
+// - veröffentlicht als ein 32-Bit-Wort (gefiltert x16 | Mittelwert | Zähler),
+//   loop() übernimmt es mit poll() in die Sitzung
+class BatterySampler {
+public:
+  // Startet den Task. seedX16: gefilterter Wert aus der Sitzung (0 = keiner,
+  // dann wird sofort synchron gemessen). measureNow: erste Messung gleich,
+  // sonst nach BATTERY_SAMPLE_INTERVAL
+  bool begin(uint16_t seedX16, bool measureNow) {
+    filterX16 = seedX16;
+    pinMode(BATTERY_ADC_PIN, INPUT_PULLDOWN);
+    firstDelayMs = measureNow ? BATTERY_SETTLE_MS : BATTERY_SAMPLE_INTERVAL;
+    if (seedX16 == 0) {
+      delay(BATTERY_SETTLE_MS);
+      sample();
+      firstDelayMs = BATTERY_SAMPLE_INTERVAL;
+    }
+    return xTaskCreatePinnedToCore(task, "battery", 2048, this, BATTERY_TASK_PRIORITY, nullptr,
+                                   tskNO_AFFINITY) == pdPASS;
+  }
   
-  int raw = analogRead(BATTERY_ADC_PIN);
-  batteryVoltage = getBatteryVoltageFromRaw(raw);
+  // Eine Messung (aus dem Task). Rückgabe: Mittelwert der Wandlungen
+  uint16_t sample() {
+    uint32_t sum = 0;
+    uint16_t lowest = UINT16_MAX, highest = 0;
+    for (int i = 0; i < BATTERY_OVERSAMPLE; i++) {
+      uint16_t raw = (uint16_t)analogRead(BATTERY_ADC_PIN);
+      sum += raw;
+      if (raw < lowest) lowest = raw;
+      if (raw > highest) highest = raw;
+    }
+    const int kept = BATTERY_OVERSAMPLE - 2;
+    uint16_t mean = (uint16_t)((sum - lowest - highest + kept / 2) / kept);
+    
+    // Gleitender Mittelwert, erste Messung übernimmt den Wert direkt
+    if (filterX16 == 0) {
+      filterX16 = (uint16_t)(mean * 16);
+    } else {
+      filterX16 = (uint16_t)((filterX16 * 3 + mean * 16 + 2) / 4);
+    }
+    uint32_t count = (published.load(std::memory_order_relaxed) + 1) & 0xF;
+    published.store((uint32_t)filterX16 << 16 | (uint32_t)(mean & 0xFFF) << 4 | count,
+                    std::memory_order_release);
+    return mean;
+  }
   
-  // Prüfen, ob Batterie schwach ist
-  batteryLow = (raw < BATTERY_LOW_RAW_THRESHOLD);
+  // Aus loop(): neue Messung seit dem letzten Aufruf?
+  bool poll(uint16_t &filteredX16, uint16_t &mean) {
+    uint32_t word = published.load(std::memory_order_acquire);
+    if ((word & 0xF) == seen) return false;
+    seen = word & 0xF;
+    filteredX16 = (uint16_t)(word >> 16);
+    mean = (uint16_t)((word >> 4) & 0xFFF);
+    return true;
+  }
+  
+private:
+  static void task(void *arg) {
+    BatterySampler *self = (BatterySampler *)arg;
+    vTaskDelay(pdMS_TO_TICKS(self->firstDelayMs));
+    for (;;) {
+      self->sample();
+      vTaskDelay(pdMS_TO_TICKS(BATTERY_SAMPLE_INTERVAL));
+    }
+  }
+  
+  std::atomic<uint32_t> published{0};  // schreibt nur sample()
+  uint16_t filterX16 = 0;              // nur im Task (bzw. vor dessen Start)
+  uint32_t firstDelayMs = 0;
+  uint8_t seen = 0;                    // nur loop()
+};
+
+BatterySampler batterySampler;
+
+// Übernimmt eine neue Messung des Samplers in die Sitzung und setzt das
+// batteryLow-Flag (aus setup()/loop())
+void serviceBattery() {
+  uint16_t filteredX16, mean;
+  if (!batterySampler.poll(filteredX16, mean)) return;
+  session.batteryRawX16 = filteredX16;
+  session.wakesSinceBattery = 0;
+  applyBatteryFilter();
   
   // Debug-Ausgabe (nur für Entwicklung)
   Serial.print("ADC: ");
-  Serial.print(raw);
-  Serial.print(" | Spannung: ");
+  Serial.print(mean);
+  Serial.print(" (gefiltert ");
+  Serial.print((session.batteryRawX16 + 8) / 16);
+  Serial.print(") | Spannung: ");
   Serial.print(batteryVoltage, 2);
   Serial.print("V | Status: ");
   Serial.println(batteryLow ? "LOW" : "OK");
 }
 
+// =================== AUTHENTISIERUNG ===================
+// Der Zähler in signierten Frames darf sich nie wiederholen, auch nicht
+// nach einem Stromausfall – sonst gälte ein mitgeschnittener Frame wieder.
+// Über den Tiefschlaf läuft er in der RTC-Sitzung weiter. Im NVS steht
+// eine Grenze, bis zu der Zähler schon vergeben sein können; nach einem
+// Kaltstart geht es dort weiter. Geschrieben wird nur einmal je
+// AUTH_COUNTER_BLOCK Frames, und zwar nach dem Senden.
+
+#define AUTH_COUNTER_BLOCK 4096
+#define AUTH_MEASURE_RUNS 32  // Frames für die Zeitmessung beim Kaltstart
+
+LinkKey linkKeyState;       // vorbereiteter Schlüssel (aus LINK_KEY)
+bool linkKeyValid = false;  // false = LINK_KEY ungültig, es wird nichts signiert
+
+// Reserviert die nächsten AUTH_COUNTER_BLOCK Zähler im NVS
+bool reserveAuthCounters() {
+  Preferences prefs;
+  if (!prefs.begin("linkauth", false)) return false;
+  uint32_t limit = session.authCounter + AUTH_COUNTER_BLOCK;
+  bool saved = prefs.putUInt("limit", limit) == sizeof(uint32_t);
+  prefs.end();
+  if (saved) session.authReserved = limit;
+  return saved;
+}
+
+// In setup() vor dem ersten Frame: Schlüssel vorbereiten, nach einem
+// Kaltstart den Zähler hinter der gespeicherten Grenze fortsetzen
+void initLinkAuth() {
+  if (!LINK_AUTH) return;
+  linkKeyValid = linkKeyFromHex(LINK_KEY, linkKeyState);
+  if (!linkKeyValid) reportError("LINK_KEY ungültig (32 Hex-Zeichen) - keine signierten Frames!");
+  if (session.authReserved != 0) return;  // Zähler aus der RTC-Sitzung
+
+  Preferences prefs;
+  uint32_t limit = 0;
+  if (prefs.begin("linkauth", true)) {
+    limit = prefs.getUInt("limit", 0);
+    prefs.end();
+  }
+  session.authCounter = limit != 0 ? limit : 1;  // 0 hat der Empfänger schon "gesehen"
+  reserveAuthCounters();
+}
+
+// Kodiert und signiert einen Frame. Rückgabe: Länge, 0 = kein Schlüssel
+// oder kein Zähler frei
+size_t encodeSignedFrame(const ButtonFrame &frame, uint8_t *out, size_t size) {
+  if (!linkKeyValid) return 0;
+  // Block aufgebraucht (NVS-Fehler): nie über die Reserve hinaus zählen,
+  // der nächste Kaltstart vergäbe dieselben Zähler sonst noch einmal. Ein
+  // STOP geht mit dem zuletzt vergebenen Zähler raus (einen wiederholten
+  // STOP führt der Empfänger aus), alle anderen Befehle unterbleiben.
+  if (session.authCounter >= session.authReserved) {
+    if (frame.command != CMD_STOP) return 0;
+    return encodeAuthFrame(frame, session.authCounter - 1, linkKeyState, out, size);
+  }
+  return encodeAuthFrame(frame, session.authCounter++, linkKeyState, out, size);
+}
+
+// Rechenzeit für Kodieren und Signieren eines Frames (ns, für die Ausgabe)
+uint32_t measureAuthNs() {
+  ButtonFrame frame = {};
+  uint8_t out[MARKISE_AUTH_FRAME_SIZE];
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < AUTH_MEASURE_RUNS; i++) {
+    encodeAuthFrame(frame, (uint32_t)i, linkKeyState, out, sizeof(out));
+  }
+  uint32_t cycles = ESP.getCycleCount() - start;
+  return cycles / AUTH_MEASURE_RUNS * 1000 / ESP.getCpuFreqMHz();
+}
+
 // =================== ESP-NOW FUNKTIONEN ===================
 
+// Kanal eines Empfängers (0 in der Konfiguration = eigener Kanal)
+uint8_t receiverChannel(int index) {
+  return receivers[index].channel != 0 ? receivers[index].channel : session.channel;
+}
+
 // Wird aufgerufen, wenn eine Nachricht gesendet wurde
 void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
+  if (sendsPending > 0) {
+    sendsPending = sendsPending - 1;
+    if (sendsPending == 0) energyTxDone();  // Funk wieder frei
+  }
+  
+  // Zustellstatus beim passenden Empfänger vermerken (Broadcast hat keinen)
+  for (int i = 0; i < RECEIVER_COUNT; i++) {
+    if (memcmp(mac_addr, receivers[i].mac, 6) == 0) {
+      receivers[i].lastFailed = (status != ESP_NOW_SEND_SUCCESS);
+      if (receivers[i].lastFailed) receivers[i].failed++;
+      else receivers[i].delivered++;
+      txPowerResult(!receivers[i].lastFailed);
+      break;
+    }
+  }
+  
   if (status == ESP_NOW_SEND_SUCCESS) {
     // Erfolgreich gesendet - keine weitere Aktion nötig
     // Die LED wird nicht mehr hier gesteuert, das macht jetzt der LEDController
+    lastSendFailed = false;
   } else {
-    // Fehler beim Senden
-    Serial.println("Sendefehler!");
+    // Fehler beim Senden -> loop() wiederholt das Paket
+    lastSendFailed = true;
+    reportError("Sendefehler!");
+    // Hauptschleife wecken, damit sie nicht bis zur nächsten Frist schläft
+    if (loopTaskHandle != nullptr) xTaskNotifyGive(loopTaskHandle);
   }
 }
 
@@ -308,56 +1280,249 @@ void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
 void initESPNOW() {
   // WiFi im Station-Modus (nicht Access Point)
   WiFi.mode(WIFI_STA);
-  WiFi.setTxPower(WIFI_POWER_19_5dBm);  // Maximale Sendeleistung
-  WiFi.setSleep(false);                  // Kein Power-Save (für schnellere Reaktion)
+  txPowerApplied = WIFI_POWER_MINUS_1dBm;  // unbekannt: applyTxPower() stellt sicher ein
+  applyTxPower(false);                     // Stufe aus der RTC-Sitzung (siehe SENDELEISTUNG)
+  WiFi.setSleep(false);                    // Kein Power-Save (für schnellere Reaktion)
   WiFi.disconnect();
   
+  // Kanal aus der RTC-Sitzung wieder einstellen, sonst den aktuellen merken
+  if (session.channel != 0) {
+    esp_wifi_set_channel(session.channel, WIFI_SECOND_CHAN_NONE);
+  } else {
+    session.channel = WiFi.channel();
+  }
+  
   // ESP-NOW initialisieren
   if (esp_now_init() != ESP_OK) {
-    Serial.println("ESP-NOW Init fehlgeschlagen!");
+    reportError("ESP-NOW Init fehlgeschlagen!");
     return;
   }
   
   // Callback für Sendestatus registrieren
   esp_now_register_send_cb(OnDataSent);
   
-  // Empfänger als Peer hinzufügen
+  // Echos der Empfänger (nur im Echo-Modus)
+  if (ECHO_MODE) esp_now_register_recv_cb(OnEchoRecv);
+  
+  // Empfänger als Peers hinzufügen, dazu die Broadcast-Adresse für die Gruppe
   esp_now_peer_info_t peerInfo;
   memset(&peerInfo, 0, sizeof(peerInfo));
-  memcpy(peerInfo.peer_addr, receiverMac, 6);
-  peerInfo.channel = 0;      // Gleichen Kanal wie WiFi nutzen
   peerInfo.encrypt = false;   // Keine Verschlüsselung (für Geschwindigkeit)
   
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    Serial.println("Peer hinzufügen fehlgeschlagen!");
-    return;
+  for (int i = 0; i < RECEIVER_COUNT; i++) {
+    memcpy(peerInfo.peer_addr, receivers[i].mac, 6);
+    peerInfo.channel = receiverChannel(i);  // Kanal fest (wie beim letzten Betrieb)
+    if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+      if (serialReady) Serial.printf("Peer %s hinzufügen fehlgeschlagen!\n", receivers[i].name);
+      else reportError("Peer hinzufügen fehlgeschlagen!");
+    }
+  }
+  if (RECEIVER_COUNT > 1) {
+    memcpy(peerInfo.peer_addr, broadcastMac, 6);
+    peerInfo.channel = 0;  // jeweils aktueller Kanal
+    if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+      reportError("Broadcast-Peer hinzufügen fehlgeschlagen!");
+    }
   }
   
-  Serial.println("ESP-NOW bereit");
+  if (serialReady) Serial.println("ESP-NOW bereit");
+}
+
+// Wartet (kurz) bis alle gesendeten Frames bestätigt sind – vor einem Kanalwechsel
+void waitForPendingSends() {
+  for (int waited = 0; sendsPending > 0 && waited < CHANNEL_SWITCH_WAIT; waited++) {
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+  if (sendsPending > 0) energyTxDone();
+  sendsPending = 0;
+}
+
+// Zuletzt gesendeter Frame, kodiert – ein Fahrbefehl wird unverändert
+// wiederholt (gleiche Sequenz: wer ihn schon hat, verwirft die Kopie, und
+// die Fahrt beginnt nicht ein zweites Mal)
+uint8_t lastFrame[MARKISE_AUTH_FRAME_SIZE];
+size_t lastFrameLen = 0;
+
+// Welche Empfänger betrifft ein Befehl? STOP geht an die Empfänger des
+// laufenden Befehls (bzw. an alle, falls keiner bekannt ist)
+uint8_t receiversFor(uint8_t buttonMask, uint8_t command) {
+  if (command == CMD_STOP) {
+    return activeReceivers != 0 ? activeReceivers : (uint8_t)((1 << RECEIVER_COUNT) - 1);
+  }
+  uint8_t targets = 0;
+  for (int i = 0; i < RECEIVER_COUNT; i++) {
+    if (receivers[i].buttonMask & buttonMask) targets |= (1 << i);
+  }
+  return targets;
+}
+
+// Sendet einen fertig kodierten Frame an die Empfänger in targets:
+// ein Frame pro Kanal – direkt an einen Empfänger oder per Broadcast an mehrere
+void sendToReceivers(uint8_t targets, const uint8_t *frame, size_t frameLen) {
+  lastSendFailed = false;
+  lastSendUnconfirmed = false;
+  uint8_t remaining = targets;
+  bool channelChanged = false;
+  
+  while (remaining != 0) {
+    // Empfänger auf dem Kanal des ersten verbleibenden Empfängers sammeln
+    int first = __builtin_ctz(remaining);
+    uint8_t channel = receiverChannel(first);
+    uint8_t group = 0;
+    for (int i = first; i < RECEIVER_COUNT; i++) {
+      if ((remaining & (1 << i)) && receiverChannel(i) == channel) group |= (1 << i);
+    }
+    remaining &= ~group;
+    
+    if (channel != WiFi.channel()) {
+      waitForPendingSends();
+      esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+      channelChanged = true;
+    }
+    
+    bool single = (group & (group - 1)) == 0;
+    const uint8_t *destination = single ? receivers[first].mac : broadcastMac;
+    if (!single) lastSendUnconfirmed = true;
+    applyTxPower(!single);  // ohne Bestätigung keine Regelung: volle Leistung
+    
+    if (sendsPending == 0) energyTxBegin();
+    sendsPending = sendsPending + 1;
+    if (esp_now_send(destination, frame, frameLen) != ESP_OK) {
+      sendsPending = sendsPending - 1;
+      lastSendFailed = true;
+      reportError("Senden fehlgeschlagen!");
+    }
+  }
+  
+  // Zurück auf den eigenen Kanal
+  if (channelChanged) {
+    waitForPendingSends();
+    esp_wifi_set_channel(session.channel, WIFI_SECOND_CHAN_NONE);
+  }
+}
+
+// Ziel eines Fahrbefehls: Taster Links (1, 3, 5) -> Endlage Linkslauf,
+// Taster Rechts -> Endlage Rechtslauf (Promille, siehe MarkiseProtocol.h)
+uint16_t moveTarget(uint8_t buttonMask) {
+  return (buttonMask & 0x55) ? MOVE_POSITION_MAX : 0;
 }
 
 // Sendet den Tasterstatus per ESP-NOW
-void sendButtonStatus(uint8_t buttonMask) {
+// command: CMD_START (neuer Tastendruck), CMD_RENEW (Lease verlängern),
+// CMD_STOP (Taster losgelassen) oder CMD_MOVE (kurz gedrückt: in die Endlage)
+// eventUs: micros() der auslösenden Taster-Flanke (für das Echo), -1 = keine
+// leaseMs: Lease für START/RENEW (nach dem Aufwecken ggf. gekürzt)
+void sendButtonStatus(uint8_t buttonMask, uint8_t command, int64_t eventUs = -1,
+                      uint16_t leaseMs = COMMAND_LEASE_MS) {
   // Nachricht zusammenstellen
-  myData.buttonMask = buttonMask;
-  myData.batteryVoltage = batteryVoltage;
-  myData.adcRaw = analogRead(BATTERY_ADC_PIN);
+  myData.command = command;
+  myData.flags = ECHO_MODE ? FRAME_FLAG_ECHO : 0;
+  myData.buttonMask = (command == CMD_STOP) ? 0 : buttonMask;
+  myData.leaseMs = (command == CMD_MOVE) ? moveTarget(buttonMask) : leaseMs;
+  myData.batteryMillivolts = (uint16_t)(batteryVoltage * 1000.0f + 0.5f);
+  myData.adcRaw = (session.batteryRawX16 + 8) / 16;  // gefiltert, vom Batterie-Sampler
   myData.sequence = sequenceNumber++;
   myData.rssi = WiFi.RSSI();           // Signalstärke für Diagnose
   myData.timestamp = millis();          // Zeitstempel für Laufzeitanalyse
+  if (ENERGY_REPORT_EVERY != 0 && myData.sequence % ENERGY_REPORT_EVERY == 0) {
+    energyRecord(myData);  // statt adcRaw/rssi ein Datensatz der Energiebilanz
+  }
   
-  // Senden
-  esp_err_t result = esp_now_send(receiverMac, (uint8_t*)&myData, sizeof(myData));
+  // Kodieren (gepackt, little-endian, mit CRC, ggf. signiert) und an die
+  // betroffenen Empfänger senden
+  lastFrameLen = LINK_AUTH ? encodeSignedFrame(myData, lastFrame, sizeof(lastFrame))
+                           : encodeFrame(myData, lastFrame, sizeof(lastFrame));
+  uint8_t targets = receiversFor(buttonMask, command);
+  if (lastFrameLen == 0) {
+    // Nicht signiert (Schlüssel ungültig, kein Zähler reserviert): nichts
+    // senden, auch keine Wiederholung
+    lastSendFailed = false;
+    lastSendUnconfirmed = false;
+    reportError("Frame nicht signiert (Schlüssel/Zähler) - Befehl nicht gesendet!");
+  } else {
+    if (ECHO_MODE) rememberCommand(myData.sequence, command, (uint32_t)esp_timer_get_time(), eventUs);
+    sendToReceivers(targets, lastFrame, lastFrameLen);
+  }
+  activeReceivers = targets;  // STOP-Wiederholungen gehen an dieselben Empfänger
   
-  if (result != ESP_OK) {
-    Serial.println("Senden fehlgeschlagen!");
+  // Nächsten Zählerblock rechtzeitig reservieren – erst nach dem Senden,
+  // der Flash-Zugriff verzögert so keinen Befehl (authCounter ist nie
+  // größer als authReserved)
+  if (LINK_AUTH && session.authCounter + AUTH_COUNTER_BLOCK / 2 > session.authReserved) {
+    reserveAuthCounters();
   }
 }
 
+// =================== LIGHT SLEEP ===================
+// Zwischen zwei Ereignissen schläft der Sender im Light Sleep, statt den
+// Task nur warten zu lassen: CPU und Funk stehen, RAM, WiFi-Konfiguration
+// und ESP-NOW-Peers bleiben erhalten. Geweckt wird durch einen Taster (GPIO,
+// Pegel LOW) oder zur nächsten Frist der Hauptschleife (Timer). Danach ist
+// ESP-NOW ohne neues Init sendebereit; das Aufwachen dauert etwa 1 ms.
+//
+// Im Schlaf sind die Flanken-Interrupts der Taster aus (die Pegel-Aufweckung
+// nutzt dieselbe GPIO-Logik). Danach werden sie wieder eingeschaltet und die
+// Taster einmal gelesen; ein Tastendruck im Schlaf bekommt die Aufweckzeit
+// als Flanke.
+
+uint32_t lightSleepCount = 0;
+uint64_t lightSleepUs = 0;  // Summe der Schlafzeiten
+
+// Schläft höchstens waitMs. Rückgabe: false = nicht geschlafen (ein Taster
+// ist gedrückt und würde sofort wieder wecken)
+bool lightSleepIdle(unsigned long waitMs) {
+  for (int i = 0; i < BUTTON_COUNT; i++) {
+    if (digitalRead(buttonPins[i]) == LOW) return false;
+  }
+  Serial.flush();  // die UART steht im Schlaf
+  energyUpdate();  // Wachzeit bis hier
+  
+  for (int i = 0; i < BUTTON_COUNT; i++) {
+    gpio_intr_disable((gpio_num_t)buttonPins[i]);
+    gpio_wakeup_enable((gpio_num_t)buttonPins[i], GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)waitMs * 1000ULL);
+  
+  int64_t startUs = esp_timer_get_time();
+  esp_light_sleep_start();
+  int64_t wakeUs = esp_timer_get_time();
+  energyLightSleep(startUs, wakeUs);
+  
+  // Aufweckquellen wieder abmelden (der Tiefschlaf weckt nur über ext1)
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  for (int i = 0; i < BUTTON_COUNT; i++) {
+    gpio_wakeup_disable((gpio_num_t)buttonPins[i]);
+    gpio_set_intr_type((gpio_num_t)buttonPins[i], GPIO_INTR_ANYEDGE);  // wie attachInterrupt(CHANGE)
+    gpio_intr_enable((gpio_num_t)buttonPins[i]);
+  }
+  // Vom Taster geweckt: Sperrzeit für alle (er kann schon wieder losgelassen
+  // sein); nach dem Timer war kein Taster gedrückt, der Pegel-Weckruf hätte
+  // sonst zuerst geweckt
+  buttons.resyncAll((uint32_t)micros(), esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER);
+  
+  lightSleepCount++;
+  lightSleepUs += (uint64_t)(wakeUs - startUs);
+  return true;
+}
+
+void printLightSleep() {
+  if (lightSleepCount == 0) return;
+  Serial.printf("Light Sleep: %lu-mal, %lu ms von %lu ms wach\n", (unsigned long)lightSleepCount,
+                (unsigned long)(lightSleepUs / 1000), (unsigned long)millis());
+}
+
 // =================== DEEP SLEEP FUNKTIONEN ===================
 
 // Versetzt den ESP in den Tiefschlaf
 void goToDeepSleep() {
+  printPressLatency();
+  printEchoLatency();
+  printTxPower();
+  printLightSleep();
+  printEnergy();
+  saveSession();  // Sequenznummer und Batteriewert für das nächste Aufwecken
   Serial.println("Gehe in Tiefschlaf...");
   delay(100);  // Kurze Wartezeit für letzte Serial-Ausgaben
   Serial.flush();
@@ -369,19 +1534,84 @@ void goToDeepSleep() {
   digitalWrite(LED_RED_PIN, LOW);
   digitalWrite(LED_GREEN_PIN, LOW);
   digitalWrite(LED_BLUE_PIN, LOW);
+  energyLed(false);
   
   // In Tiefschlaf gehen
+  energyDeepSleep();
   esp_deep_sleep_start();
 }
 
 // =================== SETUP ===================
 // Wird einmal beim Start ausgeführt
 
+// Welcher Taster hat den ESP aus dem Tiefschlaf geweckt?
+// Rückgabe: Bitmaske (wie readButtons), 0 = kein Taster-Aufwecken
+uint8_t getWakeButtonMask() {
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT1) return 0;
+  uint64_t status = esp_sleep_get_ext1_wakeup_status();
+  uint8_t mask = 0;
+  for (int i = 0; i < BUTTON_COUNT; i++) {
+    if (status & (1ULL << buttonPins[i])) mask |= (1 << i);
+  }
+  return mask;
+}
+
 void setup() {
+  bootMark("setup()");
+  
+  // Sitzung aus dem RTC-Speicher (Sequenznummer, Kanal, Batterie)
+  sessionRestored = restoreSession();
+  if (sessionRestored) applyBatteryFilter();
+  energyWake();  // Tiefschlaf in die Energiebilanz
+  initLinkAuth();  // vor dem ersten Frame (nach dem Aufwecken ohne Flash-Zugriff)
+  
+  // Schneller Weg nach dem Aufwecken durch genau einen Taster:
+  // Funk zuerst, Befehl sofort senden, alles andere danach. Auch ein kurzes
+  // Antippen ergibt so einen Befehl (loop() schickt gleich danach STOP).
+  uint8_t wakeMask = getWakeButtonMask();
+  bool fastWake = (wakeMask != 0 && (wakeMask & (wakeMask - 1)) == 0);
+  bool wakeReleased = false;
+  if (fastWake) {
+    initESPNOW();
+    bootMark("ESP-NOW bereit");
+    // Taster während des Starts: Kam ein zweiter dazu, gilt wie in loop()
+    // "mehrere Taster" und es geht kein START hinaus. Ist der Taster schon
+    // wieder los, darf die Lease nicht über Loslassen + COMMAND_LEASE_MS
+    // hinausreichen (geht der STOP verloren, liefe der Motor sonst länger
+    // nach). Losgelassen wurde frühestens beim Aufwecken.
+    uint8_t heldMask = 0;
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+      pinMode(buttonPins[i], INPUT_PULLUP);
+      if (digitalRead(buttonPins[i]) == LOW) heldMask |= (1 << i);
+    }
+    uint16_t leaseMs = COMMAND_LEASE_MS;
+    if ((heldMask & ~wakeMask) != 0) {
+      leaseMs = 0;
+      wakeChord = true;
+    } else if (heldMask == 0) {
+      wakeReleased = true;
+      uint32_t sinceWakeMs = WAKE_BOOT_MS + (uint32_t)((esp_timer_get_time() + 999) / 1000);
+      leaseMs = sinceWakeMs < COMMAND_LEASE_MS ? (uint16_t)(COMMAND_LEASE_MS - sinceWakeMs) : 0;
+    }
+    if (leaseMs >= LEASE_MIN_MS) {
+      sendButtonStatus(wakeMask, CMD_START, 0, leaseMs);  // Flanke = Aufwecken (esp_timer 0)
+      wakeCommandMask = wakeMask;
+      wakeCommandTime = millis();
+      // Aufwecken -> erster Frame; esp_timer zählt erst ab dem Start der App
+      recordPressLatency((uint32_t)esp_timer_get_time() + WAKE_BOOT_MS * 1000UL);
+      bootMark("erster Frame gesendet");
+    }
+  }
+  
   // Serielle Kommunikation für Debug-Ausgaben starten
   Serial.begin(115200);
-  delay(100);
+  serialReady = true;
+  if (!fastWake) delay(100);  // nur beim Kaltstart auf den seriellen Monitor warten
   Serial.println("\n\n=== Markisensteuerung Sender (Optimiert) ===");
+  if (bootErrorCount != 0) {
+    Serial.printf("Vor dem Start von Serial: %u Fehler, zuletzt \"%s\"\n", (unsigned)bootErrorCount, bootError);
+  }
+  bootMark("Serial");
   
   // LED-Pins als Ausgänge konfigurieren
   pinMode(LED_RED_PIN, OUTPUT);
@@ -389,22 +1619,57 @@ void setup() {
   pinMode(LED_BLUE_PIN, OUTPUT);
   
   // Taster-Pins als Eingänge mit Pull-Up konfigurieren
-  for (int i = 0; i < 6; i++) {
+  for (int i = 0; i < BUTTON_COUNT; i++) {
     pinMode(buttonPins[i], INPUT_PULLUP);
     Serial.printf("Taster %d an GPIO %d\n", i + 1, buttonPins[i]);
   }
   
-  // Batterie messen
-  logBatteryStatus();
+  // Taster-Interrupts anmelden; sie wecken den Task von loop()
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  buttons.begin(onButtonEdge);
+  bootMark("Taster");
   
-  // ESP-NOW initialisieren
-  initESPNOW();
+  // Batterie im Hintergrund messen – nach dem Aufwecken gleich nur ab und
+  // zu, sonst gilt zunächst der gefilterte Wert aus der Sitzung
+  bool measureNow = !sessionRestored || ++session.wakesSinceBattery >= BATTERY_MEASURE_EVERY_WAKES;
+  if (!batterySampler.begin(session.batteryRawX16, measureNow)) {
+    Serial.println("Batterie-Task konnte nicht gestartet werden!");
+  }
+  if (!sessionRestored) {
+    serviceBattery();  // Kaltstart: begin() hat synchron gemessen
+    bootMark("Batterie");
+    if (LINK_AUTH) {
+      Serial.printf("Signierte Frames: Zähler ab %lu, Signieren %u ns je Frame%s%s\n",
+                    (unsigned long)session.authCounter, (unsigned)measureAuthNs(),
+                    linkAuthSelfTest() ? "" : " - SELBSTTEST FEHLGESCHLAGEN!",
+                    linkKeyValid ? "" : " - KEIN GÜLTIGER SCHLÜSSEL!");
+    }
+  } else {
+    Serial.printf("Sitzung #%lu: Sequenz %u, Kanal %u, Batterie %.2fV (gespeichert)\n",
+                  (unsigned long)session.bootCount, sequenceNumber, session.channel, batteryVoltage);
+  }
+  
+  // ESP-NOW initialisieren (nach dem Aufwecken schon geschehen)
+  if (!fastWake) {
+    initESPNOW();
+    bootMark("ESP-NOW bereit");
+  }
   
   // Startzeit für Inaktivitäts-Timeout setzen
   lastButtonPressTime = millis();
   
+  if (fastWake) {
+    const char *result = "START gesendet";
+    if (wakeChord) result = "mehrere Taster, kein START";
+    else if (wakeReleased) result = wakeCommandMask != 0 ? "schon losgelassen, START mit kurzer Lease"
+                                                         : "schon losgelassen, kein START";
+    Serial.printf("Aufgeweckt durch Taster %d - %s\n", buttons.getButtonIndex(wakeMask) + 1, result);
+  }
+  printBootTimeline();
+  
   Serial.println("Bereit - warte auf Tastendruck...");
   Serial.println("=====================================\n");
+  energyBootDone();
 }
 
 // =================== LOOP ===================
@@ -412,25 +1677,44 @@ void setup() {
 
 void loop() {
   // Statische Variablen (behalten ihren Wert zwischen den Aufrufen)
-  static ButtonReader buttons;           // Taster-Logik
   static LEDController led;              // LED-Logik
   static unsigned long lastSendTime = 0; // Letzte Sendung
   static uint8_t currentMask = 0;        // Aktuell gedrückte Taster
   static unsigned long holdStartTime = 0;// Wann wurde der Taster gedrückt?
-  static unsigned long lastBatteryCheck = 0;
+  static uint8_t stopRetriesLeft = 0;    // Wiederholungen für einen nicht zugestellten STOP
+  static uint8_t releaseCommand = CMD_STOP; // ... bzw. Fahrbefehl (CMD_MOVE)
+  static bool waitForRelease = false;    // Nach Sicherheits-Stopp erst wieder nach Loslassen
   
   unsigned long now = millis();  // Aktuelle Zeit
   
   // 1. LED aktualisieren (nicht-blockierend!)
   led.update();
   
-  // 2. Taster einlesen (nicht-blockierend!)
+  // 2. Taster einlesen (Flanken aus den Interrupts verarbeiten)
   uint8_t newMask = buttons.readButtons();
   
-  // 3. Batterie regelmäßig prüfen (alle 60 Sekunden)
-  if (now - lastBatteryCheck > 60000) {
-    logBatteryStatus();
-    lastBatteryCheck = now;
+  // Nach einem Sicherheits-Stopp gilt ein Taster erst nach dem Loslassen
+  // wieder, ebenso nach mehreren Tastern beim Aufwecken (siehe setup())
+  if (wakeChord) {
+    wakeChord = false;
+    waitForRelease = true;
+  }
+  if (waitForRelease) {
+    if (newMask != 0) newMask = 0;
+    else waitForRelease = false;
+  }
+  
+  // 3. Neue Batterie-Messung übernehmen (misst der Sampler im Hintergrund)
+  serviceBattery();
+  
+  // Nach dem Aufwecken hat setup() den START schon gesendet -> übernehmen
+  if (wakeCommandMask != 0) {
+    currentMask = wakeCommandMask;
+    holdStartTime = wakeCommandTime;
+    lastSendTime = wakeCommandTime;
+    lastButtonPressTime = wakeCommandTime;
+    wakeCommandMask = 0;
+    led.setMode(batteryLow ? 3 : 2);
   }
   
   // 4. Taster-Logik
@@ -449,9 +1733,14 @@ void loop() {
         // Kurze Rückmeldung: LED kurz grün blinken lassen
         led.setMode(1);
         
-        // Sofort senden (für sofortige Reaktion)
-        sendButtonStatus(currentMask);
+        // Sofort senden (für sofortige Reaktion) – beginnt die Lease
+        sendButtonStatus(currentMask, CMD_START, buttons.pressTime(buttons.getButtonIndex(currentMask)));
+        uint32_t latencyUs = (uint32_t)micros() - buttons.pressTime(buttons.getButtonIndex(currentMask));
+        recordPressLatency(latencyUs);
         lastSendTime = now;
+        stopRetriesLeft = 0;
+        Serial.printf("Taster %d: START nach %lu us\n", buttons.getButtonIndex(currentMask) + 1,
+                      (unsigned long)latencyUs);
         
         // LED-Modus basierend auf Batteriestatus setzen
         if (batteryLow) {
@@ -461,9 +1750,10 @@ void loop() {
         }
       } else {
         // Gleicher Taster wird weiterhin gehalten
-        // Periodisch senden (für flüssigen Motorlauf)
-        if (now - lastSendTime >= HOLD_SEND_INTERVAL) {
-          sendButtonStatus(currentMask);
+        // Lease rechtzeitig erneuern – nach einem Sendefehler sofort nochmal
+        if (now - lastSendTime >= HOLD_SEND_INTERVAL ||
+            (lastSendFailed && now - lastSendTime >= SEND_RETRY_INTERVAL)) {
+          sendButtonStatus(currentMask, CMD_RENEW);
           lastSendTime = now;
         }
         
@@ -471,7 +1761,11 @@ void loop() {
         if (now - holdStartTime > BUTTON_HOLD_TIMEOUT) {
           Serial.println("Sicherheits-Timeout: Taster zu lange gedrückt!");
           currentMask = 0;
-          sendButtonStatus(0);
+          waitForRelease = true;
+          sendButtonStatus(0, CMD_STOP);
+          lastSendTime = now;
+          stopRetriesLeft = STOP_RETRIES;
+          releaseCommand = CMD_STOP;
           led.setMode(0);
         }
       }
@@ -480,440 +1774,81 @@ void loop() {
       if (currentMask != 0) {
         Serial.println("Mehrere Taster gedrückt - Befehl ignoriert!");
         currentMask = 0;
-        sendButtonStatus(0);
+        waitForRelease = true;
+        sendButtonStatus(0, CMD_STOP);
+        lastSendTime = now;
+        stopRetriesLeft = STOP_RETRIES;
+        releaseCommand = CMD_STOP;
         led.setMode(0);
       }
     }
   } else {
     // KEIN Taster gedrückt
     if (currentMask != 0) {
-      // Taster wurde losgelassen -> Stop-Signal senden
-      Serial.println("Taster losgelassen - Stop");
-      sendButtonStatus(0);
+      // Taster wurde losgelassen -> Stop-Signal sofort senden, nach einem
+      // kurzen Druck stattdessen den Fahrbefehl in die Endlage
+      int index = buttons.getButtonIndex(currentMask);
+      uint32_t heldUs = buttons.changeTime(index) - buttons.pressTime(index);
+      releaseCommand = (TAP_TRAVEL_MS != 0 && heldUs < TAP_TRAVEL_MS * 1000UL) ? CMD_MOVE : CMD_STOP;
+      if (releaseCommand == CMD_MOVE) {
+        Serial.printf("Taster %d kurz gedrückt - Fahrt in die Endlage\n", index + 1);
+        sendButtonStatus(currentMask, CMD_MOVE, buttons.changeTime(index));
+      } else {
+        Serial.println("Taster losgelassen - Stop");
+        sendButtonStatus(0, CMD_STOP, buttons.changeTime(index));
+      }
+      lastSendTime = now;
+      stopRetriesLeft = STOP_RETRIES;
       currentMask = 0;
       led.setMode(0);
       lastButtonPressTime = now;  // Zeit für Inaktivitäts-Timeout zurücksetzen
     }
   }
   
-  // 5. Inaktivitäts-Timeout prüfen
+  // 5. Nicht zugestellten STOP wiederholen (sonst läuft der Motor bis zum Lease-Ende)
+  // Per Broadcast gibt es keine Bestätigung: dann immer wiederholen.
+  // Ein Fahrbefehl geht unverändert noch einmal raus (siehe lastFrame).
+  if (currentMask == 0 && stopRetriesLeft > 0 && (lastSendFailed || lastSendUnconfirmed) &&
+      now - lastSendTime >= SEND_RETRY_INTERVAL) {
+    stopRetriesLeft--;
+    if (releaseCommand == CMD_MOVE) {
+      sendToReceivers(activeReceivers, lastFrame, lastFrameLen);
+    } else {
+      sendButtonStatus(0, CMD_STOP);
+    }
+    lastSendTime = now;
+  }
+  
+  // 6. Inaktivitäts-Timeout prüfen
   if (currentMask == 0 && (now - lastButtonPressTime) > (INACTIVITY_TIMEOUT * 1000UL)) {
     Serial.println("Inaktivitäts-Timeout - Gehe in Tiefschlaf");
     goToDeepSleep();
   }
   
-  // 6. Kleine Pause zur CPU-Entlastung
-  // Wichtig: Nur 5ms statt 50ms für bessere Reaktionszeit!
-  delay(LOOP_DELAY);
-}
-#define LED_GREEN_PIN 11
-#define LED_BLUE_PIN  12
-
-// Batterie-Messung (ADC-Pin, an VBAT-Teiler des T-Energy S3)
-#define BATTERY_ADC_PIN 3
-
-// =================== ESP-NOW KONFIGURATION ===================
-
-// MAC-Adresse des Empfängers (ESP32 WROOM)
-uint8_t receiverMac[] = {0xFC, 0xF5, 0xC4, 0x67, 0xA8, 0xE4};
-
-// Nachrichtenstruktur – muss exakt zur Empfängerseite passen
-typedef struct struct_message {
-  uint8_t buttonMask;      // Bit 0-5: Taster 1-6
-  float   batteryVoltage;  // Batteriespannung in Volt (nur Info)
-  uint8_t sequence;        // Sequenznummer
-  int16_t adcRaw;          // Rohwert
-} struct_message;
-
-struct_message myData;
-
-// =================== GLOBALE VARIABLEN ===================
-
-unsigned long lastButtonPress = 0;  // Zeitpunkt des letzten erkkannten Tastendrucks
-bool   awakeFromSleep = false;
-float  batteryVoltage = 0.0;
-uint8_t sequenceNumber = 0;
-
-// Akku-Status
-bool batteryLow = false;   // wird aus ADC-Rohwert abgeleitet
-
-// =================== LED-FUNKTIONEN ===================
-
-void initLEDs() {
-  pinMode(LED_RED_PIN, OUTPUT);
-  pinMode(LED_GREEN_PIN, OUTPUT);
-  pinMode(LED_BLUE_PIN, OUTPUT);
-
-  // Alle LEDs aus (gemeinsame Kathode -> LOW = AUS)
-  digitalWrite(LED_RED_PIN, LOW);
-  digitalWrite(LED_GREEN_PIN, LOW);
-  digitalWrite(LED_BLUE_PIN, LOW);
-}
-
-/**
- * Setzt die RGB-LED Farbe
- * Common Cathode: HIGH = LED an, LOW = aus.
- */
-void setLEDColor(bool red, bool green, bool blue) {
-  digitalWrite(LED_RED_PIN,   red   ? HIGH : LOW);
-  digitalWrite(LED_GREEN_PIN, green ? HIGH : LOW);
-  digitalWrite(LED_BLUE_PIN,  blue  ? HIGH : LOW);
-}
-
-// Aufwachen (einmaliger kurzer Cyan-Puls – mit delay, aber nur im Setup)
-void ledStatusAwake() {
-  setLEDColor(false, true, true);  // Cyan
-  delay(100);
-  setLEDColor(false, false, false);
-}
-
-// Taster OK – kurzer Grün-Blink
-void ledStatusButtonOK() {
-  setLEDColor(false, true, false);  // Grün
-}
-
-// Mehrfach-Taster Fehler – kurze rote Anzeige
-void ledStatusMultiButtonError() {
-  setLEDColor(true, false, false);  // Rot
-}
-
-// Sendebestätigung – wieder aus
-void ledStatusSendSuccess() {
-  setLEDColor(false, false, false);
-}
-
-// Sendefehler – kurze rote Anzeige
-void ledStatusSendError() {
-  setLEDColor(true, false, false);
-  delay(150);
-  setLEDColor(false, false, false);
-}
-
-// Inaktiv-Timeout (Cyan 1 s) – nur beim Übergang in Sleep
-void ledStatusInactivityTimeout() {
-  setLEDColor(false, true, true);
-  delay(1000);
-  setLEDColor(false, false, false);
-}
-
-// =================== BATTERIE-FUNKTIONEN ===================
-
-/**
- * Rechnet ADC-Rohwert in Spannung um.
- */
-float getBatteryVoltageFromRaw(int raw) {
-  const float K = 0.00172f;  // Volt pro ADC-Step (wird später neu kalibriert)
-  return raw * K;
-}
-
-/**
- * Loggt Spannung und setzt batteryLow-Flag anhand des ADC-Rohwerts.
- * Nur EINE Messung, die für alles verwendet wird.
- */
-void logBatteryStatus() {
-  pinMode(BATTERY_ADC_PIN, INPUT_PULLDOWN);
-  delay(10);
-
-  int raw = analogRead(BATTERY_ADC_PIN);
-
-  Serial.print("ADC raw: ");
-  Serial.println(raw);
-
-  batteryVoltage = getBatteryVoltageFromRaw(raw);
-
-  Serial.print("Batteriespannung (nur Info): ");
-  Serial.print(batteryVoltage, 2);
-  Serial.println(" V");
-
-  // Schwelle: ADC-Rohwert < BATTERY_LOW_RAW_THRESHOLD => "low"
-  batteryLow = (raw < BATTERY_LOW_RAW_THRESHOLD);
-
-  Serial.print("batteryLow = ");
-  Serial.println(batteryLow ? "true" : "false");
-}
-
-// =================== ESP-NOW-FUNKTIONEN ===================
-
-/**
- * Callback nach Sendeversuch (ESP-NOW).
- * - Erfolg  -> LED aus
- * - Fehler  -> Rot (kurz)
- */
-void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("Sendestatus: ");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Erfolg" : "Fehler");
-
-  if (status == ESP_NOW_SEND_SUCCESS) {
-    ledStatusSendSuccess();
-  } else {
-    ledStatusSendError();
-  }
-}
-
-/**
- * Initialisiert ESP-NOW im STA-Mode und trägt den Empfänger als Peer ein.
- */
-void initESPNOW() {
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
-
-  if (esp_now_init() != ESP_OK) {
-    Serial.println("ESP-NOW Init fehlgeschlagen!");
-    ledStatusSendError();
-    return;
+  // 7. Warten bis zum nächsten Taster-Interrupt oder zur nächsten Frist
+  //    (statt alle 5ms die Pins abzufragen)
+  unsigned long waitMs = LOOP_MAX_WAIT;
+  if (led.isAnimating() || buttons.debouncePending()) {
+    waitMs = LOOP_DELAY;
   }
-
-  esp_now_register_send_cb(OnDataSent);
-
-  // Empfänger-Peer hinzufügen
-  esp_now_peer_info_t peerInfo;
-  memset(&peerInfo, 0, sizeof(peerInfo));
-  memcpy(peerInfo.peer_addr, receiverMac, 6);
-  peerInfo.channel = 0;   // gleichen Kanal wie STA benutzen
-  peerInfo.encrypt = false;
-
-  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-    Serial.println("Peer hinzufügen fehlgeschlagen!");
-    ledStatusSendError();
-    return;
-  }
-
-  Serial.println("ESP-NOW initialisiert");
-  Serial.print("Empfänger MAC: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", receiverMac[i]);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
-}
-
-/**
- * Sendet Tasterstatus per ESP-NOW.
- * @param buttonMask Bitmaske der gedrückten Taster
- */
-void sendButtonStatus(uint8_t buttonMask) {
-  // Nicht senden, wenn mehrere Taster gedrückt (Sicherheit)
-  if (buttonMask != 0 && (buttonMask & (buttonMask - 1)) != 0) {
-    Serial.println("Mehrere Taster gedrückt - sende NICHT!");
-    ledStatusMultiButtonError();
-    return;
-  }
-
-  myData.buttonMask     = buttonMask;
-  myData.batteryVoltage = batteryVoltage;          // nur Info
-  myData.adcRaw         = analogRead(BATTERY_ADC_PIN);
-  myData.sequence       = sequenceNumber++;
-
-  esp_err_t result = esp_now_send(receiverMac, (uint8_t*)&myData, sizeof(myData));
-
-  if (result == ESP_OK) {
-    Serial.println("Senden gestartet");
+  if (currentMask != 0) {
+    unsigned long sinceSend = now - lastSendTime;
+    unsigned long interval = lastSendFailed ? SEND_RETRY_INTERVAL : HOLD_SEND_INTERVAL;
+    waitMs = min(waitMs, sinceSend < interval ? interval - sinceSend : 0UL);
+  } else if (stopRetriesLeft > 0 && (lastSendFailed || lastSendUnconfirmed)) {
+    waitMs = min(waitMs, (unsigned long)SEND_RETRY_INTERVAL);
   } else {
-    Serial.println("Fehler beim Senden (esp_now_send)");
-    ledStatusSendError();
-  }
-}
-
-// =================== TASTER-FUNKTIONEN ===================
-
-/**
- * Liest alle Taster ein (entprellt) und liefert eine Bitmaske.
- * Bit 0-5: Taster 1-6 (1 = gedrückt).
- */
-uint8_t readButtons() {
-  uint8_t mask = 0;
-  int pressedCount = 0;
-
-  for (int i = 0; i < 6; i++) {
-    if (digitalRead(buttonPins[i]) == LOW) {
-      delay(DEBOUNCE_DELAY);
-      if (digitalRead(buttonPins[i]) == LOW) {
-        mask |= (1 << i);
-        pressedCount++;
-      }
-    }
-  }
-
-  if (pressedCount > 1) {
-    Serial.print("WARNUNG: ");
-    Serial.print(pressedCount);
-    Serial.println(" Taster gleichzeitig gedrückt!");
-    ledStatusMultiButtonError();
-  }
-
-  return mask;
-}
-
-/**
- * Prüft Taster und sendet solange periodisch, wie EIN Taster gehalten wird.
- * LED-Feedback während des Haltens:
- * - Akku OK: grün dauerhaft
- * - Akku LOW: blau/rot blinkend
- */
-void checkButtonsAndSend() {
-  uint8_t buttonMask = readButtons();
-
-  if (buttonMask != 0) {
-    // Mehrere Taster – keine Aktion (Fehler ist schon angezeigt)
-    if ((buttonMask & (buttonMask - 1)) != 0) {
-      Serial.println("Mehrere Taster - keine Aktion");
-    } else {
-      int buttonIndex = 0;
-      while (!(buttonMask & (1 << buttonIndex))) {
-        buttonIndex++;
-      }
-
-      Serial.print("Taster ");
-      Serial.print(buttonIndex + 1);
-      Serial.println(" gedrückt (einzeln)");
-
-      // kurzer grüner Blink als „Taster erkannt“
-      ledStatusButtonOK();
-      delay(80);
-      setLEDColor(false, false, false);
-
-      // Einmal senden (auch bei kurzem Tastendruck)
-      sendButtonStatus(1 << buttonIndex);
-
-      unsigned long pressStart = millis();
-      unsigned long lastSend   = millis();
-      unsigned long lastBlink  = 0;
-      bool blinkState = false;
-
-      // Solange der Taster gehalten wird, weiter senden (Motor EIN)
-      while ((readButtons() & (1 << buttonIndex)) &&
-             ((millis() - pressStart) < BUTTON_HOLD_TIMEOUT)) {
-
-        unsigned long now = millis();
-
-        // 1) Senden in gewohnter Rate
-        if (now - lastSend >= HOLD_SEND_INTERVAL) {
-          sendButtonStatus(1 << buttonIndex);
-          lastSend = now;
-        }
-
-        // 2) LED-Anzeige während des Haltens
-        if (batteryLow) {
-          // Akku LOW: blau/rot im Wechsel blinken
-          if (now - lastBlink >= 250) {
-            lastBlink = now;
-            blinkState = !blinkState;
-            if (blinkState) {
-              setLEDColor(false, false, true);  // Blau
-            } else {
-              setLEDColor(true, false, false);  // Rot
-            }
-          }
-        } else {
-          // Akku OK: LED einfach dauerhaft grün
-          setLEDColor(false, true, false);
-        }
-
-        delay(10);
-      }
-
-      // Nach Loslassen (oder Timeout) -> LED aus, "alles aus"-Paket senden
-      setLEDColor(false, false, false);
-      sendButtonStatus(0);
-    }
-
-    lastButtonPress = millis();
-  }
-}
-
-// =================== DEEP SLEEP-FUNKTIONEN ===================
-
-/**
- * Geht in Deep Sleep, Taster als Wake-Quelle (ANY_LOW).
- */
-void goToDeepSleep() {
-  Serial.println("Gehe in Deep Sleep...");
-  ledStatusInactivityTimeout();
-  delay(1100);
-
-  Serial.flush();
-
-  esp_sleep_enable_ext1_wakeup(buttonBitMask, ESP_EXT1_WAKEUP_ANY_LOW);
-
-  setLEDColor(false, false, false);
-  esp_deep_sleep_start();
-}
-
-// =================== SETUP ===================
-
-void setup() {
-  Serial.begin(115200);
-  delay(100);
-  Serial.println("\n\n=== ESP32-Sender Markisensteuerung ===");
-
-  initLEDs();
-
-  esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
-
-  switch (wakeup_reason) {
-    case ESP_SLEEP_WAKEUP_EXT1: {
-      Serial.println("Aufgewacht durch Tastendruck");
-      awakeFromSleep = true;
-      ledStatusAwake();
-
-      uint64_t wakeup_pin_mask = esp_sleep_get_ext1_wakeup_status();
-      Serial.print("Geweckt von GPIO: ");
-      for (int i = 0; i < 6; i++) {
-        if (wakeup_pin_mask & (1ULL << buttonPins[i])) {
-          Serial.print(buttonPins[i]);
-          Serial.print(" ");
-        }
-      }
-      Serial.println();
-      break;
+    unsigned long idle = now - lastButtonPressTime;
+    unsigned long timeout = INACTIVITY_TIMEOUT * 1000UL;
+    waitMs = min(waitMs, idle <= timeout ? timeout - idle + 1 : 0UL);  // Tiefschlaf erst bei idle > timeout
+    
+    // Nichts läuft: Light Sleep statt Warten (nicht direkt nach dem Senden,
+    // dann kommen noch Bestätigung und ggf. Echo)
+    if (LIGHT_SLEEP_IDLE && waitMs >= LIGHT_SLEEP_MIN_MS && !led.isAnimating() &&
+        !buttons.debouncePending() && sendsPending == 0 &&
+        now - lastSendTime >= LIGHT_SLEEP_AFTER_SEND && lightSleepIdle(waitMs)) {
+      return;
     }
-
-    case ESP_SLEEP_WAKEUP_TIMER:
-      Serial.println("Aufgewacht durch Timer");
-      ledStatusAwake();
-      break;
-
-    default:
-      Serial.println("Neustart (Power-On Reset)");
-      ledStatusAwake();
-      break;
-  }
-
-  for (int i = 0; i < 6; i++) {
-    pinMode(buttonPins[i], INPUT_PULLUP);
-    Serial.printf("Taster %d an GPIO %d\n", i + 1, buttonPins[i]);
-  }
-
-  // Batterie nur zum Start loggen (setzt auch batteryLow-Flag)
-  logBatteryStatus();
-
-  initESPNOW();
-
-  lastButtonPress = millis();
-
-  Serial.println("System bereit - warte auf Tastendruck...");
-  Serial.printf("Inaktivitäts-Timeout: %d Sekunden\n", INACTIVITY_TIMEOUT);
-  Serial.println("=====================================\n");
-
-  delay(500);
-}
-
-// =================== LOOP ===================
-
-void loop() {
-  checkButtonsAndSend();
-
-  static unsigned long lastBatteryCheck = 0;
-  if (millis() - lastBatteryCheck > 60000) {
-    // Batterie periodisch loggen (nur Info, setzt batteryLow)
-    logBatteryStatus();
-    lastBatteryCheck = millis();
   }
-
-  if ((millis() - lastButtonPress) > (INACTIVITY_TIMEOUT * 1000UL)) {
-    Serial.printf("Inaktivitäts-Timeout (%d Sekunden) erreicht\n", INACTIVITY_TIMEOUT);
-    goToDeepSleep();
-  }
-
-  delay(50);
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 }
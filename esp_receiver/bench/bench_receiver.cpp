@@ -0,0 +1,406 @@
+/**
+ * Mikro-Benchmarks für den Empfänger (nur native-Build)
+ *
+ * Die Firmware wird direkt eingebunden, damit auch Funktionen und Daten
+ * aus src/main.cpp ohne eigenen Header erreichbar sind. Hardware-Zugriffe
+ * laufen gegen NativeShim (lib/NativeShim).
+ *
+ * Aufruf:  pio run -e native -t exec
+ *          (Optionen: --rounds=N --min-round-ms=N)
+ */
+
+#include "../src/main.cpp"
+
+#include "MicroBench.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Fremder Absender (z.B. ein anderes ESP-NOW-Gerät in der Nachbarschaft)
+const uint8_t foreignMac[6] = {0x24, 0x6F, 0x28, 0x11, 0x22, 0x33};
+
+// Signierender Sender (LINK_AUTH), zusätzlich zu knownSenders[]
+const uint8_t signedMac[6] = {0x20, 0x6E, 0xF1, 0xA7, 0x4E, 0xC0};
+
+// Ein kodiertes Paket, wie es der Sender verschickt
+struct EncodedFrame {
+  uint8_t bytes[MARKISE_AUTH_FRAME_SIZE];
+  size_t len;
+};
+
+// counter != 0: signiert mit key (wie der Sender mit LINK_AUTH)
+EncodedFrame makeFrame(uint8_t mask, uint16_t sequence, uint32_t counter = 0, const LinkKey *key = nullptr) {
+  ButtonFrame frame = {};
+  frame.command = mask != 0 ? CMD_RENEW : CMD_STOP;
+  frame.buttonMask = mask;
+  frame.sequence = sequence;
+  frame.leaseMs = RECEIVE_TIMEOUT;
+  frame.batteryMillivolts = 3920;
+  frame.adcRaw = 2280;
+  frame.rssi = -61;
+  frame.timestamp = 12345;
+  EncodedFrame encoded;
+  encoded.len = counter != 0 ? encodeAuthFrame(frame, counter, *key, encoded.bytes, sizeof(encoded.bytes))
+                             : encodeFrame(frame, encoded.bytes, sizeof(encoded.bytes));
+  return encoded;
+}
+
+// Fahrbefehl (CMD_MOVE): Motor aus mask an position (Promille) fahren
+EncodedFrame makeMoveFrame(uint8_t mask, uint16_t sequence, uint16_t position) {
+  ButtonFrame frame = {};
+  frame.command = CMD_MOVE;
+  frame.buttonMask = mask;
+  frame.sequence = sequence;
+  frame.leaseMs = position;
+  frame.batteryMillivolts = 3920;
+  frame.adcRaw = 2280;
+  frame.rssi = -61;
+  frame.timestamp = 12345;
+  EncodedFrame encoded;
+  encoded.len = encodeFrame(frame, encoded.bytes, sizeof(encoded.bytes));
+  return encoded;
+}
+
+// Größere Anlagen, um das Wachstum der Kosten mit der Motoranzahl zu sehen
+using Topology8 = MotorTopology<8>;
+using Topology16 = MotorTopology<16>;
+
+struct Gpio8Config {
+  static constexpr uint8_t pins[] = {26, 27, 14, 12, 13, 15, 2, 4, 5, 16, 17, 18, 19, 21, 22, 23};
+};
+
+struct ShiftRegister16Config {
+  static constexpr uint8_t bits[] = {0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15,
+                                     16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
+  static constexpr uint8_t latchPin = 25;
+  static constexpr uint32_t spiHz = 4000000;
+};
+
+struct Expander8Config {
+  static constexpr uint8_t bits[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  static constexpr uint8_t address = 0x20;
+  static constexpr uint32_t i2cHz = 400000;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bench::Suite suite("receiver");
+  suite.parseArgs(argc, argv);
+
+  setup();
+
+  // Typischer Fall: Taster gehalten, Maske bleibt gleich
+  uint16_t sequence = 0;
+  suite.run("OnDataRecv/hold", [&] {
+    EncodedFrame frame = makeFrame(0x01, sequence++);
+    shim::advanceMillis(25);
+    OnDataRecv(knownSenders[0].mac, frame.bytes, (int)frame.len);
+    serviceControl();       // Steuer-Task nachbilden (im native-Build laufen keine Tasks)
+    deferredLog.discard();  // Log-Tasks nachbilden, damit die Puffer nie voll sind
+    controlLog.discard();
+  });
+
+  // Wechsel zwischen Drücken und Loslassen: jeder Aufruf schaltet einen Ausgang
+  suite.run("OnDataRecv/toggle", [&] {
+    EncodedFrame frame = makeFrame((sequence & 1) ? 0x04 : 0x00, sequence);
+    sequence++;
+    shim::advanceMillis(25);
+    OnDataRecv(knownSenders[0].mac, frame.bytes, (int)frame.len);
+    serviceControl();       // Steuer-Task nachbilden (im native-Build laufen keine Tasks)
+    deferredLog.discard();  // Log-Tasks nachbilden, damit die Puffer nie voll sind
+    controlLog.discard();
+  });
+
+  // Nur die Seite des WiFi-Tasks: prüfen und in den Briefkasten legen
+  suite.run("OnDataRecv/handoff", [&] {
+    EncodedFrame frame = makeFrame(0x01, sequence++);
+    shim::advanceMillis(25);
+    OnDataRecv(knownSenders[0].mac, frame.bytes, (int)frame.len);
+    deferredLog.discard();
+  });
+  serviceControl();
+  controlLog.discard();
+
+  // Paket eines fremden Geräts (muss möglichst billig verworfen werden)
+  EncodedFrame foreignFrame = makeFrame(0x01, 0);
+  suite.run("OnDataRecv/foreign", [&] {
+    OnDataRecv(foreignMac, foreignFrame.bytes, (int)foreignFrame.len);
+    deferredLog.discard();
+  });
+
+  // Abgeschnittenes Paket eines bekannten Senders (an der Länge verworfen)
+  EncodedFrame shortFrame = makeFrame(0x01, 0);
+  suite.run("OnDataRecv/truncated", [&] {
+    OnDataRecv(knownSenders[0].mac, shortFrame.bytes, (int)MARKISE_FRAME_V2_SIZE - 1);
+    deferredLog.discard();
+  });
+
+  // Signierter Sender: Signatur und Zähler vor der Sequenzprüfung
+  int signedIndex = senders.add(signedMac, "Bench signiert");
+  LinkKey benchKey;
+  linkKeyFromHex("000102030405060708090a0b0c0d0e0f", benchKey);
+  setSenderKey(signedIndex, benchKey);
+  const LinkKey &signedKey = senderAuth[signedIndex].key;
+  uint32_t counter = 0;
+  suite.run("OnDataRecv/hold-signed", [&] {
+    EncodedFrame frame = makeFrame(0x01, sequence++, ++counter, &signedKey);
+    shim::advanceMillis(25);
+    OnDataRecv(signedMac, frame.bytes, (int)frame.len);
+    serviceControl();
+    deferredLog.discard();
+    controlLog.discard();
+  });
+
+  // Gefälschtes Paket mit der MAC des signierten Senders (an der Signatur verworfen)
+  EncodedFrame forged = makeFrame(0x01, 0, 0xFFFFFFF0, &signedKey);
+  forged.bytes[MARKISE_AUTH_FRAME_SIZE - 1] ^= 0x01;
+  suite.run("OnDataRecv/forged", [&] {
+    OnDataRecv(signedMac, forged.bytes, (int)forged.len);
+    deferredLog.discard();
+  });
+
+  // Nur die Signatur: erzeugen (Sender) und prüfen (Empfänger)
+  ButtonFrame signInput = {CMD_RENEW, 0x01, 7, RECEIVE_TIMEOUT, 3920, 2280, -61, 12345, MARKISE_PROTOCOL_VERSION, 0};
+  EncodedFrame signedFrame = makeFrame(0x01, 7, 7, &signedKey);
+  suite.run("encodeAuthFrame", [&] {
+    uint8_t buffer[MARKISE_AUTH_FRAME_SIZE];
+    bench::doNotOptimize(encodeAuthFrame(signInput, counter++, signedKey, buffer, sizeof(buffer)));
+    bench::doNotOptimize(buffer);
+  });
+  suite.run("verifyAuthFrame", [&] {
+    uint32_t frameCounter;
+    bench::doNotOptimize(verifyAuthFrame(signedFrame.bytes, (int)signedFrame.len, signedKey, frameCounter));
+    bench::doNotOptimize(frameCounter);
+  });
+
+  // Frame prüfen und auslesen (Länge, Version, CRC)
+  EncodedFrame decodeInput = makeFrame(0x01, 7);
+  suite.run("decodeFrame", [&] {
+    ButtonFrame decoded;
+    bench::doNotOptimize(decodeFrame(decodeInput.bytes, (int)decodeInput.len, decoded));
+    bench::doNotOptimize(decoded);
+  });
+
+  // Ausgänge bleiben unverändert
+  setOutputsFromMask(0x01);
+  suite.run("setOutputsFromMask/same", [&] { setOutputsFromMask(0x01); });
+
+  // Richtungswechsel an Motor 1 (zwei Ausgänge ändern sich)
+  uint8_t toggle = 0;
+  suite.run("setOutputsFromMask/reverse", [&] {
+    setOutputsFromMask((toggle++ & 1) ? 0x01 : 0x02);
+    controlLog.discard();
+  });
+
+  // Ungültige Kombination (beide Richtungen eines Motors)
+  suite.run("setOutputsFromMask/invalid", [&] {
+    setOutputsFromMask(0x03);
+    controlLog.discard();
+  });
+
+  suite.run("disableAllOutputs", [&] {
+    setOutputsFromMask(0x15);
+    disableAllOutputs();
+    controlLog.discard();
+  });
+
+  // Motor-Verriegelung und Kanal-Tabellen: 3 vs. 8/16 Motoren
+  uint32_t topologyMask = 0;
+  suite.run("Topology<3>::safeMask", [&] {
+    bench::doNotOptimize(Topology::safeMask((OutputMask)(topologyMask++ & Topology::ALL)));
+  });
+  suite.run("Topology<16>::safeMask", [&] {
+    bench::doNotOptimize(Topology16::safeMask((Topology16::Mask)(topologyMask++ * 2654435761U)));
+  });
+
+  GpioOutputs<Topology8, Gpio8Config> gpio8;
+  gpio8.begin();
+  suite.run("GpioOutputs<8>::commit/reverse", [&] {
+    Topology8::Mask a = 0x5555, b = 0xAAAA;
+    bool odd = topologyMask++ & 1;
+    bench::doNotOptimize(gpio8.commit(odd ? a : b, odd ? b : a));
+  });
+
+  ShiftRegisterOutputs<Topology16, ShiftRegister16Config> shift16;
+  shift16.begin();
+  suite.run("ShiftRegisterOutputs<16>::commit", [&] {
+    Topology16::Mask next = (Topology16::Mask)(topologyMask++ * 2654435761U);
+    bench::doNotOptimize(shift16.commit(0, Topology16::safeMask(next)));
+  });
+
+  I2cExpanderOutputs<Topology8, Expander8Config> expander8;
+  expander8.begin();
+  suite.run("I2cExpanderOutputs<8>::commit", [&] {
+    Topology8::Mask next = (Topology8::Mask)(topologyMask++ * 40503U);
+    bench::doNotOptimize(expander8.commit(0, Topology8::safeMask(next)));
+  });
+
+  // Failsafe-Timer nachstellen (passiert bei jedem gültigen Paket)
+  SenderEntry &firstSender = senders.at(0);
+  suite.run("armFailsafeTimer", [&] {
+    firstSender.activeMask = 0x01;
+    firstSender.leaseDeadline = esp_timer_get_time() + RECEIVE_TIMEOUT * 1000LL;
+    armFailsafeTimer();
+  });
+
+  // Timer läuft ab: Abschaltung im Steuer-Task über die virtuelle Uhr
+  suite.run("onFailsafeTimeout", [&] {
+    EncodedFrame frame = makeFrame(0x01, sequence++);
+    OnDataRecv(knownSenders[0].mac, frame.bytes, (int)frame.len);
+    serviceControl();
+    shim::advanceMillis(RECEIVE_TIMEOUT);
+    serviceControl();
+    deferredLog.discard();
+    controlLog.discard();
+  });
+
+  // Fahrbefehl: laufende Fahrt abbrechen, neue mit dem Fahrzeitmodell planen
+  // (Motor 2, abwechselnd 20 % und 80 %; die Position ist nach der ersten
+  // Referenzfahrt bekannt)
+  suite.run("OnDataRecv/move", [&] {
+    EncodedFrame frame = makeMoveFrame(0x04, sequence, (sequence & 1) ? 200 : 800);
+    sequence++;
+    shim::advanceMillis(25);
+    OnDataRecv(knownSenders[0].mac, frame.bytes, (int)frame.len);
+    serviceControl();
+    deferredLog.discard();
+    controlLog.discard();
+  });
+
+  // Fahrt bis zum Ende: Start, Ablauf über die virtuelle Uhr, Abschaltung
+  suite.run("finishTravel", [&] {
+    EncodedFrame frame = makeMoveFrame(0x04, sequence, (sequence & 1) ? 300 : 700);
+    sequence++;
+    OnDataRecv(knownSenders[0].mac, frame.bytes, (int)frame.len);
+    serviceControl();
+    shim::advanceMillis(TRAVEL_MAX_MS);
+    serviceControl();
+    deferredLog.discard();
+    controlLog.discard();
+  });
+
+  // MAC-Suche: Kosten dürfen mit der Tabellengröße nicht wachsen
+  SenderRegistry oneSender;
+  SenderRegistry fullTable;
+  uint8_t macs[SENDER_MAX][6];
+  for (int i = 0; i < SENDER_MAX; i++) {
+    const uint8_t mac[6] = {0x20, 0x6E, 0xF1, (uint8_t)(0x10 * i), (uint8_t)(0x4E + i), (uint8_t)(0xB8 ^ i)};
+    memcpy(macs[i], mac, 6);
+    fullTable.add(mac, "Sender");
+    if (i == 0) oneSender.add(mac, "Sender");
+  }
+  suite.run("SenderRegistry::find/1", [&] { bench::doNotOptimize(oneSender.find(macs[0])); });
+  uint32_t next = 0;
+  suite.run("SenderRegistry::find/8", [&] {
+    bench::doNotOptimize(fullTable.find(macs[next++ & (SENDER_MAX - 1)]));
+  });
+  suite.run("SenderRegistry::find/8-foreign", [&] { bench::doNotOptimize(fullTable.find(foreignMac)); });
+
+  // Sequenzfenster: neue Nummer (Normalfall) und Duplikat
+  ReplayWindow window = {};
+  uint16_t windowSequence = 0;
+  suite.run("ReplayWindow::check/new", [&] { bench::doNotOptimize(window.check(windowSequence++)); });
+  suite.run("ReplayWindow::check/duplicate", [&] { bench::doNotOptimize(window.check(windowSequence - 3)); });
+
+  // Funkstrecken-Statistik je Paket (im Callback)
+  static LinkStats link;
+  LinkSample linkSample = {};
+  linkSample.leaseMs = RECEIVE_TIMEOUT;
+  linkSample.verdict = SEQ_NEW;
+  linkSample.sequenced = true;
+  linkSample.rssi = -61;
+  linkSample.rssiMeasured = true;
+  suite.run("LinkStats::record", [&] {
+    linkSample.arrivalUs += 90000 + (linkSample.sequence & 7) * 150;
+    linkSample.senderMs += 90;
+    linkSample.sequence += (linkSample.sequence & 63) == 0 ? 2 : 1;
+    link.record(linkSample);
+  });
+
+  // Datensatz der Energiebilanz übernehmen (im Callback, Frames mit
+  // FRAME_FLAG_ENERGY): abwechselnd untere und obere Hälfte
+  EnergyTotals energyInput;
+  energyInput.reset();
+  uint8_t energyIndex = 0;
+  suite.run("EnergyTotals::apply", [&] {
+    energyInput.apply(energyTag(energyIndex % 4, energyIndex / 4), energyIndex);
+    energyIndex = (uint8_t)((energyIndex + 1) % ENERGY_RECORD_COUNT);
+  });
+
+  // Log-Eintrag schreiben (Producer-Seite, im Callback)
+  suite.run("DeferredLog::push", [&] {
+    deferredLog.push(LOG_LEVEL_INFO, "  %s: %s", outputNames[0], "EIN");
+    deferredLog.discard();
+  });
+
+  // Log-Eintrag formatieren und ausgeben (Consumer-Seite, im Log-Task)
+  suite.run("DeferredLog::drain", [&] {
+    deferredLog.push(LOG_LEVEL_INFO, "  %s: %s", outputNames[0], "EIN");
+    deferredLog.drain();
+  });
+
+  // Telemetrie: Wert vormerken und übernehmen (ein Paket pro Sekunde)
+  static TelemetryStore store;
+  store.attach(0, macs[0]);
+  uint32_t telemetrySecond = 0;
+  suite.run("TelemetryStore::post+process", [&] {
+    store.post(0, telemetrySecond, 3900 - (uint16_t)(telemetrySecond / 3600), 2270, -60);
+    store.process(telemetrySecond++);
+  });
+
+  // Binärformat: Flash-Blob (Stunden/Tage) und kompletter Dump
+  static uint8_t blob[TELEMETRY_BLOB_MAX];
+  suite.run("TelemetryStore::serialize/flash", [&] {
+    bench::doNotOptimize(store.serialize(0, telemetrySecond, false, blob, sizeof(blob)));
+  });
+  suite.run("TelemetryStore::serialize/dump", [&] {
+    bench::doNotOptimize(store.serialize(0, telemetrySecond, true, blob, sizeof(blob)));
+  });
+  size_t blobLength = store.serialize(0, telemetrySecond, false, blob, sizeof(blob));
+  suite.run("TelemetryStore::deserialize", [&] {
+    bench::doNotOptimize(store.deserialize(0, blob, blobLength));
+  });
+
+  // MQTT-Brücke: Zustand einstellen (Steuer-Task) und abholen (MQTT-Task)
+  PublishQueue queue;
+  PublishMessage taken;
+  uint32_t queueRound = 0;
+  char queuePayload[32];
+  suite.run("PublishQueue::post+take", [&] {
+    snprintf(queuePayload, sizeof(queuePayload), "{\"position\":%u}", (unsigned)(queueRound++ % 1000));
+    queue.post(MQTT_SLOT_MOTOR, "markise/motor/1", queuePayload, true);
+    bench::doNotOptimize(queue.take(taken));
+  });
+  // Broker hängt: jeder neue Wert ersetzt den ungesendeten
+  suite.run("PublishQueue::post/coalesce", [&] {
+    queue.post(MQTT_SLOT_MOTOR, "markise/motor/1", (queueRound++ & 1) ? "{\"state\":\"left\"}" : "{}", true);
+  });
+  // Was der Steuer-Task nach einem Schalten zusätzlich tut (ein Motor)
+  MotorReport report = {0x01, 420, 1000};
+  suite.run("postMotorReports", [&] {
+    report.position = (int16_t)(queueRound++ % 1000);
+    postMotorReports(0x01, &report);
+  });
+  while (mqttQueue.take(taken)) {
+  }
+
+  suite.report();
+
+  // Schaltversatz beim Richtungswechsel: Takte zwischen erstem und letztem
+  // Registerzugriff (Host-Zeit, auf den ESP32-Takt umgerechnet)
+  const int skewSamples = 10001;
+  std::vector<uint32_t> skew;
+  skew.reserve(skewSamples);
+  for (int i = 0; i < skewSamples; i++) {
+    setOutputsFromMask((i & 1) ? 0x01 : 0x02);
+    controlLog.discard();
+    skew.push_back(outputCommitStats.lastCycles);
+  }
+  std::sort(skew.begin(), skew.end());
+  printf("\nAusgangs-Schaltversatz (Richtungswechsel, %d Vorgänge): median %u / max %u Takte @ %u MHz\n",
+         skewSamples, (unsigned)skew[skewSamples / 2], (unsigned)skew.back(), (unsigned)ESP.getCpuFreqMHz());
+  return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * Fuzzing des Empfangspfads (nur native-Build)
+ *
+ * Füttert OnDataRecv mit beliebigen Bytes – so, wie ein fremdes oder
+ * defektes Gerät in Reichweite sie schicken könnte – und prüft nach jedem
+ * Paket:
+ * - kein Lesen über das Paketende hinaus (AddressSanitizer; jedes Paket
+ *   liegt in einem eigenen Puffer mit genau len Bytes)
+ * - nie beide Richtungen eines Motors an
+ * - ein gültiger v3-Frame ergibt beim Kodieren wieder dieselben Bytes
+ *
+ * Aufbau einer Eingabe: Byte 0 steuert den Rahmen, der Rest ist das Paket.
+ *   Bit 0-1  Absender: 0-2 = bekannter Sender (Index modulo Anzahl; der
+ *            letzte signiert, siehe LINK_AUTH), 3 = fremd
+ *   Bit 2    CRC (und beim signierten Sender die Signatur) vor dem Zustellen
+ *            korrigieren – sonst scheitern fast alle Zufallspakete an der
+ *            Prüfsumme, bevor sie etwas auslösen
+ *   Bit 3-7  virtuelle Uhr vorher um 4 ms je Schritt weiterstellen
+ *            (Lease-Ablauf und Failsafe-Timer werden mit geprüft)
+ *
+ * libFuzzer (clang; das Makro blendet den eigenen main() unten aus):
+ *   clang++ -std=gnu++17 -g -O1 -fsanitize=fuzzer,address,undefined -DNATIVE_BUILD \
+ *     -DFUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION -I../lib/NativeShim/src ... \
+ *     fuzz/fuzz_receiver.cpp <Bibliotheken> -o fuzz_receiver
+ *   ./fuzz_receiver -max_len=64
+ *
+ * Ohne libFuzzer (gcc, AFL): pio run -e fuzz, dann
+ *   .pio/build/fuzz/program datei...          Eingaben nachspielen
+ *   .pio/build/fuzz/program < datei           eine Eingabe von stdin (AFL)
+ *   .pio/build/fuzz/program --random=N        N Zufallseingaben (--seed=N)
+ */
+
+#include "../src/main.cpp"
+
+#include "NativeShim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+namespace {
+
+const uint8_t foreignMac[6] = {0x24, 0x6F, 0x28, 0x11, 0x22, 0x33};
+const uint8_t signedMac[6] = {0x20, 0x6E, 0xF1, 0xA7, 0x4E, 0xC0};
+int signedIndex = -1;
+
+#define FUZZ_CHECK(cond, what)                                   \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      fprintf(stderr, "Fuzzing: %s verletzt\n", what);           \
+      abort();                                                   \
+    }                                                            \
+  } while (0)
+
+// CRC eines v2/v3-Pakets korrigieren (Aufbau nach dem Versionsbyte)
+void fixCrc(uint8_t *data, size_t len) {
+  size_t crcOffset;
+  if (len >= MARKISE_FRAME_SIZE && data[0] == 3) {
+    crcOffset = offsetof(WireFrameV3, crc);
+  } else if (len >= MARKISE_FRAME_V2_SIZE && data[0] == 2) {
+    crcOffset = offsetof(WireFrameV2, crc);
+  } else {
+    return;
+  }
+  uint16_t crc = crc16(data, crcOffset);
+  data[crcOffset] = (uint8_t)crc;
+  data[crcOffset + 1] = (uint8_t)(crc >> 8);
+}
+
+// Signatur eines v3-Pakets mit FRAME_FLAG_AUTH neu berechnen (Zähler aus dem Paket)
+void fixSignature(uint8_t *data, size_t len) {
+  if (len < MARKISE_AUTH_FRAME_SIZE || data[0] != 3) return;
+  ButtonFrame frame;
+  if (decodeFrame(data, (int)len, frame) != DECODE_OK) return;
+  const uint8_t *trailer = data + MARKISE_FRAME_SIZE;
+  uint32_t counter = (uint32_t)trailer[0] | ((uint32_t)trailer[1] << 8) | ((uint32_t)trailer[2] << 16) |
+                     ((uint32_t)trailer[3] << 24);
+  encodeAuthFrame(frame, counter, senderAuth[signedIndex].key, data, len);
+}
+
+void checkRoundTrip(const uint8_t *data, size_t len) {
+  ButtonFrame frame;
+  if (decodeFrame(data, (int)len, frame) != DECODE_OK || frame.version != 3) return;
+  uint8_t encoded[MARKISE_FRAME_SIZE];
+  FUZZ_CHECK(encodeFrame(frame, encoded, sizeof(encoded)) == MARKISE_FRAME_SIZE, "encodeFrame");
+  FUZZ_CHECK(memcmp(encoded, data, MARKISE_FRAME_SIZE) == 0, "v3-Rundlauf");
+}
+
+void runInput(const uint8_t *input, size_t size) {
+  if (size == 0) return;
+  uint8_t control = input[0];
+  size_t len = size - 1;
+
+  // Eigener Puffer mit genau len Bytes: jedes Lesen dahinter fällt auf
+  std::vector<uint8_t> packet(input + 1, input + size);
+  int source = control & 0x03;
+  int index = source == 3 ? -1 : source % senders.count();
+  const uint8_t *mac = index < 0 ? foreignMac : senders.at(index).mac;
+  if (control & 0x04) {
+    fixCrc(packet.data(), len);
+    if (index == signedIndex) fixSignature(packet.data(), len);
+  }
+
+  // Steuer-Task nachbilden: nach dem Failsafe-Timer und nach jedem Paket
+  shim::advanceMillis((control >> 3) * 4);
+  serviceControl();
+  OnDataRecv(mac, packet.data(), (int)len);
+  serviceControl();
+  deferredLog.discard();  // Log-Tasks nachbilden, damit die Puffer nie voll sind
+  controlLog.discard();
+
+  OutputMask mask = outputMask;
+  FUZZ_CHECK(Topology::conflicts(mask) == 0, "Verriegelung");
+  FUZZ_CHECK((mask & ~(OutputMask)Topology::ALL) == 0, "Kanalbereich");
+  checkRoundTrip(packet.data(), len);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerInitialize(int *, char ***) {
+  setup();
+  signedIndex = senders.add(signedMac, "Fuzz signiert");
+  LinkKey fuzzKey;
+  linkKeyFromHex("000102030405060708090a0b0c0d0e0f", fuzzKey);
+  setSenderKey(signedIndex, fuzzKey);
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  runInput(data, size);
+  return 0;
+}
+
+// =================== OHNE LIBFUZZER ===================
+
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+
+static std::vector<uint8_t> readAll(FILE *file) {
+  std::vector<uint8_t> bytes;
+  uint8_t chunk[256];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+  return bytes;
+}
+
+int main(int argc, char **argv) {
+  LLVMFuzzerInitialize(&argc, &argv);
+
+  unsigned long randomInputs = 0;
+  unsigned long long seed = 1;
+  int files = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--random=", 9) == 0) {
+      randomInputs = strtoul(argv[i] + 9, nullptr, 10);
+    } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+      seed = strtoull(argv[i] + 7, nullptr, 10);
+    } else {
+      FILE *file = fopen(argv[i], "rb");
+      if (file == nullptr) {
+        fprintf(stderr, "Kann %s nicht lesen\n", argv[i]);
+        return 2;
+      }
+      std::vector<uint8_t> bytes = readAll(file);
+      fclose(file);
+      LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+      files++;
+    }
+  }
+
+  // Zufallseingaben: meist gültige Frames mit zufälligen Feldern, damit
+  // Arbitrierung, Sequenzfenster und Lease auch ohne libFuzzer erreicht werden
+  uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+  auto next = [&state] {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  };
+  uint8_t input[1 + 32];
+  for (unsigned long n = 0; n < randomInputs; n++) {
+    size_t size = 1 + next() % 32;
+    for (size_t i = 0; i < sizeof(input); i++) input[i] = (uint8_t)next();
+    if (size > 1 && next() % 4 != 0) {
+      input[0] |= 0x04;
+      input[1] = (uint8_t)(2 + next() % 2);
+      size = next() % 8 == 0 ? size : 1 + (input[1] == 3 ? MARKISE_FRAME_SIZE : MARKISE_FRAME_V2_SIZE);
+      if (input[1] == 3 && next() % 2 == 0) {
+        input[2] |= FRAME_FLAG_AUTH;
+        size = 1 + MARKISE_AUTH_FRAME_SIZE;
+      }
+    }
+    LLVMFuzzerTestOneInput(input, size);
+  }
+
+  if (files == 0 && randomInputs == 0) {
+    std::vector<uint8_t> bytes = readAll(stdin);
+    LLVMFuzzerTestOneInput(bytes.data(), bytes.size());
+  }
+  printf("Fuzzing: %d Dateien, %lu Zufallseingaben, keine Verletzung (Ausgänge 0x%llx)\n", files,
+         randomInputs, (unsigned long long)outputMask);
+  return 0;
+}
+
+#endif
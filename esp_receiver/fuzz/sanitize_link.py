@@ -0,0 +1,4 @@
+# Sanitizer auch beim Linken (build_flags gehen nur an den Compiler)
+Import("env")
+
+env.Append(LINKFLAGS=["-fsanitize=address,undefined"])
@@ -0,0 +1,99 @@
+/**
+ * DeferredLog – Formatierung und Ausgabe-Task
+ */
+
+#include "DeferredLog.h"
+
+#include <Arduino.h>
+
+DeferredLog deferredLog;
+
+static const char levelTags[] = {' ', 'E', 'W', 'I', 'D'};
+
+uint32_t DeferredLog::now() { return (uint32_t)millis(); }
+
+// Formatiert einen Eintrag. Jede Umwandlung (%d, %f, %s, ...) wird einzeln an
+// snprintf übergeben, damit der passende Typ aus dem LogArg gelesen wird.
+void DeferredLog::format(const LogRecord &record, char *out, size_t size) {
+  size_t used = 0;
+  int argIndex = 0;
+  const char *p = record.format;
+
+  while (*p != '\0' && used + 1 < size) {
+    if (*p != '%') {
+      out[used++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      out[used++] = '%';
+      p += 2;
+      continue;
+    }
+
+    // Umwandlung bis zum Typzeichen herauskopieren (z.B. "%02X", "%.2f")
+    char spec[16];
+    size_t n = 0;
+    spec[n++] = *p++;
+    while (*p != '\0' && strchr("diouxXcfFeEgGs", *p) == nullptr && n < sizeof(spec) - 2) {
+      spec[n++] = *p++;
+    }
+    if (*p == '\0') break;
+    char type = *p++;
+    spec[n++] = type;
+    spec[n] = '\0';
+
+    LogArg arg = argIndex < record.argCount ? record.args[argIndex] : LogArg();
+    argIndex++;
+
+    int written;
+    if (type == 's') {
+      written = snprintf(out + used, size - used, spec, arg.s != nullptr ? arg.s : "(null)");
+    } else if (strchr("fFeEgG", type) != nullptr) {
+      written = snprintf(out + used, size - used, spec, (double)arg.f);
+    } else {
+      written = snprintf(out + used, size - used, spec, (int)arg.i);
+    }
+    if (written < 0) break;
+    used += (size_t)written;
+    if (used >= size) used = size - 1;
+  }
+  out[used] = '\0';
+}
+
+size_t DeferredLog::drain() {
+  size_t count = 0;
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  uint32_t h = head.load(std::memory_order_acquire);
+  char line[160];
+
+  while (t != h) {
+    const LogRecord &r = ring[t & (LOG_RING_SIZE - 1)];
+    format(r, line, sizeof(line));
+    char tag = r.level < sizeof(levelTags) ? levelTags[r.level] : '?';
+    uint32_t timeMs = r.timeMs;
+    // Eintrag freigeben, bevor die (langsame) Ausgabe beginnt
+    tail.store(++t, std::memory_order_release);
+    Serial.printf("[%7lu %c] %s\n", (unsigned long)timeMs, tag, line);
+    count++;
+  }
+
+  uint32_t d = dropped.load(std::memory_order_relaxed);
+  if (d != reportedDropped) {
+    Serial.printf("[Log] %lu Einträge verworfen (Puffer voll)\n", (unsigned long)(d - reportedDropped));
+    reportedDropped = d;
+  }
+  return count;
+}
+
+static void deferredLogTask(void *param) {
+  DeferredLog *log = static_cast<DeferredLog *>(param);
+  for (;;) {
+    log->drain();
+    vTaskDelay(pdMS_TO_TICKS(log->intervalMs()));
+  }
+}
+
+bool DeferredLog::startTask(uint32_t intervalMs, unsigned priority, int core) {
+  taskIntervalMs = intervalMs;
+  return xTaskCreatePinnedToCore(deferredLogTask, "deferredLog", 4096, this, priority, nullptr, core) == pdPASS;
+}
@@ -0,0 +1,146 @@
+/**
+ * DeferredLog – verzögerte Log-Ausgabe für zeitkritische Callbacks
+ *
+ * Der ESP-NOW-Empfangs-Callback läuft im WiFi-Task. Jede Serial-Ausgabe dort
+ * kostet bei 115200 Baud viel mehr Zeit als das eigentliche Schalten der
+ * Relais. Deshalb schreibt der Callback nur einen kompakten Eintrag
+ * (Formatstring-Zeiger, Zeitstempel, bis zu LOG_MAX_ARGS Argumente) in einen
+ * Ringpuffer. Ein eigener Task mit niedriger Priorität formatiert die
+ * Einträge später und gibt sie auf Serial aus.
+ *
+ * Regeln:
+ * - genau EIN Schreiber (Producer) und genau EIN Leser (Consumer),
+ *   dann ist der Puffer ohne Sperren sicher
+ * - Formatstrings müssen Literale sein (es wird nur der Zeiger gespeichert)
+ * - Argumente: Ganzzahlen, float/double (%f) und konstante Strings (%s)
+ * - ist der Puffer voll, wird der Eintrag verworfen und gezählt
+ *
+ * Log-Level werden zur Compile-Zeit gefiltert: LOG_DEBUG(...) usw. erzeugen
+ * keinen Code, wenn LOG_LEVEL kleiner ist.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <type_traits>
+
+// =================== KONFIGURATION ===================
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// Höchstes Level, das überhaupt übersetzt wird
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Anzahl Einträge im Ringpuffer (Zweierpotenz)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64
+#endif
+
+// Maximale Anzahl Argumente pro Eintrag
+#define LOG_MAX_ARGS 6
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE muss eine Zweierpotenz sein");
+
+// =================== EINTRÄGE ===================
+
+// Ein Argument; welcher Teil gültig ist, ergibt sich aus dem Formatstring
+union LogArg {
+  int32_t i;
+  float f;
+  const char *s;
+
+  LogArg() : i(0) {}
+  template <typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, int>::type = 0>
+  LogArg(T value) : i((int32_t)value) {}
+  LogArg(float value) : f(value) {}
+  LogArg(double value) : f((float)value) {}
+  LogArg(const char *value) : s(value) {}
+};
+
+struct LogRecord {
+  const char *format;       // Literal, wird erst beim Ausgeben formatiert
+  uint32_t timeMs;          // millis() beim Schreiben
+  uint8_t level;
+  uint8_t argCount;
+  LogArg args[LOG_MAX_ARGS];
+};
+
+// =================== RINGPUFFER ===================
+
+class DeferredLog {
+public:
+  // Schreibt einen Eintrag (nur vom Producer aufrufen). Konstante Laufzeit,
+  // keine Sperren, keine Allokation. false = Puffer voll, Eintrag verworfen.
+  template <typename... Args>
+  bool push(uint8_t level, const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "zu viele Log-Argumente");
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+      dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    LogRecord &r = ring[h & (LOG_RING_SIZE - 1)];
+    r.format = format;
+    r.timeMs = now();
+    r.level = level;
+    r.argCount = (uint8_t)sizeof...(Args);
+    LogArg values[] = {LogArg(args)..., LogArg()};
+    for (size_t i = 0; i < sizeof...(Args); i++) r.args[i] = values[i];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Gibt alle vorhandenen Einträge auf Serial aus (nur vom Consumer aufrufen).
+  // Liefert die Anzahl ausgegebener Einträge.
+  size_t drain();
+
+  // Verwirft alle vorhandenen Einträge (Consumer-Seite, z.B. für Benchmarks)
+  void discard() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+  size_t pending() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+  // Startet den Ausgabe-Task (niedrige Priorität, leert den Puffer periodisch)
+  bool startTask(uint32_t intervalMs, unsigned priority, int core);
+  uint32_t intervalMs() const { return taskIntervalMs; }
+
+private:
+  static uint32_t now();
+  static void format(const LogRecord &record, char *out, size_t size);
+
+  LogRecord ring[LOG_RING_SIZE];
+  std::atomic<uint32_t> head{0};     // nur Producer schreibt
+  std::atomic<uint32_t> tail{0};     // nur Consumer schreibt
+  std::atomic<uint32_t> dropped{0};  // nur Producer schreibt
+  uint32_t reportedDropped = 0;      // nur Consumer
+  uint32_t taskIntervalMs = 10;
+};
+
+extern DeferredLog deferredLog;
+
+// =================== MAKROS ===================
+// Argumente werden bei herausgefiltertem Level nicht ausgewertet
+
+#define LOG_AT_TO(log, level, ...) \
+  do { \
+    if ((level) <= LOG_LEVEL) (log).push((level), __VA_ARGS__); \
+  } while (0)
+
+// Weitere Producer (eigener Task) brauchen einen eigenen Puffer: LOG_AT_TO()
+#define LOG_AT(level, ...) LOG_AT_TO(deferredLog, level, __VA_ARGS__)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
@@ -0,0 +1,65 @@
+/**
+ * LinkQuality – Auswertung je Paket
+ */
+
+#include "LinkQuality.h"
+
+void RssiHistogram::add(int8_t value) {
+  int index = (value - LINK_RSSI_MIN) / 2;
+  if (value < LINK_RSSI_MIN) index = 0;
+  if (index >= LINK_RSSI_BUCKETS) index = LINK_RSSI_BUCKETS - 1;
+  buckets[index]++;
+  if (count == 0 || value < min) min = value;
+  if (count == 0 || value > max) max = value;
+  sum += value;
+  count++;
+}
+
+void LinkStats::record(const LinkSample &sample) {
+  received++;
+  if (sample.rssiMeasured) {
+    rssi.add(sample.rssi);
+  } else {
+    rssiMissing++;
+  }
+
+  // Verspätete Pakete: waren schon als verloren gezählt, Zeiten passen
+  // nicht in die Reihenfolge
+  if (sample.sequenced && sample.verdict == SEQ_LATE) {
+    reordered++;
+    if (lost > 0) lost--;
+    return;
+  }
+
+  uint32_t gapUs = sample.arrivalUs - lastArrivalUs;
+  bool continues = started && sample.verdict != SEQ_RESYNC &&
+                   gapUs < (uint32_t)LINK_SESSION_GAP_MS * 1000UL &&
+                   sample.senderMs >= lastSenderMs;
+
+  if (!continues) {
+    sessions++;
+  } else {
+    uint32_t gapMs = (gapUs + 500) / 1000;
+    interArrivalMs.add(gapMs);
+    if (sample.leaseMs != 0 && gapMs > sample.leaseMs) leaseGaps++;
+
+    int32_t delta = (int32_t)(gapUs - (sample.senderMs - lastSenderMs) * 1000UL);
+    uint32_t deviation = (uint32_t)(delta < 0 ? -delta : delta);
+    transitDeltaUs.add(deviation);
+    // J += (|D| - J) / 16, hier mit 16·J gerechnet
+    jitterUs16 = jitterUs16 + deviation - (jitterUs16 + 8) / 16;
+
+    if (sample.sequenced) {
+      uint16_t missing = (uint16_t)(sample.sequence - highest - 1);
+      if (missing != 0) {
+        lost += missing;
+        lossBursts.add(missing);
+      }
+    }
+  }
+
+  lastArrivalUs = sample.arrivalUs;
+  lastSenderMs = sample.senderMs;
+  highest = sample.sequence;
+  started = true;
+}
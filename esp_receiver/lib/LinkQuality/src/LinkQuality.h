@@ -0,0 +1,100 @@
+/**
+ * LinkQuality – Verlust, Jitter und Empfangspegel je Sender
+ *
+ * Pro angenommenem Paket wird record() mit Ankunftszeit, Zeitstempel und
+ * Sequenznummer des Senders sowie dem gemessenen Empfangspegel aufgerufen.
+ * Daraus entstehen:
+ * - Verluste aus Lücken in der Sequenznummer (verspätet eingetroffene
+ *   Pakete werden wieder abgezogen)
+ * - Abstände zwischen zwei Paketen und die Abweichung vom Sendeabstand
+ *   (Jitter nach RFC 3550: |(R_j - R_i) - (S_j - S_i)|, geglättet mit 1/16)
+ * - Verteilung des Empfangspegels
+ *
+ * Ausgewertet wird nur innerhalb einer Sitzung (Pakete mit weniger als
+ * LINK_SESSION_GAP_MS Abstand, also ein gehaltener Taster). Zwischen zwei
+ * Tastendrücken schläft der Sender, seine Uhr beginnt neu, und Lücken in
+ * der Sequenz können Pakete an andere Empfänger sein.
+ *
+ * Alle Verteilungen sind logarithmische Histogramme mit festem Speicher
+ * (lib/LogHistogram), der Empfangspegel (schon in dB) linear in
+ * 2-dB-Schritten.
+ *
+ * record() läuft im Empfangs-Callback (konstante Zeit, keine Sperre); zum
+ * Ausgeben eine Kopie ziehen (Schnappschuss, wie bei SenderStats).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "LogHistogram.h"
+#include "SenderRegistry.h"  // SequenceVerdict
+
+// =================== KONFIGURATION ===================
+
+// Längere Pausen beginnen eine neue Sitzung (kein Abstand, keine Lücke)
+#ifndef LINK_SESSION_GAP_MS
+#define LINK_SESSION_GAP_MS 1000
+#endif
+
+// Empfangspegel-Histogramm: LINK_RSSI_MIN ... LINK_RSSI_MIN + 2·BUCKETS dBm
+#define LINK_RSSI_MIN -100
+#define LINK_RSSI_BUCKETS 40
+
+// =================== EMPFANGSPEGEL ===================
+
+struct RssiHistogram {
+  uint32_t buckets[LINK_RSSI_BUCKETS];
+  uint32_t count;
+  int32_t sum;
+  int8_t min;
+  int8_t max;
+
+  void add(int8_t rssi);
+  int lowerBound(int index) const { return LINK_RSSI_MIN + 2 * index; }
+};
+
+// =================== STATISTIK EINES SENDERS ===================
+
+// Ein angenommenes Paket
+struct LinkSample {
+  uint32_t arrivalUs;       // esp_timer beim Empfang
+  uint32_t senderMs;        // Zeitstempel des Senders (millis())
+  uint16_t leaseMs;         // Lease des Pakets (Lücken darüber zählen extra)
+  uint16_t sequence;
+  SequenceVerdict verdict;
+  bool sequenced;           // false: v1-Frame, Sequenz nicht auswertbar
+  int8_t rssi;
+  bool rssiMeasured;        // false: kein Empfangspegel zu diesem Paket
+};
+
+struct LinkStats {
+  uint32_t received;        // angenommene Pakete
+  uint32_t lost;            // Lücken in der Sequenz (innerhalb von Sitzungen)
+  uint32_t reordered;       // verspätet eingetroffen
+  uint32_t sessions;        // Beginn nach Pause oder Neusynchronisierung
+  uint32_t leaseGaps;       // Abstand größer als die Lease (Failsafe hätte ausgelöst)
+  uint32_t rssiMissing;     // Pakete ohne gemessenen Empfangspegel
+  uint32_t jitterUs16;      // geglätteter Jitter × 16 (RFC 3550)
+
+  LogHistogram<12> interArrivalMs;  // Abstand zweier Pakete (bis ca. 4 s)
+  LogHistogram<18> transitDeltaUs;  // |Abstand Empfänger - Abstand Sender|
+  LogHistogram<8> lossBursts;       // verlorene Pakete am Stück
+  RssiHistogram rssi;               // gemessener Empfangspegel
+
+  void record(const LinkSample &sample);
+
+  uint32_t jitterUs() const { return jitterUs16 / 16; }
+  // Verlustrate in Promille der erwarteten Pakete
+  uint32_t lossPermille() const {
+    uint32_t expected = received + lost;
+    return expected == 0 ? 0 : (uint32_t)(((uint64_t)lost * 1000 + expected / 2) / expected);
+  }
+
+private:
+  uint32_t lastArrivalUs;
+  uint32_t lastSenderMs;
+  uint16_t highest;         // höchste Sequenz der laufenden Sitzung
+  bool started;
+};
@@ -0,0 +1,199 @@
+/**
+ * MqttClient – kleiner MQTT-3.1.1-Client über einen TCP-Transport
+ *
+ * Transport ist auf dem ESP32 WiFiClient, im native-Build die Nachbildung
+ * aus NativeShim (echte Sockets, z.B. gegen einen lokalen mosquitto).
+ * Gebraucht werden connect(host, port), write(), available(), read(),
+ * connected() und stop().
+ *
+ * Nichts blockiert außer dem TCP-Verbindungsaufbau in open() und einem
+ * write() bei vollem Sendepuffer; der Client läuft deshalb in einem
+ * eigenen Task mit niedriger Priorität (siehe Empfänger, MQTT-BRÜCKE).
+ * poll() wird regelmäßig aufgerufen: liest eingehende Pakete, hält die
+ * Verbindung mit PINGREQ am Leben und erkennt einen stummen Broker.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MqttCodec.h"
+
+// Größtes ausgehendes Paket (Topic + Nutzdaten + Kopf)
+#ifndef MQTT_TX_MAX
+#define MQTT_TX_MAX 256
+#endif
+
+// So lange wird nach CONNECT auf CONNACK gewartet
+#define MQTT_CONNACK_TIMEOUT_MS 5000
+
+struct MqttClientStats {
+  uint32_t connects;      // angenommene Verbindungen
+  uint32_t refused;       // CONNACK mit Fehlercode (z.B. falsches Passwort)
+  uint32_t timeouts;      // Broker stumm (CONNACK oder Keep-Alive)
+  uint32_t lost;          // TCP-Verbindung weg oder Datenstrom ungültig
+  uint32_t published;     // gesendete PUBLISH
+  uint32_t received;      // empfangene PUBLISH
+  uint32_t writeErrors;   // Paket nicht vollständig geschrieben
+  uint8_t lastRefusal;    // Fehlercode des letzten CONNACK (0 = keiner)
+};
+
+template <typename Transport>
+class MqttClient {
+public:
+  enum State : uint8_t { DISCONNECTED, CONNECTING, CONNECTED };
+
+  // Eingehende Nachricht (läuft in poll(), Inhalt gilt nur während des Aufrufs)
+  typedef void (*MessageHandler)(const MqttMessage &message);
+
+  explicit MqttClient(Transport &transport) : link(transport) {}
+
+  // Baut die TCP-Verbindung auf und schickt CONNECT; angenommen ist die
+  // Verbindung erst, wenn poll() CONNECTED liefert.
+  // Rückgabe: false = TCP-Aufbau fehlgeschlagen
+  bool open(const char *host, uint16_t port, const MqttConnectOptions &options, uint32_t nowMs) {
+    close();
+    if (!link.connect(host, port)) return false;
+    reader.reset();
+    keepAliveMs = (uint32_t)options.keepAliveSec * 1000;
+    openedMs = nowMs;
+    lastReceiveMs = nowMs;
+    currentState = CONNECTING;
+    size_t len = mqttEncodeConnect(options, tx, sizeof(tx));
+    if (len == 0 || !send(len, nowMs)) {
+      drop();
+      return false;
+    }
+    return true;
+  }
+
+  State poll(uint32_t nowMs, MessageHandler handler) {
+    if (currentState == DISCONNECTED) return currentState;
+
+    uint8_t chunk[64];
+    int available;
+    while (currentState != DISCONNECTED && (available = link.available()) > 0) {
+      int got = link.read(chunk, available < (int)sizeof(chunk) ? (size_t)available : sizeof(chunk));
+      if (got <= 0) break;
+      lastReceiveMs = nowMs;
+      for (int i = 0; i < got && currentState != DISCONNECTED; i++) {
+        if (reader.feed(chunk[i])) handlePacket(handler);
+        if (reader.malformed()) {
+          counters.lost++;
+          drop();
+        }
+      }
+    }
+    if (currentState == DISCONNECTED) return currentState;
+
+    if (!link.connected()) {
+      counters.lost++;
+      drop();
+    } else if (currentState == CONNECTING && nowMs - openedMs > MQTT_CONNACK_TIMEOUT_MS) {
+      counters.timeouts++;
+      drop();
+    } else if (currentState == CONNECTED && keepAliveMs != 0) {
+      // Nach 1,5 Keep-Alive-Intervallen ohne Antwort gilt der Broker als weg
+      if (nowMs - lastReceiveMs > keepAliveMs + keepAliveMs / 2) {
+        counters.timeouts++;
+        drop();
+      } else if (nowMs - lastSendMs >= keepAliveMs / 2) {
+        size_t len = mqttEncodeEmpty(MQTT_PINGREQ, tx, sizeof(tx));
+        send(len, nowMs);
+      }
+    }
+    return currentState;
+  }
+
+  // QoS 0. Rückgabe: false = nicht verbunden, zu groß oder Schreibfehler
+  // (dann ist die Verbindung geschlossen)
+  bool publish(const char *topic, const char *payload, size_t payloadLen, bool retain, uint32_t nowMs) {
+    if (currentState != CONNECTED) return false;
+    size_t len = mqttEncodePublish(topic, (const uint8_t *)payload, payloadLen, retain, tx, sizeof(tx));
+    if (len == 0) return false;
+    if (!send(len, nowMs)) return false;
+    counters.published++;
+    return true;
+  }
+
+  // Abonniert filter mit QoS 0 (SUBACK wird nicht abgewartet)
+  bool subscribe(const char *filter, uint32_t nowMs) {
+    if (currentState != CONNECTED) return false;
+    nextPacketId = (uint16_t)(nextPacketId + 1);
+    if (nextPacketId == 0) nextPacketId = 1;
+    size_t len = mqttEncodeSubscribe(nextPacketId, filter, tx, sizeof(tx));
+    return len != 0 && send(len, nowMs);
+  }
+
+  // Meldet sich ab (DISCONNECT: der Broker verwirft das Testament) und
+  // schließt die Verbindung
+  void close() {
+    if (currentState == CONNECTED) {
+      size_t len = mqttEncodeEmpty(MQTT_DISCONNECT, tx, sizeof(tx));
+      link.write(tx, len);
+    }
+    drop();
+  }
+
+  State state() const { return currentState; }
+  const MqttClientStats &stats() const { return counters; }
+  uint32_t skippedPackets() const { return reader.skipped(); }
+
+private:
+  // Schließt die Verbindung ohne Abmeldung (der Broker veröffentlicht das Testament)
+  void drop() {
+    if (currentState != DISCONNECTED || link.connected()) link.stop();
+    currentState = DISCONNECTED;
+  }
+
+  bool send(size_t len, uint32_t nowMs) {
+    if (link.write(tx, len) != len) {
+      counters.writeErrors++;
+      drop();
+      return false;
+    }
+    lastSendMs = nowMs;
+    return true;
+  }
+
+  void handlePacket(MessageHandler handler) {
+    if (reader.truncated()) return;
+    switch (reader.type()) {
+      case MQTT_CONNACK:
+        if (currentState != CONNECTING || reader.length() < 2) break;
+        counters.lastRefusal = reader.body()[1];
+        if (counters.lastRefusal == 0) {
+          currentState = CONNECTED;
+          counters.connects++;
+        } else {
+          counters.refused++;
+          drop();
+        }
+        break;
+      case MQTT_PUBLISH: {
+        MqttMessage message;
+        if (currentState != CONNECTED || !mqttParsePublish(reader.flags(), reader.body(), reader.length(), message)) {
+          break;
+        }
+        counters.received++;
+        if (handler != nullptr) handler(message);
+        break;
+      }
+      default:
+        break;  // SUBACK, PINGRESP: zählt nur als Lebenszeichen
+    }
+  }
+
+  Transport &link;
+  State currentState = DISCONNECTED;
+  MqttReader reader;
+  uint8_t tx[MQTT_TX_MAX];
+  uint32_t keepAliveMs = 0;
+  uint32_t openedMs = 0;
+  uint32_t lastSendMs = 0;
+  uint32_t lastReceiveMs = 0;
+  uint16_t nextPacketId = 0;
+  MqttClientStats counters = {};
+};
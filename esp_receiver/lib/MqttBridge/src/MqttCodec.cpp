@@ -0,0 +1,192 @@
+/**
+ * MqttCodec – Pakete kodieren und lesen
+ */
+
+#include "MqttCodec.h"
+
+#include <string.h>
+
+// =================== HILFSFUNKTIONEN ===================
+
+// Schreibt Puffer der Reihe nach; merkt sich, ob alles gepasst hat
+struct PacketWriter {
+  uint8_t *out;
+  size_t size;
+  size_t pos;
+  bool overflow;
+
+  PacketWriter(uint8_t *buffer, size_t capacity) : out(buffer), size(capacity), pos(0), overflow(false) {}
+
+  void byte(uint8_t value) {
+    if (pos < size) {
+      out[pos] = value;
+    } else {
+      overflow = true;
+    }
+    pos++;
+  }
+
+  void bytes(const uint8_t *data, size_t len) {
+    if (pos + len <= size) {
+      memcpy(out + pos, data, len);
+    } else {
+      overflow = true;
+    }
+    pos += len;
+  }
+
+  void u16(uint16_t value) {
+    byte((uint8_t)(value >> 8));
+    byte((uint8_t)value);
+  }
+
+  // Zeichenkette mit vorangestellter Länge (2 Bytes, big-endian)
+  void string(const char *text) {
+    size_t len = strlen(text);
+    u16((uint16_t)len);
+    bytes((const uint8_t *)text, len);
+  }
+
+  // Restlänge: 7 Bit je Byte, höchstes Bit = es folgt noch eins
+  void remainingLength(size_t len) {
+    do {
+      uint8_t digit = len % 128;
+      len /= 128;
+      if (len > 0) digit |= 0x80;
+      byte(digit);
+    } while (len > 0);
+  }
+
+  size_t finish() const { return overflow ? 0 : pos; }
+};
+
+static size_t stringSize(const char *text) { return 2 + strlen(text); }
+
+static bool present(const char *text) { return text != nullptr && text[0] != '\0'; }
+
+// =================== KODIEREN ===================
+
+size_t mqttEncodeConnect(const MqttConnectOptions &options, uint8_t *out, size_t size) {
+  bool will = options.willTopic != nullptr && options.willPayload != nullptr;
+  bool user = present(options.user);
+  bool password = user && options.password != nullptr;
+
+  uint8_t flags = 0x02;  // Clean Session: keine Abos und Nachrichten aufheben
+  if (will) flags |= 0x04 | (options.willRetain ? 0x20 : 0);
+  if (user) flags |= 0x80;
+  if (password) flags |= 0x40;
+
+  size_t length = 10 + stringSize(options.clientId);
+  if (will) length += stringSize(options.willTopic) + stringSize(options.willPayload);
+  if (user) length += stringSize(options.user);
+  if (password) length += stringSize(options.password);
+
+  PacketWriter w(out, size);
+  w.byte(MQTT_CONNECT << 4);
+  w.remainingLength(length);
+  w.string("MQTT");
+  w.byte(4);  // Protokollversion 3.1.1
+  w.byte(flags);
+  w.u16(options.keepAliveSec);
+  w.string(options.clientId);
+  if (will) {
+    w.string(options.willTopic);
+    w.string(options.willPayload);
+  }
+  if (user) w.string(options.user);
+  if (password) w.string(options.password);
+  return w.finish();
+}
+
+size_t mqttEncodePublish(const char *topic, const uint8_t *payload, size_t payloadLen, bool retain,
+                         uint8_t *out, size_t size) {
+  PacketWriter w(out, size);
+  w.byte((MQTT_PUBLISH << 4) | (retain ? 0x01 : 0));  // QoS 0
+  w.remainingLength(stringSize(topic) + payloadLen);
+  w.string(topic);
+  w.bytes(payload, payloadLen);
+  return w.finish();
+}
+
+size_t mqttEncodeSubscribe(uint16_t packetId, const char *filter, uint8_t *out, size_t size) {
+  PacketWriter w(out, size);
+  w.byte((MQTT_SUBSCRIBE << 4) | 0x02);  // Flags laut Standard fest 0010
+  w.remainingLength(2 + stringSize(filter) + 1);
+  w.u16(packetId);
+  w.string(filter);
+  w.byte(0);  // QoS 0
+  return w.finish();
+}
+
+size_t mqttEncodeEmpty(MqttPacketType type, uint8_t *out, size_t size) {
+  PacketWriter w(out, size);
+  w.byte(type << 4);
+  w.byte(0);
+  return w.finish();
+}
+
+// =================== LESEN ===================
+
+bool mqttParsePublish(uint8_t flags, const uint8_t *body, size_t len, MqttMessage &message) {
+  if (len < 2) return false;
+  size_t topicLen = ((size_t)body[0] << 8) | body[1];
+  size_t offset = 2 + topicLen;
+  uint8_t qos = (flags >> 1) & 0x03;
+  if (qos == 3) return false;
+  if (qos > 0) offset += 2;  // Paket-ID (abonniert wird nur QoS 0)
+  if (offset > len) return false;
+
+  message.topic = (const char *)body + 2;
+  message.topicLen = topicLen;
+  message.payload = body + offset;
+  message.payloadLen = len - offset;
+  message.retain = (flags & 0x01) != 0;
+  return true;
+}
+
+void MqttReader::reset() {
+  phase = HEADER;
+  remaining = 0;
+  received = 0;
+  broken = false;
+}
+
+bool MqttReader::feed(uint8_t byte) {
+  switch (phase) {
+    case HEADER:
+      header = byte;
+      remaining = 0;
+      multiplier = 1;
+      lengthBytes = 0;
+      phase = LENGTH;
+      return false;
+
+    case LENGTH:
+      remaining += (size_t)(byte & 0x7F) * multiplier;
+      multiplier *= 128;
+      lengthBytes++;
+      if (byte & 0x80) {
+        if (lengthBytes == 4) {
+          broken = true;
+          phase = HEADER;
+        }
+        return false;
+      }
+      received = 0;
+      if (remaining == 0) {
+        phase = HEADER;
+        return true;
+      }
+      phase = BODY;
+      return false;
+
+    case BODY:
+      if (received < MQTT_READER_MAX) buffer[received] = byte;
+      received++;
+      if (received < remaining) return false;
+      phase = HEADER;
+      if (truncated()) skippedPackets++;
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,104 @@
+/**
+ * MqttCodec – MQTT 3.1.1, nur der Teil, den die Brücke braucht
+ *
+ * Gesendet werden CONNECT (mit Testament), PUBLISH, SUBSCRIBE, PINGREQ und
+ * DISCONNECT, gelesen CONNACK, SUBACK, PUBLISH und PINGRESP. Alles mit
+ * QoS 0: Zustände gehen als letzter Wert je Topic (retained) hinaus, ein
+ * verlorener Wert wird vom nächsten ersetzt; Befehle bestätigt der
+ * Empfänger über das Zustands-Topic des Motors. So braucht es weder
+ * Paket-IDs im Flug noch Wiederholungspuffer.
+ *
+ * Kodieren schreibt in einen Puffer des Aufrufers (nichts dynamisch),
+ * Lesen geht Byte für Byte durch MqttReader – die Bytes können in
+ * beliebigen Stücken aus dem TCP-Strom kommen.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Größtes Paket, das MqttReader vollständig aufhebt (größere werden
+// überlesen und gezählt). Eingehend sind das nur Befehle und Bestätigungen.
+#ifndef MQTT_READER_MAX
+#define MQTT_READER_MAX 256
+#endif
+
+// Pakettypen (oberes Halbbyte des ersten Bytes)
+enum MqttPacketType : uint8_t {
+  MQTT_CONNECT = 1,
+  MQTT_CONNACK = 2,
+  MQTT_PUBLISH = 3,
+  MQTT_SUBSCRIBE = 8,
+  MQTT_SUBACK = 9,
+  MQTT_PINGREQ = 12,
+  MQTT_PINGRESP = 13,
+  MQTT_DISCONNECT = 14,
+};
+
+struct MqttConnectOptions {
+  const char *clientId;
+  const char *user;         // nullptr oder "" = ohne Anmeldung
+  const char *password;
+  const char *willTopic;    // Testament (vom Broker bei Verbindungsabbruch
+  const char *willPayload;  // veröffentlicht), nullptr = ohne
+  bool willRetain;
+  uint16_t keepAliveSec;
+};
+
+// Kodieren: Rückgabe = Länge des Pakets, 0 = passt nicht in out
+size_t mqttEncodeConnect(const MqttConnectOptions &options, uint8_t *out, size_t size);
+size_t mqttEncodePublish(const char *topic, const uint8_t *payload, size_t payloadLen, bool retain,
+                         uint8_t *out, size_t size);
+size_t mqttEncodeSubscribe(uint16_t packetId, const char *filter, uint8_t *out, size_t size);
+size_t mqttEncodeEmpty(MqttPacketType type, uint8_t *out, size_t size);  // PINGREQ, DISCONNECT
+
+// Eingehende Nachricht (zeigt in den Puffer des MqttReader)
+struct MqttMessage {
+  const char *topic;  // nicht nullterminiert
+  size_t topicLen;
+  const uint8_t *payload;
+  size_t payloadLen;
+  bool retain;
+};
+
+// Zerlegt den Inhalt eines PUBLISH-Pakets. Rückgabe: false = ungültig
+bool mqttParsePublish(uint8_t flags, const uint8_t *body, size_t len, MqttMessage &message);
+
+// Liest Pakete aus dem Bytestrom
+class MqttReader {
+public:
+  // Nimmt ein Byte. Rückgabe: true = ein Paket ist vollständig (bis zum
+  // nächsten feed() über type(), flags() und body() lesbar)
+  bool feed(uint8_t byte);
+
+  void reset();
+
+  uint8_t type() const { return header >> 4; }
+  uint8_t flags() const { return header & 0x0F; }
+  const uint8_t *body() const { return buffer; }
+  size_t length() const { return remaining; }
+
+  // Paket war größer als MQTT_READER_MAX: Inhalt fehlt, nur überlesen
+  bool truncated() const { return remaining > MQTT_READER_MAX; }
+
+  // Längenangabe ungültig (mehr als 4 Bytes): der Strom ist nicht mehr
+  // synchron, die Verbindung muss neu aufgebaut werden
+  bool malformed() const { return broken; }
+
+  // Zu große Pakete seit dem Start
+  uint32_t skipped() const { return skippedPackets; }
+
+private:
+  enum Phase : uint8_t { HEADER, LENGTH, BODY };
+
+  Phase phase = HEADER;
+  uint8_t header = 0;
+  uint8_t lengthBytes = 0;
+  uint32_t multiplier = 1;
+  size_t remaining = 0;  // Länge des Pakets (Restlänge aus dem Kopf)
+  size_t received = 0;
+  bool broken = false;
+  uint32_t skippedPackets = 0;
+  uint8_t buffer[MQTT_READER_MAX];
+};
@@ -0,0 +1,129 @@
+/**
+ * PublishQueue – Plätze, Reihenfolge und Prüfsummen
+ */
+
+#include "PublishQueue.h"
+
+#include <string.h>
+
+// FNV-1a über Topic, Wert und retain-Flag (erkennt unveränderte Werte)
+static uint32_t messageHash(const char *topic, const char *payload, bool retain) {
+  uint32_t hash = 2166136261u;
+  for (const char *p = topic; *p != '\0'; p++) hash = (hash ^ (uint8_t)*p) * 16777619u;
+  hash = (hash ^ 0xFF) * 16777619u;  // Trenner: "ab"+"c" != "a"+"bc"
+  for (const char *p = payload; *p != '\0'; p++) hash = (hash ^ (uint8_t)*p) * 16777619u;
+  return (hash ^ (retain ? 1u : 0u)) * 16777619u;
+}
+
+// =================== EINSTELLEN ===================
+
+bool PublishQueue::post(int slot, const char *topic, const char *payload, bool retain) {
+  size_t topicLen = strlen(topic);
+  size_t payloadLen = strlen(payload);
+  if (slot < 0 || slot >= PUBLISH_QUEUE_SLOTS || topicLen == 0 || topicLen >= PUBLISH_TOPIC_MAX ||
+      payloadLen >= PUBLISH_PAYLOAD_MAX) {
+    portENTER_CRITICAL(&lock);
+    counters.rejected++;
+    portEXIT_CRITICAL(&lock);
+    return false;
+  }
+  uint32_t hash = messageHash(topic, payload, retain);  // außerhalb der Sperre
+
+  portENTER_CRITICAL(&lock);
+  Slot &s = slots[slot];
+  if (s.used && s.hash == hash && (s.dirty || s.sent)) {
+    counters.unchanged++;  // gleicher Wert wartet schon oder ist gesendet
+  } else {
+    if (s.dirty && s.sent && hash == s.sentHash) {
+      // Zurück auf den gesendeten Wert, bevor der neue hinaus ist: nichts zu tun
+      s.dirty = false;
+      counters.coalesced++;
+    } else if (s.dirty) {
+      counters.coalesced++;
+    } else {
+      counters.posted++;
+      enqueue(s);
+    }
+    memcpy(s.topic, topic, topicLen + 1);
+    memcpy(s.payload, payload, payloadLen + 1);
+    s.length = (uint16_t)payloadLen;
+    s.retain = retain;
+    s.hash = hash;
+    s.used = true;
+  }
+  portEXIT_CRITICAL(&lock);
+  return true;
+}
+
+void PublishQueue::enqueue(Slot &slot) {
+  slot.dirty = true;
+  slot.order = nextOrder++;
+}
+
+// =================== ABHOLEN ===================
+
+bool PublishQueue::take(PublishMessage &message) {
+  portENTER_CRITICAL(&lock);
+  int oldest = -1;
+  for (int i = 0; i < PUBLISH_QUEUE_SLOTS; i++) {
+    if (!slots[i].dirty) continue;
+    // Überlaufsicherer Vergleich der Reihenfolge
+    if (oldest < 0 || (int32_t)(slots[i].order - slots[oldest].order) < 0) oldest = i;
+  }
+  if (oldest >= 0) {
+    Slot &s = slots[oldest];
+    message.slot = oldest;
+    message.retain = s.retain;
+    message.length = s.length;
+    memcpy(message.topic, s.topic, sizeof(message.topic));
+    memcpy(message.payload, s.payload, s.length + 1);
+    s.dirty = false;
+    s.sent = true;
+    s.sentHash = s.hash;
+    counters.taken++;
+  }
+  portEXIT_CRITICAL(&lock);
+  return oldest >= 0;
+}
+
+void PublishQueue::requeue(const PublishMessage &message) {
+  if (message.slot < 0 || message.slot >= PUBLISH_QUEUE_SLOTS) return;
+  portENTER_CRITICAL(&lock);
+  Slot &s = slots[message.slot];
+  s.sent = false;  // nie angekommen
+  if (!s.dirty) {  // sonst wartet schon ein neuerer Wert
+    enqueue(s);
+    counters.requeued++;
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+void PublishQueue::requeueAll() {
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < PUBLISH_QUEUE_SLOTS; i++) {
+    Slot &s = slots[i];
+    if (!s.used) continue;
+    s.sent = false;
+    enqueue(s);  // auch wartende Werte: neu in der Reihenfolge der Plätze
+  }
+  portEXIT_CRITICAL(&lock);
+}
+
+// =================== STATUS ===================
+
+int PublishQueue::pending() const {
+  int count = 0;
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < PUBLISH_QUEUE_SLOTS; i++) {
+    if (slots[i].dirty) count++;
+  }
+  portEXIT_CRITICAL(&lock);
+  return count;
+}
+
+PublishQueueStats PublishQueue::stats() const {
+  portENTER_CRITICAL(&lock);
+  PublishQueueStats copy = counters;
+  portEXIT_CRITICAL(&lock);
+  return copy;
+}
@@ -0,0 +1,99 @@
+/**
+ * PublishQueue – begrenzte Warteschlange für MQTT-Zustände, letzter Wert je Topic
+ *
+ * Steuer-Task und loop() melden Zustände (Motor, Sender, Funkstrecke); der
+ * MQTT-Task veröffentlicht sie, sobald die Verbindung es zulässt. Jedes
+ * Topic hat einen festen Platz (slot), den der Aufrufer vergibt. Ein neuer
+ * Wert ersetzt einen noch nicht gesendeten: ein Schalt-Burst oder ein
+ * hängender Broker erzeugt so keinen Stau, gesendet wird nur der neueste
+ * Stand, und der Speicher ist fest (PUBLISH_QUEUE_SLOTS Plätze).
+ *
+ * Reihenfolge: Ein Platz reiht sich beim ersten neuen Wert hinten ein und
+ * behält diesen Platz, auch wenn der Wert danach noch ersetzt wird – ein
+ * Topic, das sich dauernd ändert, drängt die anderen nicht ab.
+ * Ein Wert, der dem zuletzt gesendeten gleicht (Prüfsumme), wird nicht
+ * noch einmal gesendet.
+ *
+ * Nebenläufigkeit: post() ist von mehreren Tasks aus erlaubt und hält die
+ * Sperre (Spinlock) nur für ein memcpy; es wartet nie auf das Netz. take(),
+ * requeue() und requeueAll() gehören dem MQTT-Task.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+// =================== KONFIGURATION ===================
+
+#ifndef PUBLISH_QUEUE_SLOTS
+#define PUBLISH_QUEUE_SLOTS 16
+#endif
+#define PUBLISH_TOPIC_MAX 48     // inkl. Nullbyte
+#define PUBLISH_PAYLOAD_MAX 192  // inkl. Nullbyte
+
+// =================== DATEN ===================
+
+struct PublishMessage {
+  int slot;
+  bool retain;
+  uint16_t length;
+  char topic[PUBLISH_TOPIC_MAX];
+  char payload[PUBLISH_PAYLOAD_MAX];
+};
+
+struct PublishQueueStats {
+  uint32_t posted;     // neue Werte (nicht gleich dem gesendeten)
+  uint32_t coalesced;  // ungesendeten Wert ersetzt
+  uint32_t unchanged;  // gleich dem zuletzt gesendeten, nicht eingereiht
+  uint32_t rejected;   // ungültiger Platz, Topic oder Wert zu lang
+  uint32_t taken;      // an den MQTT-Task übergeben
+  uint32_t requeued;   // nach einem Sendefehler wieder eingereiht
+};
+
+// =================== WARTESCHLANGE ===================
+
+class PublishQueue {
+public:
+  // Legt den neuesten Wert für slot ab. Kehrt immer sofort zurück.
+  // Rückgabe: false = abgelehnt (Platz ungültig, Topic oder Wert zu lang)
+  bool post(int slot, const char *topic, const char *payload, bool retain);
+
+  // Holt den am längsten wartenden Wert. Rückgabe: false = nichts offen
+  bool take(PublishMessage &message);
+
+  // Wert konnte nicht gesendet werden: wieder einreihen, falls inzwischen
+  // kein neuerer gekommen ist
+  void requeue(const PublishMessage &message);
+
+  // Nach dem (Wieder-)Verbinden: alle bekannten Werte noch einmal senden
+  // (retained-Werte könnten auf dem Broker fehlen), in der Reihenfolge der
+  // Plätze – der Aufrufer legt fest, was zuerst hinausgeht
+  void requeueAll();
+
+  int pending() const;
+  PublishQueueStats stats() const;
+
+private:
+  struct Slot {
+    bool used;
+    bool dirty;
+    bool sent;           // sentHash gilt (Wert an den MQTT-Task übergeben)
+    bool retain;
+    uint16_t length;
+    uint32_t order;      // Platz in der Reihe (nur gültig, wenn dirty)
+    uint32_t hash;       // Prüfsumme des aktuellen Werts
+    uint32_t sentHash;   // Prüfsumme des zuletzt übergebenen Werts
+    char topic[PUBLISH_TOPIC_MAX];
+    char payload[PUBLISH_PAYLOAD_MAX];
+  };
+
+  void enqueue(Slot &slot);
+
+  Slot slots[PUBLISH_QUEUE_SLOTS] = {};
+  uint32_t nextOrder = 0;
+  PublishQueueStats counters = {};
+  mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -0,0 +1,65 @@
+/**
+ * GpioOutputs – Ausgänge direkt an ESP32-GPIOs (z.B. über ULN2803)
+ *
+ * Config::pins[i] ist die GPIO-Nummer von Kanal i. Geschaltet wird das
+ * komplette Ausgangswort über die Set/Clear-Register: zuerst ein Zugriff auf
+ * GPIO_OUT_W1TC für alle abzuschaltenden Ausgänge, dann einer auf
+ * GPIO_OUT_W1TS für alle einzuschaltenden (GPIO 32/33 liegen im zweiten
+ * Registersatz GPIO_OUT1_*, das kostet dann je einen Zugriff mehr).
+ * Zwischen den Zugriffen liegen nur wenige CPU-Takte.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "soc/gpio_reg.h"
+
+#include "OutputTopology.h"
+
+template <typename Topology, typename Config>
+class GpioOutputs {
+public:
+  using Mask = typename Topology::Mask;
+
+  static constexpr const char *KIND = "GPIO";
+
+  // GPIO 34-39 sind beim ESP32 nur Eingänge
+  static_assert(highestBit(Config::pins) < 34, "Ausgangs-Pins müssen unter GPIO 34 liegen");
+  static_assert(bitsUnique(Config::pins), "Ausgangs-Pin doppelt vergeben");
+
+  // Alle Ausgänge aus, dann als OUTPUT schalten (kein kurzer HIGH-Puls)
+  void begin() {
+    writeClear(table.lookup(Topology::ALL));
+    for (int i = 0; i < Topology::CHANNELS; i++) pinMode(Config::pins[i], OUTPUT);
+  }
+
+  // Schaltet von previous auf next. Rückgabe: CPU-Takte zwischen erstem und
+  // letztem Registerzugriff (so lange sind die Ausgänge gemischt)
+  uint32_t commit(Mask previous, Mask next) {
+    Mask changed = (Mask)(previous ^ next);
+    uint64_t clearBits = table.lookup((Mask)(changed & ~next));
+    uint64_t setBits = table.lookup((Mask)(changed & next));
+
+    uint32_t start = ESP.getCycleCount();
+    writeClear(clearBits);
+    writeSet(setBits);
+    return ESP.getCycleCount() - start;
+  }
+
+  // Physische Lage von Kanal i (für Ausgaben)
+  static int location(int channel) { return Config::pins[channel]; }
+
+private:
+  static constexpr ChannelTable<Topology, uint64_t> table =
+      makeChannelTable<Topology, uint64_t>(Config::pins);
+
+  static void writeClear(uint64_t bits) {
+    if ((uint32_t)bits != 0) REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)bits);
+    if ((bits >> 32) != 0) REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(bits >> 32));
+  }
+
+  static void writeSet(uint64_t bits) {
+    if ((uint32_t)bits != 0) REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)bits);
+    if ((bits >> 32) != 0) REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(bits >> 32));
+  }
+};
@@ -0,0 +1,66 @@
+/**
+ * I2cExpanderOutputs – Ausgänge an einem MCP23017 (16 Ports, I2C)
+ *
+ * Config::bits[i] ist der Port von Kanal i: 0-7 = GPA0-GPA7,
+ * 8-15 = GPB0-GPB7. Config::address ist die I2C-Adresse (0x20-0x27).
+ *
+ * Geschrieben wird das komplette Bitbild in einer Übertragung (OLATA,
+ * OLATB mit automatisch weiterzählender Registeradresse). Port A wechselt
+ * nach dem ersten Datenbyte, Port B nach dem zweiten: Zwischen beiden liegt
+ * ein I2C-Byte (bei 400 kHz etwa 23 µs). Motoren, deren beide Ausgänge in
+ * derselben Hälfte liegen, schalten trotzdem gleichzeitig.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "OutputTopology.h"
+
+template <typename Topology, typename Config>
+class I2cExpanderOutputs {
+public:
+  using Mask = typename Topology::Mask;
+
+  static constexpr const char *KIND = "Expander-Port";
+
+  static_assert(highestBit(Config::bits) < 16, "MCP23017 hat 16 Ports");
+  static_assert(bitsUnique(Config::bits), "Expander-Port doppelt vergeben");
+
+  // Register (IOCON.BANK = 0, Standard nach dem Einschalten)
+  static constexpr uint8_t REG_IODIRA = 0x00;
+  static constexpr uint8_t REG_OLATA = 0x14;
+
+  void begin() {
+    Wire.begin();
+    Wire.setClock(Config::i2cHz);
+    writePair(REG_OLATA, 0);   // erst alle Ausgänge aus ...
+    writePair(REG_IODIRA, 0);  // ... dann alle Ports als Ausgang
+  }
+
+  // Rückgabe: CPU-Takte der Übertragung (obere Grenze für den Versatz
+  // zwischen Port A und B)
+  uint32_t commit(Mask previous, Mask next) {
+    (void)previous;
+    uint16_t image = table.lookup(next);
+    uint32_t start = ESP.getCycleCount();
+    writePair(REG_OLATA, image);
+    return ESP.getCycleCount() - start;
+  }
+
+  static int location(int channel) { return Config::bits[channel]; }
+
+private:
+  static constexpr ChannelTable<Topology, uint16_t> table =
+      makeChannelTable<Topology, uint16_t>(Config::bits);
+
+  // Schreibt ein Registerpaar (A, B) in einer Übertragung
+  static bool writePair(uint8_t reg, uint16_t value) {
+    Wire.beginTransmission(Config::address);
+    Wire.write(reg);
+    Wire.write((uint8_t)value);
+    Wire.write((uint8_t)(value >> 8));
+    return Wire.endTransmission() == 0;
+  }
+};
@@ -0,0 +1,124 @@
+/**
+ * OutputTopology – Motoren und Ausgänge des Empfängers zur Compile-Zeit
+ *
+ * Bisher waren Ausgänge, Namen und Motor-Paare als Felder mit fester Größe
+ * 6 bzw. 3 verdrahtet, und jedes Paket lief in einer Schleife über alle
+ * Motoren. Hier wird die Anlage einmal als Anzahl Motoren beschrieben; alles
+ * andere (Breite der Kanalmaske, Bitmasken für die Verriegelung) entsteht
+ * beim Übersetzen.
+ *
+ * Kanäle: Jeder Motor m hat zwei Ausgänge, Kanal 2m = Linkslauf und
+ * Kanal 2m+1 = Rechtslauf (wie Taster 1/2, 3/4, 5/6 beim Sender). Wo die
+ * Kanäle physisch landen, legt das Ausgangs-Backend fest: GpioOutputs.h
+ * (direkt), ShiftRegisterOutputs.h (74HC595 über SPI) oder
+ * I2cExpanderOutputs.h (MCP23017). Alle haben dieselbe Schnittstelle
+ * begin() / commit(previous, next) / location(channel).
+ *
+ * Motor-Verriegelung: Weil Links/Rechts immer nebeneinander liegen, werden
+ * alle Motoren gleichzeitig mit ein paar Bit-Operationen geprüft – ohne
+ * Schleife, die Kosten hängen nicht von der Anzahl Motoren ab.
+ *
+ * Kanalmaske -> Bitbild des Backends (Pins, Schieberegister-Bits, Ports):
+ * ChannelTable wird zur Compile-Zeit erzeugt, ein Teil mit 256 Einträgen je
+ * Byte der Maske. Pro Umschaltung kostet das einen Tabellenzugriff je acht
+ * Kanäle statt einer Schleife über alle Ausgänge.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Kleinster vorzeichenloser Typ mit mindestens Bits Bits (höchstens 64)
+template <int Bits>
+using ChannelMaskFor = typename std::conditional<(Bits <= 8), uint8_t,
+    typename std::conditional<(Bits <= 16), uint16_t,
+    typename std::conditional<(Bits <= 32), uint32_t, uint64_t>::type>::type>::type;
+
+template <int Motors>
+struct MotorTopology {
+  static_assert(Motors >= 1 && Motors <= 32, "1 bis 32 Motoren (höchstens 64 Kanäle)");
+
+  static constexpr int MOTORS = Motors;
+  static constexpr int CHANNELS = 2 * Motors;
+  using Mask = ChannelMaskFor<CHANNELS>;
+
+  // Alle Kanäle / alle Linkslauf-Kanäle (gerade Bits) / alle Rechtslauf-Kanäle
+  static constexpr Mask ALL = (Mask)(~0ULL >> (64 - CHANNELS));
+  static constexpr Mask LEFT = (Mask)(0x5555555555555555ULL & ALL);
+  static constexpr Mask RIGHT = (Mask)(LEFT << 1);
+
+  static constexpr int leftChannel(int motor) { return 2 * motor; }
+  static constexpr int rightChannel(int motor) { return 2 * motor + 1; }
+  static constexpr int motorOf(int channel) { return channel >> 1; }
+  static constexpr Mask motorBits(int motor) { return (Mask)(3ULL << (2 * motor)); }
+
+  // Motoren, bei denen beide Richtungen gesetzt sind (Bit am Linkslauf-Kanal)
+  static constexpr Mask conflicts(Mask mask) {
+    return (Mask)(mask & (mask >> 1) & LEFT);
+  }
+
+  // Erlaubte Ausgänge: Motoren mit beiden Richtungen bleiben ganz aus
+  static constexpr Mask safeMask(Mask mask) {
+    return (Mask)(mask & ~(conflicts(mask) * 3));
+  }
+
+  // Index des niedrigsten gesetzten Kanals (mask != 0)
+  static int lowestChannel(Mask mask) { return __builtin_ctzll((unsigned long long)mask); }
+};
+
+// Tabelle Kanalmaske -> Bitbild (Word), ein Teil je Byte der Kanalmaske
+template <typename Topology, typename Word>
+struct ChannelTable {
+  static constexpr int CHUNKS = (Topology::CHANNELS + 7) / 8;
+  Word entry[CHUNKS][256];
+
+  Word lookup(typename Topology::Mask mask) const {
+    Word word = 0;
+    for (int chunk = 0; chunk < CHUNKS; chunk++) {
+      word |= entry[chunk][(uint8_t)((uint64_t)mask >> (8 * chunk))];
+    }
+    return word;
+  }
+};
+
+// Erzeugt die Tabelle zur Compile-Zeit. bits[i] = Bitposition von Kanal i
+// im Bitbild (z.B. GPIO-Nummer)
+template <typename Topology, typename Word, size_t N>
+constexpr ChannelTable<Topology, Word> makeChannelTable(const uint8_t (&bits)[N]) {
+  static_assert(N == (size_t)Topology::CHANNELS, "Ein Eintrag je Kanal (2 je Motor)");
+  ChannelTable<Topology, Word> table = {};
+  for (int chunk = 0; chunk < table.CHUNKS; chunk++) {
+    for (int value = 0; value < 256; value++) {
+      Word word = 0;
+      for (int bit = 0; bit < 8; bit++) {
+        int channel = chunk * 8 + bit;
+        if (channel < Topology::CHANNELS && ((value >> bit) & 1)) word |= (Word)1 << bits[channel];
+      }
+      table.entry[chunk][value] = word;
+    }
+  }
+  return table;
+}
+
+// Höchste Bitposition in bits (für Prüfungen zur Compile-Zeit)
+template <size_t N>
+constexpr int highestBit(const uint8_t (&bits)[N]) {
+  int highest = 0;
+  for (size_t i = 0; i < N; i++) {
+    if (bits[i] > highest) highest = bits[i];
+  }
+  return highest;
+}
+
+// Prüft, dass keine Bitposition doppelt vorkommt
+template <size_t N>
+constexpr bool bitsUnique(const uint8_t (&bits)[N]) {
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = i + 1; j < N; j++) {
+      if (bits[i] == bits[j]) return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+/**
+ * ShiftRegisterOutputs – Ausgänge an einer Kette von 74HC595 (über SPI)
+ *
+ * Config::bits[i] ist die Position von Kanal i in der Kette: Bit 0-7 = Q0-Q7
+ * des ersten Bausteins (direkt am ESP32), Bit 8-15 = Q0-Q7 des zweiten usw.
+ * Bis zu acht Bausteine (64 Ausgänge).
+ *
+ * Es wird immer das komplette Bitbild geschoben (SPI: MOSI -> SER,
+ * SCK -> SRCLK) und danach mit einem Puls an Config::latchPin (RCLK)
+ * übernommen. Alle Ausgänge wechseln mit derselben Flanke – gemischte
+ * Zustände während des Schiebens sind nach außen nicht sichtbar.
+ *
+ * /OE der Bausteine sollte per Pull-Up auf HIGH liegen und erst nach
+ * begin() freigegeben werden, sonst sind die Ausgänge beim Einschalten
+ * undefiniert.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "soc/gpio_reg.h"
+
+#include "OutputTopology.h"
+
+template <typename Topology, typename Config>
+class ShiftRegisterOutputs {
+public:
+  using Mask = typename Topology::Mask;
+
+  static constexpr const char *KIND = "Schieberegister-Bit";
+  static constexpr int CHIPS = highestBit(Config::bits) / 8 + 1;
+
+  static_assert(highestBit(Config::bits) < 64, "höchstens acht 74HC595 (64 Bits)");
+  static_assert(bitsUnique(Config::bits), "Schieberegister-Bit doppelt vergeben");
+  static_assert(Config::latchPin < 32, "Latch-Pin muss unter GPIO 32 liegen");
+
+  void begin() {
+    pinMode(Config::latchPin, OUTPUT);
+    REG_WRITE(GPIO_OUT_W1TC_REG, LATCH_BIT);
+    SPI.begin();
+    shiftOut(0);
+    REG_WRITE(GPIO_OUT_W1TS_REG, LATCH_BIT);
+    REG_WRITE(GPIO_OUT_W1TC_REG, LATCH_BIT);
+  }
+
+  // Schiebt das Bitbild zu next und übernimmt es. Rückgabe: CPU-Takte des
+  // Latch-Pulses (nur in dieser Zeit können die Ausgänge gemischt sein)
+  uint32_t commit(Mask previous, Mask next) {
+    (void)previous;  // ein Schieberegister braucht immer das ganze Bild
+    shiftOut(table.lookup(next));
+
+    uint32_t start = ESP.getCycleCount();
+    REG_WRITE(GPIO_OUT_W1TS_REG, LATCH_BIT);
+    REG_WRITE(GPIO_OUT_W1TC_REG, LATCH_BIT);
+    return ESP.getCycleCount() - start;
+  }
+
+  static int location(int channel) { return Config::bits[channel]; }
+
+private:
+  static constexpr uint32_t LATCH_BIT = 1UL << Config::latchPin;
+
+  static constexpr ChannelTable<Topology, uint64_t> table =
+      makeChannelTable<Topology, uint64_t>(Config::bits);
+
+  // Letzter Baustein der Kette zuerst, jeweils Q7 zuerst
+  static void shiftOut(uint64_t image) {
+    SPI.beginTransaction(SPISettings(Config::spiHz, MSBFIRST, SPI_MODE0));
+    for (int chip = CHIPS - 1; chip >= 0; chip--) {
+      SPI.transfer((uint8_t)(image >> (8 * chip)));
+    }
+    SPI.endTransaction();
+  }
+};
@@ -0,0 +1,72 @@
+/**
+ * SenderRegistry – Hash-Tabelle und Sequenzprüfung
+ */
+
+#include "SenderRegistry.h"
+
+#include <string.h>
+
+SenderRegistry::SenderRegistry() {
+  memset(entries, 0, sizeof(entries));
+  for (int i = 0; i < SENDER_HASH_SLOTS; i++) slots[i] = -1;
+}
+
+// Die letzten vier Bytes einer MAC sind gerätespezifisch; Multiplikation mit
+// der Fibonacci-Konstante verteilt sie gleichmäßig auf die Plätze
+uint32_t SenderRegistry::hash(const uint8_t *mac) {
+  uint32_t key = (uint32_t)mac[2] | ((uint32_t)mac[3] << 8) | ((uint32_t)mac[4] << 16) | ((uint32_t)mac[5] << 24);
+  return (uint32_t)(key * 2654435769U) >> (32 - SENDER_HASH_BITS);
+}
+
+int SenderRegistry::add(const uint8_t mac[6], const char *name) {
+  if (entryCount >= SENDER_MAX || find(mac) >= 0) return -1;
+
+  int index = entryCount++;
+  SenderEntry &entry = entries[index];
+  memset(&entry, 0, sizeof(entry));
+  memcpy(entry.mac, mac, 6);
+  entry.name = name;
+
+  uint32_t slot = hash(mac);
+  while (slots[slot] >= 0) slot = (slot + 1) & (SENDER_HASH_SLOTS - 1);
+  slots[slot] = (int8_t)index;
+  return index;
+}
+
+int SenderRegistry::find(const uint8_t *mac) const {
+  uint32_t slot = hash(mac);
+  // Tabelle ist höchstens halb voll: spätestens nach wenigen Plätzen kommt ein freier
+  for (int probes = 0; probes < SENDER_HASH_SLOTS; probes++) {
+    int index = slots[slot];
+    if (index < 0) return -1;
+    if (memcmp(entries[index].mac, mac, 6) == 0) return index;
+    slot = (slot + 1) & (SENDER_HASH_SLOTS - 1);
+  }
+  return -1;
+}
+
+SequenceVerdict SenderRegistry::checkSequence(int index, uint16_t sequence, uint32_t nowMs) {
+  SenderEntry &entry = entries[index];
+  SequenceVerdict verdict = entry.window.check(sequence);
+
+  if (verdict == SEQ_TOO_OLD && nowMs - entry.lastSeenMs > REPLAY_RESYNC_MS) {
+    // Sender war lange still und hat vermutlich neu gestartet
+    entry.window.reset(sequence);
+    verdict = SEQ_RESYNC;
+  }
+
+  switch (verdict) {
+    case SEQ_NEW:       break;
+    case SEQ_LATE:      entry.stats.late++; break;
+    case SEQ_RESYNC:    entry.stats.resyncs++; break;
+    case SEQ_DUPLICATE: entry.stats.duplicates++; break;
+    case SEQ_TOO_OLD:   entry.stats.tooOld++; break;
+  }
+  if (sequenceAccepted(verdict)) markSeen(index, nowMs);
+  return verdict;
+}
+
+void SenderRegistry::markSeen(int index, uint32_t nowMs) {
+  entries[index].stats.packets++;
+  entries[index].lastSeenMs = nowMs;
+}
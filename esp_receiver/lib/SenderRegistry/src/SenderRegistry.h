@@ -0,0 +1,158 @@
+/**
+ * SenderRegistry – Tabelle der bekannten Sender (Fernbedienungen)
+ *
+ * Bisher kannte der Empfänger genau eine Sender-MAC und eine einzige
+ * Sequenznummer für alle. Eine Anlage hat aber oft mehrere Sender
+ * (Wandtaster, Handsender, Ersatzgerät). Jeder Sender bekommt hier einen
+ * Eintrag mit eigenem Duplikat-/Wiederholungsschutz und eigener Statistik.
+ *
+ * Suche nach MAC in konstanter Zeit: Die Einträge liegen in einem festen
+ * Feld, dazu kommt eine kleine Hash-Tabelle (offene Adressierung, höchstens
+ * halb voll). Ein Lookup kostet einen Hash und im Mittel ein bis zwei
+ * Vergleiche – unabhängig davon, wie viele Sender eingetragen sind. Auch
+ * fremde MACs werden so schnell verworfen.
+ *
+ * Sequenzfenster (wie bei IPsec): Pro Sender werden die höchste gesehene
+ * Sequenznummer und ein Bitfeld der letzten REPLAY_WINDOW_SIZE Nummern
+ * gespeichert. Neue Nummern werden angenommen, verspätete (aber noch nicht
+ * gesehene) ebenfalls, doppelte und zu alte werden abgelehnt. Die Nummern
+ * sind 16 Bit und laufen über (Vergleich modulo 2^16).
+ *
+ * Startet ein Sender neu (z.B. nach Stromausfall, Sequenz wieder bei 0),
+ * wären seine Nummern "zu alt". Hat man den Sender länger als
+ * REPLAY_RESYNC_MS nicht gehört, wird das Fenster deshalb neu aufgesetzt.
+ *
+ * Einträge werden nur in setup() angelegt; danach schreibt nur noch der
+ * Empfangs-Callback (Statistik, Fenster).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =================== KONFIGURATION ===================
+
+// Maximale Anzahl Sender (höchstens 8: Sender-Bitmasken sind uint8_t)
+#ifndef SENDER_MAX
+#define SENDER_MAX 8
+#endif
+
+// Plätze der Hash-Tabelle (Zweierpotenz, mindestens doppelt so viele wie Sender)
+#define SENDER_HASH_BITS 4
+#define SENDER_HASH_SLOTS (1 << SENDER_HASH_BITS)
+
+// Größe des Sequenzfensters (Bits in ReplayWindow::bitmap)
+#define REPLAY_WINDOW_SIZE 32
+
+// Nach so langer Funkstille darf ein Sender mit beliebiger Sequenz neu beginnen
+#ifndef REPLAY_RESYNC_MS
+#define REPLAY_RESYNC_MS 10000
+#endif
+
+static_assert(SENDER_MAX <= 8, "SENDER_MAX: Sender-Bitmasken sind 8 Bit breit");
+static_assert(SENDER_HASH_SLOTS >= 2 * SENDER_MAX, "Hash-Tabelle höchstens halb voll");
+
+// =================== SEQUENZFENSTER ===================
+
+enum SequenceVerdict {
+  SEQ_NEW = 0,     // neuer als alles bisher
+  SEQ_LATE,        // verspätet, aber noch nicht gesehen (angenommen)
+  SEQ_RESYNC,      // Fenster nach Funkstille neu aufgesetzt (angenommen)
+  SEQ_DUPLICATE,   // schon gesehen (abgelehnt)
+  SEQ_TOO_OLD      // älter als das Fenster (abgelehnt, möglicher Replay)
+};
+
+inline bool sequenceAccepted(SequenceVerdict verdict) { return verdict <= SEQ_RESYNC; }
+
+struct ReplayWindow {
+  uint16_t highest;  // höchste angenommene Sequenznummer
+  uint32_t bitmap;   // Bit i = (highest - i) wurde gesehen
+  bool valid;        // false = noch kein Paket
+
+  void reset(uint16_t sequence) {
+    highest = sequence;
+    bitmap = 1;
+    valid = true;
+  }
+
+  // Prüft eine Sequenznummer und merkt sie sich, falls sie angenommen wird
+  SequenceVerdict check(uint16_t sequence) {
+    if (!valid) {
+      reset(sequence);
+      return SEQ_NEW;
+    }
+    uint16_t ahead = (uint16_t)(sequence - highest);
+    if (ahead == 0) return SEQ_DUPLICATE;
+    if (ahead < 0x8000) {
+      bitmap = ahead >= REPLAY_WINDOW_SIZE ? 1 : (bitmap << ahead) | 1;
+      highest = sequence;
+      return SEQ_NEW;
+    }
+    uint16_t behind = (uint16_t)(highest - sequence);
+    if (behind >= REPLAY_WINDOW_SIZE) return SEQ_TOO_OLD;
+    uint32_t bit = 1UL << behind;
+    if (bitmap & bit) return SEQ_DUPLICATE;
+    bitmap |= bit;
+    return SEQ_LATE;
+  }
+};
+
+// =================== EINTRÄGE ===================
+
+struct SenderStats {
+  uint32_t packets;     // angenommene Pakete
+  uint32_t duplicates;  // doppelt empfangen
+  uint32_t tooOld;      // älter als das Fenster
+  uint32_t late;        // verspätet angenommen
+  uint32_t resyncs;     // Fenster neu aufgesetzt
+  uint32_t conflicts;   // Befehl kollidierte mit einem anderen Sender
+};
+
+struct SenderEntry {
+  uint8_t mac[6];
+  const char *name;             // Klartext für Ausgaben (Literal)
+  ReplayWindow window;
+  uint32_t lastSeenMs;          // millis() des letzten angenommenen Pakets
+  int8_t lastRssi;              // Empfangspegel (gemessen, sonst vom Sender gemeldet)
+  uint16_t batteryMillivolts;   // vom Sender gemeldete Batteriespannung
+  uint16_t adcRaw;              // vom Sender gemeldeter ADC-Rohwert (ohne Energie-Frames)
+  SenderStats stats;
+
+  // Zustand des Befehls (wird vom Empfänger gepflegt)
+  uint8_t activeMask;           // Taster, die dieser Sender gerade hält
+  int64_t leaseDeadline;        // Ende der Lease (µs, esp_timer)
+  uint8_t channelOffset;        // Ausgangskanal von Taster 1
+};
+
+// =================== TABELLE ===================
+
+class SenderRegistry {
+public:
+  SenderRegistry();
+
+  // Trägt einen Sender ein (nur in setup()). Rückgabe: Index, -1 = Tabelle
+  // voll oder MAC schon vorhanden
+  int add(const uint8_t mac[6], const char *name);
+
+  // Sucht einen Sender nach MAC. Rückgabe: Index, -1 = unbekannt
+  int find(const uint8_t *mac) const;
+
+  // Prüft die Sequenznummer eines Pakets von Sender index und zählt mit.
+  // nowMs: millis() (für die Neu-Synchronisation nach Funkstille)
+  SequenceVerdict checkSequence(int index, uint16_t sequence, uint32_t nowMs);
+
+  // Zählt ein Paket ohne Sequenzprüfung (z.B. altes Format mit 8-Bit-Sequenz)
+  void markSeen(int index, uint32_t nowMs);
+
+  SenderEntry &at(int index) { return entries[index]; }
+  const SenderEntry &at(int index) const { return entries[index]; }
+  int count() const { return entryCount; }
+
+private:
+  static uint32_t hash(const uint8_t *mac);
+
+  SenderEntry entries[SENDER_MAX];
+  int8_t slots[SENDER_HASH_SLOTS];  // Index in entries, -1 = frei
+  int entryCount = 0;
+};
@@ -0,0 +1,259 @@
+/**
+ * TelemetryStore – Verdichtung, Trend und Binärformat
+ */
+
+#include "TelemetryStore.h"
+
+#include <string.h>
+
+#include "MarkiseProtocol.h"  // crc16()
+
+// =================== INTERVALLE ===================
+
+void TelemetryAccumulator::start(uint32_t newPeriod) {
+  memset(this, 0, sizeof(*this));
+  period = newPeriod;
+  minMillivolts = UINT16_MAX;
+  minRssi = INT8_MAX;
+  maxRssi = INT8_MIN;
+}
+
+void TelemetryAccumulator::add(uint16_t millivolts, int8_t rssi) {
+  count++;
+  sumMillivolts += millivolts;
+  sumRssi += rssi;
+  if (millivolts < minMillivolts) minMillivolts = millivolts;
+  if (millivolts > maxMillivolts) maxMillivolts = millivolts;
+  if (rssi < minRssi) minRssi = rssi;
+  if (rssi > maxRssi) maxRssi = rssi;
+}
+
+void TelemetryAccumulator::merge(const TelemetryAccumulator &other) {
+  if (other.count == 0) return;
+  count += other.count;
+  sumMillivolts += other.sumMillivolts;
+  sumRssi += other.sumRssi;
+  if (other.minMillivolts < minMillivolts) minMillivolts = other.minMillivolts;
+  if (other.maxMillivolts > maxMillivolts) maxMillivolts = other.maxMillivolts;
+  if (other.minRssi < minRssi) minRssi = other.minRssi;
+  if (other.maxRssi > maxRssi) maxRssi = other.maxRssi;
+}
+
+TelemetryBucket TelemetryAccumulator::finish() const {
+  TelemetryBucket bucket;
+  memset(&bucket, 0, sizeof(bucket));
+  bucket.period = period;
+  bucket.count = count > UINT16_MAX ? UINT16_MAX : (uint16_t)count;
+  bucket.minMillivolts = minMillivolts;
+  bucket.maxMillivolts = maxMillivolts;
+  bucket.meanMillivolts = (uint16_t)((sumMillivolts + count / 2) / count);
+  bucket.minRssi = minRssi;
+  bucket.maxRssi = maxRssi;
+  bucket.meanRssi = (int8_t)(sumRssi / (int32_t)count);
+  return bucket;
+}
+
+// =================== VERLAUF ===================
+
+void TelemetrySeries::add(const TelemetrySample &sample) {
+  advance(sample.timeSec);
+  if (minute.count == 0) minute.start(sample.timeSec / 60);
+  minute.add(sample.batteryMillivolts, sample.rssi);
+  raw.push(sample);
+}
+
+void TelemetrySeries::advance(uint32_t nowSec) {
+  if (minute.count != 0 && minute.period != nowSec / 60) closeMinute();
+  if (hour.count != 0 && hour.period != nowSec / 3600) closeHour();
+  if (day.count != 0 && day.period != nowSec / 86400) closeDay();
+}
+
+void TelemetrySeries::closeMinute() {
+  uint32_t hourPeriod = minute.period / 60;
+  if (hour.count != 0 && hour.period != hourPeriod) closeHour();
+  if (hour.count == 0) hour.start(hourPeriod);
+  hour.merge(minute);
+  minutes.push(minute.finish());
+  minute.count = 0;
+}
+
+void TelemetrySeries::closeHour() {
+  uint32_t dayPeriod = hour.period / 24;
+  if (day.count != 0 && day.period != dayPeriod) closeDay();
+  if (day.count == 0) day.start(dayPeriod);
+  day.merge(hour);
+  hours.push(hour.finish());
+  hour.count = 0;
+  dirty = true;
+}
+
+void TelemetrySeries::closeDay() {
+  days.push(day.finish());
+  day.count = 0;
+  dirty = true;
+}
+
+// Ausgleichsgerade y = a + b·x über (x = Tage, y = mV)
+template <typename Ring>
+static bool fitSlope(const Ring &ring, float periodsPerDay, float &slope) {
+  int n = ring.count;
+  if (n < 2) return false;
+  float x0 = (float)ring.at(0).period;
+  float sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+  for (int i = 0; i < n; i++) {
+    float x = ((float)ring.at(i).period - x0) / periodsPerDay;
+    float y = (float)ring.at(i).meanMillivolts;
+    sumX += x;
+    sumY += y;
+    sumXX += x * x;
+    sumXY += x * y;
+  }
+  float denominator = n * sumXX - sumX * sumX;
+  if (denominator <= 0) return false;
+  slope = (n * sumXY - sumX * sumY) / denominator;
+  return true;
+}
+
+bool TelemetrySeries::batteryTrend(float &millivoltsPerDay) const {
+  // Tageswerte sind genauer (Temperaturgang mittelt sich heraus), brauchen
+  // aber einige Tage; bis dahin die Stundenwerte
+  if (days.count >= 3) return fitSlope(days, 1.0f, millivoltsPerDay);
+  if (hours.count >= 6) return fitSlope(hours, 24.0f, millivoltsPerDay);
+  return false;
+}
+
+// =================== SPEICHER ===================
+
+TelemetryStore::TelemetryStore() : inboxHead(0), inboxTail(0) {
+  memset(entries, 0, sizeof(entries));
+  memset(macs, 0, sizeof(macs));
+  memset(&counters, 0, sizeof(counters));
+}
+
+void TelemetryStore::attach(int index, const uint8_t mac[6]) {
+  memcpy(macs[index], mac, 6);
+}
+
+bool TelemetryStore::post(int index, uint32_t timeSec, uint16_t millivolts, uint16_t adcRaw, int8_t rssi) {
+  uint32_t head = inboxHead.load(std::memory_order_relaxed);
+  if (head - inboxTail.load(std::memory_order_acquire) >= TELEMETRY_INBOX_SIZE) {
+    counters.dropped++;
+    return false;
+  }
+  InboxEntry &entry = inbox[head & (TELEMETRY_INBOX_SIZE - 1)];
+  memset(&entry.sample, 0, sizeof(entry.sample));
+  entry.sample.timeSec = timeSec;
+  entry.sample.batteryMillivolts = millivolts;
+  entry.sample.adcRaw = adcRaw;
+  entry.sample.rssi = rssi;
+  entry.index = (uint8_t)index;
+  inboxHead.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+void TelemetryStore::process(uint32_t nowSec) {
+  uint32_t tail = inboxTail.load(std::memory_order_relaxed);
+  uint32_t head = inboxHead.load(std::memory_order_acquire);
+  while (tail != head) {
+    const InboxEntry &entry = inbox[tail & (TELEMETRY_INBOX_SIZE - 1)];
+    entries[entry.index].add(entry.sample);
+    counters.samples++;
+    tail++;
+  }
+  inboxTail.store(tail, std::memory_order_release);
+
+  for (int i = 0; i < SENDER_MAX; i++) entries[i].advance(nowSec);
+}
+
+// Hängt die Einträge eines Rings (ältester zuerst) an
+template <typename Ring>
+static uint8_t *appendRing(uint8_t *p, const Ring &ring) {
+  for (int i = 0; i < ring.count; i++) {
+    memcpy(p, &ring.at(i), sizeof(ring.items[0]));
+    p += sizeof(ring.items[0]);
+  }
+  return p;
+}
+
+size_t TelemetryStore::serialize(int index, uint32_t nowSec, bool recent, uint8_t *out, size_t size) const {
+  const TelemetrySeries &s = entries[index];
+
+  TelemetryBlobHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic[0] = 'M';
+  header.magic[1] = 'T';
+  header.version = TELEMETRY_FORMAT_VERSION;
+  memcpy(header.mac, macs[index], 6);
+  header.timeSec = nowSec;
+  header.rawCount = recent ? s.raw.count : 0;
+  header.minuteCount = recent ? s.minutes.count : 0;
+  header.hourCount = s.hours.count;
+  header.dayCount = s.days.count;
+
+  size_t length = sizeof(header) + header.rawCount * sizeof(TelemetrySample) +
+                  (header.minuteCount + header.hourCount + header.dayCount) * sizeof(TelemetryBucket) +
+                  2 * sizeof(TelemetryAccumulator) + 2;
+  if (length > size) return 0;
+
+  uint8_t *p = out;
+  memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  if (recent) {
+    p = appendRing(p, s.raw);
+    p = appendRing(p, s.minutes);
+  }
+  p = appendRing(p, s.hours);
+  p = appendRing(p, s.days);
+  memcpy(p, &s.hour, sizeof(s.hour));
+  p += sizeof(s.hour);
+  memcpy(p, &s.day, sizeof(s.day));
+  p += sizeof(s.day);
+
+  uint16_t crc = crc16(out, (size_t)(p - out));
+  p[0] = (uint8_t)crc;
+  p[1] = (uint8_t)(crc >> 8);
+  return length;
+}
+
+// Liest count Einträge in einen leeren Ring
+template <typename Ring>
+static const uint8_t *readRing(const uint8_t *p, int count, Ring &ring) {
+  ring.next = 0;
+  ring.count = 0;
+  for (int i = 0; i < count; i++) {
+    memcpy(&ring.items[ring.next], p, sizeof(ring.items[0]));
+    ring.next = (uint8_t)((ring.next + 1) % (int)(sizeof(ring.items) / sizeof(ring.items[0])));
+    if (ring.count < sizeof(ring.items) / sizeof(ring.items[0])) ring.count++;
+    p += sizeof(ring.items[0]);
+  }
+  return p;
+}
+
+uint32_t TelemetryStore::deserialize(int index, const uint8_t *data, size_t len) {
+  TelemetryBlobHeader header;
+  if (len < sizeof(header) + 2) return 0;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic[0] != 'M' || header.magic[1] != 'T' || header.version != TELEMETRY_FORMAT_VERSION) return 0;
+  if (memcmp(header.mac, macs[index], 6) != 0) return 0;
+  if (header.rawCount > TELEMETRY_RAW_SAMPLES || header.minuteCount > TELEMETRY_MINUTE_BUCKETS ||
+      header.hourCount > TELEMETRY_HOUR_BUCKETS || header.dayCount > TELEMETRY_DAY_BUCKETS) return 0;
+
+  size_t length = sizeof(header) + header.rawCount * sizeof(TelemetrySample) +
+                  (header.minuteCount + header.hourCount + header.dayCount) * sizeof(TelemetryBucket) +
+                  2 * sizeof(TelemetryAccumulator) + 2;
+  if (len < length) return 0;
+  uint16_t crc = (uint16_t)(data[length - 2] | (data[length - 1] << 8));
+  if (crc16(data, length - 2) != crc) return 0;
+
+  TelemetrySeries &s = entries[index];
+  memset(&s, 0, sizeof(s));
+  const uint8_t *p = data + sizeof(header);
+  p = readRing(p, header.rawCount, s.raw);
+  p = readRing(p, header.minuteCount, s.minutes);
+  p = readRing(p, header.hourCount, s.hours);
+  p = readRing(p, header.dayCount, s.days);
+  memcpy(&s.hour, p, sizeof(s.hour));
+  p += sizeof(s.hour);
+  memcpy(&s.day, p, sizeof(s.day));
+  return header.timeSec;
+}
@@ -0,0 +1,214 @@
+/**
+ * TelemetryStore – Verlauf von Batteriespannung und Signalstärke je Sender
+ *
+ * Jedes Paket bringt batteryMillivolts, adcRaw und rssi mit. Bisher wurden
+ * die Werte nur ausgegeben und dann vergessen. Hier werden sie mit festem
+ * Speicherbedarf aufgehoben:
+ * - die letzten TELEMETRY_RAW_SAMPLES Rohwerte
+ * - Minuten-, Stunden- und Tageswerte (Minimum, Maximum, Mittelwert, Anzahl)
+ *   in Ringpuffern; ist ein Ring voll, fällt der älteste Wert heraus
+ *
+ * Verdichtet wird beim Wechsel des Intervalls: Eine fertige Minute fließt in
+ * die laufende Stunde, eine fertige Stunde in den laufenden Tag. Die Summen
+ * werden dabei exakt weitergereicht (keine Mittelwerte von Mittelwerten).
+ *
+ * Zeitbasis ist die Betriebszeit in Sekunden (ohne Uhrzeit, der Empfänger
+ * hat keine). Der Aufrufer setzt sie nach einem Neustart mit dem
+ * gespeicherten Stand fort.
+ *
+ * Nebenläufigkeit: post() läuft im Empfangs-Callback (WiFi-Task) und legt
+ * den Wert nur in einen kleinen Eingangspuffer (ein Schreiber, ein Leser,
+ * ohne Sperre). Alles andere läuft in loop(): process() übernimmt die Werte
+ * und schließt abgelaufene Intervalle.
+ *
+ * Binärformat (serialize/deserialize, little-endian, gepackt):
+ *   TelemetryBlobHeader, danach die Ringinhalte vom ältesten zum neuesten:
+ *   [TelemetrySample × rawCount] [TelemetryBucket × minuteCount]
+ *   [TelemetryBucket × hourCount] [TelemetryBucket × dayCount]
+ *   [TelemetryAccumulator × 2 (laufende Stunde, laufender Tag)]
+ *   uint16_t crc (CRC-16/CCITT-FALSE über alles davor)
+ * Für den Flash werden nur Stunden und Tage geschrieben (rawCount und
+ * minuteCount = 0), ein Dump enthält alles.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "SenderRegistry.h"
+
+// =================== KONFIGURATION ===================
+
+#ifndef TELEMETRY_RAW_SAMPLES
+#define TELEMETRY_RAW_SAMPLES 32
+#endif
+#define TELEMETRY_MINUTE_BUCKETS 60  // 1 Stunde
+#define TELEMETRY_HOUR_BUCKETS 48    // 2 Tage
+#define TELEMETRY_DAY_BUCKETS 60     // 2 Monate
+
+// Eingangspuffer zwischen Empfangs-Callback und loop() (Zweierpotenz)
+#define TELEMETRY_INBOX_SIZE 16
+
+#define TELEMETRY_FORMAT_VERSION 1
+
+static_assert((TELEMETRY_INBOX_SIZE & (TELEMETRY_INBOX_SIZE - 1)) == 0,
+              "TELEMETRY_INBOX_SIZE muss eine Zweierpotenz sein");
+static_assert(TELEMETRY_RAW_SAMPLES <= 255 && TELEMETRY_MINUTE_BUCKETS <= 255 &&
+              TELEMETRY_HOUR_BUCKETS <= 255 && TELEMETRY_DAY_BUCKETS <= 255,
+              "Ringgrößen werden als uint8_t gespeichert");
+
+// =================== DATENSÄTZE ===================
+
+struct __attribute__((packed)) TelemetrySample {
+  uint32_t timeSec;             // Betriebszeit
+  uint16_t batteryMillivolts;
+  uint16_t adcRaw;
+  int8_t   rssi;
+  uint8_t  reserved[3];
+};
+
+// Verdichtetes Intervall (Minute, Stunde oder Tag)
+struct __attribute__((packed)) TelemetryBucket {
+  uint32_t period;              // Betriebszeit / Intervalllänge
+  uint16_t count;               // Anzahl Pakete (bei 65535 gedeckelt)
+  uint16_t minMillivolts;
+  uint16_t maxMillivolts;
+  uint16_t meanMillivolts;
+  int8_t   minRssi;
+  int8_t   maxRssi;
+  int8_t   meanRssi;
+  uint8_t  reserved;
+};
+
+// Laufendes Intervall mit exakten Summen
+struct __attribute__((packed)) TelemetryAccumulator {
+  uint32_t period;
+  uint32_t count;               // 0 = leer
+  uint32_t sumMillivolts;
+  int32_t  sumRssi;
+  uint16_t minMillivolts;
+  uint16_t maxMillivolts;
+  int8_t   minRssi;
+  int8_t   maxRssi;
+  uint8_t  reserved[2];
+
+  void start(uint32_t newPeriod);
+  void add(uint16_t millivolts, int8_t rssi);
+  void merge(const TelemetryAccumulator &other);
+  TelemetryBucket finish() const;
+};
+
+struct __attribute__((packed)) TelemetryBlobHeader {
+  uint8_t  magic[2];            // 'M', 'T'
+  uint8_t  version;             // TELEMETRY_FORMAT_VERSION
+  uint8_t  reserved;
+  uint8_t  mac[6];              // Sender
+  uint32_t timeSec;             // Betriebszeit beim Schreiben
+  uint8_t  rawCount;
+  uint8_t  minuteCount;
+  uint8_t  hourCount;
+  uint8_t  dayCount;
+};
+
+static_assert(sizeof(TelemetrySample) == 12, "TelemetrySample: 12 Bytes");
+static_assert(sizeof(TelemetryBucket) == 16, "TelemetryBucket: 16 Bytes");
+static_assert(sizeof(TelemetryAccumulator) == 24, "TelemetryAccumulator: 24 Bytes");
+static_assert(sizeof(TelemetryBlobHeader) == 18, "TelemetryBlobHeader: 18 Bytes");
+
+// Ringpuffer fester Größe; at(0) ist der älteste Eintrag
+template <typename T, int N>
+struct TelemetryRing {
+  T items[N];
+  uint8_t next;
+  uint8_t count;
+
+  void push(const T &item) {
+    items[next] = item;
+    next = (uint8_t)((next + 1) % N);
+    if (count < N) count++;
+  }
+  const T &at(int i) const { return items[(next + N - count + i) % N]; }
+  const T &newest() const { return at(count - 1); }
+};
+
+// Größte Blob-Länge (Dump mit allen Rohwerten und Minuten)
+#define TELEMETRY_BLOB_MAX                                                         \
+  (sizeof(TelemetryBlobHeader) + TELEMETRY_RAW_SAMPLES * sizeof(TelemetrySample) + \
+   (TELEMETRY_MINUTE_BUCKETS + TELEMETRY_HOUR_BUCKETS + TELEMETRY_DAY_BUCKETS) *   \
+       sizeof(TelemetryBucket) +                                                   \
+   2 * sizeof(TelemetryAccumulator) + 2)
+
+// =================== VERLAUF EINES SENDERS ===================
+
+struct TelemetrySeries {
+  TelemetryRing<TelemetrySample, TELEMETRY_RAW_SAMPLES> raw;
+  TelemetryRing<TelemetryBucket, TELEMETRY_MINUTE_BUCKETS> minutes;
+  TelemetryRing<TelemetryBucket, TELEMETRY_HOUR_BUCKETS> hours;
+  TelemetryRing<TelemetryBucket, TELEMETRY_DAY_BUCKETS> days;
+  TelemetryAccumulator minute;  // laufende Minute
+  TelemetryAccumulator hour;    // laufende Stunde (nur abgeschlossene Minuten)
+  TelemetryAccumulator day;     // laufender Tag (nur abgeschlossene Stunden)
+  bool dirty;                   // Stunden/Tage seit dem letzten Speichern geändert
+
+  void add(const TelemetrySample &sample);
+  void advance(uint32_t nowSec);  // abgelaufene Intervalle abschließen
+
+  // Batterie-Trend in mV pro Tag (Ausgleichsgerade über Tages- bzw.
+  // Stundenmittel). Rückgabe: false = zu wenig Daten
+  bool batteryTrend(float &millivoltsPerDay) const;
+
+private:
+  void closeMinute();
+  void closeHour();
+  void closeDay();
+};
+
+// =================== SPEICHER ===================
+
+struct TelemetryStats {
+  uint32_t samples;   // übernommene Pakete
+  uint32_t dropped;   // Eingangspuffer voll
+};
+
+class TelemetryStore {
+public:
+  TelemetryStore();
+
+  // Sender index anmelden (nur in setup(), MAC für das Binärformat)
+  void attach(int index, const uint8_t mac[6]);
+
+  // Aus dem Empfangs-Callback: Wert vormerken (konstante Zeit, keine Sperre)
+  bool post(int index, uint32_t timeSec, uint16_t millivolts, uint16_t adcRaw, int8_t rssi);
+
+  // Aus loop(): vorgemerkte Werte übernehmen, Intervalle abschließen
+  void process(uint32_t nowSec);
+
+  // Schreibt den Verlauf von Sender index ins Binärformat (siehe oben).
+  // recent = auch Rohwerte und Minuten. Rückgabe: Länge, 0 = Puffer zu klein
+  size_t serialize(int index, uint32_t nowSec, bool recent, uint8_t *out, size_t size) const;
+
+  // Liest einen gespeicherten Verlauf zurück (nur Stunden, Tage und die
+  // laufenden Intervalle; MAC muss zum Sender passen).
+  // Rückgabe: Zeitstempel des Blobs, 0 = ungültig
+  uint32_t deserialize(int index, const uint8_t *data, size_t len);
+
+  TelemetrySeries &series(int index) { return entries[index]; }
+  const TelemetrySeries &series(int index) const { return entries[index]; }
+  const TelemetryStats &stats() const { return counters; }
+
+private:
+  struct InboxEntry {
+    TelemetrySample sample;
+    uint8_t index;
+  };
+
+  TelemetrySeries entries[SENDER_MAX];
+  uint8_t macs[SENDER_MAX][6];
+  TelemetryStats counters;
+
+  InboxEntry inbox[TELEMETRY_INBOX_SIZE];
+  std::atomic<uint32_t> inboxHead;  // schreibt nur post()
+  std::atomic<uint32_t> inboxTail;  // schreibt nur process()
+};
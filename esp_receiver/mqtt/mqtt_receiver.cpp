@@ -0,0 +1,139 @@
+/**
+ * MQTT-Brücke gegen einen echten Broker (nur native-Build)
+ *
+ * Die Firmware läuft mit MQTT_BRIDGE in Echtzeit gegen NativeShim; dessen
+ * WiFiClient geht auf echte Sockets des Hosts. So lässt sich die Brücke
+ * ohne Hardware an einem lokalen mosquitto prüfen:
+ *   mosquitto -v
+ *   pio run -e mqtt && .pio/build/mqtt/program
+ *   mosquitto_sub -v -t 'markise/#'
+ *   mosquitto_pub -t markise/motor/1/set -m 500      (auch STOP, LEFT, RIGHT)
+ *
+ * Ein nachgebildeter Sender ("Sender 1") hält nach einer Sekunde Taster 1
+ * für zwei Sekunden und schickt dann einen Fahrbefehl für Motor 2, damit
+ * Zustände entstehen. Die Steuer-, Log- und MQTT-Tasks bildet die Schleife
+ * unten nach (im native-Build laufen keine Tasks).
+ *
+ * Optionen:
+ *   --seconds=N      Laufzeit (Standard 60, 0 = bis Strg+C)
+ *   --ap-channel=N   Kanal des nachgebildeten Routers (Standard 6)
+ *   --ap-off=S[:K]   Router ab Sekunde S für 15 s weg (Wiederverbinden),
+ *                    danach auf Kanal K (Kanalwechsel des Routers)
+ * Broker: -DMQTT_HOST=\"...\" und -DMQTT_PORT=... in build_flags
+ */
+
+#define MQTT_BRIDGE 1
+#define MQTT_WIFI_SSID "NativeShim"
+#ifndef MQTT_HOST
+#define MQTT_HOST "127.0.0.1"
+#endif
+
+#include "../src/main.cpp"
+
+#include "NativeShim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+
+namespace {
+
+#define TICK_MS 5
+#define AP_OFF_SECONDS 15
+
+uint16_t demoSequence = 0;
+
+void sendFrame(uint8_t command, uint8_t mask, uint16_t leaseMs) {
+  ButtonFrame frame = {};
+  frame.command = command;
+  frame.buttonMask = mask;
+  frame.sequence = demoSequence++;
+  frame.leaseMs = leaseMs;
+  frame.batteryMillivolts = 3920;
+  frame.adcRaw = 2280;
+  frame.rssi = -61;
+  frame.timestamp = (uint32_t)millis();
+  uint8_t data[MARKISE_FRAME_SIZE];
+  size_t len = encodeFrame(frame, data, sizeof(data));
+  shim::injectReceive(knownSenders[0].mac, data, (int)len);
+}
+
+// Sender-Skript: Taster 1 halten (1-3 s), Fahrbefehl Motor 2 auf 30 % (4 s)
+void runDemoSender(uint32_t nowMs) {
+  static uint32_t lastRenew = 0;
+  static bool pressed = false;
+  static bool released = false;
+  static bool moved = false;
+  if (nowMs >= 1000 && nowMs < 3000 && nowMs - lastRenew >= 100) {
+    lastRenew = nowMs;
+    sendFrame(pressed ? CMD_RENEW : CMD_START, 0x01, RECEIVE_TIMEOUT);
+    pressed = true;
+  } else if (nowMs >= 3000 && !released) {
+    released = true;
+    sendFrame(CMD_STOP, 0x00, RECEIVE_TIMEOUT);
+  } else if (nowMs >= 4000 && !moved) {
+    moved = true;
+    sendFrame(CMD_MOVE, 0x04, 300);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 60;
+  long apOff = -1;
+  int apChannel = 6;
+  int apChannelAfter = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--seconds=", 10) == 0) {
+      seconds = strtoul(argv[i] + 10, nullptr, 10);
+    } else if (strncmp(argv[i], "--ap-channel=", 13) == 0) {
+      apChannel = atoi(argv[i] + 13);
+    } else if (strncmp(argv[i], "--ap-off=", 9) == 0) {
+      char *rest;
+      apOff = strtol(argv[i] + 9, &rest, 10);
+      if (*rest == ':') apChannelAfter = atoi(rest + 1);
+    } else {
+      fprintf(stderr, "Unbekannte Option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  shim::setSerialEcho(true);
+  shim::current().apChannel = (uint8_t)apChannel;
+  setup();
+
+  // Virtuelle Uhr folgt der echten (MQTT-Keep-Alive, Fahrzeiten)
+  auto start = std::chrono::steady_clock::now();
+  uint64_t bootMicros = shim::nowMicros();
+  for (;;) {
+    usleep(TICK_MS * 1000);
+    uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start).count();
+    if (bootMicros + elapsed > shim::nowMicros()) shim::setMicros(bootMicros + elapsed);
+    uint32_t elapsedMs = (uint32_t)(elapsed / 1000);
+    if (seconds != 0 && elapsedMs >= seconds * 1000) break;
+
+    if (apOff >= 0) {
+      bool away = elapsedMs >= apOff * 1000 && elapsedMs < (apOff + AP_OFF_SECONDS) * 1000;
+      if (away == shim::current().apReachable) {
+        shim::current().apReachable = !away;
+        if (away) mqttSocket.stop();  // TCP bricht mit dem WLAN ab
+        if (!away && apChannelAfter != 0) shim::current().apChannel = (uint8_t)apChannelAfter;
+        printf("[Treiber] Router %s, Kanal %u\n", away ? "weg" : "wieder da", shim::current().apChannel);
+      }
+    }
+
+    runDemoSender(elapsedMs);
+    serviceControl();  // Steuer-Task
+    serviceMqtt();     // MQTT-Task
+    deferredLog.drain();
+    controlLog.drain();
+  }
+
+  printTravelStats();
+  printMqttStats();
+  return 0;
+}
@@ -14,23 +14,237 @@
 
 #include <esp_now.h>
 #include <WiFi.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/semphr.h"
+#include "MarkiseProtocol.h"
+#include "LinkAuth.h"
+#include "SenderRegistry.h"
+#include "TelemetryStore.h"
+#include "LinkQuality.h"
+#include "OutputTopology.h"
+#include "GpioOutputs.h"
+#include "ShiftRegisterOutputs.h"
+#include "I2cExpanderOutputs.h"
+#include "LogHistogram.h"
+#include "MqttClient.h"
+#include "PublishQueue.h"
+
+// Log-Level für Ausgaben aus dem Empfangs-Callback (zur Compile-Zeit gefiltert)
+// LOG_LEVEL_DEBUG zeigt zusätzlich jedes einzelne Paket
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#include "DeferredLog.h"
 
 // =================== KONFIGURATION ===================
 
 // Timeout: Wenn länger keine Pakete kommen, werden alle Ausgänge ausgeschaltet
 // VON 200ms AUF 150ms REDUZIERT für schnellere Sicherheitsabschaltung
+// Gilt für Sender ohne Lease (Frame v1/v2); v3-Sender geben die Lease selbst vor
+#ifndef RECEIVE_TIMEOUT
 #define RECEIVE_TIMEOUT 150  // Millisekunden
+#endif
+
+// Grenzen für die vom Sender gewünschte Lease-Dauer
+// LEASE_MAX_MS ist die längste mögliche Nachlaufzeit, egal was der Sender schickt
+#ifndef LEASE_MIN_MS
+#define LEASE_MIN_MS 20    // Millisekunden
+#endif
+#ifndef LEASE_MAX_MS
+#define LEASE_MAX_MS 1000  // Millisekunden
+#endif
 
 // Hauptschleifen-Delay
 #define LOOP_DELAY 5  // Millisekunden
 
+// Rückfallebene: Falls der Failsafe-Timer nicht angelegt werden konnte oder
+// nicht auslöst, schaltet loop() nach Ablauf der Lease + dieser Marge ab
+#ifndef FAILSAFE_BACKUP_MARGIN
+#define FAILSAFE_BACKUP_MARGIN 50  // Millisekunden
+#endif
+
+// Wie oft die Jitter-Statistik des Failsafe-Timers ausgegeben wird
+#define FAILSAFE_REPORT_INTERVAL 60000  // Millisekunden
+
+// Taster, die dieser Empfänger bedient (Bit 0-5 = Taster 1-6). Verteilt ein
+// Sender seine Motoren auf mehrere Empfänger (Broadcast an die Gruppe),
+// ignoriert jeder Empfänger die Taster der anderen.
+#define SERVED_BUTTON_MASK 0x3F
+
+// Anzahl Motoren (je zwei Ausgänge: Linkslauf, Rechtslauf). Bei Änderung
+// Ausgänge (OutputConfig) und outputNames unten mit anpassen.
+#ifndef MOTOR_COUNT
+#define MOTOR_COUNT 3
+#endif
+
+// Fahrbefehle (CMD_MOVE, z.B. kurzer Tastendruck am Sender): Der Empfänger
+// fährt den Motor selbst und schätzt die Position aus der Fahrzeit
+// (motorTravel[] unten). In eine Endlage wird um diesen Anteil länger
+// gefahren, damit der Motor sie sicher erreicht (dort schaltet sein
+// Endschalter ab).
+#ifndef TRAVEL_OVERRUN_PERCENT
+#define TRAVEL_OVERRUN_PERCENT 10
+#endif
+
+// Kürzere Fahrten werden nicht ausgeführt (Ziel schon erreicht)
+#define TRAVEL_MIN_MS 200  // Millisekunden
+
+// Obergrenze je Fahrt, egal was in motorTravel[] steht
+#define TRAVEL_MAX_MS 120000  // Millisekunden
+
+// Wie die Ausgänge angeschlossen sind
+#define OUTPUT_BACKEND_GPIO           1  // direkt an GPIOs (ULN2803)
+#define OUTPUT_BACKEND_SHIFT_REGISTER 2  // 74HC595-Kette über SPI
+#define OUTPUT_BACKEND_I2C_EXPANDER   3  // MCP23017 über I2C
+#ifndef OUTPUT_BACKEND
+#define OUTPUT_BACKEND OUTPUT_BACKEND_GPIO
+#endif
+
+// Log-Task: leert den Log-Puffer in diesem Abstand (niedrige Priorität)
+#define LOG_TASK_INTERVAL 10  // Millisekunden
+#define LOG_TASK_PRIORITY 1
+
+// Steuer-Task: führt die empfangenen Befehle aus (Arbitrierung, Ausgänge,
+// Lease). Läuft auf dem Kern ohne WiFi und loop() (ARDUINO_RUNNING_CORE=0)
+// und mit höherer Priorität als loop() und die Log-Tasks.
+#define CONTROL_TASK_CORE 1
+#define CONTROL_TASK_PRIORITY 20
+#define CONTROL_TASK_STACK 4096
+
+// Telemetrie (Batterie/RSSI-Verlauf je Sender, siehe lib/TelemetryStore):
+// Stunden- und Tageswerte werden in diesem Abstand in den Flash (NVS)
+// geschrieben – nur Sender mit neuen Werten
+#define TELEMETRY_SAVE_INTERVAL 3600  // Sekunden
+
+// Ab dieser Spannung gilt ein Sender als leer (Prognose im Bericht).
+// Entspricht BATTERY_LOW_RAW_THRESHOLD des Senders (1900 * 0.00172 V)
+#define TELEMETRY_BATTERY_EMPTY_MV 3270
+
+// Serieller Befehl: dieses Zeichen gibt den Verlauf aller Sender binär aus
+#define TELEMETRY_DUMP_COMMAND 'T'
+
+// Serieller Befehl: Funkstrecken-Bericht (Verlust, Abstände, Jitter, Pegel)
+#define LINK_REPORT_COMMAND 'L'
+
+// Serieller Befehl: Energiebilanz der Sender (Zeit und Ladung je Zustand)
+#define ENERGY_REPORT_COMMAND 'E'
+
+// Signierte Befehle (lib/LinkAuth): 1 = Sender mit Schlüssel in
+// knownSenders[] müssen jeden Frame signieren, unsignierte werden
+// verworfen. 0 = Schlüssel ignorieren (solange die Sender noch ohne
+// LINK_AUTH laufen). Einschalten z.B. per -DLINK_AUTH=1 in build_flags
+#ifndef LINK_AUTH
+#define LINK_AUTH 0
+#endif
+
+// Schlüssel der Sender (32 Hex-Zeichen, dieselben wie LINK_KEY im Sender).
+// Stehen bewusst nicht im Code, sondern kommen als Build-Flag, z.B.
+// -DSENDER1_KEY=\"<32 Hex-Zeichen>\". Weitere Sender bekommen eigene Makros
+// (SENDER2_KEY ...) in knownSenders[].
+#if LINK_AUTH && !defined(SENDER1_KEY)
+#error "LINK_AUTH braucht den Schlüssel von Sender 1 in SENDER1_KEY (siehe README)"
+#endif
+#ifndef SENDER1_KEY
+#define SENDER1_KEY nullptr
+#endif
+
+// Höchster angenommener Zähler je Sender: in diesem Abstand ins NVS
+// (nur bei Änderung). Nach einem Stromausfall gelten mitgeschnittene
+// Frames aus dieser Zeitspanne noch einmal.
+#define AUTH_SAVE_INTERVAL 60000  // Millisekunden
+#define AUTH_MEASURE_RUNS 32      // Frames für die Zeitmessung in setup()
+
+// MQTT-Brücke (lib/MqttBridge): meldet Motoren, Sender und Brücke an einen
+// Broker im Heimnetz und nimmt Fahrbefehle entgegen (siehe README).
+// 1 = einschalten, z.B. per -DMQTT_BRIDGE=1 in build_flags; Zugangsdaten
+// ebenso, z.B. -DMQTT_WIFI_SSID=\"MeinNetz\" -DMQTT_HOST=\"192.168.1.10\"
+#ifndef MQTT_BRIDGE
+#define MQTT_BRIDGE 0
+#endif
+#ifndef MQTT_WIFI_SSID
+#define MQTT_WIFI_SSID ""
+#endif
+#ifndef MQTT_WIFI_PASSWORD
+#define MQTT_WIFI_PASSWORD ""
+#endif
+
+// WLAN und ESP-NOW teilen sich das Funkmodul und damit den Kanal: mit
+// WLAN empfängt der Empfänger ESP-NOW nur auf dem Kanal des Routers.
+// 0 = Kanal des Routers beim ersten Verbinden übernehmen und festhalten
+// (NVS); 1-13 = nur auf diesem Kanal verbinden (Router mit festem Kanal).
+// Der Sender braucht denselben Kanal (receivers[].channel), der Empfänger
+// meldet ihn beim Start, bei jeder Änderung und unter <Präfix>/channel.
+#ifndef MQTT_WIFI_CHANNEL
+#define MQTT_WIFI_CHANNEL 0
+#endif
+
+#ifndef MQTT_HOST
+#define MQTT_HOST ""  // Name oder IP des Brokers, "" = Brücke aus
+#endif
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+#ifndef MQTT_USER
+#define MQTT_USER ""  // "" = ohne Anmeldung
+#endif
+#ifndef MQTT_PASSWORD
+#define MQTT_PASSWORD ""
+#endif
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX "markise"
+#endif
+
+#define MQTT_KEEPALIVE 30            // Sekunden
+#define MQTT_RECONNECT_MS 5000       // Abstand der Verbindungsversuche (WLAN und Broker)
+#define MQTT_CHANNEL_RETRIES 6       // Fehlversuche auf dem gemerkten Kanal, dann alle Kanäle
+#define MQTT_POSITION_INTERVAL 1000  // Motorzustände (Position während der Fahrt)
+#define MQTT_STATS_INTERVAL 10000    // Sender und Brücke
+
+// MQTT-Task: Netz und Broker, niedrige Priorität auf dem WiFi-Kern
+#define MQTT_TASK_INTERVAL 20  // Millisekunden
+#define MQTT_TASK_PRIORITY 1
+#define MQTT_TASK_CORE 0
+#define MQTT_TASK_STACK 6144
+
 // =================== GPIO DEFINITIONEN ===================
+// Kanal 2m = Motor m+1 Linkslauf, Kanal 2m+1 = Motor m+1 Rechtslauf
+// (Kanal 0-5 entsprechen Taster 1-6 des Senders)
 
-// Ausgänge für ULN2803 (entsprechen Tastern 1-6)
-const int outputPins[6] = {26, 27, 14, 12, 13, 15};
+using Topology = MotorTopology<MOTOR_COUNT>;
+using OutputMask = Topology::Mask;
 
-// Klartext-Bezeichnungen für Debug-Ausgaben
-const char* outputNames[6] = {
+#if OUTPUT_BACKEND == OUTPUT_BACKEND_GPIO
+// Ausgänge für ULN2803 (GPIO je Kanal)
+struct OutputConfig {
+  static constexpr uint8_t pins[] = {26, 27, 14, 12, 13, 15};
+};
+using OutputBackend = GpioOutputs<Topology, OutputConfig>;
+#elif OUTPUT_BACKEND == OUTPUT_BACKEND_SHIFT_REGISTER
+// 74HC595-Kette: Bit je Kanal (0-7 = Q0-Q7 des ersten Bausteins)
+struct OutputConfig {
+  static constexpr uint8_t bits[] = {0, 1, 2, 3, 4, 5};
+  static constexpr uint8_t latchPin = 25;     // RCLK
+  static constexpr uint32_t spiHz = 4000000;  // MOSI/SCK: Standard-Pins von SPI
+};
+using OutputBackend = ShiftRegisterOutputs<Topology, OutputConfig>;
+#elif OUTPUT_BACKEND == OUTPUT_BACKEND_I2C_EXPANDER
+// MCP23017: Port je Kanal (0-7 = GPA0-7, 8-15 = GPB0-7)
+struct OutputConfig {
+  static constexpr uint8_t bits[] = {0, 1, 2, 3, 4, 5};
+  static constexpr uint8_t address = 0x20;
+  static constexpr uint32_t i2cHz = 400000;
+};
+using OutputBackend = I2cExpanderOutputs<Topology, OutputConfig>;
+#else
+#error "OUTPUT_BACKEND unbekannt"
+#endif
+
+OutputBackend outputs;
+
+// Klartext-Bezeichnungen für Debug-Ausgaben (eine je Kanal)
+const char *const outputNames[] = {
   "Motor 1 Linkslauf (Taster 1)",
   "Motor 1 Rechtslauf (Taster 2)",
   "Motor 2 Linkslauf (Taster 3)",
@@ -38,167 +252,1212 @@ const char* outputNames[6] = {
   "Motor 3 Linkslauf (Taster 5)",
   "Motor 3 Rechtslauf (Taster 6)"
 };
+static_assert(sizeof(outputNames) / sizeof(outputNames[0]) == Topology::CHANNELS,
+              "outputNames: ein Name je Ausgang (2 je Motor)");
 
-// Motor-Zuordnung: Jeder Motor hat zwei Ausgänge
-// Format: {Linkslauf-Ausgang, Rechtslauf-Ausgang}
-const int motorPairs[3][2] = {
-  {0, 1},  // Motor 1: Ausgang 0 (Links), Ausgang 1 (Rechts)
-  {2, 3},  // Motor 2: Ausgang 2 (Links), Ausgang 3 (Rechts)
-  {4, 5}   // Motor 3: Ausgang 4 (Links), Ausgang 5 (Rechts)
+// Fahrzeit je Motor von Endlage zu Endlage (für Fahrbefehle), je Richtung
+// mit der Stoppuhr messen und eintragen. 0 = keine Fahrbefehle für diesen
+// Motor (CMD_MOVE hält ihn dann nur an).
+struct MotorTravelTime {
+  uint32_t leftMs;   // Endlage Rechtslauf -> Endlage Linkslauf
+  uint32_t rightMs;  // Endlage Linkslauf -> Endlage Rechtslauf
 };
+const MotorTravelTime motorTravel[] = {
+  {25000, 23000},
+  {25000, 23000},
+  {25000, 23000}
+};
+static_assert(sizeof(motorTravel) / sizeof(motorTravel[0]) == MOTOR_COUNT,
+              "motorTravel: ein Eintrag je Motor");
 
 // =================== ESP-NOW KONFIGURATION ===================
 
-// MAC-Adresse des Senders (muss an Ihre Hardware angepasst werden!)
-uint8_t senderMac[] = {0x20, 0x6E, 0xF1, 0xA7, 0x4E, 0xB8};
+// Bekannte Sender (MAC-Adressen müssen an Ihre Hardware angepasst werden!)
+// Weitere Fernbedienungen einfach ergänzen (höchstens SENDER_MAX)
+// firstMotor: Taster 1/2 des Senders steuern diesen Motor (0 = Motor 1),
+// Taster 3/4 den nächsten usw. So können mehrere Sender mit je 6 Tastern
+// zusammen mehr als 3 Motoren bedienen.
+// key: Schlüssel des Senders (LINK_KEY dort, 32 Hex-Zeichen) für signierte
+// Befehle (LINK_AUTH), nullptr = Sender signiert nicht.
+struct KnownSender {
+  uint8_t mac[6];
+  const char *name;
+  uint8_t firstMotor;
+  const char *key;
+};
 
-// Nachrichtenstruktur (muss exakt mit dem Sender übereinstimmen!)
-typedef struct struct_message {
-  uint8_t buttonMask;      // Bit 0-5: Taster 1-6
-  float   batteryVoltage;  // Batteriespannung des Senders
-  uint8_t sequence;        // Sequenznummer
-  int16_t adcRaw;          // ADC-Rohwert
-  int8_t  rssi;            // Signalstärke (NEU)
-  uint32_t timestamp;      // Zeitstempel (NEU)
-} struct_message;
+const KnownSender knownSenders[] = {
+  {{0x20, 0x6E, 0xF1, 0xA7, 0x4E, 0xB8}, "Sender 1", 0, SENDER1_KEY},
+  // {{0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF}, "Handsender", 0, nullptr},
+  // {{0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x01}, "Sender Motoren 4-6", 3, nullptr},
+};
 
-struct_message receivedData;  // Hier wird die empfangene Nachricht gespeichert
+SenderRegistry senders;  // Tabelle mit Sequenzfenster und Statistik je Sender
+
+// Frames fremder ESP-NOW-Geräte (vor jeder Auswertung verworfen). Gemeldet
+// wird nur ein neuer Absender, nicht jedes Paket eines gesprächigen Nachbarn.
+uint32_t foreignFrames = 0;
+uint8_t lastForeignMac[6] = {0};
 
 // =================== GLOBALE VARIABLEN ===================
 
 unsigned long lastReceiveTime = 0;  // Wann wurde zuletzt ein Paket empfangen?
-uint8_t lastSequence = 0;           // Letzte Sequenznummer (erkennt doppelte Pakete)
-bool outputState[6] = {false};      // Aktueller Zustand der Ausgänge
+OutputMask outputMask = 0;          // Aktueller Zustand der Ausgänge (Bit i = Kanal i)
+
+// Funkstrecke je Sender (schreibt nur der Empfangs-Callback)
+LinkStats linkStats[SENDER_MAX];
+
+// Energiebilanz je Sender, aus Frames mit FRAME_FLAG_ENERGY (schreibt nur
+// der Empfangs-Callback)
+EnergyTotals energyTotals[SENDER_MAX];
+
+// Signierte Befehle je Sender (siehe LINK_AUTH)
+struct SenderAuth {
+  LinkKey key;
+  bool required;          // nur signierte Frames annehmen
+  uint32_t counter;       // höchster angenommener Zähler (schreibt nur der Empfangs-Callback)
+  uint32_t savedCounter;  // zuletzt im NVS gespeichert (nur loop())
+  uint32_t rejected;      // ohne oder mit falscher Signatur
+  uint32_t replayed;      // Zähler nicht neuer als counter (Wiederholung)
+};
+SenderAuth senderAuth[SENDER_MAX];
+
+// Empfangspegel des letzten ESP-NOW-Frames, vom Promiscuous-Callback kurz
+// vor OnDataRecv gesetzt (beide laufen im WiFi-Task)
+struct RxMeta {
+  uint8_t mac[6];
+  int8_t rssi;
+  bool valid;
+};
+RxMeta lastRxMeta;
+
+// Telemetrie-Verlauf aller Sender
+TelemetryStore telemetry;
+uint32_t telemetryClockBase = 0;   // Betriebszeit (s) vor diesem Start, aus dem NVS
+uint32_t telemetryLastSave = 0;    // Betriebszeit (s) des letzten Speicherns
+uint32_t telemetrySaves = 0;       // geschriebene Blobs seit dem Start
+uint32_t telemetrySavedBytes = 0;
+uint8_t telemetryBuffer[TELEMETRY_BLOB_MAX];  // für serialize (nur loop/setup)
+
+// Betriebszeit in Sekunden, über Neustarts fortgesetzt
+uint32_t telemetryClock() {
+  return telemetryClockBase + (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+// Laufzeit des Empfangs-Callbacks (µs), wird mit der Failsafe-Statistik ausgegeben
+volatile uint32_t recvCallbackMaxUs = 0;
+volatile uint32_t recvCallbackCount = 0;
+
+// =================== ARBITRIERUNG ===================
+// Mehrere Sender können dieselben Motoren ansteuern. Regeln pro Motor:
+// - Wer einen freien Motor startet, hält ihn, bis er STOP schickt, einen
+//   anderen Motor wählt oder seine Lease abläuft.
+// - Will ein weiterer Sender dieselbe Richtung, hält er den Motor mit
+//   (der Motor läuft, solange einer der beiden drückt).
+// - Will ein weiterer Sender die Gegenrichtung, wird der Motor gestoppt und
+//   bleibt gesperrt, bis alle beteiligten Sender losgelassen haben
+//   (kein Hin- und Herschalten zwischen zwei Fernbedienungen).
+// - STOP eines Senders betrifft nur die Motoren, die er selbst hält.
+// Sender-Bitmasken: Bit i = Sender mit Index i in senders.
+// Pro Paket werden nur die Motoren angefasst, die der Sender jetzt oder
+// bisher wollte – die Kosten wachsen nicht mit der Anzahl Motoren.
+
+uint8_t motorHolders[MOTOR_COUNT] = {0};       // Sender, die den Motor gerade halten
+OutputMask motorDirection[MOTOR_COUNT] = {0};  // gehaltene Kanäle des Motors
+uint8_t motorBlocked[MOTOR_COUNT] = {0};       // Sender im Konflikt -> Motor gesperrt
+OutputMask senderRequest[SENDER_MAX] = {0};    // zuletzt gewünschte Kanäle je Sender
+OutputMask arbitrated = 0;                     // Ergebnis: Kanäle, die laufen sollen
+
+// Schützt Arbitrierung, Leases und Ausgänge: WiFi-Task (Empfang) und
+// esp_timer-Task (Failsafe) greifen beide darauf zu. Ein Mutex statt eines
+// Spinlocks, weil SPI/I2C-Backends nicht in einem kritischen Abschnitt
+// (Interrupts aus) schreiben dürfen.
+SemaphoreHandle_t controlMutex = nullptr;
+
+void lockControl() { xSemaphoreTake(controlMutex, portMAX_DELAY); }
+void unlockControl() { xSemaphoreGive(controlMutex); }
+
+// =================== STEUER-TASK ===================
+// OnDataRecv prüft nur (Absender, Frame, Sequenz) und legt den Befehl im
+// Briefkasten seines Senders ab; geschaltet wird im Steuer-Task. Je Sender
+// zählt nur der neueste Befehl (jeder Frame trägt den ganzen Tasterzustand):
+// ein Funk-Burst staut sich nicht auf, und ein STOP wartet nie hinter älteren
+// Befehlen desselben Senders. Auch der Failsafe-Timer weckt nur den Task.
+
+// Befehl eines Senders, wie ihn der Steuer-Task braucht
+struct ControlCommand {
+  int64_t receiveUs;         // esp_timer beim Empfang (Lease-Beginn, Übergabezeit)
+  uint32_t senderTimestamp;  // für das Echo
+  uint16_t sequence;
+  uint16_t leaseMs;          // Rohwert aus dem Frame (CMD_MOVE: Zielposition)
+  uint8_t command;           // FrameCommand
+  uint8_t buttonMask;        // schon auf SERVED_BUTTON_MASK begrenzt
+  bool echo;                 // FRAME_FLAG_ECHO
+  bool rssiMeasured;
+  int8_t rssi;
+};
+
+ControlCommand controlMailbox[SENDER_MAX];
+uint8_t controlPending = 0;  // Bit i: Briefkasten von Sender i ist voll
+portMUX_TYPE controlMailboxMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t controlTask = nullptr;
+
+// Fahrbefehle über MQTT (MQTT-Task -> Steuer-Task), je Motor zählt nur der
+// neueste; geschützt durch controlMailboxMux
+#define REMOTE_STOP -1
+int16_t remoteTarget[MOTOR_COUNT];  // Promille oder REMOTE_STOP
+uint32_t remotePending = 0;         // Bit m: Befehl für Motor m liegt vor
+static_assert(MOTOR_COUNT <= 32, "remotePending hat 32 Bits");
+
+struct ControlStats {
+  uint32_t commands;            // ausgeführte Befehle (nur Steuer-Task)
+  uint32_t coalesced;           // vor der Ausführung überschrieben (nur WiFi-Task)
+  LogHistogram<18> handoffUs;   // Empfang -> Steuer-Task (nur Steuer-Task)
+};
+ControlStats controlStats = {};
+
+// Log des Steuer-Tasks: eigener Puffer, da je Puffer nur ein Schreiber
+DeferredLog controlLog;
+#define CONTROL_LOG_ERROR(...) LOG_AT_TO(controlLog, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define CONTROL_LOG_WARN(...)  LOG_AT_TO(controlLog, LOG_LEVEL_WARN, __VA_ARGS__)
+#define CONTROL_LOG_INFO(...)  LOG_AT_TO(controlLog, LOG_LEVEL_INFO, __VA_ARGS__)
+#define CONTROL_LOG_DEBUG(...) LOG_AT_TO(controlLog, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+void serviceControl();
+
+// Weckt den Steuer-Task. Ohne Task (Start fehlgeschlagen) wird sofort im
+// aufrufenden Task geschaltet wie früher; dann kann der Log des Steuer-Tasks
+// Einträge verlieren (zwei Schreiber), das Schalten bleibt durch den Mutex sicher.
+void wakeControlTask() {
+  if (controlTask != nullptr) {
+    xTaskNotifyGive(controlTask);
+  } else {
+    serviceControl();
+  }
+}
+
+// =================== FAILSAFE-TIMER ===================
+// Einmal-Timer (esp_timer), der bei jedem START/RENEW auf das früheste
+// Lease-Ende aller aktiven Sender gestellt wird. Läuft er ab, schaltet sein
+// Callback die Ausgänge der abgelaufenen Sender sofort ab – unabhängig
+// davon, wann loop() das nächste Mal läuft.
+
+esp_timer_handle_t failsafeTimer = nullptr;
+volatile int64_t failsafeDeadline = 0;  // Soll-Abschaltzeit (µs seit Start)
+volatile bool leaseActive = false;      // läuft gerade eine Lease?
+volatile int64_t leaseDeadlineMin = INT64_MAX;  // frühestes Lease-Ende aller Sender (Rückfallebene in loop())
+volatile uint32_t activeLeaseMs = RECEIVE_TIMEOUT;  // Dauer der aktuellen Lease
+
+// Histogramm "Soll-Abschaltzeit vs. tatsächliche Abschaltung" in µs
+// Fach i zählt Abweichungen < failsafeJitterLimits[i], das letzte Fach den Rest
+const uint32_t failsafeJitterLimits[] = {50, 100, 200, 500, 1000, 2000, 5000};
+const int FAILSAFE_JITTER_BUCKETS = sizeof(failsafeJitterLimits) / sizeof(failsafeJitterLimits[0]) + 1;
+
+struct FailsafeStats {
+  uint32_t count;                               // Anzahl Abschaltungen
+  uint32_t buckets[FAILSAFE_JITTER_BUCKETS];
+  uint32_t minJitter;                           // µs
+  uint32_t maxJitter;                           // µs
+  uint64_t sumJitter;                           // µs, für den Mittelwert
+  uint32_t lastJitter;                          // µs, letzte Abschaltung
+};
+
+FailsafeStats failsafeStats = {0, {0}, UINT32_MAX, 0, 0, 0};
+volatile bool failsafeTripped = false;  // wird in loop() gemeldet
+
+// Schaltversatz: CPU-Takte, in denen die Ausgänge eines Schaltvorgangs
+// gemischt sein können (vom Backend gemessen, siehe commit())
+struct OutputCommitStats {
+  uint32_t count;       // Schaltvorgänge mit Änderung
+  uint32_t maxCycles;   // größter Versatz
+  uint32_t lastCycles;  // Versatz des letzten Vorgangs
+  uint32_t lastUs;      // esp_timer beim letzten Vorgang (für das Echo)
+};
+
+OutputCommitStats outputCommitStats = {0, 0, 0, 0};
+
+// Echo-Antworten an Sender (FRAME_FLAG_ECHO, siehe MarkiseProtocol.h)
+uint32_t echoReplies = 0;
+uint32_t echoSendErrors = 0;
+
+// =================== FAHRBEFEHLE ===================
+// Ein Fahrbefehl (CMD_MOVE) fährt einen Motor ohne weitere Frames auf eine
+// Position; der Steuer-Task hält ihn nach der berechneten Fahrzeit selbst
+// an (Failsafe-Timer). Die Position wird bei jedem Schalten aus der
+// Laufzeit fortgeschrieben, auch bei gehaltenen Tastern. Nach dem Start
+// ist sie unbekannt: Dann fährt ein Befehl zuerst in die nächstgelegene
+// Endlage (Referenzfahrt) und von dort aus auf das Ziel.
+// Abbrechen: jeder START/RENEW/MOVE für denselben Motor. Ein Taster
+// während der Fahrt hält den Motor nur an, bis zum Loslassen läuft er
+// nicht (ein kurzer Druck schickt START und MOVE, das MOVE wird dann
+// nicht ausgeführt).
+
+#define TRAVEL_PPM 1000000  // Position in Millionstel des Weges (Endlage Linkslauf)
+
+struct MotorTravelState {
+  int32_t positionPpm;  // geschätzte Position beim letzten Schalten
+  bool known;           // Position gilt (nach einer Fahrt bis in eine Endlage)
+  int64_t runSinceUs;   // seit wann läuft der Motor in der jetzigen Richtung
+  // laufender Fahrbefehl
+  bool moving;
+  OutputMask direction;  // Kanal der Fahrt
+  int32_t targetPpm;     // Ziel dieser Fahrt
+  int32_t finalPpm;      // Ziel nach der Referenzfahrt, -1 = keins
+  int64_t stopUs;        // hier wird angehalten
+};
+
+MotorTravelState motorTravelState[MOTOR_COUNT];
+OutputMask travelMask = 0;          // Kanäle, die Fahrbefehle gerade fahren
+OutputMask travelInterrupted[SENDER_MAX] = {0};  // Motoren, deren Fahrt der Sender mit START angehalten hat
+int64_t positionClockUs = 0;        // esp_timer beim letzten Schalten
+volatile int64_t travelDeadline = INT64_MAX;  // frühestes Fahrtende (Rückfallebene in loop())
+
+struct TravelStats {
+  uint32_t started;     // ausgeführte Fahrbefehle
+  uint32_t references;  // davon mit Referenzfahrt
+  uint32_t completed;   // Ziel erreicht
+  uint32_t cancelled;   // durch einen anderen Befehl abgebrochen
+  uint32_t refused;     // Motor von einem anderen Sender gehalten, ohne Fahrzeit oder schon am Ziel
+  uint32_t maxLateUs;   // größte Verspätung beim Anhalten
+};
+TravelStats travelStats = {};
+
+// Zustand eines Motors für die MQTT-Brücke (Schnappschuss unter controlMutex)
+struct MotorReport {
+  OutputMask running;  // eingeschaltete Kanäle
+  int16_t position;    // Promille, -1 = unbekannt
+  int16_t target;      // Ziel der laufenden Fahrt (Promille), -1 = keine
+};
+
+// Meldet die Motoren in motors an die MQTT-Brücke (siehe MQTT-BRÜCKE)
+void postMotorReports(uint32_t motors, const MotorReport *reports);
+
+// Fahrzeit von Endlage zu Endlage in Richtung dir (µs), 0 = nicht konfiguriert
+int64_t fullTravelUs(int motor, OutputMask dir) {
+  uint32_t ms = (dir & Topology::LEFT) ? motorTravel[motor].leftMs : motorTravel[motor].rightMs;
+  return ms * 1000LL;
+}
+
+// Position nach elapsed µs Fahrt in Richtung dir (an den Endlagen begrenzt)
+int32_t advancePosition(int motor, int32_t positionPpm, OutputMask dir, int64_t elapsed) {
+  int64_t full = fullTravelUs(motor, dir);
+  if (full == 0) return positionPpm;
+  int64_t delta = elapsed * TRAVEL_PPM / full;
+  int64_t next = (dir & Topology::LEFT) ? positionPpm + delta : positionPpm - delta;
+  if (next < 0) return 0;
+  if (next > TRAVEL_PPM) return TRAVEL_PPM;
+  return (int32_t)next;
+}
+
+// Geschätzte Position jetzt, auch während der Motor läuft (nur mit controlMutex)
+int32_t motorPosition(int motor, int64_t now) {
+  const MotorTravelState &state = motorTravelState[motor];
+  OutputMask running = outputMask & Topology::motorBits(motor);
+  if (running == 0) return state.positionPpm;
+  return advancePosition(motor, state.positionPpm, running, now - positionClockUs);
+}
+
+// Schreibt die Fahrt seit dem letzten Schalten in die Positionen ein
+// (commitOutputs, vor dem Umschalten von previous auf next)
+void trackPositions(OutputMask previous, OutputMask next, int64_t now) {
+  int64_t elapsed = now - positionClockUs;
+  positionClockUs = now;
+  OutputMask touched = previous | next;
+  while (touched != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(touched));
+    OutputMask bits = Topology::motorBits(motor);
+    touched &= ~bits;
+    MotorTravelState &state = motorTravelState[motor];
+    OutputMask was = previous & bits;
+    if (was != 0) state.positionPpm = advancePosition(motor, state.positionPpm, was, elapsed);
+    if (was == (next & bits)) continue;
+    // Richtung wechselt oder Motor hält: lief er den ganzen Weg, steht er in der Endlage
+    int64_t full = fullTravelUs(motor, was);
+    if (was != 0 && full != 0 && now - state.runSinceUs >= full) state.known = true;
+    state.runSinceUs = now;
+  }
+}
 
 // =================== AUSGANGS-FUNKTIONEN ===================
 
 // Initialisiert alle Ausgänge (setzt sie auf AUS)
 void initOutputs() {
-  for (int i = 0; i < 6; i++) {
-    pinMode(outputPins[i], OUTPUT);
-    digitalWrite(outputPins[i], LOW);
-    outputState[i] = false;
-    Serial.printf("Ausgang %d (GPIO %d): %s\n", 
-                  i+1, outputPins[i], outputNames[i]);
+  outputs.begin();
+  outputMask = 0;
+  for (int i = 0; i < Topology::CHANNELS; i++) {
+    Serial.printf("Ausgang %d (%s %d): %s\n",
+                  i+1, OutputBackend::KIND, OutputBackend::location(i), outputNames[i]);
   }
 }
 
+// Schreibt das komplette Ausgangswort in einem Schritt über das Backend
+// (GPIO: ein Clear- und ein Set-Registerzugriff, 74HC595: ein Latch-Puls,
+// MCP23017: eine I2C-Übertragung). Es gibt keinen Zwischenzustand mit einer
+// halb umgeschalteten Richtung.
+// Gibt nichts aus (läuft auch im Timer-Callback); nur mit controlMutex aufrufen.
+// Rückgabe: geänderte Ausgänge
+OutputMask commitOutputs(OutputMask nextMask) {
+  OutputMask changed = nextMask ^ outputMask;
+  if (changed == 0) return 0;
+
+  uint32_t cycles = outputs.commit(outputMask, nextMask);
+
+  int64_t now = esp_timer_get_time();
+  trackPositions(outputMask, nextMask, now);
+  outputMask = nextMask;
+  outputCommitStats.lastUs = (uint32_t)now;
+  outputCommitStats.count++;
+  outputCommitStats.lastCycles = cycles;
+  if (cycles > outputCommitStats.maxCycles) outputCommitStats.maxCycles = cycles;
+  return changed;
+}
+
+// Schaltet alle Ausgänge aus, die nicht in keepMask stehen
+// Gibt bewusst nichts aus, damit sie auch aus dem Timer-Callback
+// ohne Verzögerung durch die serielle Schnittstelle läuft
+void disableOutputsExcept(OutputMask keepMask) {
+  commitOutputs(outputMask & keepMask);
+}
+
 // Schaltet alle Ausgänge aus (Sicherheitsfunktion)
 void disableAllOutputs() {
-  Serial.println("!!! SICHERHEITSABSCHALTUNG: Alle Ausgänge AUS !!!");
-  for (int i = 0; i < 6; i++) {
-    if (outputState[i]) {
-      outputState[i] = false;
-      digitalWrite(outputPins[i], LOW);
-    }
-  }
-}
-
-// Setzt die Ausgänge basierend auf der empfangenen Taster-Maske
-void setOutputsFromMask(uint8_t buttonMask) {
-  bool hasInvalidCombination = false;
-  
-  // Debug-Ausgabe der empfangenen Maske
-  Serial.print("Empfangene Maske: 0b");
-  for (int i = 5; i >= 0; i--) {
-    Serial.print((buttonMask >> i) & 1);
-  }
-  Serial.print(" (0x");
-  Serial.print(buttonMask, HEX);
-  Serial.println(")");
-  
-  // Prüfung auf ungültige Kombinationen (beide Taster eines Motors gleichzeitig)
-  for (int motor = 0; motor < 3; motor++) {
-    int leftIndex  = motorPairs[motor][0];   // Linkslauf-Ausgang
-    int rightIndex = motorPairs[motor][1];   // Rechtslauf-Ausgang
-    
-    bool leftPressed  = (buttonMask >> leftIndex) & 1;
-    bool rightPressed = (buttonMask >> rightIndex) & 1;
-    
-    if (leftPressed && rightPressed) {
-      // Beide Richtungen gleichzeitig - DAS DARF NICHT PASSIEREN!
-      Serial.printf("FEHLER: Motor %d würde Links und Rechts gleichzeitig bekommen!\n", motor+1);
-      Serial.println("-> Beide Ausgänge werden AUSgeschaltet!");
-      
-      // Sicherheitshalber beide Ausgänge ausschalten
-      if (outputState[leftIndex]) {
-        outputState[leftIndex] = false;
-        digitalWrite(outputPins[leftIndex], LOW);
+  disableOutputsExcept(0);
+}
+
+// Setzt die Ausgänge basierend auf der Kanal-Maske
+// Läuft im Steuer-Task: Ausgaben nur über CONTROL_LOG_*() (siehe DeferredLog.h),
+// und erst nachdem geschaltet wurde
+void setOutputsFromMask(OutputMask channelMask) {
+  // Motor-Verriegelung: beide Richtungen eines Motors -> beide aus
+  OutputMask invalid = Topology::conflicts(channelMask);
+  OutputMask nextMask = Topology::safeMask(channelMask);
+  OutputMask changed = commitOutputs(nextMask);
+  
+  // Debug-Ausgabe der empfangenen Maske (Log kennt nur 32-Bit-Werte)
+  CONTROL_LOG_DEBUG("Empfangene Maske: 0x%02X", (uint32_t)channelMask);
+  
+  while (invalid != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(invalid));
+    invalid &= invalid - 1;
+    // Beide Richtungen gleichzeitig - DAS DARF NICHT PASSIEREN!
+    CONTROL_LOG_ERROR("FEHLER: Motor %d würde Links und Rechts gleichzeitig bekommen! -> Beide AUS", motor+1);
+  }
+  
+  while (changed != 0) {
+    int i = Topology::lowestChannel(changed);
+    changed &= changed - 1;
+    CONTROL_LOG_INFO("  %s: %s", outputNames[i], ((nextMask >> i) & 1) ? "EIN" : "AUS");
+  }
+  
+  if (Topology::conflicts(channelMask) != 0) {
+    CONTROL_LOG_WARN("WARNUNG: Ungültige Tasterkombination wurde korrigiert!");
+  }
+}
+
+// Gibt Schaltvorgänge und den größten Schaltversatz der Ausgänge aus
+void printOutputStats() {
+  OutputCommitStats stats = outputCommitStats;  // Schnappschuss
+  if (stats.count == 0) return;
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  Serial.printf("Ausgänge: %u Schaltvorgänge, Versatz max. %u Takte (%u ns), zuletzt %u Takte\n",
+                (unsigned)stats.count, (unsigned)stats.maxCycles,
+                (unsigned)(stats.maxCycles * 1000ULL / mhz), (unsigned)stats.lastCycles);
+}
+
+// =================== ARBITRIERUNGS-FUNKTIONEN ===================
+// Nur mit gehaltenem controlMutex aufrufen
+
+// Ausgänge, die nach der Arbitrierung eingeschaltet sein sollen
+// (gehaltene Taster und laufende Fahrbefehle)
+OutputMask arbitratedMask() {
+  return arbitrated | travelMask;
+}
+
+// Überträgt den Zustand eines Motors in arbitrated
+void updateArbitrated(int motor) {
+  OutputMask motorBits = Topology::motorBits(motor);
+  arbitrated &= ~motorBits;
+  if (motorHolders[motor] != 0) arbitrated |= motorDirection[motor];
+}
+
+// Kanäle zur Taster-Maske eines Senders (Taster 1 = Kanal channelOffset)
+OutputMask senderChannels(int index, uint8_t buttonMask) {
+  return (OutputMask)(((uint64_t)buttonMask << senders.at(index).channelOffset) & Topology::ALL);
+}
+
+// Sender gibt alle Motoren frei (STOP oder Lease abgelaufen)
+void releaseSender(int index) {
+  uint8_t bit = 1 << index;
+  OutputMask touched = senderRequest[index];
+  while (touched != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(touched));
+    touched &= ~Topology::motorBits(motor);
+    motorHolders[motor] &= ~bit;
+    motorBlocked[motor] &= ~bit;
+    if (motorHolders[motor] == 0) motorDirection[motor] = 0;
+    updateArbitrated(motor);
+  }
+  senderRequest[index] = 0;
+  senders.at(index).activeMask = 0;
+}
+
+// Wendet den Wunsch eines Senders (Taster-Maske) auf seine Motoren an
+// Rückgabe: true = Konflikt mit einem anderen Sender (Motor gestoppt)
+bool requestFromSender(int index, uint8_t buttonMask) {
+  uint8_t bit = 1 << index;
+  bool conflict = false;
+  OutputMask channels = senderChannels(index, buttonMask);
+  OutputMask touched = channels | senderRequest[index];
+  while (touched != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(touched));
+    OutputMask motorBits = Topology::motorBits(motor);
+    OutputMask wanted = channels & motorBits;
+    touched &= ~motorBits;
+
+    if (wanted == 0) {
+      // Sender will diesen Motor (nicht mehr)
+      motorHolders[motor] &= ~bit;
+      motorBlocked[motor] &= ~bit;
+      if (motorHolders[motor] == 0) motorDirection[motor] = 0;
+    } else if (motorBlocked[motor] != 0) {
+      // Gesperrt bis alle Beteiligten loslassen
+      motorBlocked[motor] |= bit;
+    } else if (motorHolders[motor] == 0 || motorDirection[motor] == wanted) {
+      motorHolders[motor] |= bit;
+      motorDirection[motor] = wanted;
+    } else if (motorHolders[motor] == bit) {
+      // Einziger Halter wechselt die Richtung
+      motorDirection[motor] = wanted;
+    } else {
+      // Gegenrichtung von einem anderen Sender -> stoppen und sperren
+      motorBlocked[motor] = motorHolders[motor] | bit;
+      motorHolders[motor] = 0;
+      motorDirection[motor] = 0;
+      conflict = true;
+    }
+    updateArbitrated(motor);
+  }
+  senderRequest[index] = channels;
+  senders.at(index).activeMask = buttonMask;
+  return conflict;
+}
+
+// =================== FAHRBEFEHL-FUNKTIONEN ===================
+// Nur mit gehaltenem controlMutex aufrufen (Steuer-Task)
+
+// Beendet die Fahrt eines Motors (geschaltet wird danach mit setOutputsFromMask)
+void endTravel(int motor) {
+  MotorTravelState &state = motorTravelState[motor];
+  state.moving = false;
+  state.finalPpm = -1;
+  travelMask &= ~Topology::motorBits(motor);
+}
+
+// Bricht die Fahrten der Motoren in channels ab
+// Rückgabe: Kanäle der Motoren, deren Fahrt abgebrochen wurde
+OutputMask cancelTravel(OutputMask channels) {
+  OutputMask cancelled = 0;
+  while (channels != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(channels));
+    OutputMask bits = Topology::motorBits(motor);
+    channels &= ~bits;
+    if (!motorTravelState[motor].moving) continue;
+    endTravel(motor);
+    cancelled |= bits;
+    travelStats.cancelled++;
+    CONTROL_LOG_INFO("Motor %d: Fahrt abgebrochen", motor + 1);
+  }
+  return cancelled;
+}
+
+// Startet die Fahrt eines Motors auf targetPpm (bei unbekannter Position
+// über die nähere Endlage). Rückgabe: false = nichts zu fahren (keine
+// Fahrzeit eingetragen oder Ziel schon erreicht)
+bool startTravel(int motor, int32_t targetPpm, int64_t now) {
+  MotorTravelState &state = motorTravelState[motor];
+  if (motorTravel[motor].leftMs == 0 || motorTravel[motor].rightMs == 0) return false;
+
+  int32_t goal = targetPpm;
+  int32_t finalPpm = -1;
+  bool toEnd = goal == 0 || goal == TRAVEL_PPM;
+  if (!state.known && !toEnd) {
+    finalPpm = targetPpm;
+    goal = targetPpm < TRAVEL_PPM / 2 ? 0 : TRAVEL_PPM;
+    toEnd = true;
+  }
+
+  int32_t position = motorPosition(motor, now);
+  if (state.known && position == goal) return false;
+  bool left = goal == TRAVEL_PPM || (goal != 0 && goal > position);
+  OutputMask dir = (OutputMask)1 << (left ? Topology::leftChannel(motor) : Topology::rightChannel(motor));
+  int64_t full = fullTravelUs(motor, dir);
+  int64_t durationUs = state.known ? (int64_t)(goal > position ? goal - position : position - goal) * full / TRAVEL_PPM
+                                   : full;
+  // In die Endlage etwas länger, dort schaltet der Endschalter ab
+  if (toEnd) durationUs += full * TRAVEL_OVERRUN_PERCENT / 100;
+  if (durationUs < TRAVEL_MIN_MS * 1000LL) return false;
+  if (durationUs > TRAVEL_MAX_MS * 1000LL) durationUs = TRAVEL_MAX_MS * 1000LL;
+
+  state.moving = true;
+  state.direction = dir;
+  state.targetPpm = goal;
+  state.finalPpm = finalPpm;
+  state.stopUs = now + durationUs;
+  travelMask = (OutputMask)((travelMask & ~Topology::motorBits(motor)) | dir);
+  return true;
+}
+
+// Fährt einen Motor auf position (Promille), sofern ihn kein Sender hält
+// Rückgabe: false = abgelehnt oder nichts zu fahren
+bool moveMotor(int motor, uint16_t position, int64_t now) {
+  if (motorHolders[motor] != 0 || motorBlocked[motor] != 0) {
+    travelStats.refused++;
+    CONTROL_LOG_WARN("Motor %d: von einem Sender gehalten - Fahrbefehl ignoriert", motor + 1);
+    return false;
+  }
+  cancelTravel(Topology::motorBits(motor));
+  if (!startTravel(motor, (int32_t)position * (TRAVEL_PPM / MOVE_POSITION_MAX), now)) {
+    travelStats.refused++;
+    CONTROL_LOG_INFO("Motor %d: Fahrbefehl auf %d Promille - nichts zu fahren", motor + 1, position);
+    return false;
+  }
+  const MotorTravelState &state = motorTravelState[motor];
+  travelStats.started++;
+  if (state.finalPpm >= 0) travelStats.references++;
+  CONTROL_LOG_INFO("Motor %d: Fahrt auf %d Promille, %u ms%s", motor + 1, position,
+                   (uint32_t)((state.stopUs - now) / 1000),
+                   state.finalPpm >= 0 ? " (Referenzfahrt, Position unbekannt)" : "");
+  return true;
+}
+
+// Fahrbefehl eines Senders: Er gibt seine gehaltenen Motoren frei, die
+// gewählten Motoren fahren auf position (Promille). Motoren, deren Fahrt
+// er mit diesem Tastendruck angehalten hat, bleiben stehen.
+void moveFromSender(int index, uint8_t buttonMask, uint16_t position, int64_t now) {
+  OutputMask channels = senderChannels(index, buttonMask);
+  OutputMask interrupted = travelInterrupted[index];
+  travelInterrupted[index] = 0;
+  releaseSender(index);
+  while (channels != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(channels));
+    OutputMask bits = Topology::motorBits(motor);
+    channels &= ~bits;
+    if (interrupted & bits) continue;
+    moveMotor(motor, position, now);
+  }
+}
+
+// Fahrbefehle über MQTT (Bit m in motors: targets[m] für Motor m).
+// REMOTE_STOP bricht nur eine Fahrt ab – gehaltene Taster gehen vor.
+void moveFromRemote(uint32_t motors, const int16_t *targets, int64_t now) {
+  for (; motors != 0; motors &= motors - 1) {
+    int motor = __builtin_ctz(motors);
+    if (targets[motor] == REMOTE_STOP) {
+      cancelTravel(Topology::motorBits(motor));
+    } else {
+      moveMotor(motor, (uint16_t)targets[motor], now);
+    }
+  }
+}
+
+// Hält die Motoren an, deren Fahrt zu Ende ist; nach einer Referenzfahrt
+// geht es von der Endlage aus weiter zum eigentlichen Ziel
+void finishTravel(int64_t now) {
+  OutputMask moving = travelMask;
+  while (moving != 0) {
+    int motor = Topology::motorOf(Topology::lowestChannel(moving));
+    moving &= ~Topology::motorBits(motor);
+    MotorTravelState &state = motorTravelState[motor];
+    if (state.stopUs > now) continue;
+
+    uint32_t late = (uint32_t)(now - state.stopUs);
+    if (late > travelStats.maxLateUs) travelStats.maxLateUs = late;
+    // Den ganzen Weg gefahren: Motor steht in der Endlage (wie trackPositions)
+    if (now - state.runSinceUs >= fullTravelUs(motor, state.direction)) state.known = true;
+    int32_t finalPpm = state.finalPpm;
+    endTravel(motor);
+    if (finalPpm >= 0 && state.known && startTravel(motor, finalPpm, now)) {
+      CONTROL_LOG_INFO("Motor %d: Referenzfahrt beendet, weiter auf %d Promille", motor + 1,
+                       finalPpm / (TRAVEL_PPM / MOVE_POSITION_MAX));
+      continue;
+    }
+    travelStats.completed++;
+    CONTROL_LOG_INFO("Motor %d: Fahrt beendet, Position %d Promille", motor + 1,
+                     motorPosition(motor, now) / (TRAVEL_PPM / MOVE_POSITION_MAX));
+  }
+}
+
+// Zustand eines Motors für die MQTT-Brücke
+MotorReport motorReport(int motor, int64_t now) {
+  const MotorTravelState &state = motorTravelState[motor];
+  MotorReport report;
+  report.running = outputMask & Topology::motorBits(motor);
+  report.position = state.known ? (int16_t)(motorPosition(motor, now) / (TRAVEL_PPM / MOVE_POSITION_MAX)) : -1;
+  report.target = -1;
+  if (state.moving) {
+    int32_t goal = state.finalPpm >= 0 ? state.finalPpm : state.targetPpm;
+    report.target = (int16_t)(goal / (TRAVEL_PPM / MOVE_POSITION_MAX));
+  }
+  return report;
+}
+
+// Positionen und Fahrbefehle (im 60-s-Bericht, nur wenn es Fahrbefehle gab)
+void printTravelStats() {
+  TravelStats stats = travelStats;  // Schnappschuss
+  if (stats.started == 0 && stats.refused == 0) return;
+  Serial.printf("Fahrbefehle: %u gestartet (%u mit Referenzfahrt), %u am Ziel, %u abgebrochen, "
+                "%u ignoriert, Anhalten max. %u us verspätet\n",
+                (unsigned)stats.started, (unsigned)stats.references, (unsigned)stats.completed,
+                (unsigned)stats.cancelled, (unsigned)stats.refused, (unsigned)stats.maxLateUs);
+  // Schnappschuss unter der Sperre, ausgegeben erst danach: Serial kann
+  // hier blockieren und der Steuer-Task darf nicht warten
+  struct {
+    bool known;
+    bool moving;
+    int32_t position;  // Promille
+  } motors[MOTOR_COUNT];
+  lockControl();
+  int64_t now = esp_timer_get_time();
+  for (int m = 0; m < MOTOR_COUNT; m++) {
+    motors[m].known = motorTravelState[m].known;
+    motors[m].moving = motorTravelState[m].moving;
+    motors[m].position = motorPosition(m, now) / (TRAVEL_PPM / MOVE_POSITION_MAX);
+  }
+  unlockControl();
+  for (int m = 0; m < MOTOR_COUNT; m++) {
+    if (motors[m].known) {
+      Serial.printf("  Motor %d: Position %d Promille%s\n", m + 1, (int)motors[m].position,
+                    motors[m].moving ? " (fährt)" : "");
+    } else {
+      Serial.printf("  Motor %d: Position unbekannt\n", m + 1);
+    }
+  }
+}
+
+// =================== FAILSAFE-FUNKTIONEN ===================
+
+// Trägt eine Abweichung (µs) ins Histogramm ein
+void recordFailsafeJitter(uint32_t jitter) {
+  int bucket = 0;
+  while (bucket < FAILSAFE_JITTER_BUCKETS - 1 && jitter >= failsafeJitterLimits[bucket]) {
+    bucket++;
+  }
+  failsafeStats.buckets[bucket]++;
+  failsafeStats.count++;
+  failsafeStats.sumJitter += jitter;
+  failsafeStats.lastJitter = jitter;
+  if (jitter < failsafeStats.minJitter) failsafeStats.minJitter = jitter;
+  if (jitter > failsafeStats.maxJitter) failsafeStats.maxJitter = jitter;
+}
+
+// Gibt alle Sender frei, deren Lease ohne Erneuerung abgelaufen ist
+// (nur mit controlMutex aufrufen).
+// Rückgabe: frühestes abgelaufenes Lease-Ende, INT64_MAX = keins
+int64_t releaseExpiredSenders(int64_t now) {
+  int64_t earliest = INT64_MAX;
+  for (int i = 0; i < senders.count(); i++) {
+    const SenderEntry &entry = senders.at(i);
+    if (entry.activeMask == 0 || entry.leaseDeadline > now) continue;
+    if (entry.leaseDeadline < earliest) earliest = entry.leaseDeadline;
+    releaseSender(i);
+  }
+  return earliest;
+}
+
+// Läuft im esp_timer-Task, wenn eine Lease ohne Erneuerung abgelaufen ist:
+// abgeschaltet wird im Steuer-Task (serviceControl)
+void onFailsafeTimeout(void *) {
+  wakeControlTask();
+}
+
+// Legt den Failsafe-Timer an (einmalig in setup())
+void initFailsafeTimer() {
+  esp_timer_create_args_t args = {};
+  args.callback = onFailsafeTimeout;
+  args.arg = nullptr;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "failsafe";
+
+  if (esp_timer_create(&args, &failsafeTimer) != ESP_OK) {
+    failsafeTimer = nullptr;
+    Serial.println("Failsafe-Timer konnte nicht angelegt werden - nur loop()-Überwachung!");
+  }
+}
+
+// Lease-Dauer aus dem Frame auf die erlaubten Grenzen bringen
+// (0 = Sender ohne Lease: RECEIVE_TIMEOUT wie bisher)
+uint32_t leaseFromFrame(uint16_t requestedMs) {
+  if (requestedMs == 0) return RECEIVE_TIMEOUT;
+  if (requestedMs < LEASE_MIN_MS) return LEASE_MIN_MS;
+  if (requestedMs > LEASE_MAX_MS) return LEASE_MAX_MS;
+  return requestedMs;
+}
+
+// Stellt den Failsafe-Timer auf das früheste Lease-Ende aller aktiven
+// Sender bzw. Ende eines Fahrbefehls; ohne beides wird er angehalten (nur
+// mit controlMutex aufrufen)
+// Rückgabe: true = mindestens eine Lease läuft
+bool armFailsafeTimer() {
+  int64_t earliest = INT64_MAX;
+  for (int i = 0; i < senders.count(); i++) {
+    const SenderEntry &entry = senders.at(i);
+    if (entry.activeMask != 0 && entry.leaseDeadline < earliest) earliest = entry.leaseDeadline;
+  }
+  leaseActive = (earliest != INT64_MAX);
+  leaseDeadlineMin = earliest;
+
+  // Fahrbefehle hält derselbe Timer an
+  int64_t travelEnd = INT64_MAX;
+  for (OutputMask moving = travelMask; moving != 0; moving &= moving - 1) {
+    const MotorTravelState &state = motorTravelState[Topology::motorOf(Topology::lowestChannel(moving))];
+    if (state.stopUs < travelEnd) travelEnd = state.stopUs;
+  }
+  travelDeadline = travelEnd;
+  if (travelEnd < earliest) earliest = travelEnd;
+  if (failsafeTimer == nullptr) return leaseActive;
+
+  esp_timer_stop(failsafeTimer);  // Fehler "läuft nicht" ist hier egal
+  if (earliest == INT64_MAX) return false;
+  failsafeDeadline = earliest;
+  int64_t delay = earliest - esp_timer_get_time();
+  esp_timer_start_once(failsafeTimer, delay > 0 ? (uint64_t)delay : 0);
+  return leaseActive;
+}
+
+// Gibt die Sender frei, deren Lease seit mehr als FAILSAFE_BACKUP_MARGIN
+// abgelaufen ist, und schaltet deren Motoren ab (Rückfallebene in loop()).
+// Sender mit laufender Lease und Fahrbefehle bleiben unberührt.
+void releaseOverdueSenders(int64_t now) {
+  lockControl();
+  releaseExpiredSenders(now - FAILSAFE_BACKUP_MARGIN * 1000LL);
+  setOutputsFromMask(arbitratedMask());
+  armFailsafeTimer();
+  unlockControl();
+}
+
+// Gibt Statistik und Zustand aller Sender aus
+void printSenderStats() {
+  for (int i = 0; i < senders.count(); i++) {
+    SenderEntry entry = senders.at(i);  // Schnappschuss (WiFi-Task schreibt weiter)
+    if (entry.stats.packets == 0 && entry.stats.duplicates == 0 && entry.stats.tooOld == 0) continue;
+    Serial.printf("%s: %u Pakete, doppelt %u, zu alt %u, verspätet %u, neu synchronisiert %u, Konflikte %u\n",
+                  entry.name, (unsigned)entry.stats.packets, (unsigned)entry.stats.duplicates,
+                  (unsigned)entry.stats.tooOld, (unsigned)entry.stats.late,
+                  (unsigned)entry.stats.resyncs, (unsigned)entry.stats.conflicts);
+    const SenderAuth &auth = senderAuth[i];
+    if (auth.required) {
+      Serial.printf("  signiert: Zähler %lu, Signatur falsch %u, wiederholt %u\n",
+                    (unsigned long)auth.counter, (unsigned)auth.rejected, (unsigned)auth.replayed);
+    }
+    const LinkStats &link = linkStats[i];
+    Serial.printf("  zuletzt vor %lu ms, RSSI %d dBm, Batterie %u mV, Verlust %u.%u %%, Jitter %u us\n",
+                  (unsigned long)(millis() - entry.lastSeenMs), entry.lastRssi,
+                  (unsigned)entry.batteryMillivolts, (unsigned)(link.lossPermille() / 10),
+                  (unsigned)(link.lossPermille() % 10), (unsigned)link.jitterUs());
+  }
+}
+
+// Gibt die nicht leeren Fächer eines Histogramms aus
+template <typename Histogram>
+void printHistogram(const char *title, const char *unit, const Histogram &histogram) {
+  Serial.printf("  %s [%s]: p50 %u, p90 %u, p99 %u, p99.9 %u, max %u\n", title, unit,
+                (unsigned)histogram.percentile(500), (unsigned)histogram.percentile(900),
+                (unsigned)histogram.percentile(990), (unsigned)histogram.percentile(999),
+                (unsigned)histogram.max);
+  for (int b = 0; b < Histogram::BUCKETS; b++) {
+    if (histogram.buckets[b] == 0) continue;
+    if (b + 1 < Histogram::BUCKETS) {
+      Serial.printf("    %6u-%-6u %u\n", (unsigned)Histogram::lowerBound(b),
+                    (unsigned)(Histogram::lowerBound(b + 1) - 1), (unsigned)histogram.buckets[b]);
+    } else {
+      Serial.printf("    >=%-11u %u\n", (unsigned)Histogram::lowerBound(b), (unsigned)histogram.buckets[b]);
+    }
+  }
+}
+
+// Funkstrecken-Bericht je Sender (serieller Befehl LINK_REPORT_COMMAND)
+void printLinkReport() {
+  for (int i = 0; i < senders.count(); i++) {
+    LinkStats link = linkStats[i];  // Schnappschuss (WiFi-Task schreibt weiter)
+    if (link.received == 0) continue;
+    Serial.printf("Funkstrecke %s: %u Pakete, verloren %u (%u.%u %%), verspätet %u, %u Sitzungen\n",
+                  senders.at(i).name, (unsigned)link.received, (unsigned)link.lost,
+                  (unsigned)(link.lossPermille() / 10), (unsigned)(link.lossPermille() % 10),
+                  (unsigned)link.reordered, (unsigned)link.sessions);
+    Serial.printf("  Jitter %u us, Abstand größer als die Lease: %u\n",
+                  (unsigned)link.jitterUs(), (unsigned)link.leaseGaps);
+    printHistogram("Abstand", "ms", link.interArrivalMs);
+    printHistogram("Abweichung vom Sendeabstand", "us", link.transitDeltaUs);
+    printHistogram("Verlust am Stück", "Pakete", link.lossBursts);
+    if (link.rssi.count == 0) {
+      Serial.printf("  Empfangspegel: nicht gemessen (%u Pakete)\n", (unsigned)link.rssiMissing);
+      continue;
+    }
+    Serial.printf("  Empfangspegel [dBm]: min %d, mittel %d, max %d (ohne Messung: %u)\n",
+                  link.rssi.min, (int)(link.rssi.sum / (int32_t)link.rssi.count), link.rssi.max,
+                  (unsigned)link.rssiMissing);
+    for (int b = 0; b < LINK_RSSI_BUCKETS; b++) {
+      if (link.rssi.buckets[b] == 0) continue;
+      Serial.printf("    %4d..%-4d %u\n", link.rssi.lowerBound(b), link.rssi.lowerBound(b) + 1,
+                    (unsigned)link.rssi.buckets[b]);
+    }
+  }
+}
+
+// Energiebilanz je Sender (serieller Befehl ENERGY_REPORT_COMMAND)
+void printEnergyReport() {
+  static const char *const names[ENERGY_STATE_COUNT] = {
+    "Start", "Wach", "Senden", "LED", "Light Sleep", "Tiefschlaf"};
+  for (int i = 0; i < senders.count(); i++) {
+    EnergyTotals totals = energyTotals[i];  // Schnappschuss (WiFi-Task schreibt weiter)
+    if (totals.records == 0) continue;
+    uint32_t totalUah = 0;
+    for (int s = 0; s < ENERGY_STATE_COUNT; s++) totalUah += totals.chargeUah[s];
+    Serial.printf("Energiebilanz %s: %u Datensätze (ohne Paar %u), bisher %lu.%03lu mAh\n",
+                  senders.at(i).name, (unsigned)totals.records, (unsigned)totals.unpaired,
+                  (unsigned long)(totalUah / 1000), (unsigned long)(totalUah % 1000));
+    for (int s = 0; s < ENERGY_STATE_COUNT; s++) {
+      Serial.printf("  %-11s", names[s]);
+      if (totals.validSeconds & (1 << s)) {
+        Serial.printf(" %9lu s", (unsigned long)totals.seconds[s]);
+      } else {
+        Serial.printf(" %9s s", "-");
       }
-      if (outputState[rightIndex]) {
-        outputState[rightIndex] = false;
-        digitalWrite(outputPins[rightIndex], LOW);
+      if (totals.validCharge & (1 << s)) {
+        Serial.printf("  %8lu uAh  %3lu %%\n", (unsigned long)totals.chargeUah[s],
+                      (unsigned long)(totalUah == 0 ? 0 : (uint64_t)totals.chargeUah[s] * 100 / totalUah));
+      } else {
+        Serial.printf("  %8s uAh\n", "-");
       }
-      
-      hasInvalidCombination = true;
     }
   }
-  
-  // Normale Ausgangssetzung für alle Kanäle
-  for (int i = 0; i < 6; i++) {
-    bool newState = (buttonMask >> i) & 1;
-    
-    if (newState != outputState[i]) {
-      // Zustand ändert sich
-      outputState[i] = newState;
-      digitalWrite(outputPins[i], newState ? HIGH : LOW);
-      
-      // Debug-Ausgabe
-      Serial.printf("  %s: %s\n", outputNames[i], newState ? "EIN" : "AUS");
+}
+
+// Gibt die Jitter-Statistik des Failsafe-Timers aus
+void printFailsafeStats() {
+  FailsafeStats stats = failsafeStats;  // Schnappschuss (Timer-Task schreibt weiter)
+  if (stats.count == 0) return;
+
+  Serial.printf("Failsafe: %u Abschaltungen, Jitter min/mittel/max: %u/%u/%u us\n",
+                (unsigned)stats.count, (unsigned)stats.minJitter,
+                (unsigned)(stats.sumJitter / stats.count), (unsigned)stats.maxJitter);
+  for (int i = 0; i < FAILSAFE_JITTER_BUCKETS; i++) {
+    if (i < FAILSAFE_JITTER_BUCKETS - 1) {
+      Serial.printf("  < %5u us: %u\n", (unsigned)failsafeJitterLimits[i], (unsigned)stats.buckets[i]);
+    } else {
+      Serial.printf("  >=%5u us: %u\n", (unsigned)failsafeJitterLimits[i - 1], (unsigned)stats.buckets[i]);
     }
   }
-  
-  if (hasInvalidCombination) {
-    Serial.println("WARNUNG: Ungültige Tasterkombination wurde korrigiert!");
-  }
 }
 
 // =================== ESP-NOW FUNKTIONEN ===================
 
+// Sieht jeden Management-Frame vor der ESP-NOW-Auswertung und merkt sich
+// Absender und Empfangspegel von ESP-NOW-Frames (Action, herstellerspezifisch)
+void OnPromiscuousRx(void *buf, wifi_promiscuous_pkt_type_t type) {
+  if (type != WIFI_PKT_MGMT) return;
+  const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+  if (pkt->rx_ctrl.sig_len < 24 + 4 || pkt->payload[0] != 0xD0 || pkt->payload[24] != 127) return;
+  memcpy(lastRxMeta.mac, pkt->payload + 10, 6);
+  lastRxMeta.rssi = (int8_t)pkt->rx_ctrl.rssi;
+  lastRxMeta.valid = true;
+}
+
+// Beantwortet einen Befehl mit FRAME_FLAG_ECHO: Empfangs-, Schalt- und
+// Antwortzeit (esp_timer, µs) sowie der gemessene Empfangspegel gehen an
+// den Sender zurück (Steuer-Task, nach dem Schalten)
+void sendEcho(const uint8_t *mac, const ControlCommand &command, bool switched, uint32_t commitUs) {
+  uint32_t receiveUs = (uint32_t)command.receiveUs;
+  EchoFrame echo;
+  echo.flags = (switched ? ECHO_FLAG_OUTPUTS_CHANGED : 0) | (command.rssiMeasured ? ECHO_FLAG_RSSI : 0);
+  echo.sequence = command.sequence;
+  echo.senderTimestamp = command.senderTimestamp;
+  echo.receiveUs = receiveUs;
+  echo.commitUs = switched ? commitUs : receiveUs;
+  echo.rssi = command.rssiMeasured ? command.rssi : 0;
+  echo.replyUs = (uint32_t)esp_timer_get_time();
+  
+  uint8_t frame[MARKISE_ECHO_SIZE];
+  size_t frameLen = encodeEcho(echo, frame, sizeof(frame));
+  if (esp_now_send(mac, frame, frameLen) == ESP_OK) {
+    echoReplies++;
+  } else {
+    echoSendErrors++;
+  }
+}
+
 // Wird aufgerufen, wenn Daten empfangen wurden
+// Läuft im WiFi-Task: keine Serial-Ausgaben hier, nur LOG_*() (konstante Zeit)
 void OnDataRecv(const uint8_t *mac, const uint8_t *incomingData, int len) {
-  // Daten in die Struktur kopieren
-  memcpy(&receivedData, incomingData, sizeof(receivedData));
-  
-  // Prüfen, ob der Absender bekannt ist (Sicherheit)
-  bool knownSender = true;
-  for (int i = 0; i < 6; i++) {
-    if (mac[i] != senderMac[i]) {
-      knownSender = false;
-      break;
+  // Empfangspegel gehört nur zu diesem Frame, auch wenn er verworfen wird
+  bool rxMetaValid = lastRxMeta.valid;
+  lastRxMeta.valid = false;
+  
+  // Zuerst den Absender prüfen (Sicherheit) – Hash-Suche, konstante Zeit.
+  // Fremde Frames kosten so keine Kopie, keine CRC und keine Uhrzeit.
+  int senderIndex = senders.find(mac);
+  if (senderIndex < 0) {
+    foreignFrames++;
+    if (memcmp(lastForeignMac, mac, 6) != 0) {
+      memcpy(lastForeignMac, mac, 6);
+      LOG_WARN("Unbekannter Absender: %02X:%02X:%02X:%02X:%02X:%02X - Pakete werden ignoriert!",
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     }
+    return;
   }
+  int64_t callbackStart = esp_timer_get_time();
+  SenderEntry &sender = senders.at(senderIndex);
+  bool rssiMeasured = rxMetaValid && memcmp(lastRxMeta.mac, mac, 6) == 0;
+  int8_t measuredRssi = lastRxMeta.rssi;
   
-  if (!knownSender) {
-    // Unbekannter Absender - Paket ignorieren
-    Serial.print("Unbekannter Absender: ");
-    for (int i = 0; i < 6; i++) {
-      Serial.printf("%02X", mac[i]);
-      if (i < 5) Serial.print(":");
-    }
-    Serial.println(" - Paket ignoriert!");
+  // Frame prüfen (Länge, Version, CRC) und direkt aus dem Empfangspuffer
+  // auslesen – decodeFrame liest nie über len hinaus
+  ButtonFrame frame;
+  DecodeResult decoded = decodeFrame(incomingData, len, frame);
+  if (decoded != DECODE_OK) {
+    LOG_WARN("%s: Ungültiges Paket (%s, %d Bytes) - ignoriert!", sender.name, decodeResultName(decoded), len);
     return;
   }
   
-  // Zeitstempel aktualisieren (für Timeout-Überwachung)
-  lastReceiveTime = millis();
+  if (frame.command > CMD_MOVE) {
+    LOG_WARN("Unbekannter Befehl %d - Paket ignoriert!", frame.command);
+    return;
+  }
+  if (frame.command == CMD_MOVE && frame.leaseMs > MOVE_POSITION_MAX) {
+    LOG_WARN("%s: Fahrbefehl auf Position %d - ignoriert!", sender.name, frame.leaseMs);
+    return;
+  }
+  
+  // Signatur und Zähler prüfen, bevor das Paket irgendetwas ändert (auch
+  // nicht das Sequenzfenster). Ein wiederholter STOP wird trotzdem
+  // ausgeführt (kann nie etwas einschalten, Signatur muss aber stimmen).
+  SenderAuth &auth = senderAuth[senderIndex];
+  if (auth.required) {
+    uint32_t counter;
+    if (!verifyAuthFrame(incomingData, len, auth.key, counter)) {
+      auth.rejected++;
+      LOG_WARN("%s: Paket ohne gültige Signatur - ignoriert!", sender.name);
+      return;
+    }
+    if (counter > auth.counter) {
+      auth.counter = counter;
+    } else if (frame.command != CMD_STOP) {
+      auth.replayed++;
+      LOG_WARN("%s: Wiederholtes Paket (Zähler %u) - ignoriert!", sender.name, (unsigned)counter);
+      return;
+    }
+  }
+  
+  // Nur die eigenen Taster auswerten (Frame kann per Broadcast an mehrere gehen)
+  frame.buttonMask &= SERVED_BUTTON_MASK;
+  
+  // Doppelte und zu alte Pakete erkennen (Sequenzfenster je Sender).
+  // v1 hat nur 8-Bit-Sequenznummern: dort wird nicht geprüft.
+  uint32_t nowMs = millis();
+  SequenceVerdict verdict;
+  if (frame.version >= 2) {
+    verdict = senders.checkSequence(senderIndex, frame.sequence, nowMs);
+  } else {
+    senders.markSeen(senderIndex, nowMs);
+    verdict = SEQ_NEW;
+  }
+  if (!sequenceAccepted(verdict)) {
+    // Ein STOP wird trotzdem ausgeführt (kann nie etwas einschalten)
+    if (frame.command != CMD_STOP) {
+      if (verdict == SEQ_DUPLICATE) {
+        LOG_DEBUG("%s: Doppeltes Paket (Sequenz %d) - ignoriert", sender.name, frame.sequence);
+      } else {
+        LOG_WARN("%s: Veraltete Sequenz %d - Paket ignoriert!", sender.name, frame.sequence);
+      }
+      return;
+    }
+  } else if (verdict == SEQ_RESYNC) {
+    LOG_INFO("%s: Sequenz neu synchronisiert (%d)", sender.name, frame.sequence);
+  }
+  
+  // Funkstrecke auswerten (nur angenommene Pakete)
+  if (sequenceAccepted(verdict)) {
+    LinkSample link;
+    link.arrivalUs = (uint32_t)callbackStart;
+    link.senderMs = frame.timestamp;
+    link.leaseMs = frame.command == CMD_MOVE ? 0 : leaseFromFrame(frame.leaseMs);
+    link.sequence = frame.sequence;
+    link.verdict = verdict;
+    link.sequenced = frame.version >= 2;
+    link.rssi = measuredRssi;
+    link.rssiMeasured = rssiMeasured;
+    linkStats[senderIndex].record(link);
+  }
+  
+  // Energie-Frames tragen in adcRaw/rssi einen Datensatz der Energiebilanz;
+  // dann gelten der zuletzt gemeldete ADC-Wert und Empfangspegel weiter
+  int8_t reportedRssi = frame.rssi;
+  if (frame.flags & FRAME_FLAG_ENERGY) {
+    if (sequenceAccepted(verdict)) {
+      energyTotals[senderIndex].apply((uint8_t)frame.rssi, frame.adcRaw);
+    }
+    frame.adcRaw = sender.adcRaw;
+    reportedRssi = sender.lastRssi;
+  }
+  
+  // Zeitstempel aktualisieren (Empfangspegel: gemessen, sonst vom Sender gemeldet)
+  int8_t rssi = rssiMeasured ? measuredRssi : reportedRssi;
+  lastReceiveTime = nowMs;
+  sender.lastRssi = rssi;
+  sender.batteryMillivolts = frame.batteryMillivolts;
+  sender.adcRaw = frame.adcRaw;
+  telemetry.post(senderIndex, telemetryClock(), frame.batteryMillivolts,
+                 frame.adcRaw, rssi);
   
   // Paket-Informationen ausgeben (für Diagnose)
-  Serial.println("\n=== Paket empfangen ===");
-  Serial.printf("Seq: %d | RSSI: %d dBm | ADC: %d\n", 
-                receivedData.sequence, receivedData.rssi, receivedData.adcRaw);
-  Serial.printf("Batterie Sender: %.2fV\n", receivedData.batteryVoltage);
+  LOG_DEBUG("Paket %s: Seq %d | RSSI %d dBm | ADC %d | Batterie Sender %d mV",
+            sender.name, frame.sequence, rssi, frame.adcRaw,
+            frame.batteryMillivolts);
+  
+  // Befehl an den Steuer-Task übergeben (Arbitrierung, Ausgänge, Lease, Echo)
+  ControlCommand command;
+  command.receiveUs = callbackStart;
+  command.senderTimestamp = frame.timestamp;
+  command.sequence = frame.sequence;
+  command.leaseMs = frame.leaseMs;
+  command.command = frame.command;
+  command.buttonMask = frame.buttonMask;
+  command.echo = (frame.flags & FRAME_FLAG_ECHO) != 0;
+  command.rssiMeasured = rssiMeasured;
+  command.rssi = measuredRssi;
   
-  // Prüfen auf doppelte Pakete (gleiche Sequenznummer)
-  if (receivedData.sequence == lastSequence) {
-    Serial.println("Hinweis: Doppeltes Paket (Sequenznummer wiederholt)");
+  uint8_t bit = 1 << senderIndex;
+  portENTER_CRITICAL(&controlMailboxMux);
+  if (controlPending & bit) controlStats.coalesced++;
+  controlMailbox[senderIndex] = command;
+  controlPending |= bit;
+  portEXIT_CRITICAL(&controlMailboxMux);
+  wakeControlTask();
+  
+  // Laufzeit festhalten (nur gültige Pakete)
+  uint32_t duration = (uint32_t)(esp_timer_get_time() - callbackStart);
+  if (duration > recvCallbackMaxUs) recvCallbackMaxUs = duration;
+  recvCallbackCount = recvCallbackCount + 1;
+}
+
+// Arbeitsfunktion des Steuer-Tasks: führt die Befehle aus den Briefkästen
+// aus, schaltet Sender mit abgelaufener Lease und beendete Fahrten ab und
+// stellt den Failsafe-Timer neu. Im native-Build laufen keine Tasks; Benchmarks und
+// Simulator rufen sie nach OnDataRecv bzw. dem Timer selbst auf.
+void serviceControl() {
+  ControlCommand commands[SENDER_MAX];
+  int16_t targets[MOTOR_COUNT];
+  portENTER_CRITICAL(&controlMailboxMux);
+  uint8_t pending = controlPending;
+  controlPending = 0;
+  for (uint8_t p = pending; p != 0; p &= p - 1) {
+    int i = __builtin_ctz(p);
+    commands[i] = controlMailbox[i];
   }
-  lastSequence = receivedData.sequence;
+  uint32_t remote = remotePending;
+  remotePending = 0;
+  for (uint32_t r = remote; r != 0; r &= r - 1) {
+    int m = __builtin_ctz(r);
+    targets[m] = remoteTarget[m];
+  }
+  portEXIT_CRITICAL(&controlMailboxMux);
+  
+  int64_t now = esp_timer_get_time();
+  uint8_t conflicts = 0;
+  lockControl();
+  uint32_t commitsBefore = outputCommitStats.count;
+  OutputMask outputsBefore = outputMask;
+  OutputMask travelBefore = travelMask;
+  for (uint8_t p = pending; p != 0; p &= p - 1) {
+    int i = __builtin_ctz(p);
+    const ControlCommand &command = commands[i];
+    controlStats.handoffUs.add((uint32_t)(now - command.receiveUs));
+    controlStats.commands++;
+    if (command.command == CMD_STOP) {
+      travelInterrupted[i] = 0;
+      releaseSender(i);
+    } else if (command.command == CMD_MOVE) {
+      moveFromSender(i, command.buttonMask, command.leaseMs, now);
+    } else {
+      uint32_t leaseMs = leaseFromFrame(command.leaseMs);
+      activeLeaseMs = leaseMs;
+      senders.at(i).leaseDeadline = command.receiveUs + leaseMs * 1000LL;
+      // Taster auf einem fahrenden Motor: Fahrt abbrechen, der Motor bleibt
+      // stehen, bis der Taster losgelassen ist
+      travelInterrupted[i] |= cancelTravel(senderChannels(i, command.buttonMask));
+      uint8_t stopped = (uint8_t)(travelInterrupted[i] >> senders.at(i).channelOffset);
+      if (requestFromSender(i, command.buttonMask & ~stopped)) conflicts |= 1 << i;
+    }
+  }
+  moveFromRemote(remote, targets, now);
+  int64_t expired = releaseExpiredSenders(now);
+  finishTravel(now);
+  setOutputsFromMask(arbitratedMask());
+  bool switched = outputCommitStats.count != commitsBefore;
+  uint32_t commitUs = outputCommitStats.lastUs;
+  armFailsafeTimer();
+  // Geänderte Motoren für die MQTT-Brücke (gemeldet erst nach dem Echo)
+  uint32_t changedMotors = 0;
+  MotorReport reports[MOTOR_COUNT];
+  if (MQTT_BRIDGE) {
+    OutputMask changed = (outputMask ^ outputsBefore) | (travelMask ^ travelBefore);
+    while (changed != 0) {
+      int motor = Topology::motorOf(Topology::lowestChannel(changed));
+      changed &= ~Topology::motorBits(motor);
+      reports[motor] = motorReport(motor, now);
+      changedMotors |= 1u << motor;
+    }
+  }
+  unlockControl();
   
-  // Ausgänge entsprechend der empfangenen Maske setzen
-  setOutputsFromMask(receivedData.buttonMask);
+  // Abweichung zwischen Lease-Ende und tatsächlicher Abschaltung
+  if (expired != INT64_MAX) {
+    int64_t jitter = now - expired;
+    recordFailsafeJitter(jitter > 0 ? (uint32_t)jitter : 0);
+    failsafeTripped = true;
+  }
+  
+  for (uint8_t p = conflicts; p != 0; p &= p - 1) {
+    SenderEntry &sender = senders.at(__builtin_ctz(p));
+    sender.stats.conflicts++;
+    CONTROL_LOG_WARN("%s: Gegenrichtung zu einem anderen Sender - Motor gestoppt", sender.name);
+  }
   
-  Serial.println("=====================\n");
+  // Echo erst nach dem Schalten
+  for (uint8_t p = pending; p != 0; p &= p - 1) {
+    int i = __builtin_ctz(p);
+    if (commands[i].echo) sendEcho(senders.at(i).mac, commands[i], switched, commitUs);
+  }
+  
+  if (changedMotors != 0) postMotorReports(changedMotors, reports);
+}
+
+void controlTaskMain(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    serviceControl();
+  }
+}
+
+// Startet den Steuer-Task (in setup(), vor ESP-NOW und dem Failsafe-Timer)
+void startControlTask() {
+  if (xTaskCreatePinnedToCore(controlTaskMain, "control", CONTROL_TASK_STACK, nullptr,
+                              CONTROL_TASK_PRIORITY, &controlTask, CONTROL_TASK_CORE) != pdPASS) {
+    controlTask = nullptr;
+    Serial.println("Steuer-Task konnte nicht gestartet werden - Schalten im WiFi-Task!");
+    return;
+  }
+  Serial.printf("Steuer-Task: Kern %d, Priorität %d\n", CONTROL_TASK_CORE, CONTROL_TASK_PRIORITY);
+}
+
+// Gibt Anzahl und Übergabezeit (Empfang -> Steuer-Task) der Befehle aus
+void printControlStats() {
+  if (controlStats.commands == 0) return;
+  LogHistogram<18> handoff = controlStats.handoffUs;  // Schnappschuss
+  Serial.printf("Steuer-Task: %u Befehle, %u zusammengefasst, Übergabe p50 %u us, p99 %u us, max %u us\n",
+                (unsigned)controlStats.commands, (unsigned)controlStats.coalesced,
+                (unsigned)handoff.percentile(500), (unsigned)handoff.percentile(990),
+                (unsigned)handoff.max);
 }
 
 // Initialisiert ESP-NOW
@@ -220,15 +1479,590 @@ void initESPNOW() {
   // Callback für empfangene Daten registrieren
   esp_now_register_recv_cb(OnDataRecv);
   
+  // Bekannte Sender als Peers (nur für Echo-Antworten, aktueller Kanal)
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  for (int i = 0; i < senders.count(); i++) {
+    memcpy(peerInfo.peer_addr, senders.at(i).mac, 6);
+    if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+      Serial.printf("Peer %s hinzufügen fehlgeschlagen (kein Echo)!\n", senders.at(i).name);
+    }
+  }
+  
+  // Empfangspegel: der ESP-NOW-Callback liefert ihn (IDF 4.4) nicht mit,
+  // daher Management-Frames im Promiscuous-Modus mitlesen
+  wifi_promiscuous_filter_t filter = {WIFI_PROMIS_FILTER_MASK_MGMT};
+  esp_wifi_set_promiscuous_filter(&filter);
+  esp_wifi_set_promiscuous_rx_cb(OnPromiscuousRx);
+  esp_wifi_set_promiscuous(true);
+  
   Serial.println("ESP-NOW bereit - warte auf Sender...");
-  Serial.print("Erwartete Sender-MAC: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", senderMac[i]);
-    if (i < 5) Serial.print(":");
+}
+
+// =================== SIGNIERTE BEFEHLE ===================
+// Der höchste angenommene Zähler je Sender übersteht einen Neustart im
+// NVS (Namespace "linkauth"), damit mitgeschnittene Frames danach nicht
+// wieder gelten. Gespeichert wird aus loop(), höchstens alle
+// AUTH_SAVE_INTERVAL und nur bei Änderung.
+
+// NVS-Schlüssel eines Senders (hier und in der Telemetrie): "s" + MAC in
+// Hex (13 Zeichen, max. 15)
+void senderNvsKey(int index, char *key) {
+  const uint8_t *m = senders.at(index).mac;
+  snprintf(key, 16, "s%02X%02X%02X%02X%02X%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+}
+
+// Sender index nimmt ab jetzt nur noch signierte Frames an (nur in setup())
+void setSenderKey(int index, const LinkKey &key) {
+  SenderAuth &auth = senderAuth[index];
+  auth.key = key;
+  auth.required = true;
+}
+
+// Liest die gespeicherten Zähler (in setup() nach initSenders())
+void loadAuthCounters() {
+  Preferences prefs;
+  if (!prefs.begin("linkauth", true)) return;
+  for (int i = 0; i < senders.count(); i++) {
+    if (!senderAuth[i].required) continue;
+    char key[16];
+    senderNvsKey(i, key);
+    senderAuth[i].counter = prefs.getUInt(key, 0);
+    senderAuth[i].savedCounter = senderAuth[i].counter;
+  }
+  prefs.end();
+}
+
+// Speichert geänderte Zähler (loop())
+void saveAuthCounters() {
+  Preferences prefs;
+  bool open = false;
+  for (int i = 0; i < senders.count(); i++) {
+    SenderAuth &auth = senderAuth[i];
+    uint32_t counter = auth.counter;  // Schnappschuss (WiFi-Task schreibt weiter)
+    if (!auth.required || counter == auth.savedCounter) continue;
+    if (!open && !(open = prefs.begin("linkauth", false))) return;
+    char key[16];
+    senderNvsKey(i, key);
+    if (prefs.putUInt(key, counter) == sizeof(uint32_t)) auth.savedCounter = counter;
+  }
+  if (open) prefs.end();
+}
+
+void serviceLinkAuth() {
+  static unsigned long lastSave = 0;
+  if (millis() - lastSave < AUTH_SAVE_INTERVAL) return;
+  lastSave = millis();
+  saveAuthCounters();
+}
+
+// Selbsttest und Rechenzeit der Signaturprüfung (in setup(), nur mit Schlüsseln)
+void printLinkAuthCost() {
+  int index = -1;
+  for (int i = 0; i < senders.count() && index < 0; i++) {
+    if (senderAuth[i].required) index = i;
   }
+  if (index < 0) return;
+  ButtonFrame frame = {};
+  uint8_t data[MARKISE_AUTH_FRAME_SIZE];
+  encodeAuthFrame(frame, 1, senderAuth[index].key, data, sizeof(data));
+  uint32_t counter;
+  uint32_t start = ESP.getCycleCount();
+  for (int i = 0; i < AUTH_MEASURE_RUNS; i++) verifyAuthFrame(data, sizeof(data), senderAuth[index].key, counter);
+  uint32_t cycles = ESP.getCycleCount() - start;
+  Serial.printf("Signierte Befehle: Prüfung %u ns je Frame%s\n",
+                (unsigned)(cycles / AUTH_MEASURE_RUNS * 1000 / ESP.getCpuFreqMHz()),
+                linkAuthSelfTest() ? "" : " - SELBSTTEST FEHLGESCHLAGEN!");
+}
+
+// Trägt die bekannten Sender in die Tabelle ein
+void initSenders() {
+  for (size_t i = 0; i < sizeof(knownSenders) / sizeof(knownSenders[0]); i++) {
+    const KnownSender &known = knownSenders[i];
+    const uint8_t *m = known.mac;
+    if (known.firstMotor >= MOTOR_COUNT) {
+      Serial.printf("Sender %s: Motor %d gibt es nicht - nicht eingetragen!\n",
+                    known.name, known.firstMotor + 1);
+      continue;
+    }
+    // Ungültiger Schlüssel: Sender gar nicht eintragen (seine Frames gelten
+    // als fremd), statt ihn unsigniert schalten zu lassen
+    LinkKey key = {};
+    bool keyed = LINK_AUTH && known.key != nullptr;
+    if (keyed && !linkKeyFromHex(known.key, key)) {
+      Serial.printf("Sender %s: Schlüssel ungültig (32 Hex-Zeichen) - nicht eingetragen!\n", known.name);
+      continue;
+    }
+    int index = senders.add(known.mac, known.name);
+    if (index < 0) {
+      Serial.printf("Sender %s nicht eingetragen (Tabelle voll oder doppelt)!\n", known.name);
+      continue;
+    }
+    senders.at(index).channelOffset = (uint8_t)Topology::leftChannel(known.firstMotor);
+    telemetry.attach(index, known.mac);
+    energyTotals[index].reset();
+    if (keyed) setSenderKey(index, key);
+    Serial.printf("Erwarteter Sender: %s %02X:%02X:%02X:%02X:%02X:%02X (ab Motor %d%s)\n",
+                  known.name, m[0], m[1], m[2], m[3], m[4], m[5], known.firstMotor + 1,
+                  senderAuth[index].required ? ", signiert" : "");
+  }
+}
+
+// =================== TELEMETRIE ===================
+// Verlauf von Batterie und RSSI je Sender. Der Flash wird geschont: nur
+// Stunden- und Tageswerte, höchstens alle TELEMETRY_SAVE_INTERVAL Sekunden
+// und nur für Sender mit neuen Werten (NVS verteilt die Schreibzugriffe
+// zusätzlich über seine Seiten).
+
+// Liest Uhr und Verläufe aus dem NVS (in setup() nach initSenders())
+void loadTelemetry() {
+  Preferences prefs;
+  if (!prefs.begin("telemetry", true)) return;
+  uint32_t clock = prefs.getUInt("clock", 0);
+  int restored = 0;
+  for (int i = 0; i < senders.count(); i++) {
+    char key[16];
+    senderNvsKey(i, key);
+    size_t len = prefs.getBytes(key, telemetryBuffer, sizeof(telemetryBuffer));
+    uint32_t savedAt = len > 0 ? telemetry.deserialize(i, telemetryBuffer, len) : 0;
+    if (savedAt == 0) continue;
+    restored++;
+    if (savedAt > clock) clock = savedAt;
+  }
+  prefs.end();
+  telemetryClockBase = clock;
+  telemetryLastSave = clock;
+  Serial.printf("Telemetrie: %d Verläufe geladen, Betriebszeit %lu h\n",
+                restored, (unsigned long)(clock / 3600));
+}
+
+// Schreibt geänderte Verläufe und die Uhr ins NVS
+void saveTelemetry(uint32_t nowSec) {
+  Preferences prefs;
+  if (!prefs.begin("telemetry", false)) return;
+  for (int i = 0; i < senders.count(); i++) {
+    TelemetrySeries &series = telemetry.series(i);
+    if (!series.dirty) continue;
+    size_t len = telemetry.serialize(i, nowSec, false, telemetryBuffer, sizeof(telemetryBuffer));
+    char key[16];
+    senderNvsKey(i, key);
+    if (len > 0 && prefs.putBytes(key, telemetryBuffer, len) == len) {
+      series.dirty = false;
+      telemetrySaves++;
+      telemetrySavedBytes += len;
+    }
+  }
+  prefs.putUInt("clock", nowSec);
+  prefs.end();
+  telemetryLastSave = nowSec;
+}
+
+// Binär-Dump aller Verläufe auf Serial: je Sender 2 Bytes Länge
+// (little-endian) und der Blob (Format: TelemetryStore.h), Ende = Länge 0
+void dumpTelemetry(uint32_t nowSec) {
+  Serial.printf("TELEMETRIE-DUMP %d\n", senders.count());
+  for (int i = 0; i < senders.count(); i++) {
+    size_t len = telemetry.serialize(i, nowSec, true, telemetryBuffer, sizeof(telemetryBuffer));
+    uint8_t prefix[2] = {(uint8_t)len, (uint8_t)(len >> 8)};
+    Serial.write(prefix, 2);
+    Serial.write(telemetryBuffer, len);
+  }
+  uint8_t end[2] = {0, 0};
+  Serial.write(end, 2);
   Serial.println();
 }
 
+// Batterie-Trend und Prognose je Sender (im 60-s-Bericht)
+void printTelemetrySummary() {
+  for (int i = 0; i < senders.count(); i++) {
+    const TelemetrySeries &series = telemetry.series(i);
+    if (series.raw.count == 0 && series.hours.count == 0) continue;
+    uint16_t latest = series.raw.count > 0 ? series.raw.newest().batteryMillivolts
+                                           : series.hours.newest().meanMillivolts;
+    float trend;
+    if (!series.batteryTrend(trend)) {
+      Serial.printf("%s: Batterie %u mV, Trend: noch zu wenig Daten\n",
+                    senders.at(i).name, (unsigned)latest);
+    } else if (trend < 0 && latest > TELEMETRY_BATTERY_EMPTY_MV) {
+      Serial.printf("%s: Batterie %u mV, Trend %.1f mV/Tag, leer in ca. %.0f Tagen\n",
+                    senders.at(i).name, (unsigned)latest, trend,
+                    (latest - TELEMETRY_BATTERY_EMPTY_MV) / -trend);
+    } else {
+      Serial.printf("%s: Batterie %u mV, Trend %.1f mV/Tag\n", senders.at(i).name, (unsigned)latest, trend);
+    }
+  }
+  const TelemetryStats &stats = telemetry.stats();
+  Serial.printf("Telemetrie: %u Werte, verworfen %u, %u Blobs (%u Bytes) gespeichert\n",
+                (unsigned)stats.samples, (unsigned)stats.dropped,
+                (unsigned)telemetrySaves, (unsigned)telemetrySavedBytes);
+}
+
+// Übernimmt neue Werte und speichert bei Bedarf
+void serviceTelemetry() {
+  uint32_t nowSec = telemetryClock();
+  telemetry.process(nowSec);
+  if (nowSec - telemetryLastSave >= TELEMETRY_SAVE_INTERVAL) saveTelemetry(nowSec);
+}
+
+// =================== MQTT-BRÜCKE ===================
+// Meldet Motoren, Sender und Brücke an einen MQTT-Broker und nimmt
+// Fahrbefehle entgegen. Netz und Broker laufen im MQTT-Task (niedrige
+// Priorität); mit dem Steuer-Task tauscht er nur die PublishQueue
+// (Zustände) und den Briefkasten remoteTarget (Befehle) aus. Ein langsamer
+// oder fehlender Broker hält so weder Empfang noch Schalten auf; staut es
+// sich, geht je Topic nur der neueste Wert hinaus.
+//
+// Topics (Präfix MQTT_TOPIC_PREFIX, Zustände retained):
+//   <p>/status          online / offline (Testament bei Verbindungsabbruch)
+//   <p>/channel         WiFi-Kanal, den die Sender eintragen müssen
+//   <p>/motor/<n>       {"state":"left|right|stopped","position":0-1000|null,"target":0-1000|null}
+//   <p>/sender/<n>      Batterie, Pegel, Verlust und Jitter je Sender
+//   <p>/bridge          Zähler der Brücke
+//   <p>/motor/<n>/set   Befehl: STOP, LEFT (= 1000), RIGHT (= 0) oder Position in Promille
+
+// Platz je Topic in der PublishQueue (nach dem Verbinden geht es in dieser
+// Reihenfolge hinaus)
+enum MqttSlot {
+  MQTT_SLOT_STATUS,
+  MQTT_SLOT_CHANNEL,
+  MQTT_SLOT_BRIDGE,
+  MQTT_SLOT_MOTOR,
+  MQTT_SLOT_SENDER = MQTT_SLOT_MOTOR + MOTOR_COUNT,
+  MQTT_SLOT_COUNT = MQTT_SLOT_SENDER + SENDER_MAX
+};
+static_assert(MQTT_SLOT_COUNT <= PUBLISH_QUEUE_SLOTS,
+              "-DPUBLISH_QUEUE_SLOTS=<3 + MOTOR_COUNT + SENDER_MAX> in build_flags setzen");
+static_assert(PUBLISH_TOPIC_MAX + PUBLISH_PAYLOAD_MAX + 5 <= MQTT_TX_MAX,
+              "PUBLISH-Paket passt nicht in MQTT_TX_MAX");
+
+#define MQTT_STATUS_TOPIC MQTT_TOPIC_PREFIX "/status"
+
+WiFiClient mqttSocket;
+MqttClient<WiFiClient> mqtt(mqttSocket);
+PublishQueue mqttQueue;
+TaskHandle_t mqttTask = nullptr;
+char mqttClientId[24];
+
+uint8_t mqttChannel = MQTT_WIFI_CHANNEL;  // festgehaltener Kanal (0 = noch keiner)
+uint8_t mqttChannelMisses = 0;            // Verbindungsversuche seit dem letzten Erfolg
+
+struct MqttBridgeStats {
+  uint32_t wifiConnects;
+  uint32_t channelChanges;  // Router auf einem anderen Kanal als festgehalten
+  uint32_t commands;        // angenommene Fahrbefehle
+  uint32_t invalid;         // unbekanntes Topic, ungültiger Wert oder retained
+};
+MqttBridgeStats mqttStats = {};
+
+void postMotorReports(uint32_t motors, const MotorReport *reports) {
+  for (; motors != 0; motors &= motors - 1) {
+    int motor = __builtin_ctz(motors);
+    const MotorReport &report = reports[motor];
+    char topic[PUBLISH_TOPIC_MAX];
+    char position[8] = "null";
+    char target[8] = "null";
+    char payload[80];
+    snprintf(topic, sizeof(topic), MQTT_TOPIC_PREFIX "/motor/%d", motor + 1);
+    if (report.position >= 0) snprintf(position, sizeof(position), "%d", report.position);
+    if (report.target >= 0) snprintf(target, sizeof(target), "%d", report.target);
+    const char *state = (report.running & Topology::LEFT) ? "left" : report.running != 0 ? "right" : "stopped";
+    snprintf(payload, sizeof(payload), "{\"state\":\"%s\",\"position\":%s,\"target\":%s}", state, position,
+             target);
+    mqttQueue.post(MQTT_SLOT_MOTOR + motor, topic, payload, true);
+  }
+}
+
+// Alle Motoren (MQTT-Task, MQTT_POSITION_INTERVAL): hält die Position
+// während einer Fahrt aktuell, Unverändertes kostet nichts
+void postMotorStates() {
+  MotorReport reports[MOTOR_COUNT];
+  lockControl();
+  int64_t now = esp_timer_get_time();
+  for (int m = 0; m < MOTOR_COUNT; m++) reports[m] = motorReport(m, now);
+  unlockControl();
+  postMotorReports((uint32_t)((1ULL << MOTOR_COUNT) - 1), reports);
+}
+
+void postSenderStates() {
+  for (int i = 0; i < senders.count(); i++) {
+    SenderEntry entry = senders.at(i);  // Schnappschuss (WiFi-Task schreibt weiter)
+    if (entry.stats.packets == 0) continue;
+    LinkStats link = linkStats[i];
+    char topic[PUBLISH_TOPIC_MAX];
+    char payload[PUBLISH_PAYLOAD_MAX];
+    snprintf(topic, sizeof(topic), MQTT_TOPIC_PREFIX "/sender/%d", i + 1);
+    snprintf(payload, sizeof(payload),
+             "{\"name\":\"%s\",\"battery_mv\":%u,\"rssi\":%d,\"loss_permille\":%u,\"jitter_us\":%u,"
+             "\"packets\":%u,\"last_seen_s\":%lu}",
+             entry.name, (unsigned)entry.batteryMillivolts, entry.lastRssi, (unsigned)link.lossPermille(),
+             (unsigned)link.jitterUs(), (unsigned)entry.stats.packets,
+             (unsigned long)((millis() - entry.lastSeenMs) / 1000));
+    mqttQueue.post(MQTT_SLOT_SENDER + i, topic, payload, true);
+  }
+}
+
+void postBridgeState() {
+  MqttClientStats client = mqtt.stats();
+  PublishQueueStats queue = mqttQueue.stats();
+  char payload[PUBLISH_PAYLOAD_MAX];
+  snprintf(payload, sizeof(payload),
+           "{\"wifi_rssi\":%d,\"channel\":%u,\"connects\":%u,\"published\":%u,\"coalesced\":%u,"
+           "\"unchanged\":%u,\"commands\":%u,\"invalid\":%u}",
+           WiFi.RSSI(), (unsigned)WiFi.channel(), (unsigned)client.connects, (unsigned)client.published,
+           (unsigned)queue.coalesced, (unsigned)queue.unchanged, (unsigned)mqttStats.commands,
+           (unsigned)mqttStats.invalid);
+  mqttQueue.post(MQTT_SLOT_BRIDGE, MQTT_TOPIC_PREFIX "/bridge", payload, true);
+}
+
+// Befehl auf <Präfix>/motor/<n>/set (MQTT-Task): in den Briefkasten des
+// Steuer-Tasks, der ihn wie einen Fahrbefehl eines Senders ausführt
+void onMqttMessage(const MqttMessage &message) {
+  static const char prefix[] = MQTT_TOPIC_PREFIX "/motor/";
+  const size_t prefixLen = sizeof(prefix) - 1;
+  char topic[PUBLISH_TOPIC_MAX];
+  char value[16];
+  int number = 0;
+  int used = 0;
+  int target = -2;
+  // Retained-Befehle nicht ausführen: sie kämen bei jedem Verbinden wieder
+  if (!message.retain && message.topicLen < sizeof(topic) && message.payloadLen < sizeof(value)) {
+    memcpy(topic, message.topic, message.topicLen);
+    topic[message.topicLen] = '\0';
+    memcpy(value, message.payload, message.payloadLen);
+    value[message.payloadLen] = '\0';
+    if (strncmp(topic, prefix, prefixLen) == 0 && sscanf(topic + prefixLen, "%d/set%n", &number, &used) == 1 &&
+        used > 0 && topic[prefixLen + used] == '\0' && number >= 1 && number <= MOTOR_COUNT) {
+      char *end;
+      long position = strtol(value, &end, 10);
+      if (strcasecmp(value, "STOP") == 0) {
+        target = REMOTE_STOP;
+      } else if (strcasecmp(value, "LEFT") == 0) {
+        target = MOVE_POSITION_MAX;
+      } else if (strcasecmp(value, "RIGHT") == 0) {
+        target = 0;
+      } else if (end != value && *end == '\0' && position >= 0 && position <= MOVE_POSITION_MAX) {
+        target = (int)position;
+      }
+    }
+  }
+  if (target == -2) {
+    mqttStats.invalid++;
+    Serial.printf("MQTT: Befehl ignoriert (%.*s: %.*s%s)\n", (int)message.topicLen, message.topic,
+                  (int)(message.payloadLen < 16 ? message.payloadLen : 16), (const char *)message.payload,
+                  message.retain ? ", retained" : "");
+    return;
+  }
+
+  int motor = number - 1;
+  mqttStats.commands++;
+  portENTER_CRITICAL(&controlMailboxMux);
+  remoteTarget[motor] = (int16_t)target;
+  remotePending |= 1u << motor;
+  portEXIT_CRITICAL(&controlMailboxMux);
+  wakeControlTask();
+}
+
+// Verbindet das WLAN. Mit festgehaltenem Kanal sucht der Empfänger nur dort
+// (ESP-NOW hört dabei weiter); findet er den Router dort mehrmals nicht,
+// sucht er einmal alle Kanäle ab (Router hat den Kanal gewechselt – in
+// dieser Zeit gehen ESP-NOW-Frames verloren). Ein fest eingestellter Kanal
+// (MQTT_WIFI_CHANNEL) wird nie verlassen.
+void connectWifi() {
+  uint8_t channel = mqttChannel;
+  if (channel != 0 && ++mqttChannelMisses > MQTT_CHANNEL_RETRIES) {
+    mqttChannelMisses = 0;
+    if (MQTT_WIFI_CHANNEL == 0) {
+      channel = 0;
+      Serial.printf("WLAN: Router nicht auf Kanal %u - suche alle Kanäle\n", (unsigned)mqttChannel);
+    } else {
+      Serial.printf("WLAN: Router nicht auf Kanal %u (MQTT_WIFI_CHANNEL)\n", (unsigned)mqttChannel);
+    }
+  }
+  WiFi.begin(MQTT_WIFI_SSID, MQTT_WIFI_PASSWORD, channel);
+}
+
+// WLAN steht: Kanal festhalten und melden
+void onWifiConnected() {
+  uint8_t channel = WiFi.channel();
+  mqttStats.wifiConnects++;
+  mqttChannelMisses = 0;
+  if (channel != mqttChannel) {
+    if (mqttChannel != 0) {
+      mqttStats.channelChanges++;
+      Serial.printf("WLAN: Router jetzt auf Kanal %u statt %u - Sender anpassen!\n", (unsigned)channel,
+                    (unsigned)mqttChannel);
+    }
+    mqttChannel = channel;
+    Preferences prefs;
+    if (prefs.begin("mqtt", false)) {
+      prefs.putUInt("channel", channel);
+      prefs.end();
+    }
+  }
+  Serial.printf("WLAN verbunden: Kanal %u, RSSI %d dBm (Sender: receivers[].channel = %u)\n",
+                (unsigned)channel, WiFi.RSSI(), (unsigned)channel);
+  char payload[4];
+  snprintf(payload, sizeof(payload), "%u", (unsigned)channel);
+  mqttQueue.post(MQTT_SLOT_CHANNEL, MQTT_TOPIC_PREFIX "/channel", payload, true);
+}
+
+// Arbeitsfunktion des MQTT-Tasks: Zustände einstellen, WLAN und Broker
+// verbinden, Befehle lesen, Warteschlange leeren. Im native-Build ruft der
+// Treiber in mqtt/ sie selbst auf.
+void serviceMqtt() {
+  static bool wifiUp = false;
+  static bool brokerUp = false;
+  static bool wifiTried = false;
+  static bool brokerTried = false;
+  static uint32_t lastWifiAttempt = 0;
+  static uint32_t lastBrokerAttempt = 0;
+  static uint32_t lastPositions = 0;
+  static uint32_t lastStats = 0;
+  static uint32_t reportedRefusals = 0;
+  uint32_t now = millis();
+
+  // Auch ohne Verbindung: die Warteschlange hält je Topic den neuesten Wert
+  if (now - lastPositions >= MQTT_POSITION_INTERVAL) {
+    lastPositions = now;
+    postMotorStates();
+  }
+  if (now - lastStats >= MQTT_STATS_INTERVAL) {
+    lastStats = now;
+    postSenderStates();
+    postBridgeState();
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (wifiUp) {
+      wifiUp = false;
+      Serial.println("WLAN getrennt");
+    }
+    if (!wifiTried || now - lastWifiAttempt >= MQTT_RECONNECT_MS) {
+      wifiTried = true;
+      lastWifiAttempt = now;
+      connectWifi();
+    }
+    return;
+  }
+  if (!wifiUp) {
+    wifiUp = true;
+    onWifiConnected();
+  }
+
+  typedef MqttClient<WiFiClient> Client;
+  if (mqtt.state() == Client::DISCONNECTED) {
+    if (brokerUp) {
+      brokerUp = false;
+      Serial.println("MQTT: Verbindung zum Broker verloren");
+    }
+    if (mqtt.stats().refused != reportedRefusals) {
+      reportedRefusals = mqtt.stats().refused;
+      Serial.printf("MQTT: Broker lehnt ab (Code %u)\n", (unsigned)mqtt.stats().lastRefusal);
+    }
+    if (brokerTried && now - lastBrokerAttempt < MQTT_RECONNECT_MS) return;
+    brokerTried = true;
+    lastBrokerAttempt = now;
+    MqttConnectOptions options = {mqttClientId, MQTT_USER, MQTT_PASSWORD, MQTT_STATUS_TOPIC, "offline",
+                                  true, MQTT_KEEPALIVE};
+    if (!mqtt.open(MQTT_HOST, MQTT_PORT, options, millis())) return;
+    mqttSocket.setNoDelay(true);
+  }
+  if (mqtt.poll(millis(), onMqttMessage) != Client::CONNECTED) return;
+  if (!brokerUp) {
+    brokerUp = true;
+    Serial.printf("MQTT: verbunden mit %s:%d als %s\n", MQTT_HOST, MQTT_PORT, mqttClientId);
+    mqtt.subscribe(MQTT_TOPIC_PREFIX "/motor/+/set", millis());
+    mqttQueue.post(MQTT_SLOT_STATUS, MQTT_STATUS_TOPIC, "online", true);
+    mqttQueue.requeueAll();  // retained-Werte können auf dem Broker fehlen
+  }
+
+  PublishMessage message;
+  while (mqttQueue.take(message)) {
+    if (!mqtt.publish(message.topic, message.payload, message.length, message.retain, millis())) {
+      mqttQueue.requeue(message);
+      break;
+    }
+  }
+}
+
+void mqttTaskMain(void *) {
+  for (;;) {
+    serviceMqtt();
+    vTaskDelay(pdMS_TO_TICKS(MQTT_TASK_INTERVAL));
+  }
+}
+
+// Startet die Brücke (in setup(), nach initESPNOW(); nur mit MQTT_BRIDGE)
+void startMqttBridge() {
+  if (!MQTT_BRIDGE) return;
+  if (MQTT_WIFI_SSID[0] == '\0' || MQTT_HOST[0] == '\0') {
+    Serial.println("MQTT-Brücke: MQTT_WIFI_SSID oder MQTT_HOST fehlt - aus");
+    return;
+  }
+
+  // ESP-NOW gleich auf dem Kanal des Routers, nicht erst nach dem Verbinden
+  if (MQTT_WIFI_CHANNEL == 0) {
+    Preferences prefs;
+    if (prefs.begin("mqtt", true)) {
+      mqttChannel = (uint8_t)prefs.getUInt("channel", 0);
+      prefs.end();
+    }
+  }
+  if (mqttChannel != 0) {
+    esp_wifi_set_channel(mqttChannel, WIFI_SECOND_CHAN_NONE);
+    Serial.printf("ESP-NOW-Kanal %u (WLAN%s) - Sender: receivers[].channel = %u\n", (unsigned)mqttChannel,
+                  MQTT_WIFI_CHANNEL != 0 ? ", fest eingestellt" : ", gemerkt", (unsigned)mqttChannel);
+  } else {
+    Serial.println("ESP-NOW-Kanal: wird beim ersten WLAN-Verbinden vom Router übernommen");
+  }
+  WiFi.setSleep(false);          // Modem-Sleep verpasst ESP-NOW-Frames
+  WiFi.setAutoReconnect(false);  // neu verbinden nur mit Kanal (connectWifi)
+
+  // Client-ID aus der MAC-Adresse
+  String mac = WiFi.macAddress();
+  char *id = mqttClientId + snprintf(mqttClientId, sizeof(mqttClientId), "markise-");
+  for (const char *c = mac.c_str(); *c != '\0' && id < mqttClientId + sizeof(mqttClientId) - 1; c++) {
+    if (*c != ':') *id++ = *c;
+  }
+  *id = '\0';
+
+  if (xTaskCreatePinnedToCore(mqttTaskMain, "mqtt", MQTT_TASK_STACK, nullptr, MQTT_TASK_PRIORITY, &mqttTask,
+                              MQTT_TASK_CORE) != pdPASS) {
+    mqttTask = nullptr;
+    Serial.println("MQTT-Task konnte nicht gestartet werden!");
+    return;
+  }
+  Serial.printf("MQTT-Brücke: %s:%d, Präfix %s\n", MQTT_HOST, MQTT_PORT, MQTT_TOPIC_PREFIX);
+}
+
+// Verbindung und Warteschlange (im 60-s-Bericht, nur mit laufender Brücke)
+void printMqttStats() {
+  if (mqttTask == nullptr) return;
+  MqttClientStats client = mqtt.stats();  // Schnappschuss (MQTT-Task schreibt weiter)
+  PublishQueueStats queue = mqttQueue.stats();
+  Serial.printf("MQTT: %s, WLAN-Kanal %u, %u Verbindungen (abgelehnt %u, Timeout %u, verloren %u), "
+                "%u gesendet, %u zusammengefasst, %u unverändert, %u offen, Befehle %u (ignoriert %u)\n",
+                mqtt.state() == MqttClient<WiFiClient>::CONNECTED ? "verbunden" : "getrennt",
+                (unsigned)mqttChannel, (unsigned)client.connects, (unsigned)client.refused,
+                (unsigned)client.timeouts, (unsigned)client.lost, (unsigned)client.published,
+                (unsigned)queue.coalesced, (unsigned)queue.unchanged, mqttQueue.pending(),
+                (unsigned)mqttStats.commands, (unsigned)mqttStats.invalid);
+}
+
+// =================== SERIELLE BEFEHLE ===================
+
+// Einzelne Zeichen vom seriellen Monitor
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case TELEMETRY_DUMP_COMMAND: dumpTelemetry(telemetryClock()); break;
+      case LINK_REPORT_COMMAND: printLinkReport(); break;
+      case ENERGY_REPORT_COMMAND: printEnergyReport(); break;
+      default: break;
+    }
+  }
+}
+
 // =================== SETUP ===================
 
 void setup() {
@@ -240,17 +2074,44 @@ void setup() {
   Serial.println("Optimierte Version");
   Serial.println("=====================================");
   
+  // Sperre für Arbitrierung und Ausgänge (vor allem anderen)
+  controlMutex = xSemaphoreCreateMutex();
+  
   // Ausgänge initialisieren
   initOutputs();
+
+  // Failsafe-Timer anlegen (wird erst mit dem ersten Paket gestartet)
+  initFailsafeTimer();
+  
+  // Log-Tasks für Ausgaben aus dem Empfangs-Callback und dem Steuer-Task
+  if (!deferredLog.startTask(LOG_TASK_INTERVAL, LOG_TASK_PRIORITY, tskNO_AFFINITY) ||
+      !controlLog.startTask(LOG_TASK_INTERVAL, LOG_TASK_PRIORITY, tskNO_AFFINITY)) {
+    Serial.println("Log-Task konnte nicht gestartet werden!");
+  }
+  
+  // Steuer-Task: schaltet die Ausgänge (vor dem ersten Paket)
+  startControlTask();
+  
+  // Bekannte Sender eintragen (vor dem ersten Paket)
+  initSenders();
+  
+  // Gespeicherten Telemetrie-Verlauf und die Zähler signierter Befehle laden
+  loadTelemetry();
+  loadAuthCounters();
+  printLinkAuthCost();
   
   // ESP-NOW initialisieren
   initESPNOW();
   
+  // MQTT-Brücke (legt den WiFi-Kanal fest, daher nach ESP-NOW)
+  startMqttBridge();
+  
   // Zeitstempel initialisieren
   lastReceiveTime = millis();
   
   Serial.println("System bereit");
-  Serial.printf("Sicherheits-Timeout: %d ms\n", RECEIVE_TIMEOUT);
+  Serial.printf("Sicherheits-Timeout: %d ms (ohne Lease), Lease max. %d ms\n",
+                RECEIVE_TIMEOUT, LEASE_MAX_MS);
   Serial.println("=====================================\n");
 }
 
@@ -259,17 +2120,35 @@ void setup() {
 void loop() {
   static bool timeoutActive = false;
   static unsigned long lastStatusOutput = 0;
+  static unsigned long lastFailsafeReport = 0;
+  static uint32_t reportedFailsafeCount = 0;
   
-  // Timeout-Überwachung
-  // Wenn länger als RECEIVE_TIMEOUT kein Paket empfangen wurde...
-  if (millis() - lastReceiveTime > RECEIVE_TIMEOUT) {
+  // Lease-Überwachung
+  // Die eigentliche Abschaltung macht der Failsafe-Timer; hier wird sie nur
+  // gemeldet. Ohne Timer (oder falls er nicht auslöst) schaltet loop() mit
+  // etwas Marge selbst ab – je Sender, nach dessen eigener Lease. Nach einem
+  // STOP läuft keine Lease mehr.
+  uint32_t leaseMs = activeLeaseMs;
+  int64_t leaseEnd = leaseDeadlineMin;
+  int64_t nowUs = esp_timer_get_time();
+  if (failsafeTripped) {
+    failsafeTripped = false;
+    if (!timeoutActive) {
+      Serial.printf("TIMEOUT: Lease (%u ms) ohne Erneuerung abgelaufen! (Abschaltung %u us nach Soll)\n",
+                    (unsigned)leaseMs, (unsigned)failsafeStats.lastJitter);
+      Serial.println("!!! SICHERHEITSABSCHALTUNG: Alle Ausgänge AUS !!!");
+      timeoutActive = true;
+    }
+  } else if (leaseEnd != INT64_MAX && nowUs > leaseEnd + FAILSAFE_BACKUP_MARGIN * 1000LL) {
+    releaseOverdueSenders(nowUs);
     if (!timeoutActive) {
       // Nur einmal beim ersten Timeout ausgeben
-      Serial.printf("TIMEOUT: Kein Paket für %d ms!\n", RECEIVE_TIMEOUT);
-      disableAllOutputs();
+      Serial.printf("TIMEOUT: Lease seit %u ms abgelaufen! (Rückfallebene loop)\n",
+                    (unsigned)((nowUs - leaseEnd) / 1000));
+      Serial.println("!!! SICHERHEITSABSCHALTUNG: Alle Ausgänge AUS !!!");
       timeoutActive = true;
     }
-  } else {
+  } else if (millis() - lastReceiveTime <= leaseMs) {
     // Pakete kommen wieder an
     if (timeoutActive) {
       Serial.println("Verbindung wiederhergestellt - Timeout aufgehoben");
@@ -277,6 +2156,42 @@ void loop() {
     }
   }
   
+  // Rückfallebene für Fahrbefehle: Timer hat nicht ausgelöst -> Steuer-Task wecken
+  int64_t travelEnd = travelDeadline;
+  if (travelEnd != INT64_MAX && esp_timer_get_time() > travelEnd + FAILSAFE_BACKUP_MARGIN * 1000LL) {
+    wakeControlTask();
+  }
+  
+  // Jitter-Statistik des Failsafe-Timers (nur wenn es neue Abschaltungen gab)
+  if (millis() - lastFailsafeReport > FAILSAFE_REPORT_INTERVAL) {
+    lastFailsafeReport = millis();
+    if (failsafeStats.count != reportedFailsafeCount) {
+      reportedFailsafeCount = failsafeStats.count;
+      printFailsafeStats();
+    }
+    printSenderStats();
+    printTelemetrySummary();
+    printOutputStats();
+    printControlStats();
+    printTravelStats();
+    printMqttStats();
+    if (recvCallbackCount != 0 || foreignFrames != 0) {
+      Serial.printf("Empfangs-Callback: %u Pakete, max. %u us, fremd: %u, Log verworfen: %u, Echos %u (Fehler %u)\n",
+                    (unsigned)recvCallbackCount, (unsigned)recvCallbackMaxUs, (unsigned)foreignFrames,
+                    (unsigned)deferredLog.droppedCount(), (unsigned)echoReplies,
+                    (unsigned)echoSendErrors);
+    }
+  }
+  
+  // Telemetrie-Werte übernehmen und ggf. speichern
+  serviceTelemetry();
+  
+  // Zähler signierter Befehle sichern
+  serviceLinkAuth();
+  
+  // Befehle vom seriellen Monitor
+  handleSerialCommands();
+  
   // Nur alle 10 Sekunden einen Status ausgeben (für Diagnose)
   if (millis() - lastStatusOutput > 10000) {
     // Optional: Status der Ausgänge ausgeben
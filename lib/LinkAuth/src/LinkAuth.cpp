@@ -0,0 +1,140 @@
+/**
+ * LinkAuth – SipHash-2-4 und signierte Frames
+ */
+
+#include "LinkAuth.h"
+
+// =================== HILFSFUNKTIONEN ===================
+
+static inline uint64_t get64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+static inline void put64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+// Wert einer Hex-Ziffer, -1 = keine
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// =================== SIPHASH ===================
+
+#define SIPROUND                                                    \
+  do {                                                              \
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);       \
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;                          \
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;                          \
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);       \
+  } while (0)
+
+LinkKey linkKeyFromBytes(const uint8_t bytes[LINK_KEY_SIZE]) {
+  LinkKey key;
+  key.k0 = get64(bytes);
+  key.k1 = get64(bytes + 8);
+  return key;
+}
+
+bool linkKeyFromHex(const char *hex, LinkKey &key) {
+  if (hex == nullptr) return false;
+  uint8_t bytes[LINK_KEY_SIZE];
+  uint8_t any = 0;
+  for (int i = 0; i < LINK_KEY_SIZE; i++) {
+    int hi = hexDigit(hex[2 * i]);
+    int lo = hi < 0 ? -1 : hexDigit(hex[2 * i + 1]);  // nicht hinter ein '\0' lesen
+    if (lo < 0) return false;
+    bytes[i] = (uint8_t)((hi << 4) | lo);
+    any |= bytes[i];
+  }
+  if (hex[2 * LINK_KEY_SIZE] != '\0' || any == 0) return false;
+  key = linkKeyFromBytes(bytes);
+  return true;
+}
+
+uint64_t sipHash24(const LinkKey &key, const uint8_t *data, size_t len) {
+  uint64_t v0 = 0x736f6d6570736575ULL ^ key.k0;
+  uint64_t v1 = 0x646f72616e646f6dULL ^ key.k1;
+  uint64_t v2 = 0x6c7967656e657261ULL ^ key.k0;
+  uint64_t v3 = 0x7465646279746573ULL ^ key.k1;
+
+  const uint8_t *end = data + (len & ~(size_t)7);
+  for (; data != end; data += 8) {
+    uint64_t m = get64(data);
+    v3 ^= m;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= m;
+  }
+
+  // Letzter Block: restliche Bytes, Länge im obersten Byte
+  uint64_t b = (uint64_t)len << 56;
+  for (size_t i = 0; i < (len & 7); i++) b |= (uint64_t)data[i] << (8 * i);
+  v3 ^= b;
+  SIPROUND;
+  SIPROUND;
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  SIPROUND;
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// =================== SIGNIERTE FRAMES ===================
+
+static const size_t TRAILER_OFFSET = sizeof(WireFrameV3);
+static const size_t SIGNED_BYTES = TRAILER_OFFSET + offsetof(WireAuthTrailer, tag);
+
+size_t encodeAuthFrame(const ButtonFrame &frame, uint32_t counter, const LinkKey &key,
+                       uint8_t *out, size_t size) {
+  if (size < MARKISE_AUTH_FRAME_SIZE) return 0;
+
+  ButtonFrame flagged = frame;
+  flagged.flags |= FRAME_FLAG_AUTH;
+  encodeFrame(flagged, out, size);
+  put32(out + TRAILER_OFFSET + offsetof(WireAuthTrailer, counter), counter);
+  put64(out + SIGNED_BYTES, sipHash24(key, out, SIGNED_BYTES));
+
+  return MARKISE_AUTH_FRAME_SIZE;
+}
+
+bool verifyAuthFrame(const uint8_t *data, int len, const LinkKey &key, uint32_t &counter) {
+  if (len < (int)MARKISE_AUTH_FRAME_SIZE || data[0] != 3) return false;
+  if (!(data[offsetof(WireFrameV3, command)] & FRAME_FLAG_AUTH)) return false;
+
+  uint8_t expected[LINK_TAG_SIZE];
+  put64(expected, sipHash24(key, data, SIGNED_BYTES));
+  uint8_t diff = 0;
+  for (int i = 0; i < LINK_TAG_SIZE; i++) diff |= (uint8_t)(expected[i] ^ data[SIGNED_BYTES + i]);
+
+  counter = get32(data + TRAILER_OFFSET + offsetof(WireAuthTrailer, counter));
+  return diff == 0;
+}
+
+bool linkAuthSelfTest() {
+  // Schlüssel 00 01 ... 0f, Nachricht 00 01 ... 0e (15 Bytes)
+  uint8_t bytes[LINK_KEY_SIZE];
+  for (int i = 0; i < LINK_KEY_SIZE; i++) bytes[i] = (uint8_t)i;
+  return sipHash24(linkKeyFromBytes(bytes), bytes, 15) == 0xa129ca6149be45e5ULL;
+}
@@ -0,0 +1,73 @@
+/**
+ * LinkAuth – signierte Befehle zwischen Sender und Empfänger
+ *
+ * Bisher prüfte der Empfänger nur die MAC des Absenders, und die lässt
+ * sich beliebig fälschen. Mit Authentisierung hängt der Sender an jeden
+ * Frame einen Zähler und eine Signatur (FRAME_FLAG_AUTH, Aufbau in
+ * MarkiseProtocol.h). Der Empfänger nimmt von einem Sender mit Schlüssel
+ * nur noch Frames mit gültiger Signatur an.
+ *
+ * Signatur: SipHash-2-4 mit 128-Bit-Schlüssel und 64-Bit-Ergebnis über den
+ * ganzen Frame samt Zähler (22 Bytes). SipHash ist für kurze Nachrichten
+ * gebaut und braucht weder Tabellen noch Hardware; auf dem ESP32 kostet
+ * ein Frame nur wenige µs (siehe Benchmarks und die Messung in setup()).
+ * Verschlüsselt wird nichts: Tasterzustand und Batteriewerte sind kein
+ * Geheimnis, es geht nur darum, wer schalten darf.
+ *
+ * Wiederholungen: Der Zähler wird bei jedem Frame größer und wiederholt
+ * sich auch nach Tiefschlaf und Stromausfall nicht (Sender: RTC-Speicher
+ * und reservierte Blöcke im NVS). Der Empfänger merkt sich je Sender den
+ * höchsten angenommenen Zähler; ein mitgeschnittener Frame gilt damit
+ * kein zweites Mal.
+ *
+ * ESP-NOW kann selbst verschlüsseln (LMK je Peer), aber nur direkt
+ * adressierte Frames – der Sender erreicht mehrere Empfänger per
+ * Broadcast – und nur für wenige Peers. Die Signatur hier gilt für beide
+ * Wege gleich.
+ *
+ * Jeder Sender braucht einen eigenen, zufälligen Schlüssel (z.B.
+ * `openssl rand -hex 16`). Er steht nicht im Code, sondern kommt als
+ * Build-Flag in Sender (LINK_KEY) und Empfänger (SENDER1_KEY usw.).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MarkiseProtocol.h"
+
+#define LINK_KEY_SIZE 16
+#define LINK_TAG_SIZE 8
+
+// Schlüssel, für SipHash vorbereitet (zwei 64-Bit-Hälften, little-endian)
+struct LinkKey {
+  uint64_t k0;
+  uint64_t k1;
+};
+
+LinkKey linkKeyFromBytes(const uint8_t bytes[LINK_KEY_SIZE]);
+
+// Schlüssel aus 32 Hex-Zeichen (Build-Flag, siehe Sender und Empfänger).
+// false bei nullptr, falscher Länge, anderen Zeichen oder lauter Nullen –
+// dann gibt es keine Signatur, statt mit einem erratbaren Schlüssel zu laufen
+bool linkKeyFromHex(const char *hex, LinkKey &key);
+
+// SipHash-2-4 über len Bytes
+uint64_t sipHash24(const LinkKey &key, const uint8_t *data, size_t len);
+
+// Schreibt einen signierten Frame (MARKISE_AUTH_FRAME_SIZE Bytes) nach out;
+// FRAME_FLAG_AUTH wird dabei gesetzt. Rückgabe: Anzahl geschriebener Bytes,
+// 0 wenn der Puffer zu klein ist.
+size_t encodeAuthFrame(const ButtonFrame &frame, uint32_t counter, const LinkKey &key,
+                       uint8_t *out, size_t size);
+
+// Prüft die Signatur eines empfangenen Frames (v3 mit FRAME_FLAG_AUTH,
+// mindestens MARKISE_AUTH_FRAME_SIZE Bytes). Liest nie über len hinaus;
+// der Vergleich dauert unabhängig vom Ergebnis gleich lang.
+// Rückgabe: true = gültig, counter = Zähler aus dem Frame
+bool verifyAuthFrame(const uint8_t *data, int len, const LinkKey &key, uint32_t &counter);
+
+// Prüft die Implementierung mit dem Testvektor aus dem SipHash-Papier
+// (für setup(): falsch übersetzter Code würde sonst jeden Frame ablehnen)
+bool linkAuthSelfTest();
@@ -0,0 +1,60 @@
+/**
+ * LogHistogram – Verteilung von Zeiten und Zählwerten mit festem Speicher
+ *
+ * Werte 0 ... 2^MaxBits, je Verdopplung vier Fächer (Auflösung etwa
+ * ±12 %); größere Werte landen im letzten Fach, max hält den echten
+ * Größtwert. add() kostet ein paar Bit-Operationen und ist damit auch im
+ * Empfangs-Callback oder Interrupt-nahen Code unbedenklich.
+ *
+ * Reines POD ohne Konstruktor: darf im RTC-Speicher liegen und mit memset
+ * gelöscht werden.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+template <int MaxBits>
+struct LogHistogram {
+  static constexpr int BUCKETS = 4 * (MaxBits - 1);
+
+  uint32_t buckets[BUCKETS];
+  uint32_t count;
+  uint32_t max;
+
+  static int bucketOf(uint32_t value) {
+    if (value < 4) return (int)value;
+    int bits = 31 - __builtin_clz(value);  // >= 2
+    int index = (bits - 1) * 4 + (int)((value >> (bits - 2)) & 3);
+    return index < BUCKETS ? index : BUCKETS - 1;
+  }
+
+  // Kleinster Wert in Fach index
+  static uint32_t lowerBound(int index) {
+    if (index < 4) return (uint32_t)index;
+    return (uint32_t)(4 + (index & 3)) << (index / 4 - 1);
+  }
+
+  void add(uint32_t value) {
+    buckets[bucketOf(value)]++;
+    count++;
+    if (value > max) max = value;
+  }
+
+  // Obere Grenze des Fachs, in dem das Quantil permille/1000 liegt
+  // (höchstens max). 0 bei leerem Histogramm
+  uint32_t percentile(uint32_t permille) const {
+    if (count == 0) return 0;
+    uint64_t rank = ((uint64_t)count * permille + 999) / 1000;
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        uint32_t upper = i + 1 < BUCKETS ? lowerBound(i + 1) - 1 : max;
+        return upper < max ? upper : max;
+      }
+    }
+    return max;
+  }
+};
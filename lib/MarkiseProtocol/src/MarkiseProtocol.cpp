@@ -0,0 +1,229 @@
+/**
+ * MarkiseProtocol – Kodierung und Dekodierung der Frames
+ */
+
+#include "MarkiseProtocol.h"
+
+#include <string.h>
+
+// =================== HILFSFUNKTIONEN ===================
+// Little-endian lesen/schreiben, unabhängig von Ausrichtung und Prozessor
+
+static inline void put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t get16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// =================== CRC ===================
+
+// Halb-Byte-Tabelle: nur 32 Bytes Flash, ca. doppelt so schnell wie bitweise
+static const uint16_t crcNibbleTable[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc = (uint16_t)((crc << 4) ^ crcNibbleTable[((crc >> 12) ^ (data[i] >> 4)) & 0x0F]);
+    crc = (uint16_t)((crc << 4) ^ crcNibbleTable[((crc >> 12) ^ (data[i] & 0x0F)) & 0x0F]);
+  }
+  return crc;
+}
+
+// =================== FRAME v3 ===================
+
+size_t encodeFrame(const ButtonFrame &frame, uint8_t *out, size_t size) {
+  if (size < MARKISE_FRAME_SIZE) return 0;
+
+  out[offsetof(WireFrameV3, version)] = MARKISE_PROTOCOL_VERSION;
+  out[offsetof(WireFrameV3, command)] = (uint8_t)((frame.command & FRAME_COMMAND_MASK) | frame.flags);
+  out[offsetof(WireFrameV3, buttonMask)] = frame.buttonMask;
+  put16(out + offsetof(WireFrameV3, sequence), frame.sequence);
+  put16(out + offsetof(WireFrameV3, leaseMs), frame.leaseMs);
+  put16(out + offsetof(WireFrameV3, batteryMillivolts), frame.batteryMillivolts);
+  put16(out + offsetof(WireFrameV3, adcRaw), frame.adcRaw);
+  out[offsetof(WireFrameV3, rssi)] = (uint8_t)frame.rssi;
+  put32(out + offsetof(WireFrameV3, timestamp), frame.timestamp);
+  put16(out + offsetof(WireFrameV3, crc), crc16(out, offsetof(WireFrameV3, crc)));
+
+  return MARKISE_FRAME_SIZE;
+}
+
+static void decodeFrameV3(const uint8_t *data, ButtonFrame &frame) {
+  frame.command = data[offsetof(WireFrameV3, command)] & FRAME_COMMAND_MASK;
+  frame.flags = data[offsetof(WireFrameV3, command)] & (uint8_t)~FRAME_COMMAND_MASK;
+  frame.buttonMask = data[offsetof(WireFrameV3, buttonMask)];
+  frame.sequence = get16(data + offsetof(WireFrameV3, sequence));
+  frame.leaseMs = get16(data + offsetof(WireFrameV3, leaseMs));
+  frame.batteryMillivolts = get16(data + offsetof(WireFrameV3, batteryMillivolts));
+  frame.adcRaw = get16(data + offsetof(WireFrameV3, adcRaw));
+  frame.rssi = (int8_t)data[offsetof(WireFrameV3, rssi)];
+  frame.timestamp = get32(data + offsetof(WireFrameV3, timestamp));
+  frame.version = 3;
+}
+
+// =================== ÄLTERE VERSIONEN ===================
+// v1 und v2 kennen keinen Befehl und keine Lease: gedrückt = Erneuerung,
+// nichts gedrückt = Stopp, Lease-Dauer bestimmt der Empfänger
+
+static void decodeFrameV2(const uint8_t *data, ButtonFrame &frame) {
+  frame.buttonMask = data[offsetof(WireFrameV2, buttonMask)];
+  frame.command = frame.buttonMask != 0 ? CMD_RENEW : CMD_STOP;
+  frame.flags = 0;
+  frame.sequence = get16(data + offsetof(WireFrameV2, sequence));
+  frame.leaseMs = 0;
+  frame.batteryMillivolts = get16(data + offsetof(WireFrameV2, batteryMillivolts));
+  frame.adcRaw = get16(data + offsetof(WireFrameV2, adcRaw));
+  frame.rssi = (int8_t)data[offsetof(WireFrameV2, rssi)];
+  frame.timestamp = get32(data + offsetof(WireFrameV2, timestamp));
+  frame.version = 2;
+}
+
+// Altes Format v1 (struct_message mit natürlicher Ausrichtung auf dem ESP32):
+// 0 buttonMask, 4 float batteryVoltage, 8 uint8 sequence, 10 int16 adcRaw,
+// 12 int8 rssi, 16 uint32 timestamp – ohne Versionsbyte und ohne CRC
+static void decodeFrameV1(const uint8_t *data, ButtonFrame &frame) {
+  float voltage;
+  memcpy(&voltage, data + 4, sizeof(voltage));
+
+  frame.buttonMask = data[0];
+  frame.command = frame.buttonMask != 0 ? CMD_RENEW : CMD_STOP;
+  frame.flags = 0;
+  frame.sequence = data[8];
+  frame.leaseMs = 0;
+  frame.batteryMillivolts = (voltage > 0.0f && voltage < 65.0f) ? (uint16_t)(voltage * 1000.0f + 0.5f) : 0;
+  frame.adcRaw = get16(data + 10);
+  frame.rssi = (int8_t)data[12];
+  frame.timestamp = get32(data + 16);
+  frame.version = 1;
+}
+
+// =================== DEKODIEREN ===================
+
+// Prüft Länge und CRC eines Frames mit bekanntem Aufbau
+static DecodeResult checkFrame(const uint8_t *data, int len, size_t frameSize, size_t crcOffset) {
+  if (len < (int)frameSize) return DECODE_TOO_SHORT;
+  if (get16(data + crcOffset) != crc16(data, crcOffset)) return DECODE_BAD_CRC;
+  return DECODE_OK;
+}
+
+DecodeResult decodeFrame(const uint8_t *data, int len, ButtonFrame &frame) {
+  if (len < 1) return DECODE_TOO_SHORT;
+
+  DecodeResult result;
+  switch (data[0]) {
+    case 3:
+      result = checkFrame(data, len, sizeof(WireFrameV3), offsetof(WireFrameV3, crc));
+      if (result == DECODE_OK) decodeFrameV3(data, frame);
+      break;
+    case 2:
+      result = checkFrame(data, len, sizeof(WireFrameV2), offsetof(WireFrameV2, crc));
+      if (result == DECODE_OK) decodeFrameV2(data, frame);
+      break;
+    default:
+      result = len < (int)MARKISE_FRAME_V2_SIZE ? DECODE_TOO_SHORT : DECODE_BAD_VERSION;
+      break;
+  }
+
+  // Übergangsweise: alte Sender ohne Versionsbyte. Ein v1-Frame mit
+  // Tastermaske 0x02/0x03 sieht wie v2/v3 aus – an der Länge erkennbar.
+  if (result != DECODE_OK && len == MARKISE_FRAME_V1_SIZE) {
+    decodeFrameV1(data, frame);
+    result = DECODE_OK;
+  }
+  return result;
+}
+
+// =================== ECHO ===================
+
+size_t encodeEcho(const EchoFrame &echo, uint8_t *out, size_t size) {
+  if (size < MARKISE_ECHO_SIZE) return 0;
+
+  out[offsetof(WireEcho, marker)] = MARKISE_ECHO_MARKER;
+  out[offsetof(WireEcho, flags)] = echo.flags;
+  put16(out + offsetof(WireEcho, sequence), echo.sequence);
+  put32(out + offsetof(WireEcho, senderTimestamp), echo.senderTimestamp);
+  put32(out + offsetof(WireEcho, receiveUs), echo.receiveUs);
+  put32(out + offsetof(WireEcho, commitUs), echo.commitUs);
+  put32(out + offsetof(WireEcho, replyUs), echo.replyUs);
+  out[offsetof(WireEcho, rssi)] = (uint8_t)echo.rssi;
+  put16(out + offsetof(WireEcho, crc), crc16(out, offsetof(WireEcho, crc)));
+
+  return MARKISE_ECHO_SIZE;
+}
+
+bool decodeEcho(const uint8_t *data, int len, EchoFrame &echo) {
+  if (len < (int)MARKISE_ECHO_SIZE || data[0] != MARKISE_ECHO_MARKER) return false;
+  if (get16(data + offsetof(WireEcho, crc)) != crc16(data, offsetof(WireEcho, crc))) return false;
+
+  echo.flags = data[offsetof(WireEcho, flags)];
+  echo.sequence = get16(data + offsetof(WireEcho, sequence));
+  echo.senderTimestamp = get32(data + offsetof(WireEcho, senderTimestamp));
+  echo.receiveUs = get32(data + offsetof(WireEcho, receiveUs));
+  echo.commitUs = get32(data + offsetof(WireEcho, commitUs));
+  echo.replyUs = get32(data + offsetof(WireEcho, replyUs));
+  echo.rssi = (int8_t)data[offsetof(WireEcho, rssi)];
+  return true;
+}
+
+// =================== ENERGIEBILANZ ===================
+
+void EnergyTotals::reset() {
+  memset(this, 0, sizeof(*this));
+  pendingTag = ENERGY_TAG_NONE;
+}
+
+bool EnergyTotals::apply(uint8_t tag, uint16_t value) {
+  uint8_t state = tag & 0x0F;
+  uint8_t field = tag >> 4;
+  if (state >= ENERGY_STATE_COUNT || field > ENERGY_CHARGE_HI) return false;
+  records++;
+
+  if (field == ENERGY_SECONDS_LO || field == ENERGY_CHARGE_LO) {
+    pendingTag = tag;
+    pendingValue = value;
+    return true;
+  }
+
+  // Obere Hälfte: nur mit der unteren direkt davor (sonst Werte verschiedener Stände)
+  if (pendingTag != energyTag(field - 1, state)) {
+    unpaired++;
+    return true;
+  }
+  uint32_t total = ((uint32_t)value << 16) | pendingValue;
+  if (field == ENERGY_SECONDS_HI) {
+    seconds[state] = total;
+    validSeconds |= (uint16_t)(1 << state);
+  } else {
+    chargeUah[state] = total;
+    validCharge |= (uint16_t)(1 << state);
+  }
+  pendingTag = ENERGY_TAG_NONE;
+  return true;
+}
+
+const char *decodeResultName(DecodeResult result) {
+  switch (result) {
+    case DECODE_OK:          return "OK";
+    case DECODE_TOO_SHORT:   return "zu kurz";
+    case DECODE_BAD_VERSION: return "unbekannte Version";
+    case DECODE_BAD_CRC:     return "CRC-Fehler";
+  }
+  return "?";
+}
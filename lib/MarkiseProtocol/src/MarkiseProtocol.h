@@ -0,0 +1,303 @@
+/**
+ * MarkiseProtocol – gemeinsames Funkprotokoll von Sender und Empfänger
+ *
+ * Bisher war struct_message in beiden main.cpp einzeln deklariert und wurde
+ * als normal ausgerichtete C-Struktur (mit Füllbytes) verschickt. Seit
+ * Version 2 gibt es genau ein Frame-Format, das hier beschrieben ist.
+ *
+ * Version 3 (aktuell) – Befehl mit Lease:
+ *
+ *   Offset  Größe  Feld
+ *   0       1      version            (= MARKISE_PROTOCOL_VERSION)
+ *   1       1      command            CMD_STOP / CMD_START / CMD_RENEW / CMD_MOVE
+ *   2       1      buttonMask         Bit 0-5: Taster 1-6
+ *   3       2      sequence           fortlaufende Nummer
+ *   5       2      leaseMs            so lange darf der Empfänger den Befehl
+ *                                     ohne Erneuerung ausführen (CMD_MOVE:
+ *                                     Zielposition, siehe unten)
+ *   7       2      batteryMillivolts  Batteriespannung in mV (statt float)
+ *   9       2      adcRaw             ADC-Rohwert der Batteriemessung
+ *   11      1      rssi               Signalstärke (dBm, vorzeichenbehaftet)
+ *   12      4      timestamp          millis() des Senders
+ *   16      2      crc                CRC-16/CCITT-FALSE über Byte 0-15
+ *
+ * Version 2 ist gleich aufgebaut, aber ohne command und leaseMs (15 Bytes).
+ * Alle Mehrbyte-Felder sind little-endian, unabhängig vom Prozessor.
+ *
+ * Lease-Prinzip: Der Sender schickt beim Drücken CMD_START mit einer
+ * Lease-Dauer, erneuert sie mit CMD_RENEW rechtzeitig vor Ablauf und schickt
+ * beim Loslassen sofort CMD_STOP. Läuft die Lease ab, schaltet der Empfänger
+ * selbst ab. Die Lease-Dauer ist damit die maximale Nachlaufzeit.
+ *
+ * Fahrbefehl: CMD_MOVE fährt die in buttonMask gewählten Motoren (einer
+ * der beiden Taster eines Motors genügt) ohne weitere Frames auf eine
+ * Position. leaseMs trägt dann statt der Lease das Ziel in Promille des
+ * Weges: 0 = Endlage Rechtslauf, MOVE_POSITION_MAX = Endlage Linkslauf.
+ * Fahrzeit und Position schätzt der Empfänger aus seinem Fahrzeitmodell;
+ * ein neuer Befehl für denselben Motor bricht die Fahrt ab.
+ *
+ * Der Empfänger versteht zusätzlich noch v2 und das alte v1-Format, damit
+ * Sender und Empfänger unabhängig voneinander aktualisiert werden können.
+ * Diese Frames haben keine Lease (leaseMs = 0: Empfänger-Standard).
+ *
+ * Echo (optional): Ist im command-Byte FRAME_FLAG_ECHO gesetzt, antwortet
+ * der Empfänger nach dem Schalten mit einem Echo-Frame an den Sender:
+ *
+ *   Offset  Größe  Feld
+ *   0       1      marker             (= MARKISE_ECHO_MARKER, keine Version)
+ *   1       1      flags              ECHO_FLAG_*
+ *   2       2      sequence           Sequenznummer des Befehls
+ *   4       4      senderTimestamp    timestamp des Befehls (zurückgegeben)
+ *   8       4      receiveUs          esp_timer des Empfängers beim Empfang
+ *   12      4      commitUs           ... beim Schalten der Ausgänge
+ *   16      4      replyUs            ... beim Absenden des Echos
+ *   20      1      rssi               Empfangspegel des Befehls (dBm, mit ECHO_FLAG_RSSI)
+ *   21      2      crc                CRC-16/CCITT-FALSE über Byte 0-20
+ *
+ * Damit kann der Sender den Versatz der beiden Uhren schätzen (wie NTP)
+ * und die Zeit vom Tastendruck bis zum Schalten des Relais ausrechnen.
+ * Der Empfangspegel hilft ihm, die Sendeleistung zu regeln.
+ * Ältere Empfänger kennen das Flag nicht und verwerfen solche Befehle –
+ * Echo erst einschalten, wenn alle Empfänger aktualisiert sind.
+ *
+ * Energiebilanz: Ist im command-Byte FRAME_FLAG_ENERGY gesetzt, tragen
+ * adcRaw und rssi statt der Diagnosewerte einen Datensatz der
+ * Energiebilanz des Senders:
+ *
+ *   rssi    Kennung: Bit 0-3 Zustand (EnergyState), Bit 4-5 Feld (EnergyField)
+ *   adcRaw  16 Bit des Werts (Sekunden bzw. µAh, jeweils seit dem Kaltstart)
+ *
+ * Ein 32-Bit-Wert kommt in zwei aufeinanderfolgenden Datensätzen (untere,
+ * dann obere Hälfte aus demselben Stand). Der Empfänger übernimmt ihn nur,
+ * wenn er beide Hälften direkt hintereinander bekommen hat.
+ *
+ * Authentisierung (optional): Ist im command-Byte FRAME_FLAG_AUTH gesetzt,
+ * folgt auf die CRC ein Anhang (Berechnung in lib/LinkAuth):
+ *
+ *   Offset  Größe  Feld
+ *   18      4      counter            Zähler des Senders, wiederholt sich nie
+ *   22      8      tag                SipHash-2-4 über Byte 0-21 (Schlüssel
+ *                                     des Senders, 128 Bit)
+ *
+ * Ältere Empfänger lesen nur die ersten 18 Bytes und ignorieren den Anhang.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MARKISE_PROTOCOL_VERSION 3
+
+// Befehle (Frame v3)
+enum FrameCommand : uint8_t {
+  CMD_STOP = 0,   // alle Ausgänge aus, Lease beenden
+  CMD_START = 1,  // Ausgänge nach buttonMask setzen, Lease beginnen
+  CMD_RENEW = 2,  // Lease verlängern (buttonMask wie bei START)
+  CMD_MOVE = 3    // Motoren selbständig auf Position leaseMs fahren (ohne Lease)
+};
+
+// Zielposition eines Fahrbefehls (CMD_MOVE) in Promille des Weges
+#define MOVE_POSITION_MAX 1000  // Endlage Linkslauf (0 = Endlage Rechtslauf)
+
+// Zusatz-Flags im command-Byte (v3: Befehl in den unteren 4 Bits)
+#define FRAME_COMMAND_MASK 0x0F
+#define FRAME_FLAG_ECHO    0x80  // Empfänger soll mit einem Echo-Frame antworten
+#define FRAME_FLAG_ENERGY  0x40  // adcRaw/rssi tragen einen Energie-Datensatz
+#define FRAME_FLAG_AUTH    0x20  // Zähler und Signatur nach der CRC (WireAuthTrailer)
+
+// Inhalt eines Tasten-Frames (im Speicher, nicht auf dem Funkweg)
+struct ButtonFrame {
+  uint8_t  command;            // FrameCommand
+  uint8_t  buttonMask;         // Bit 0-5: Welche Taster sind gedrückt?
+  uint16_t sequence;           // Sequenznummer (erkennt doppelte Pakete)
+  uint16_t leaseMs;            // Lease-Dauer (0 = Standard des Empfängers), bei CMD_MOVE Zielposition
+  uint16_t batteryMillivolts;  // Batteriespannung des Senders in mV
+  uint16_t adcRaw;             // ADC-Rohwert (für Diagnose)
+  int8_t   rssi;               // Signalstärke (für Diagnose)
+  uint32_t timestamp;          // Zeitstempel des Senders (ms)
+  uint8_t  version;            // Protokollversion des empfangenen Frames (nur decodeFrame)
+  uint8_t  flags;              // FRAME_FLAG_* (auf dem Funkweg im command-Byte)
+};
+
+// Aufbau auf dem Funkweg (nur zur Beschreibung und für die Offsets;
+// gelesen und geschrieben wird byteweise, siehe encode/decode)
+struct __attribute__((packed)) WireFrameV3 {
+  uint8_t  version;
+  uint8_t  command;
+  uint8_t  buttonMask;
+  uint16_t sequence;
+  uint16_t leaseMs;
+  uint16_t batteryMillivolts;
+  uint16_t adcRaw;
+  int8_t   rssi;
+  uint32_t timestamp;
+  uint16_t crc;
+};
+
+// Vorgänger ohne command/leaseMs (wird nur noch gelesen)
+struct __attribute__((packed)) WireFrameV2 {
+  uint8_t  version;
+  uint8_t  buttonMask;
+  uint16_t sequence;
+  uint16_t batteryMillivolts;
+  uint16_t adcRaw;
+  int8_t   rssi;
+  uint32_t timestamp;
+  uint16_t crc;
+};
+
+#define MARKISE_FRAME_SIZE sizeof(WireFrameV3)
+#define MARKISE_FRAME_V2_SIZE sizeof(WireFrameV2)
+
+static_assert(sizeof(WireFrameV3) == 18, "Frame v3 muss 18 Bytes lang sein");
+static_assert(offsetof(WireFrameV3, version) == 0, "Frame v3: version");
+static_assert(offsetof(WireFrameV3, command) == 1, "Frame v3: command");
+static_assert(offsetof(WireFrameV3, buttonMask) == 2, "Frame v3: buttonMask");
+static_assert(offsetof(WireFrameV3, sequence) == 3, "Frame v3: sequence");
+static_assert(offsetof(WireFrameV3, leaseMs) == 5, "Frame v3: leaseMs");
+static_assert(offsetof(WireFrameV3, batteryMillivolts) == 7, "Frame v3: batteryMillivolts");
+static_assert(offsetof(WireFrameV3, adcRaw) == 9, "Frame v3: adcRaw");
+static_assert(offsetof(WireFrameV3, rssi) == 11, "Frame v3: rssi");
+static_assert(offsetof(WireFrameV3, timestamp) == 12, "Frame v3: timestamp");
+static_assert(offsetof(WireFrameV3, crc) == 16, "Frame v3: crc");
+
+static_assert(sizeof(WireFrameV2) == 15, "Frame v2 muss 15 Bytes lang sein");
+static_assert(offsetof(WireFrameV2, version) == 0, "Frame v2: version");
+static_assert(offsetof(WireFrameV2, buttonMask) == 1, "Frame v2: buttonMask");
+static_assert(offsetof(WireFrameV2, sequence) == 2, "Frame v2: sequence");
+static_assert(offsetof(WireFrameV2, batteryMillivolts) == 4, "Frame v2: batteryMillivolts");
+static_assert(offsetof(WireFrameV2, adcRaw) == 6, "Frame v2: adcRaw");
+static_assert(offsetof(WireFrameV2, rssi) == 8, "Frame v2: rssi");
+static_assert(offsetof(WireFrameV2, timestamp) == 9, "Frame v2: timestamp");
+static_assert(offsetof(WireFrameV2, crc) == 13, "Frame v2: crc");
+
+// Anhang signierter Frames (FRAME_FLAG_AUTH), direkt nach WireFrameV3
+struct __attribute__((packed)) WireAuthTrailer {
+  uint32_t counter;
+  uint8_t  tag[8];
+};
+
+#define MARKISE_AUTH_FRAME_SIZE (sizeof(WireFrameV3) + sizeof(WireAuthTrailer))
+
+static_assert(sizeof(WireAuthTrailer) == 12, "Anhang muss 12 Bytes lang sein");
+static_assert(offsetof(WireAuthTrailer, tag) == 4, "Anhang: tag");
+
+// =================== ECHO ===================
+
+#define MARKISE_ECHO_MARKER 0xEC
+
+#define ECHO_FLAG_OUTPUTS_CHANGED 0x01  // der Befehl hat Ausgänge geschaltet (commitUs gültig)
+#define ECHO_FLAG_RSSI            0x02  // rssi gemessen
+
+// Inhalt eines Echo-Frames (Empfänger -> Sender)
+struct EchoFrame {
+  uint8_t  flags;              // ECHO_FLAG_*
+  uint16_t sequence;           // Sequenznummer des beantworteten Befehls
+  uint32_t senderTimestamp;    // timestamp des Befehls (Sender-Uhr, ms)
+  uint32_t receiveUs;          // Empfänger-Uhr (esp_timer, µs)
+  uint32_t commitUs;
+  uint32_t replyUs;
+  int8_t   rssi;               // Empfangspegel beim Empfänger (mit ECHO_FLAG_RSSI)
+};
+
+struct __attribute__((packed)) WireEcho {
+  uint8_t  marker;
+  uint8_t  flags;
+  uint16_t sequence;
+  uint32_t senderTimestamp;
+  uint32_t receiveUs;
+  uint32_t commitUs;
+  uint32_t replyUs;
+  int8_t   rssi;
+  uint16_t crc;
+};
+
+#define MARKISE_ECHO_SIZE sizeof(WireEcho)
+
+static_assert(sizeof(WireEcho) == 23, "Echo muss 23 Bytes lang sein");
+static_assert(offsetof(WireEcho, sequence) == 2, "Echo: sequence");
+static_assert(offsetof(WireEcho, senderTimestamp) == 4, "Echo: senderTimestamp");
+static_assert(offsetof(WireEcho, receiveUs) == 8, "Echo: receiveUs");
+static_assert(offsetof(WireEcho, commitUs) == 12, "Echo: commitUs");
+static_assert(offsetof(WireEcho, replyUs) == 16, "Echo: replyUs");
+static_assert(offsetof(WireEcho, rssi) == 20, "Echo: rssi");
+static_assert(offsetof(WireEcho, crc) == 21, "Echo: crc");
+
+// =================== ENERGIEBILANZ ===================
+
+// Zustände des Senders. TX und LED laufen parallel zu den anderen (ihr
+// Strom kommt zum Wachstrom dazu), die übrigen schließen sich gegenseitig aus.
+enum EnergyState : uint8_t {
+  ENERGY_BOOT = 0,      // Start bis Ende von setup()
+  ENERGY_AWAKE,         // wach in loop()
+  ENERGY_TX,            // Frame unterwegs (bis zur Bestätigung)
+  ENERGY_LED,           // LED an
+  ENERGY_LIGHT_SLEEP,
+  ENERGY_DEEP_SLEEP,
+  ENERGY_STATE_COUNT
+};
+
+// Felder eines Datensatzes (32-Bit-Werte in zwei Hälften)
+enum EnergyField : uint8_t {
+  ENERGY_SECONDS_LO = 0,
+  ENERGY_SECONDS_HI,
+  ENERGY_CHARGE_LO,     // Ladung in µAh
+  ENERGY_CHARGE_HI
+};
+
+#define ENERGY_RECORD_COUNT (ENERGY_STATE_COUNT * 4)  // Datensätze einer vollen Runde
+#define ENERGY_TAG_NONE 0xFF
+
+inline uint8_t energyTag(uint8_t field, uint8_t state) { return (uint8_t)((field << 4) | state); }
+
+// Energiebilanz eines Senders, wie sie beim Empfänger ankommt
+struct EnergyTotals {
+  uint32_t seconds[ENERGY_STATE_COUNT];
+  uint32_t chargeUah[ENERGY_STATE_COUNT];
+  uint16_t validSeconds;   // Bit je Zustand: seconds[] schon empfangen
+  uint16_t validCharge;    // Bit je Zustand: chargeUah[] schon empfangen
+  uint32_t records;        // empfangene Datensätze
+  uint32_t unpaired;       // obere Hälfte ohne passende untere (verworfen)
+  uint8_t pendingTag;      // letzte untere Hälfte (ENERGY_TAG_NONE = keine)
+  uint16_t pendingValue;
+
+  void reset();
+  // Übernimmt einen Datensatz (rssi, adcRaw eines Frames mit
+  // FRAME_FLAG_ENERGY). Rückgabe: false = unbekannte Kennung
+  bool apply(uint8_t tag, uint16_t value);
+};
+
+// Altes Format (v1), wie es ein ESP32 mit natürlicher Ausrichtung verschickt
+#define MARKISE_FRAME_V1_SIZE 20
+
+// Ergebnis von decodeFrame()
+enum DecodeResult {
+  DECODE_OK = 0,
+  DECODE_TOO_SHORT,    // weniger Bytes als ein Frame seiner Version
+  DECODE_BAD_VERSION,  // unbekannte Versionsnummer
+  DECODE_BAD_CRC       // Prüfsumme falsch (Übertragungsfehler oder fremdes Paket)
+};
+
+// Schreibt einen Frame (MARKISE_FRAME_SIZE Bytes) nach out.
+// Rückgabe: Anzahl geschriebener Bytes, 0 wenn der Puffer zu klein ist.
+size_t encodeFrame(const ButtonFrame &frame, uint8_t *out, size_t size);
+
+// Liest einen Frame aus den empfangenen Bytes (v3, v2, oder v1 mit genau
+// MARKISE_FRAME_V1_SIZE Bytes). Liest nie über len hinaus.
+// Bei v1/v2 wird command aus buttonMask abgeleitet und leaseMs = 0 gesetzt.
+// frame.version enthält die erkannte Version (v1: Sequenznummer nur 8 Bit).
+DecodeResult decodeFrame(const uint8_t *data, int len, ButtonFrame &frame);
+
+// Schreibt einen Echo-Frame (MARKISE_ECHO_SIZE Bytes) nach out.
+// Rückgabe: Anzahl geschriebener Bytes, 0 wenn der Puffer zu klein ist.
+size_t encodeEcho(const EchoFrame &echo, uint8_t *out, size_t size);
+
+// Liest einen Echo-Frame. Rückgabe: false = kein (gültiges) Echo
+bool decodeEcho(const uint8_t *data, int len, EchoFrame &echo);
+
+// Klartext zu einem DecodeResult (für Log-Ausgaben)
+const char *decodeResultName(DecodeResult result);
+
+// CRC-16/CCITT-FALSE (Polynom 0x1021, Startwert 0xFFFF)
+uint16_t crc16(const uint8_t *data, size_t len);
@@ -0,0 +1,60 @@
+/**
+ * MicroBench – Auswertung und Ausgabe
+ */
+
+#include "MicroBench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace bench {
+
+Suite::Suite(const char *target) : targetName(target) {}
+
+void Suite::parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--rounds=", 9) == 0) {
+      rounds = std::max(1, atoi(argv[i] + 9));
+    } else if (strncmp(argv[i], "--min-round-ms=", 15) == 0) {
+      minRoundNs = (uint64_t)std::max(1, atoi(argv[i] + 15)) * 1000000ULL;
+    }
+  }
+}
+
+void Suite::finish(Result &result, std::vector<double> &roundNsPerOp) {
+  std::sort(roundNsPerOp.begin(), roundNsPerOp.end());
+  result.nsPerOpMin = roundNsPerOp.front();
+  result.nsPerOp = roundNsPerOp[roundNsPerOp.size() / 2];
+  all.push_back(result);
+}
+
+void Suite::report() const {
+  // Menschlich lesbare Tabelle (stderr, damit stdout reines JSON bleibt)
+  fprintf(stderr, "%-32s %12s %12s %10s %10s %10s %8s\n",
+          "Benchmark", "ns/op", "min ns/op", "allocs/op", "bytes/op", "serial/op", "gpio/op");
+  for (const Result &r : all) {
+    fprintf(stderr, "%-32s %12.1f %12.1f %10.2f %10.1f %10.1f %8.2f\n",
+            r.name.c_str(), r.nsPerOp, r.nsPerOpMin, r.allocsPerOp, r.allocBytesPerOp,
+            r.serialBytesPerOp, r.digitalWritesPerOp + r.digitalReadsPerOp);
+  }
+
+  // Maschinenlesbare Ergebnisse (stdout)
+  printf("{\"target\":\"%s\",\"rounds\":%d,\"results\":[", targetName.c_str(), rounds);
+  for (size_t i = 0; i < all.size(); i++) {
+    const Result &r = all[i];
+    printf("%s\n  {\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.2f,\"ns_per_op_min\":%.2f,"
+           "\"allocs_per_op\":%.4f,\"alloc_bytes_per_op\":%.2f,\"serial_bytes_per_op\":%.2f,"
+           "\"digital_writes_per_op\":%.4f,\"digital_reads_per_op\":%.4f,"
+           "\"analog_reads_per_op\":%.4f,\"esp_now_sends_per_op\":%.4f}",
+           i == 0 ? "" : ",", r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp,
+           r.nsPerOpMin, r.allocsPerOp, r.allocBytesPerOp, r.serialBytesPerOp,
+           r.digitalWritesPerOp, r.digitalReadsPerOp, r.analogReadsPerOp, r.espNowSendsPerOp);
+  }
+  printf("\n]}\n");
+  fflush(stdout);
+}
+
+}  // namespace bench
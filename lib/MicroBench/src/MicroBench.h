@@ -0,0 +1,125 @@
+/**
+ * MicroBench – Mikro-Benchmarks für die heißen Pfade der Firmware
+ *
+ * Läuft nur im native-Build (gegen NativeShim). Pro Funktion wird gemessen:
+ * - Rechenzeit in ns/op (echte Host-Zeit, Median und Minimum über mehrere Runden)
+ * - Heap-Allokationen und -Bytes pro Aufruf
+ * - Serial-Bytes, digitalWrite/digitalRead/analogRead und esp_now_send pro Aufruf
+ *
+ * Die Ergebnisse werden als JSON auf stdout geschrieben (maschinenlesbar,
+ * z.B. zum Vergleich vor einem Release), eine kurze Tabelle geht auf stderr.
+ *
+ * Beispiel:
+ *   bench::Suite suite("receiver");
+ *   suite.run("setOutputsFromMask", [&] { setOutputsFromMask(0x01); });
+ *   suite.report();
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "NativeShim.h"
+
+namespace bench {
+
+// Ergebnis eines einzelnen Benchmarks (alle *PerOp-Werte pro Aufruf)
+struct Result {
+  std::string name;
+  uint64_t iterations = 0;      // Aufrufe je Messrunde
+  double nsPerOp = 0;           // Median über alle Runden
+  double nsPerOpMin = 0;        // schnellste Runde
+  double allocsPerOp = 0;
+  double allocBytesPerOp = 0;
+  double serialBytesPerOp = 0;
+  double digitalWritesPerOp = 0;
+  double digitalReadsPerOp = 0;
+  double analogReadsPerOp = 0;
+  double espNowSendsPerOp = 0;
+};
+
+// Verhindert, dass der Compiler ein Ergebnis wegoptimiert
+template <typename T>
+inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Suite {
+public:
+  explicit Suite(const char *target);
+
+  // Führt fn so oft aus, dass jede Messrunde mindestens minRoundNs dauert.
+  template <typename F>
+  const Result &run(const char *name, F &&fn);
+
+  // Schreibt alle Ergebnisse als JSON auf stdout und als Tabelle auf stderr
+  void report() const;
+
+  const std::vector<Result> &results() const { return all; }
+
+  // Einstellungen (über Kommandozeile: --rounds=N --min-round-ms=N)
+  int rounds = 7;
+  uint64_t minRoundNs = 20000000ULL;  // 20 ms
+
+  void parseArgs(int argc, char **argv);
+
+private:
+  static uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void finish(Result &result, std::vector<double> &roundNsPerOp);
+
+  std::string targetName;
+  std::vector<Result> all;
+};
+
+template <typename F>
+const Result &Suite::run(const char *name, F &&fn) {
+  Result result;
+  result.name = name;
+
+  // Aufwärmen und Iterationszahl kalibrieren (verdoppeln bis lang genug)
+  uint64_t iterations = 1;
+  for (;;) {
+    uint64_t start = nowNs();
+    for (uint64_t i = 0; i < iterations; i++) fn();
+    if (nowNs() - start >= minRoundNs / 4 || iterations >= (1ULL << 30)) break;
+    iterations *= 2;
+  }
+  iterations *= 4;
+  result.iterations = iterations;
+
+  std::vector<double> roundNsPerOp;
+  roundNsPerOp.reserve((size_t)rounds);  // keine Allokation im Messfenster
+  for (int r = 0; r < rounds; r++) {
+    shim::resetCounters();
+    uint64_t start = nowNs();
+    for (uint64_t i = 0; i < iterations; i++) fn();
+    uint64_t elapsed = nowNs() - start;
+    roundNsPerOp.push_back((double)elapsed / (double)iterations);
+
+    // Zähler aus der letzten Runde übernehmen (alle Runden sind gleich lang)
+    const shim::Device &d = shim::current();
+    shim::AllocStats allocs = shim::allocations();
+    double n = (double)iterations;
+    result.allocsPerOp = (double)allocs.count / n;
+    result.allocBytesPerOp = (double)allocs.bytes / n;
+    result.serialBytesPerOp = (double)d.serialBytes / n;
+    result.digitalWritesPerOp = (double)d.digitalWrites / n;
+    result.digitalReadsPerOp = (double)d.digitalReads / n;
+    result.analogReadsPerOp = (double)d.analogReads / n;
+    result.espNowSendsPerOp = (double)d.espNowSends / n;
+  }
+
+  finish(result, roundNsPerOp);
+  return all.back();
+}
+
+}  // namespace bench
@@ -0,0 +1,136 @@
+/**
+ * NativeShim: Nachbildung der für die Firmware nötigen Teile von Arduino.h
+ *
+ * Zeitfunktionen laufen auf der virtuellen Uhr aus NativeShim.h:
+ * delay() blockiert nicht, sondern stellt die Uhr vor.
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Wie im ESP32-Core: min/max aus der Standardbibliothek
+using std::max;
+using std::min;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define PULLUP         0x04
+#define INPUT_PULLUP   0x05
+#define PULLDOWN       0x08
+#define INPUT_PULLDOWN 0x09
+
+// Interrupt-Arten für attachInterrupt()
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define digitalPinToInterrupt(p) (p)
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+typedef void (*voidFuncPtrArg)(void *);
+void attachInterruptArg(uint8_t pin, voidFuncPtrArg handler, void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// Minimaler Ersatz für die Arduino-String-Klasse
+class String {
+public:
+  String() = default;
+  String(const char *s) : str(s ? s : "") {}
+  String(const std::string &s) : str(s) {}
+  const char *c_str() const { return str.c_str(); }
+  unsigned int length() const { return (unsigned int)str.length(); }
+  String &operator+=(const String &other) { str += other.str; return *this; }
+  String &operator+=(const char *s) { str += s; return *this; }
+  String &operator+=(char c) { str += c; return *this; }
+  bool operator==(const String &other) const { return str == other.str; }
+
+private:
+  std::string str;
+};
+
+// Nachbildung von Print/HardwareSerial (Ausgabe zählt nur Bytes, optional Echo)
+class HardwareSerial {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  void flush() {}
+  operator bool() const { return true; }
+
+  int available();
+  int read();
+
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(const String &s) { return print(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+  size_t print(int n, int base = DEC) { return printSigned(n, base); }
+  size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+  size_t print(long n, int base = DEC) { return printSigned(n, base); }
+  size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(long long n, int base = DEC) { return printSigned(n, base); }
+  size_t print(unsigned long long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return print("\r\n"); }
+  template <typename T>
+  size_t println(const T &value) { size_t n = print(value); return n + println(); }
+  template <typename T>
+  size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  size_t printNumber(unsigned long long n, int base);
+  size_t printSigned(long long n, int base);
+};
+
+extern HardwareSerial Serial;
+
+// Nachbildung von EspClass (Esp.h): nur Takt und Zyklenzähler
+class EspClass {
+public:
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getCycleCount();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,952 @@
+/**
+ * NativeShim – Implementierung der Host-Nachbildung
+ *
+ * Alle Arduino-/ESP-IDF-Funktionen arbeiten auf shim::current(), damit ein
+ * Simulator mehrere Geräte in einem Prozess betreiben kann.
+ */
+
+#include "NativeShim.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "Arduino.h"
+#include "Preferences.h"
+#include "SPI.h"
+#include "WiFi.h"
+#include "Wire.h"
+#include "esp_now.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp32s3/rtc.h"
+#include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+EspClass ESP;
+SPIClass SPI;
+TwoWire Wire;
+
+// Registrierte Tasks (laufen nicht von selbst, siehe freertos/task.h)
+struct shim_task {
+  TaskFunction_t code = nullptr;
+  void *param = nullptr;
+  const char *name = nullptr;
+  UBaseType_t priority = 0;
+  BaseType_t core = 0;
+  uint32_t notifications = 0;
+};
+
+// Ein esp_timer gehört immer zu dem Gerät, das ihn angelegt hat
+struct esp_timer {
+  esp_timer_cb_t callback = nullptr;
+  void *arg = nullptr;
+  shim::Device *owner = nullptr;
+  bool armed = false;
+  uint64_t due = 0;     // globale Uhr (µs)
+  uint64_t period = 0;  // 0 = einmalig
+};
+
+namespace shim {
+
+namespace {
+Device defaultDevice;
+Device *activeDevice = &defaultDevice;
+uint64_t clockMicros = 0;
+
+std::vector<esp_timer *> timers;
+std::vector<std::unique_ptr<shim_task>> tasks;  // angelegte Tasks (laufen nicht, leben bis zum Ende)
+
+// Allokationszähler (global, da operator new kein Gerät kennt)
+uint64_t allocCount = 0;
+uint64_t allocBytes = 0;
+}  // namespace
+
+Device &current() { return *activeDevice; }
+void select(Device &device) { activeDevice = &device; }
+
+uint64_t nowMicros() { return clockMicros; }
+
+// Nächster fälliger Timer bis einschließlich 'until' (nullptr = keiner)
+static esp_timer *nextDueTimer(uint64_t until) {
+  esp_timer *next = nullptr;
+  for (esp_timer *t : timers) {
+    if (t->armed && t->due <= until && (next == nullptr || t->due < next->due)) {
+      next = t;
+    }
+  }
+  return next;
+}
+
+void setMicros(uint64_t micros) {
+  // Fällige Timer in zeitlicher Reihenfolge auslösen, jeweils mit dem
+  // Gerät des Timers als aktuellem Gerät
+  while (esp_timer *t = nextDueTimer(micros)) {
+    if (t->due > clockMicros) clockMicros = t->due;
+    if (t->period != 0) {
+      t->due += t->period;
+    } else {
+      t->armed = false;
+    }
+    Device *previous = activeDevice;
+    activeDevice = t->owner;
+    t->callback(t->arg);
+    activeDevice = previous;
+  }
+  if (micros > clockMicros) {
+    clockMicros = micros;
+  }
+}
+
+void advanceMicros(uint64_t delta) { setMicros(clockMicros + delta); }
+
+uint64_t nextTimerMicros() {
+  esp_timer *t = nextDueTimer(UINT64_MAX);
+  return t != nullptr ? t->due : UINT64_MAX;
+}
+
+// Setzt einen Eingangspegel und ruft bei passender Flanke den Interrupt auf
+static void changeInputLevel(Device &d, int pin, uint8_t level) {
+  uint8_t old = d.pinLevel[pin];
+  d.pinLevel[pin] = level;
+  if (old == level || d.isr[pin] == nullptr || d.pinIntrDisabled[pin]) return;
+  bool rising = (level == HIGH);
+  if (d.isrMode[pin] == CHANGE || (rising && d.isrMode[pin] == RISING) ||
+      (!rising && d.isrMode[pin] == FALLING)) {
+    d.isr[pin](d.isrArg[pin]);
+  }
+}
+
+void setInput(int pin, int level) {
+  Device &d = current();
+  d.pinDriven[pin] = true;
+  changeInputLevel(d, pin, level ? HIGH : LOW);
+}
+
+void releaseInput(int pin) {
+  Device &d = current();
+  d.pinDriven[pin] = false;
+  if (d.pinMode[pin] == INPUT_PULLUP) changeInputLevel(d, pin, HIGH);
+  if (d.pinMode[pin] == INPUT_PULLDOWN) changeInputLevel(d, pin, LOW);
+}
+
+int outputLevel(int pin) { return current().pinLevel[pin]; }
+
+void setAnalog(int pin, uint16_t raw) { current().analogValue[pin] = raw; }
+
+void setSendHook(SendHook hook) { current().sendHook = std::move(hook); }
+
+static bool gpioWakeupPending(Device &d) {
+  if (!d.gpioWakeup) return false;
+  for (int pin = 0; pin < PIN_COUNT; pin++) {
+    if (d.pinWakeup[pin] != 0 && d.pinLevel[pin] == d.pinWakeup[pin] - 1) return true;
+  }
+  return false;
+}
+
+bool waitSatisfied(Device &device, Wait wait) {
+  switch (wait) {
+    case Wait::Notify:     return device.mainTask != nullptr && device.mainTask->notifications != 0;
+    case Wait::GpioWakeup: return gpioWakeupPending(device);
+    default:               return false;
+  }
+}
+
+// Wartet bis until (globale Uhr) oder bis die Bedingung erfüllt ist: mit
+// Scheduler laufen derweil die anderen Geräte, sonst springt die Uhr
+static void waitUntil(uint64_t until, Wait wait) {
+  Device &d = current();
+  if (!d.scheduler) {
+    setMicros(until);
+    return;
+  }
+  d.scheduler(until, wait);
+  select(d);
+}
+
+// Meldet einen ESP-NOW-Frame an den Promiscuous-Callback: 802.11-Action-Frame
+// (Kategorie 127, herstellerspezifisch) mit mac als Absender (addr2)
+static void reportPromiscuous(Device &d, const uint8_t *mac, const uint8_t *data, int len) {
+  if (!d.promiscuous || d.promiscuousCb == nullptr) return;
+  if ((d.promiscuousFilter & WIFI_PROMIS_FILTER_MASK_MGMT) == 0) return;
+
+  static uint8_t buffer[sizeof(wifi_promiscuous_pkt_t) + 24 + 15 + ESP_NOW_MAX_DATA_LEN + 4];
+  if (len < 0 || len > ESP_NOW_MAX_DATA_LEN) return;
+  memset(buffer, 0, sizeof(buffer));
+  wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buffer;
+  uint8_t *frame = pkt->payload;
+  frame[0] = 0xD0;                        // Management, Subtyp Action
+  memset(frame + 4, 0xFF, 6);             // addr1 (Broadcast/Empfänger)
+  memcpy(frame + 10, mac, 6);             // addr2 = Absender
+  frame[24] = 127;                        // Kategorie: herstellerspezifisch
+  frame[25] = 0x18;                       // OUI Espressif
+  frame[26] = 0xFE;
+  frame[27] = 0x34;
+  memcpy(frame + 24 + 15, data, len);     // Kopf + Vendor-Element, dann Nutzdaten
+  pkt->rx_ctrl.rssi = d.rxRssi;
+  pkt->rx_ctrl.channel = d.wifiChannel;
+  pkt->rx_ctrl.sig_len = 24 + 15 + len + 4;
+  pkt->rx_ctrl.timestamp = (uint32_t)esp_timer_get_time();
+  d.promiscuousCb(pkt, WIFI_PKT_MGMT);
+}
+
+bool injectReceive(const uint8_t *mac, const uint8_t *data, int len) {
+  Device &d = current();
+  if (!d.espNowReady || d.recvCb == nullptr) return false;
+  reportPromiscuous(d, mac, data, len);
+  d.recvCb(mac, data, len);
+  return true;
+}
+
+bool deliverSendStatus(const uint8_t *mac, bool success) {
+  Device &d = current();
+  if (!d.espNowReady || d.sendCb == nullptr) return false;
+  d.sendCb(mac, success ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+  return true;
+}
+
+AllocStats allocations() {
+  AllocStats stats;
+  stats.count = allocCount;
+  stats.bytes = allocBytes;
+  return stats;
+}
+
+void resetCounters() {
+  Device &d = current();
+  d.digitalWrites = 0;
+  d.digitalReads = 0;
+  d.analogReads = 0;
+  d.espNowSends = 0;
+  d.serialBytes = 0;
+  d.lightSleeps = 0;
+  d.lightSleepMicros = 0;
+  allocCount = 0;
+  allocBytes = 0;
+}
+
+void setSerialEcho(bool echo) { current().serialEcho = echo; }
+
+void serialInput(const char *text) { current().serialIn += text; }
+
+void countAllocation(size_t size) {
+  allocCount++;
+  allocBytes += size;
+}
+
+}  // namespace shim
+
+// =================== ARDUINO-KERN ===================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  shim::Device &d = shim::current();
+  d.pinMode[pin] = mode;
+  if (!d.pinDriven[pin]) {
+    if (mode == INPUT_PULLUP) d.pinLevel[pin] = HIGH;
+    if (mode == INPUT_PULLDOWN) d.pinLevel[pin] = LOW;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  shim::Device &d = shim::current();
+  d.digitalWrites++;
+  d.pinLevel[pin] = val ? HIGH : LOW;
+  if (d.onOutput) d.onOutput();
+}
+
+int digitalRead(uint8_t pin) {
+  shim::Device &d = shim::current();
+  d.digitalReads++;
+  return d.pinLevel[pin];
+}
+
+uint16_t analogRead(uint8_t pin) {
+  shim::Device &d = shim::current();
+  d.analogReads++;
+  return d.analogValue[pin];
+}
+
+void attachInterruptArg(uint8_t pin, voidFuncPtrArg handler, void *arg, int mode) {
+  shim::Device &d = shim::current();
+  d.isr[pin] = handler;
+  d.isrArg[pin] = arg;
+  d.isrMode[pin] = (uint8_t)mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  shim::Device &d = shim::current();
+  d.isr[pin] = nullptr;
+  d.isrArg[pin] = nullptr;
+  d.isrMode[pin] = 0;
+}
+
+// GPIO-Ausgangsregister: alle Pins einer Maske wechseln im selben Schritt.
+// Ein Registerzugriff zählt wie ein digitalWrite() (gpio/op im Benchmark).
+static void writePinBank(int firstPin, uint32_t mask, int level) {
+  shim::Device &d = shim::current();
+  for (int bit = 0; bit < 32 && firstPin + bit < shim::PIN_COUNT; bit++) {
+    if ((mask >> bit) & 1) d.pinLevel[firstPin + bit] = (uint8_t)level;
+  }
+  if (d.onOutput) d.onOutput();
+}
+
+static uint32_t readPinBank(int firstPin) {
+  shim::Device &d = shim::current();
+  uint32_t value = 0;
+  for (int bit = 0; bit < 32 && firstPin + bit < shim::PIN_COUNT; bit++) {
+    if (d.pinLevel[firstPin + bit] == HIGH) value |= 1UL << bit;
+  }
+  return value;
+}
+
+void shim_reg_write(uint32_t reg, uint32_t value) {
+  if (reg >= GPIO_OUT_REG && reg <= GPIO_OUT1_W1TC_REG) shim::current().digitalWrites++;
+  switch (reg) {
+    case GPIO_OUT_REG:
+      writePinBank(0, value, HIGH);
+      writePinBank(0, ~value, LOW);
+      break;
+    case GPIO_OUT_W1TS_REG:  writePinBank(0, value, HIGH); break;
+    case GPIO_OUT_W1TC_REG:  writePinBank(0, value, LOW); break;
+    case GPIO_OUT1_REG:
+      writePinBank(32, value & 0xFF, HIGH);
+      writePinBank(32, ~value & 0xFF, LOW);
+      break;
+    case GPIO_OUT1_W1TS_REG: writePinBank(32, value & 0xFF, HIGH); break;
+    case GPIO_OUT1_W1TC_REG: writePinBank(32, value & 0xFF, LOW); break;
+    default: break;
+  }
+}
+
+uint32_t shim_reg_read(uint32_t reg) {
+  switch (reg) {
+    case GPIO_OUT_REG:  return readPinBank(0);
+    case GPIO_OUT1_REG: return readPinBank(32) & 0xFF;
+    default: return 0;
+  }
+}
+
+// Zyklenzähler: echte Host-Zeit, umgerechnet auf den CPU-Takt des ESP32.
+// Damit lassen sich kurze Abschnitte (z.B. Schaltversatz) messen, obwohl
+// die virtuelle Uhr währenddessen stillsteht.
+uint32_t EspClass::getCycleCount() {
+  uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  return (uint32_t)(ns * getCpuFreqMHz() / 1000ULL);
+}
+
+unsigned long millis() {
+  return (unsigned long)((shim::nowMicros() - shim::current().bootMicros) / 1000ULL);
+}
+
+unsigned long micros() {
+  return (unsigned long)(shim::nowMicros() - shim::current().bootMicros);
+}
+
+void delay(uint32_t ms) { shim::waitUntil(shim::nowMicros() + ms * 1000ULL, shim::Wait::Time); }
+void delayMicroseconds(uint32_t us) { shim::waitUntil(shim::nowMicros() + us, shim::Wait::Time); }
+void yield() {}
+
+// =================== SPI / I2C ===================
+
+void SPIClass::beginTransaction(SPISettings settings) {
+  (void)settings;
+  shim::current().spiLength = 0;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  shim::Device &d = shim::current();
+  if (d.spiLength < shim::Device::BUS_BUFFER) d.spiData[d.spiLength++] = data;
+  return 0;
+}
+
+void TwoWire::beginTransmission(uint16_t address) {
+  shim::Device &d = shim::current();
+  d.i2cAddress = (uint8_t)address;
+  d.i2cLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  shim::Device &d = shim::current();
+  if (d.i2cLength >= shim::Device::BUS_BUFFER) return 0;
+  d.i2cData[d.i2cLength++] = data;
+  return 1;
+}
+
+// =================== PREFERENCES (NVS) ===================
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  prefix = std::string(name) + "/";
+  this->readOnly = readOnly;
+  opened = true;
+  return true;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!opened || readOnly) return 0;
+  shim::Device &d = shim::current();
+  const uint8_t *bytes = (const uint8_t *)value;
+  d.nvs[prefix + key].assign(bytes, bytes + len);
+  d.nvsWrites++;
+  d.nvsBytesWritten += len;
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  if (!opened) return 0;
+  shim::Device &d = shim::current();
+  auto it = d.nvs.find(prefix + key);
+  return it == d.nvs.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  if (!opened) return 0;
+  shim::Device &d = shim::current();
+  auto it = d.nvs.find(prefix + key);
+  if (it == d.nvs.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+  return putBytes(key, &value, sizeof(value)) == sizeof(value) ? sizeof(value) : 0;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+  uint32_t value;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!opened || readOnly) return false;
+  return shim::current().nvs.erase(prefix + key) > 0;
+}
+
+// =================== SERIAL ===================
+
+int HardwareSerial::available() { return (int)shim::current().serialIn.size(); }
+
+int HardwareSerial::read() {
+  shim::Device &d = shim::current();
+  if (d.serialIn.empty()) return -1;
+  int c = (uint8_t)d.serialIn[0];
+  d.serialIn.erase(0, 1);
+  return c;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  shim::Device &d = shim::current();
+  d.serialBytes += size;
+  if (d.serialEcho) {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+size_t HardwareSerial::printNumber(unsigned long long n, int base) {
+  char buf[8 * sizeof(n) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = (char)(n % base);
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return print(str);
+}
+
+size_t HardwareSerial::printSigned(long long n, int base) {
+  if (base == DEC && n < 0) {
+    return print('-') + printNumber((unsigned long long)(-n), base);
+  }
+  return printNumber((unsigned long long)n, base);
+}
+
+size_t HardwareSerial::print(double n, int digits) {
+  char buf[32];
+  int len = snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write((const uint8_t *)buf, (size_t)len);
+}
+
+// Wie Print::printf in arduino-esp32: 64-Byte-Stackpuffer, längere Texte
+// landen in einem malloc()-Puffer (wird als Allokation gezählt).
+size_t HardwareSerial::printf(const char *format, ...) {
+  char loc_buf[64];
+  char *temp = loc_buf;
+  va_list arg;
+  va_list copy;
+  va_start(arg, format);
+  va_copy(copy, arg);
+  int len = vsnprintf(temp, sizeof(loc_buf), format, copy);
+  va_end(copy);
+  if (len < 0) {
+    va_end(arg);
+    return 0;
+  }
+  if (len >= (int)sizeof(loc_buf)) {
+    temp = (char *)malloc(len + 1);
+    shim::countAllocation(len + 1);
+    if (temp == nullptr) {
+      va_end(arg);
+      return 0;
+    }
+    len = vsnprintf(temp, len + 1, format, arg);
+  }
+  va_end(arg);
+  len = (int)write((const uint8_t *)temp, (size_t)len);
+  if (temp != loc_buf) {
+    free(temp);
+  }
+  return (size_t)len;
+}
+
+// =================== WIFI ===================
+
+int8_t WiFiClass::RSSI() { return shim::current().rssi; }
+
+uint8_t WiFiClass::channel() { return shim::current().wifiChannel; }
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel,
+                             const uint8_t *bssid, bool connect) {
+  (void)passphrase;
+  (void)bssid;
+  shim::Device &d = shim::current();
+  d.staConnected = false;
+  if (ssid == nullptr || ssid[0] == '\0' || !connect) return WL_DISCONNECTED;
+  if (!d.apReachable || (channel != 0 && channel != d.apChannel)) return WL_NO_SSID_AVAIL;
+  d.staConnected = true;
+  d.wifiChannel = d.apChannel;  // die Station folgt dem Kanal des Zugangspunkts
+  return WL_CONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  shim::Device &d = shim::current();
+  if (d.staConnected && !d.apReachable) d.staConnected = false;
+  return d.staConnected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+  (void)wifiOff;
+  (void)eraseAp;
+  shim::current().staConnected = false;
+  return true;
+}
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // macOS: SO_NOSIGPIPE, siehe connect()
+#endif
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeoutMs) {
+  stop();
+  char service[8];
+  snprintf(service, sizeof(service), "%u", (unsigned)port);
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *result = nullptr;
+  if (getaddrinfo(host, service, &hints, &result) != 0) return 0;
+
+  for (struct addrinfo *ai = result; ai != nullptr && fd < 0; ai = ai->ai_next) {
+    int s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (s < 0) continue;
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    // Nicht blockierend aufbauen, damit der Timeout greift
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+    bool ok = ::connect(s, ai->ai_addr, ai->ai_addrlen) == 0;
+    if (!ok && errno == EINPROGRESS) {
+      struct pollfd pfd = {s, POLLOUT, 0};
+      int error = 0;
+      socklen_t errorLen = sizeof(error);
+      ok = poll(&pfd, 1, timeoutMs) == 1 && getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &errorLen) == 0 &&
+           error == 0;
+    }
+    fcntl(s, F_SETFL, flags);
+    if (ok) {
+      fd = s;
+    } else {
+      close(s);
+    }
+  }
+  freeaddrinfo(result);
+  return fd >= 0 ? 1 : 0;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+  size_t sent = 0;
+  while (fd >= 0 && sent < size) {
+    ssize_t n = send(fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) continue;
+      stop();
+      return 0;
+    }
+    sent += (size_t)n;
+  }
+  return fd >= 0 ? sent : 0;
+}
+
+int WiFiClient::available() {
+  if (fd < 0) return 0;
+  int count = 0;
+  if (ioctl(fd, FIONREAD, &count) != 0) return 0;
+  return count;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+  if (fd < 0) return -1;
+  ssize_t n = recv(fd, buf, size, MSG_DONTWAIT);
+  if (n == 0) {
+    stop();  // Gegenseite hat geschlossen
+    return -1;
+  }
+  return n < 0 ? -1 : (int)n;
+}
+
+uint8_t WiFiClient::connected() {
+  if (fd < 0) return 0;
+  uint8_t probe;
+  ssize_t n = recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiClient::stop() {
+  if (fd < 0) return;
+  close(fd);
+  fd = -1;
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+  if (fd < 0) return -1;
+  int value = nodelay ? 1 : 0;
+  return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+  (void)second;
+  if (primary < 1 || primary > 14) return ESP_ERR_INVALID_ARG;
+  shim::current().wifiChannel = primary;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second) {
+  if (primary != nullptr) *primary = shim::current().wifiChannel;
+  if (second != nullptr) *second = WIFI_SECOND_CHAN_NONE;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb) {
+  shim::current().promiscuousCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter) {
+  if (filter == nullptr) return ESP_ERR_INVALID_ARG;
+  shim::current().promiscuousFilter = filter->filter_mask;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool en) {
+  shim::current().promiscuous = en;
+  return ESP_OK;
+}
+
+String WiFiClass::macAddress() {
+  const uint8_t *m = shim::current().ownMac;
+  char buf[18];
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+  return String(buf);
+}
+
+// =================== ESP-NOW ===================
+
+esp_err_t esp_now_init(void) {
+  shim::current().espNowReady = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit(void) {
+  shim::Device &d = shim::current();
+  d.espNowReady = false;
+  d.sendCb = nullptr;
+  d.recvCb = nullptr;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  shim::Device &d = shim::current();
+  if (!d.espNowReady) return ESP_ERR_ESPNOW_NOT_INIT;
+  d.sendCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  shim::Device &d = shim::current();
+  if (!d.espNowReady) return ESP_ERR_ESPNOW_NOT_INIT;
+  d.recvCb = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+  if (!shim::current().espNowReady) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (peer == nullptr) return ESP_ERR_ESPNOW_ARG;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len) {
+  shim::Device &d = shim::current();
+  if (!d.espNowReady) return ESP_ERR_ESPNOW_NOT_INIT;
+  if (len == 0 || len > ESP_NOW_MAX_DATA_LEN) return ESP_ERR_ESPNOW_ARG;
+  d.espNowSends++;
+  if (d.sendHook) {
+    return d.sendHook(peer_addr, data, len);
+  }
+  return ESP_OK;
+}
+
+// =================== FREERTOS ===================
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority,
+                                   TaskHandle_t *pvCreatedTask, BaseType_t xCoreID) {
+  (void)usStackDepth;
+  shim_task *task = new shim_task;
+  task->code = pvTaskCode;
+  task->param = pvParameters;
+  task->name = pcName;
+  task->priority = uxPriority;
+  task->core = xCoreID;
+  shim::tasks.emplace_back(task);
+  if (pvCreatedTask != nullptr) *pvCreatedTask = task;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) { delay(xTicksToDelay * portTICK_PERIOD_MS); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  shim::Device &d = shim::current();
+  if (d.mainTask == nullptr) {
+    d.mainTask = new shim_task;
+    d.mainTask->name = "loopTask";
+  }
+  return d.mainTask;
+}
+
+// Nimmt Benachrichtigungen des Haupt-Tasks; ohne Benachrichtigung läuft die
+// virtuelle Uhr um die Wartezeit weiter (fällige Timer können dabei benachrichtigen).
+// Mit Scheduler endet das Warten mit der ersten Benachrichtigung, und
+// portMAX_DELAY wartet wirklich; ohne kehrt es dann sofort zurück.
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+  shim_task *task = xTaskGetCurrentTaskHandle();
+  if (task->notifications == 0 && xTicksToWait != 0) {
+    if (xTicksToWait != portMAX_DELAY) {
+      shim::waitUntil(shim::nowMicros() + xTicksToWait * portTICK_PERIOD_MS * 1000ULL, shim::Wait::Notify);
+    } else if (shim::current().scheduler) {
+      shim::waitUntil(UINT64_MAX, shim::Wait::Notify);
+    }
+  }
+  uint32_t value = task->notifications;
+  if (value != 0) {
+    task->notifications = xClearCountOnExit ? 0 : value - 1;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  if (xTaskToNotify != nullptr) xTaskToNotify->notifications++;
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken) {
+  xTaskNotifyGive(xTaskToNotify);
+  if (pxHigherPriorityTaskWoken != nullptr) *pxHigherPriorityTaskWoken = pdFALSE;
+}
+
+BaseType_t xPortGetCoreID(void) { return 1; }
+
+// =================== ESP_TIMER ===================
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+  if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_timer *t = new esp_timer;
+  t->callback = create_args->callback;
+  t->arg = create_args->arg;
+  t->owner = &shim::current();
+  shim::timers.push_back(t);
+  *out_handle = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  if (timer == nullptr) return ESP_ERR_INVALID_ARG;
+  if (timer->armed) return ESP_ERR_INVALID_STATE;
+  timer->armed = true;
+  timer->period = 0;
+  timer->due = shim::nowMicros() + timeout_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  if (timer == nullptr || period == 0) return ESP_ERR_INVALID_ARG;
+  if (timer->armed) return ESP_ERR_INVALID_STATE;
+  timer->armed = true;
+  timer->period = period;
+  timer->due = shim::nowMicros() + period;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (timer == nullptr) return ESP_ERR_INVALID_ARG;
+  if (!timer->armed) return ESP_ERR_INVALID_STATE;
+  timer->armed = false;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  if (timer == nullptr) return ESP_ERR_INVALID_ARG;
+  if (timer->armed) return ESP_ERR_INVALID_STATE;
+  for (size_t i = 0; i < shim::timers.size(); i++) {
+    if (shim::timers[i] == timer) {
+      shim::timers.erase(shim::timers.begin() + i);
+      break;
+    }
+  }
+  delete timer;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) { return timer != nullptr && timer->armed; }
+
+int64_t esp_timer_get_time(void) { return (int64_t)micros(); }
+
+uint64_t esp_rtc_get_time_us(void) { return shim::nowMicros(); }
+
+// =================== DEEP SLEEP ===================
+
+esp_err_t esp_sleep_enable_ext1_wakeup(uint64_t mask, esp_sleep_ext1_wakeup_mode_t mode) {
+  (void)mask;
+  (void)mode;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  shim::current().sleepTimerUs = time_in_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void) {
+  shim::current().gpioWakeup = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_wakeup_cause_t source) {
+  shim::Device &d = shim::current();
+  if (source == ESP_SLEEP_WAKEUP_TIMER || source == ESP_SLEEP_WAKEUP_ALL) d.sleepTimerUs = 0;
+  if (source == ESP_SLEEP_WAKEUP_GPIO || source == ESP_SLEEP_WAKEUP_ALL) d.gpioWakeup = false;
+  return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) {
+  return (esp_sleep_wakeup_cause_t)shim::current().wakeupCause;
+}
+
+uint64_t esp_sleep_get_ext1_wakeup_status(void) { return shim::current().ext1WakeupStatus; }
+
+void esp_deep_sleep_start(void) { throw shim::DeepSleepRequest{}; }
+
+// =================== LIGHT SLEEP / GPIO ===================
+
+// Schläft bis zum Timer; mit Scheduler weckt auch ein Taster, der erst
+// während des Schlafs gedrückt wird
+esp_err_t esp_light_sleep_start(void) {
+  shim::Device &d = shim::current();
+  d.lightSleeps++;
+  if (d.onLightSleep) d.onLightSleep();
+  if (shim::waitSatisfied(d, shim::Wait::GpioWakeup)) {
+    d.wakeupCause = ESP_SLEEP_WAKEUP_GPIO;
+    return ESP_OK;
+  }
+  if (d.sleepTimerUs == 0) return ESP_ERR_INVALID_STATE;  // würde nie aufwachen
+  uint64_t start = shim::nowMicros();
+  shim::waitUntil(start + d.sleepTimerUs, shim::Wait::GpioWakeup);
+  d.lightSleepMicros += shim::nowMicros() - start;
+  d.wakeupCause = shim::waitSatisfied(d, shim::Wait::GpioWakeup) ? ESP_SLEEP_WAKEUP_GPIO
+                                                                 : ESP_SLEEP_WAKEUP_TIMER;
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+  (void)gpio_num;
+  (void)intr_type;
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+  shim::current().pinIntrDisabled[gpio_num] = false;
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+  shim::current().pinIntrDisabled[gpio_num] = true;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+  if (intr_type != GPIO_INTR_LOW_LEVEL && intr_type != GPIO_INTR_HIGH_LEVEL) return ESP_ERR_INVALID_ARG;
+  shim::current().pinWakeup[gpio_num] = intr_type == GPIO_INTR_LOW_LEVEL ? LOW + 1 : HIGH + 1;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t gpio_num) {
+  shim::current().pinWakeup[gpio_num] = 0;
+  return ESP_OK;
+}
+
+// =================== ALLOKATIONSZÄHLER ===================
+
+// GCC hält malloc/free in den Ersatzfunktionen für "mismatched", sobald
+// std::map-Knoten in dieser Datei inline angelegt werden (Preferences)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t size) {
+  shim::countAllocation(size);
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) {
+  shim::countAllocation(size);
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
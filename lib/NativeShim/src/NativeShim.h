@@ -0,0 +1,195 @@
+/**
+ * NativeShim – Steuer-Schnittstelle der Host-Nachbildung
+ *
+ * Die Firmware (src/main.cpp) wird im native-Build unverändert gegen
+ * Arduino.h, WiFi.h, SPI.h, Wire.h, Preferences.h, esp_now.h, esp_sleep.h,
+ * esp_timer.h, esp32s3/rtc.h, driver/gpio.h und soc/gpio_reg.h aus diesem
+ * Ordner übersetzt.
+ * Über die Funktionen hier kann ein Benchmark oder ein Simulator:
+ * - die virtuelle Uhr stellen (millis/micros/delay laufen NICHT in Echtzeit,
+ *   fällige esp_timer-Callbacks werden dabei ausgeführt)
+ * - Taster-Pegel und ADC-Werte vorgeben
+ * - gesendete ESP-NOW-Frames abgreifen und Frames "empfangen"
+ * - Speicher-Allokationen und Serial-Ausgaben zählen
+ * - den WLAN-Zugangspunkt vorgeben (Device::apChannel/apReachable); TCP
+ *   über WiFiClient geht auf echte Sockets des Hosts
+ * - Wartestellen der Firmware an einen Scheduler abgeben (mehrere Geräte
+ *   auf einer gemeinsamen Uhr, siehe simulator/)
+ *
+ * Der gesamte Zustand eines ESP32 steckt in einem shim::Device. Im Normalfall
+ * gibt es genau eines; ein Simulator kann mehrere anlegen und mit
+ * shim::select() zwischen ihnen umschalten.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+struct shim_task;
+
+#include "esp_err.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+
+namespace shim {
+
+// Anzahl nachgebildeter GPIOs (ESP32-S3 hat 49, ESP32 40)
+constexpr int PIN_COUNT = 64;
+
+// Hook für esp_now_send(): Rückgabewert wird an die Firmware durchgereicht
+using SendHook = std::function<esp_err_t(const uint8_t *mac, const uint8_t *data, size_t len)>;
+
+// Worauf eine blockierende Funktion der Firmware wartet
+enum class Wait {
+  Time,        // delay(), vTaskDelay(): nur auf die Uhr
+  Notify,      // ulTaskNotifyTake(): Benachrichtigung des Haupt-Tasks
+  GpioWakeup,  // esp_light_sleep_start(): Aufweck-Pegel an einem GPIO
+};
+
+// Scheduler eines Geräts (Simulator): delay(), vTaskDelay(), ulTaskNotifyTake()
+// und esp_light_sleep_start() rufen ihn auf, statt die Uhr selbst
+// weiterzustellen. Er lässt bis 'until' (globale Uhr) die anderen Geräte
+// laufen und kehrt früher zurück, sobald waitSatisfied() gilt. Danach ist
+// wieder das wartende Gerät ausgewählt.
+using Scheduler = std::function<void(uint64_t until, Wait wait)>;
+
+// Zustand eines nachgebildeten ESP32
+struct Device {
+  // Zeitpunkt des (virtuellen) Einschaltens auf der globalen Uhr
+  uint64_t bootMicros = 0;
+
+  // GPIO
+  uint8_t pinMode[PIN_COUNT] = {0};
+  uint8_t pinLevel[PIN_COUNT] = {0};
+  bool    pinDriven[PIN_COUNT] = {false};  // Pegel von außen vorgegeben (Taster)
+  uint16_t analogValue[PIN_COUNT] = {0};
+
+  // SPI / I2C: letzte Übertragung (siehe SPI.h, Wire.h)
+  static constexpr int BUS_BUFFER = 16;
+  uint8_t spiData[BUS_BUFFER] = {0};
+  int spiLength = 0;
+  uint8_t i2cAddress = 0;
+  uint8_t i2cData[BUS_BUFFER] = {0};
+  int i2cLength = 0;
+
+  // GPIO-Interrupts (attachInterruptArg), werden von setInput/releaseInput ausgelöst
+  void (*isr[PIN_COUNT])(void *) = {nullptr};
+  void *isrArg[PIN_COUNT] = {nullptr};
+  uint8_t isrMode[PIN_COUNT] = {0};
+
+  // Haupt-Task (setup/loop) für Task-Benachrichtigungen
+  shim_task *mainTask = nullptr;
+
+  // Ohne Scheduler springt die Uhr beim Warten direkt weiter (Benchmarks)
+  Scheduler scheduler;
+
+  // Nach jedem Schreiben eines Ausgangs (digitalWrite, GPIO-Register), auch
+  // zwischen zwei Registerzugriffen desselben Umschaltens
+  std::function<void()> onOutput;
+
+  // ESP-NOW
+  bool espNowReady = false;
+  esp_now_send_cb_t sendCb = nullptr;
+  esp_now_recv_cb_t recvCb = nullptr;
+  SendHook sendHook;
+  uint8_t ownMac[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01};
+  int8_t rssi = 0;
+  uint8_t wifiChannel = 1;
+
+  // Zugangspunkt für WiFi.begin() (Station-Modus): Kanal und Erreichbarkeit.
+  // begin() mit Kanal != 0 findet ihn nur auf genau diesem Kanal.
+  uint8_t apChannel = 6;
+  bool apReachable = true;
+  bool staConnected = false;
+
+  // Promiscuous-Empfang: injectReceive() meldet den Frame vorher hier
+  // (als ESP-NOW-Action-Frame mit Empfangspegel rxRssi)
+  bool promiscuous = false;
+  uint32_t promiscuousFilter = WIFI_PROMIS_FILTER_MASK_ALL;
+  wifi_promiscuous_cb_t promiscuousCb = nullptr;
+  int8_t rxRssi = -60;
+
+  // Deep/Light Sleep, Wake-Ursache
+  int wakeupCause = 0;
+  uint64_t ext1WakeupStatus = 0;
+  uint64_t sleepTimerUs = 0;                 // 0 = kein Timer-Aufwecken
+  bool gpioWakeup = false;                   // esp_sleep_enable_gpio_wakeup()
+  uint8_t pinWakeup[PIN_COUNT] = {0};        // gpio_wakeup_enable: 0 = aus, sonst Pegel + 1
+  bool pinIntrDisabled[PIN_COUNT] = {false}; // gpio_intr_disable(): Interrupt meldet nichts
+  // Zu Beginn von esp_light_sleep_start(): z.B. im Schlaf einen Taster drücken
+  std::function<void()> onLightSleep;
+
+  // Zähler (seit dem letzten resetCounters())
+  uint64_t digitalWrites = 0;
+  uint64_t digitalReads = 0;
+  uint64_t analogReads = 0;
+  uint64_t espNowSends = 0;
+  uint64_t serialBytes = 0;
+  uint64_t lightSleeps = 0;
+  uint64_t lightSleepMicros = 0;
+
+  // Serial-Ausgabe zusätzlich auf stdout spiegeln
+  bool serialEcho = false;
+
+  // Serial-Eingabe (siehe serialInput()), wird von Serial.read() geleert
+  std::string serialIn;
+
+  // NVS (Preferences): "namespace/key" -> Inhalt; bleibt über Neustarts erhalten
+  std::map<std::string, std::vector<uint8_t>> nvs;
+  uint64_t nvsWrites = 0;
+  uint64_t nvsBytesWritten = 0;
+};
+
+// ---------- Geräteverwaltung ----------
+Device &current();
+void select(Device &device);
+
+// ---------- Virtuelle Uhr ----------
+uint64_t nowMicros();             // globale Uhr
+void setMicros(uint64_t micros);  // darf nur vorwärts laufen
+void advanceMicros(uint64_t delta);
+inline void advanceMillis(uint64_t delta) { advanceMicros(delta * 1000ULL); }
+
+// ---------- GPIO / ADC ----------
+void setInput(int pin, int level);  // Pegel von außen treiben (z.B. Taster), löst ggf. Interrupt aus
+void releaseInput(int pin);         // wieder dem Pull-Up/-Down überlassen
+int  outputLevel(int pin);
+void setAnalog(int pin, uint16_t raw);
+
+// ---------- Scheduler ----------
+// Ist die Wartebedingung des Geräts erfüllt? (Wait::Time: nie vorzeitig)
+bool waitSatisfied(Device &device, Wait wait);
+// Fälligkeit des nächsten esp_timer (UINT64_MAX = keiner)
+uint64_t nextTimerMicros();
+
+// ---------- ESP-NOW ----------
+void setSendHook(SendHook hook);
+// Ruft den registrierten Empfangs-Callback auf (Frame "kommt an"); ist der
+// Promiscuous-Modus an, sieht dessen Callback den Frame zuerst (Pegel rxRssi)
+bool injectReceive(const uint8_t *mac, const uint8_t *data, int len);
+// Ruft den registrierten Sende-Callback auf (Zustellstatus)
+bool deliverSendStatus(const uint8_t *mac, bool success);
+
+// ---------- Zähler ----------
+struct AllocStats {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+};
+AllocStats allocations();  // operator new + Print::printf-Heap-Puffer
+void resetCounters();
+
+void setSerialEcho(bool echo);
+
+// Zeichen, die die Firmware über Serial.read() lesen kann
+void serialInput(const char *text);
+
+// Wird von esp_deep_sleep_start() geworfen – der Aufrufer entscheidet,
+// ob er das Gerät "neu startet" oder den Lauf beendet.
+struct DeepSleepRequest {};
+
+}  // namespace shim
@@ -0,0 +1,27 @@
+// NativeShim: Nachbildung der genutzten Teile von Preferences.h (arduino-esp32)
+//
+// Die Einträge liegen in shim::Device::nvs und überleben damit einen
+// simulierten Neustart. Geschriebene Einträge und Bytes werden gezählt.
+#pragma once
+
+#include <string>
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false);
+  void end() { opened = false; }
+
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t getBytesLength(const char *key);
+  size_t putUInt(const char *key, uint32_t value);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  bool remove(const char *key);
+
+private:
+  std::string prefix;
+  bool readOnly = false;
+  bool opened = false;
+};
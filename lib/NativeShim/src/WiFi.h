@@ -0,0 +1,86 @@
+// NativeShim: Nachbildung der genutzten Teile von WiFi.h (arduino-esp32)
+#pragma once
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+  WIFI_POWER_19_5dBm = 78,
+  WIFI_POWER_19dBm = 76,
+  WIFI_POWER_18_5dBm = 74,
+  WIFI_POWER_17dBm = 68,
+  WIFI_POWER_15dBm = 60,
+  WIFI_POWER_13dBm = 52,
+  WIFI_POWER_11dBm = 44,
+  WIFI_POWER_8_5dBm = 34,
+  WIFI_POWER_7dBm = 28,
+  WIFI_POWER_5dBm = 20,
+  WIFI_POWER_2dBm = 8,
+  WIFI_POWER_MINUS_1dBm = -4
+} wifi_power_t;
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+// Station-Modus: der Zugangspunkt wird über shim::Device nachgebildet
+// (apChannel, apReachable); begin() verbindet sofort oder gar nicht
+class WiFiClass {
+public:
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr, int32_t channel = 0,
+                    const uint8_t *bssid = nullptr, bool connect = true);
+  wl_status_t status();
+  bool setAutoReconnect(bool autoReconnect) { this->autoReconnect = autoReconnect; return true; }
+  bool getAutoReconnect() const { return autoReconnect; }
+  bool mode(wifi_mode_t m) { currentMode = m; return true; }
+  wifi_mode_t getMode() const { return currentMode; }
+  bool setTxPower(wifi_power_t power) { txPower = power; return true; }
+  wifi_power_t getTxPower() const { return txPower; }
+  bool setSleep(bool enable) { sleepEnabled = enable; return true; }
+  bool getSleep() const { return sleepEnabled; }
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  int8_t RSSI();
+  uint8_t channel();
+  String macAddress();
+
+private:
+  wifi_mode_t currentMode = WIFI_OFF;
+  wifi_power_t txPower = WIFI_POWER_19_5dBm;
+  bool sleepEnabled = true;
+  bool autoReconnect = true;
+};
+
+extern WiFiClass WiFi;
+
+// TCP-Verbindung über echte Sockets des Hosts (z.B. zu einem lokalen
+// MQTT-Broker). connect() blockiert bis zum Aufbau oder Timeout, read()
+// nie; write() schreibt alles oder meldet 0.
+class WiFiClient {
+public:
+  WiFiClient() = default;
+  ~WiFiClient() { stop(); }
+  WiFiClient(const WiFiClient &) = delete;
+  WiFiClient &operator=(const WiFiClient &) = delete;
+
+  int connect(const char *host, uint16_t port, int32_t timeoutMs = 3000);
+  size_t write(const uint8_t *buf, size_t size);
+  int available();
+  int read(uint8_t *buf, size_t size);
+  uint8_t connected();
+  void stop();
+  int setNoDelay(bool nodelay);
+
+private:
+  int fd = -1;
+};
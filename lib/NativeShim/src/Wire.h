@@ -0,0 +1,18 @@
+// NativeShim: Nachbildung der genutzten Teile von Wire.h (arduino-esp32)
+//
+// Jede Übertragung wird nur mitgeschrieben: Adresse und Bytes der letzten
+// stehen in shim::Device::i2cAddress / i2cData. Es antwortet immer ein Gerät.
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+  bool begin() { return true; }
+  bool setClock(uint32_t frequency) { (void)frequency; return true; }
+  void beginTransmission(uint16_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool sendStop = true) { (void)sendStop; return 0; }
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,8 @@
+// NativeShim: Nachbildung von esp32s3/rtc.h (ESP-IDF 4.4)
+#pragma once
+
+#include <stdint.h>
+
+// RTC-Zähler in µs: läuft auch im Tiefschlaf weiter. Hier die globale
+// virtuelle Uhr (Einschalten bei 0), unabhängig vom Neustart eines Geräts.
+uint64_t esp_rtc_get_time_us(void);
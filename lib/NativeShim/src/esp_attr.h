@@ -0,0 +1,9 @@
+// NativeShim: Nachbildung von esp_attr.h
+//
+// Auf dem Host gibt es weder IRAM noch RTC-Speicher: die Attribute sind leer,
+// RTC-Variablen sind normale globale Variablen.
+#pragma once
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,27 @@
+// NativeShim: Nachbildung der genutzten Teile von freertos/semphr.h
+//
+// Auf dem Host läuft alles in einem Thread: ein Mutex ist immer frei.
+// Gezählt wird trotzdem, damit ein vergessenes Give auffällt.
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct shim_semaphore {
+  int taken = 0;
+};
+typedef shim_semaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new shim_semaphore(); }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  (void)ticks;
+  if (sem->taken != 0) return pdFALSE;
+  sem->taken = 1;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  if (sem->taken == 0) return pdFALSE;
+  sem->taken = 0;
+  return pdTRUE;
+}
@@ -0,0 +1,27 @@
+// NativeShim: Nachbildung der genutzten Teile von freertos/task.h
+//
+// Tasks werden nur registriert, nicht nebenläufig ausgeführt. Benchmarks und
+// Simulator rufen die Arbeitsfunktionen der Firmware selbst auf.
+// Task-Benachrichtigungen gibt es für den Haupt-Task (setup/loop) jedes
+// Geräts: ulTaskNotifyTake() wartet auf der virtuellen Uhr.
+#pragma once
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct shim_task *TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                                   void *pvParameters, UBaseType_t uxPriority,
+                                   TaskHandle_t *pvCreatedTask, BaseType_t xCoreID);
+void vTaskDelay(TickType_t xTicksToDelay);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xPortGetCoreID(void);
+
+#define portYIELD_FROM_ISR(...) ((void)0)
@@ -0,0 +1,14 @@
+// NativeShim: Nachbildung der genutzten Teile von soc/gpio_reg.h
+//
+// GPIO 0-31 liegen in GPIO_OUT_*, GPIO 32-39 in GPIO_OUT1_*. Ein Schreiben
+// auf W1TS setzt alle Pins der Maske gleichzeitig auf HIGH, W1TC auf LOW.
+#pragma once
+
+#include "soc/soc.h"
+
+#define GPIO_OUT_REG       (DR_REG_GPIO_BASE + 0x0004)
+#define GPIO_OUT_W1TS_REG  (DR_REG_GPIO_BASE + 0x0008)
+#define GPIO_OUT_W1TC_REG  (DR_REG_GPIO_BASE + 0x000c)
+#define GPIO_OUT1_REG      (DR_REG_GPIO_BASE + 0x0010)
+#define GPIO_OUT1_W1TS_REG (DR_REG_GPIO_BASE + 0x0014)
+#define GPIO_OUT1_W1TC_REG (DR_REG_GPIO_BASE + 0x0018)
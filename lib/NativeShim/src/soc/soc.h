@@ -0,0 +1,15 @@
+// NativeShim: Nachbildung der genutzten Teile von soc/soc.h
+//
+// Registerzugriffe gehen an die Host-Nachbildung; bekannt sind nur die
+// GPIO-Ausgangsregister aus soc/gpio_reg.h.
+#pragma once
+
+#include <stdint.h>
+
+#define DR_REG_GPIO_BASE 0x3ff44000
+
+void shim_reg_write(uint32_t reg, uint32_t value);
+uint32_t shim_reg_read(uint32_t reg);
+
+#define REG_WRITE(reg, val) shim_reg_write((uint32_t)(reg), (uint32_t)(val))
+#define REG_READ(reg)       shim_reg_read((uint32_t)(reg))
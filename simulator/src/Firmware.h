@@ -0,0 +1,49 @@
+/**
+ * Firmware – Sender und Empfänger in einem Prozess
+ *
+ * Beide Firmwares definieren setup(), loop(), initESPNOW(), LOOP_DELAY
+ * usw. Damit sie nebeneinander passen, bindet je eine eigene
+ * Übersetzungseinheit die unveränderte src/main.cpp in einem Namespace ein
+ * (SenderFirmware.cpp, ReceiverFirmware.cpp). Nach außen gehen nur die
+ * Funktionen hier.
+ *
+ * Pins, MAC-Adressen und Zeiten kommen aus der Firmware selbst; ein -D-Flag
+ * (z.B. -DCOMMAND_LEASE_MS=120) wirkt so auf Firmware und Simulator.
+ *
+ * Globale Variablen der Firmware gibt es nur einmal pro Prozess: Ein
+ * simulierter Tiefschlaf ruft setup() erneut auf, setzt sie aber nicht
+ * zurück (siehe Simulation.h).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// esp32_sender/src/main.cpp
+struct SenderFirmware {
+  static void setup();
+  static void loop();
+
+  static int buttonCount();
+  static int buttonPin(int index);
+  static int batteryPin();
+  static const uint8_t *receiverMac();  // erster Empfänger der Gruppe
+
+  static uint32_t leaseMs();             // COMMAND_LEASE_MS
+  static uint32_t holdSendIntervalMs();  // HOLD_SEND_INTERVAL
+  static uint32_t holdTimeoutMs();       // BUTTON_HOLD_TIMEOUT
+  static uint32_t inactivityMs();        // INACTIVITY_TIMEOUT
+};
+
+// esp_receiver/src/main.cpp
+struct ReceiverFirmware {
+  static void setup();
+  static void loop();
+  static void serviceControl();  // wie der Steuer-Task nach einer Benachrichtigung
+  static void drainLog();        // wie die Log-Tasks: DeferredLog auf Serial
+
+  static const uint8_t *senderMac();  // erster bekannter Sender
+  static int firstChannel();          // Kanal von Taster 1 dieses Senders
+  static int channelCount();
+  static int channelPin(int channel); // nur OUTPUT_BACKEND_GPIO
+};
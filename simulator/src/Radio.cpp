@@ -0,0 +1,84 @@
+/**
+ * Radio – Verlust, Laufzeit und Bestätigung je Frame
+ */
+
+#include "Radio.h"
+
+#include <string.h>
+
+// =================== ZUFALL ===================
+
+Rng::Rng(uint64_t seed) {
+  // splitmix64: auch Seed 0 ergibt einen brauchbaren Startzustand
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  state = (z ^ (z >> 31)) | 1;
+}
+
+uint64_t Rng::next() {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+uint32_t Rng::between(uint32_t low, uint32_t high) {
+  if (high <= low) return low;
+  return low + (uint32_t)(next() % ((uint64_t)high - low + 1));
+}
+
+// =================== FUNKSTRECKE ===================
+
+Radio::Radio(const RadioConfig &config, uint64_t seed) : cfg(config), rng(seed), bad(false) {
+  memset(&counters, 0, sizeof(counters));
+}
+
+bool Radio::lose() {
+  if (bad) {
+    if (cfg.burstLength <= 1 || rng.chance(1.0 / cfg.burstLength)) bad = false;
+  } else if (rng.chance(cfg.burstStart)) {
+    bad = true;
+    counters.bursts++;
+  }
+  return rng.chance(bad ? cfg.lossBad : cfg.lossGood);
+}
+
+Transmission Radio::transmit(uint64_t nowUs, bool unicast) {
+  Transmission t;
+  memset(&t, 0, sizeof(t));
+  counters.frames++;
+
+  t.delivered = !lose();
+  if (!t.delivered) {
+    counters.lost++;
+    if (bad) counters.lostInBurst++;
+  }
+
+  t.arrivalUs = nowUs + cfg.delayUs + rng.between(0, cfg.jitterUs);
+  if (rng.chance(cfg.reorder)) {
+    t.arrivalUs += cfg.reorderUs;
+    counters.reordered++;
+  }
+  if (t.delivered && rng.chance(cfg.duplicate)) {
+    t.duplicated = true;
+    t.duplicateUs = nowUs + cfg.delayUs + rng.between(0, cfg.jitterUs);
+    counters.duplicated++;
+  }
+  int spread = cfg.rssiSpread;
+  t.rssi = (int8_t)(cfg.rssi - spread + (int)rng.between(0, 2 * spread));
+
+  // Bestätigung: nur Direktsendung, geht wie ein Frame verloren
+  if (!unicast) {
+    t.success = true;
+    t.statusUs = nowUs + cfg.delayUs;
+  } else if (t.delivered && !lose()) {
+    t.success = true;
+    t.statusUs = t.arrivalUs + cfg.ackUs;
+  } else {
+    if (t.delivered) counters.acksLost++;
+    t.success = false;
+    t.statusUs = nowUs + cfg.failUs;
+  }
+  return t;
+}
@@ -0,0 +1,97 @@
+/**
+ * Radio – Funkstrecke zwischen den simulierten Geräten
+ *
+ * Jeder Frame wird einzeln entschieden, mit eigenem Zufallsgenerator
+ * (gleicher Seed = gleicher Lauf):
+ * - Verlust nach dem Gilbert-Elliott-Modell: im guten Zustand geht ein
+ *   Frame mit lossGood verloren, im schlechten mit lossBad. Pro Frame
+ *   beginnt mit burstStart ein schlechter Abschnitt, der im Mittel
+ *   burstLength Frames dauert (Störer, Abschattung).
+ * - Laufzeit delayUs + gleichverteilt 0 ... jitterUs
+ * - Umsortieren: mit reorder kommt der Frame zusätzlich reorderUs später
+ *   (und überholt damit den nächsten)
+ * - Doppelt: mit duplicate kommt eine zweite Kopie mit eigener Laufzeit
+ * - Direktsendung: die Bestätigung geht mit derselben Wahrscheinlichkeit
+ *   verloren wie ein Frame; der Sender meldet dann einen Fehler, obwohl
+ *   der Frame angekommen ist. Broadcast meldet immer Erfolg.
+ * - Empfangspegel rssi ± rssiSpread dBm
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+struct RadioConfig {
+  double lossGood = 0.0;
+  double lossBad = 1.0;
+  double burstStart = 0.0;
+  double burstLength = 5.0;     // Frames
+  uint32_t delayUs = 1000;
+  uint32_t jitterUs = 500;
+  double reorder = 0.0;
+  uint32_t reorderUs = 20000;
+  double duplicate = 0.0;
+  uint32_t ackUs = 300;         // Bestätigung nach der Ankunft
+  uint32_t failUs = 4000;       // Fehlermeldung nach den MAC-Wiederholungen
+  int8_t rssi = -65;
+  uint8_t rssiSpread = 6;
+
+  // Späteste Ankunft eines Frames nach dem Senden
+  uint32_t maxDelayUs() const { return delayUs + jitterUs + (reorder > 0 ? reorderUs : 0); }
+};
+
+// xorshift64* mit splitmix64-Startwert: schnell und auf jeder Plattform gleich
+class Rng {
+public:
+  explicit Rng(uint64_t seed);
+
+  uint64_t next();
+  // Gleichverteilt in [0, 1)
+  double uniform() { return (double)(next() >> 11) * (1.0 / 9007199254740992.0); }
+  // Gleichverteilt in [low, high]
+  uint32_t between(uint32_t low, uint32_t high);
+  bool chance(double p) { return p > 0 && uniform() < p; }
+
+private:
+  uint64_t state;
+};
+
+// Was mit einem gesendeten Frame passiert
+struct Transmission {
+  bool delivered;
+  uint64_t arrivalUs;
+  bool duplicated;
+  uint64_t duplicateUs;
+  bool success;                 // Zustellstatus für OnDataSent
+  uint64_t statusUs;
+  int8_t rssi;
+};
+
+struct RadioStats {
+  uint64_t frames;
+  uint64_t lost;
+  uint64_t lostInBurst;
+  uint64_t bursts;
+  uint64_t reordered;
+  uint64_t duplicated;
+  uint64_t acksLost;
+};
+
+class Radio {
+public:
+  Radio(const RadioConfig &config, uint64_t seed);
+
+  // unicast: Direktsendung mit Bestätigung (sonst Broadcast)
+  Transmission transmit(uint64_t nowUs, bool unicast);
+
+  const RadioConfig &config() const { return cfg; }
+  const RadioStats &stats() const { return counters; }
+
+private:
+  bool lose();  // nächster Verlust-Entscheid (schaltet den Zustand weiter)
+
+  RadioConfig cfg;
+  Rng rng;
+  bool bad;
+  RadioStats counters;
+};
@@ -0,0 +1,49 @@
+/**
+ * ReceiverFirmware – esp_receiver/src/main.cpp im Namespace fw_receiver
+ *
+ * Wie SenderFirmware.cpp: erst alle Header global, dann die Firmware.
+ * Der Simulator prüft die Ausgänge an den GPIO-Pins, daher nur mit
+ * OUTPUT_BACKEND_GPIO.
+ */
+
+#include <esp_now.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/semphr.h"
+#include "MarkiseProtocol.h"
+#include "LinkAuth.h"
+#include "SenderRegistry.h"
+#include "TelemetryStore.h"
+#include "LinkQuality.h"
+#include "OutputTopology.h"
+#include "GpioOutputs.h"
+#include "ShiftRegisterOutputs.h"
+#include "I2cExpanderOutputs.h"
+#include "DeferredLog.h"
+#include "MqttClient.h"
+#include "PublishQueue.h"
+
+#include "Firmware.h"
+
+namespace fw_receiver {
+#include "../../esp_receiver/src/main.cpp"
+}  // namespace fw_receiver
+
+static_assert(OUTPUT_BACKEND == OUTPUT_BACKEND_GPIO, "Simulator prüft die Ausgänge an GPIO-Pins");
+
+void ReceiverFirmware::setup() { fw_receiver::setup(); }
+void ReceiverFirmware::loop() { fw_receiver::loop(); }
+void ReceiverFirmware::serviceControl() { fw_receiver::serviceControl(); }
+void ReceiverFirmware::drainLog() {
+  deferredLog.drain();
+  fw_receiver::controlLog.drain();
+}
+
+const uint8_t *ReceiverFirmware::senderMac() { return fw_receiver::knownSenders[0].mac; }
+int ReceiverFirmware::firstChannel() {
+  return fw_receiver::Topology::leftChannel(fw_receiver::knownSenders[0].firstMotor);
+}
+int ReceiverFirmware::channelCount() { return fw_receiver::Topology::CHANNELS; }
+int ReceiverFirmware::channelPin(int channel) { return fw_receiver::OutputConfig::pins[channel]; }
@@ -0,0 +1,40 @@
+/**
+ * SenderFirmware – esp32_sender/src/main.cpp im Namespace fw_sender
+ *
+ * Die Header der Firmware werden vorher global eingebunden: #pragma once
+ * macht die #includes in main.cpp dann wirkungslos, und nur die
+ * Definitionen der Firmware landen im Namespace.
+ */
+
+#include <atomic>
+
+#include <esp_now.h>
+#include <WiFi.h>
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp32s3/rtc.h"
+#include "driver/gpio.h"
+#include <Preferences.h>
+#include "MarkiseProtocol.h"
+#include "LinkAuth.h"
+#include "LogHistogram.h"
+
+#include "Firmware.h"
+
+namespace fw_sender {
+#include "../../esp32_sender/src/main.cpp"
+}  // namespace fw_sender
+
+void SenderFirmware::setup() { fw_sender::setup(); }
+void SenderFirmware::loop() { fw_sender::loop(); }
+
+int SenderFirmware::buttonCount() { return fw_sender::BUTTON_COUNT; }
+int SenderFirmware::buttonPin(int index) { return fw_sender::buttonPins[index]; }
+int SenderFirmware::batteryPin() { return BATTERY_ADC_PIN; }
+const uint8_t *SenderFirmware::receiverMac() { return fw_sender::receivers[0].mac; }
+
+uint32_t SenderFirmware::leaseMs() { return COMMAND_LEASE_MS; }
+uint32_t SenderFirmware::holdSendIntervalMs() { return HOLD_SEND_INTERVAL; }
+uint32_t SenderFirmware::holdTimeoutMs() { return BUTTON_HOLD_TIMEOUT; }
+uint32_t SenderFirmware::inactivityMs() { return INACTIVITY_TIMEOUT * 1000UL; }
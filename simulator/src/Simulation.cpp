@@ -0,0 +1,512 @@
+/**
+ * Simulation – Ereignisschleife, Funk, Tastenskript und Invarianten
+ */
+
+#include "Simulation.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Arduino.h"
+#include "esp_sleep.h"
+#include "Firmware.h"
+
+// =================== KONFIGURATION ===================
+
+#define SIM_WARMUP_MS 1000     // erster Tastendruck nach dem Start beider Geräte
+#define SIM_SETTLE_MS 2000     // nach dem letzten Loslassen noch weiterlaufen
+#define SIM_OFF_MARGIN_MS 10   // Frist = Lease + späteste Funk-Ankunft + Marge
+#define SIM_BATTERY_RAW 2300   // ADC-Wert am Batterie-Pin des Senders (voll)
+
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+const char *violationName(int kind) {
+  switch (kind) {
+    case VIOLATION_INTERLOCK: return "Verriegelung";
+    case VIOLATION_LATE_OFF:  return "Abschaltung zu spät";
+    case VIOLATION_SPURIOUS:  return "Ein ohne Taster";
+    default:                  return "?";
+  }
+}
+
+uint64_t SimReport::violationTotal() const {
+  uint64_t total = 0;
+  for (int i = 0; i < VIOLATION_KINDS; i++) total += violationCount[i];
+  return total;
+}
+
+// =================== AUFBAU ===================
+
+Simulation::Simulation(const Scenario &scenario, const RadioConfig &radioConfig, uint64_t seed)
+    : script(scenario), radio(radioConfig, seed), rng(seed ^ 0x5CE7A210ULL), result() {
+  result.seed = seed;
+
+  firstChannel = ReceiverFirmware::firstChannel();
+  channels = ReceiverFirmware::channelCount();
+  usedButtons = std::min(SenderFirmware::buttonCount(), channels - firstChannel);
+  offLimitUs = script.offMs != 0 ? script.offMs * 1000UL
+                                 : SenderFirmware::leaseMs() * 1000UL + radio.config().maxDelayUs() +
+                                       SIM_OFF_MARGIN_MS * 1000UL;
+  result.offLimitMs = offLimitUs / 1000;
+
+  allowedSinceUs.assign(channels, 0);
+  forbiddenSinceUs.assign(channels, 0);
+  deadlineUs.assign(channels, 0);
+  deadlineGeneration.assign(channels, 0);
+  sawOn.assign(channels, 0);
+  measureOff.assign(channels, 0);
+
+  // Adressen wie in der Konfiguration der Gegenseite
+  memcpy(sender.ownMac, ReceiverFirmware::senderMac(), 6);
+  memcpy(receiver.ownMac, SenderFirmware::receiverMac(), 6);
+  sender.analogValue[SenderFirmware::batteryPin()] = SIM_BATTERY_RAW;
+  sender.rssi = radioConfig.rssi;
+
+  sender.sendHook = [this](const uint8_t *mac, const uint8_t *data, size_t len) {
+    return transmit(SENDER, mac, data, len);
+  };
+  receiver.sendHook = [this](const uint8_t *mac, const uint8_t *data, size_t len) {
+    return transmit(RECEIVER, mac, data, len);
+  };
+  sender.scheduler = [this](uint64_t untilUs, shim::Wait wait) { pump(untilUs, &sender, wait); };
+  receiver.scheduler = [this](uint64_t untilUs, shim::Wait) {
+    receiverWakeUs = std::max(receiverWakeUs, untilUs);
+  };
+  receiver.onOutput = [this] { checkOutputs(); };
+}
+
+void Simulation::setVerbose(bool on) {
+  verbose = on;
+  sender.serialEcho = on;
+  receiver.serialEcho = on;
+}
+
+// =================== EREIGNISSCHLEIFE ===================
+
+void Simulation::schedule(uint64_t timeUs, EventType type, uint8_t side, uint8_t a, uint32_t arg) {
+  Event e;
+  e.timeUs = timeUs;
+  e.order = order++;
+  e.type = type;
+  e.side = side;
+  e.a = a;
+  e.arg = arg;
+  queue.push(e);
+}
+
+uint32_t Simulation::allocFrame() {
+  if (!freeFrames.empty()) {
+    uint32_t index = freeFrames.back();
+    freeFrames.pop_back();
+    return index;
+  }
+  frames.emplace_back();
+  return (uint32_t)(frames.size() - 1);
+}
+
+void Simulation::run() {
+  // Der Empfänger ist netzbetrieben und läuft schon, wenn der Sender startet
+  shim::select(receiver);
+  receiver.bootMicros = shim::nowMicros();
+  ReceiverFirmware::setup();
+  schedule(std::max(receiverWakeUs, shim::nowMicros()), EventType::ReceiverLoop, RECEIVER);
+  schedule(shim::nowMicros() + SIM_WARMUP_MS * 1000ULL, EventType::NextPress, SENDER);
+
+  try {
+    bootSender(false);
+    for (;;) {
+      shim::select(sender);
+      try {
+        SenderFirmware::loop();
+      } catch (const shim::DeepSleepRequest &) {
+        sleepSender();
+        pump(UINT64_MAX, nullptr, shim::Wait::Time);  // bis SenderBoot
+        bootSender(true);
+      }
+    }
+  } catch (const SimulationDone &) {
+  }
+  result.simulatedUs = shim::nowMicros();
+  result.radio = radio.stats();
+}
+
+// Arbeitet Ereignisse und fällige esp_timer ab, bis untilUs erreicht ist
+// oder die Wartebedingung des Senders gilt (waiter == nullptr: bis zum
+// Neustart aus dem Tiefschlaf)
+void Simulation::pump(uint64_t untilUs, shim::Device *waiter, shim::Wait wait) {
+  if (pumping) throw std::logic_error("Firmware wartet innerhalb eines Ereignisses");
+  struct Guard {
+    bool &flag;
+    ~Guard() { flag = false; }
+  } guard{pumping};
+  pumping = true;
+
+  for (;;) {
+    if (waiter != nullptr ? shim::waitSatisfied(*waiter, wait) : bootDue) return;
+
+    uint64_t timerUs = shim::nextTimerMicros();
+    uint64_t eventUs = queue.empty() ? UINT64_MAX : queue.top().timeUs;
+    uint64_t nextUs = std::min(timerUs, eventUs);
+    if (scriptDone && std::min(nextUs, untilUs) >= endUs) {
+      shim::setMicros(endUs);
+      throw SimulationDone();
+    }
+    if (nextUs > untilUs) {
+      shim::setMicros(untilUs);
+      return;
+    }
+    if (timerUs <= eventUs) {
+      shim::setMicros(timerUs);  // löst den Timer mit seinem Gerät aus
+      shim::select(receiver);
+      ReceiverFirmware::serviceControl();  // Failsafe-Timer weckt den Steuer-Task
+      continue;
+    }
+
+    Event e = queue.top();
+    queue.pop();
+    shim::setMicros(e.timeUs);
+    result.events++;
+    dispatch(e);
+  }
+}
+
+void Simulation::dispatch(const Event &e) {
+  switch (e.type) {
+    case EventType::Deliver:
+      deliver(e);
+      break;
+
+    case EventType::SendStatus:
+      sendStatus(e);
+      break;
+
+    case EventType::Button:
+      buttonLevel(e.a, (int)e.arg);
+      break;
+
+    case EventType::Intent:
+      setHeld((uint8_t)e.arg);
+      break;
+
+    case EventType::ReceiverLoop:
+      shim::select(receiver);
+      receiverWakeUs = 0;
+      ReceiverFirmware::loop();
+      if (verbose) ReceiverFirmware::drainLog();
+      schedule(std::max(receiverWakeUs, shim::nowMicros() + 1000), EventType::ReceiverLoop, RECEIVER);
+      break;
+
+    case EventType::Deadline: {
+      int channel = e.a;
+      if (e.arg != deadlineGeneration[channel] || ((allowed >> channel) & 1)) break;
+      if (!sawOn[channel]) result.missed++;
+      if ((outputs >> channel) & 1) violation(VIOLATION_LATE_OFF, channel);
+      break;
+    }
+
+    case EventType::HoldLimit:
+      if (e.arg == holdGeneration && held != 0 && !blocked) {
+        blocked = true;
+        // Der Sender merkt es erst beim nächsten Erneuern der Lease
+        updateAllowed(SenderFirmware::holdSendIntervalMs() * 1000ULL);
+      }
+      break;
+
+    case EventType::SenderBoot:
+      bootPending = false;
+      bootDue = true;
+      break;
+
+    case EventType::NextPress:
+      nextPress();
+      break;
+  }
+}
+
+// =================== FUNK ===================
+
+esp_err_t Simulation::transmit(Side from, const uint8_t *mac, const uint8_t *data, size_t len) {
+  const shim::Device &source = from == SENDER ? sender : receiver;
+  const shim::Device &target = from == SENDER ? receiver : sender;
+  Side to = from == SENDER ? RECEIVER : SENDER;
+
+  bool unicast = memcmp(mac, BROADCAST_MAC, 6) != 0;
+  bool addressed = !unicast || memcmp(mac, target.ownMac, 6) == 0;
+  Transmission t = radio.transmit(shim::nowMicros(), unicast);
+
+  if (t.delivered && addressed) {
+    uint32_t index = allocFrame();
+    Frame &frame = frames[index];
+    memcpy(frame.mac, source.ownMac, 6);
+    memcpy(frame.data, data, len);
+    frame.len = (uint8_t)len;
+    frame.rssi = t.rssi;
+    frame.generation = generation;
+    schedule(t.arrivalUs, EventType::Deliver, to, 0, index);
+    if (t.duplicated) {
+      uint32_t copy = allocFrame();
+      frames[copy] = frames[index];
+      schedule(t.duplicateUs, EventType::Deliver, to, 0, copy);
+    }
+  }
+
+  uint32_t status = allocFrame();
+  memcpy(frames[status].mac, mac, 6);
+  frames[status].generation = generation;
+  schedule(t.statusUs, EventType::SendStatus, from, t.success && addressed, status);
+  return ESP_OK;
+}
+
+void Simulation::deliver(const Event &e) {
+  const Frame &frame = frames[e.arg];
+  if (e.side == SENDER) {
+    if (!asleep && frame.generation == generation) {
+      shim::select(sender);
+      sender.rxRssi = frame.rssi;
+      shim::injectReceive(frame.mac, frame.data, frame.len);
+    } else {
+      result.framesDropped++;
+    }
+  } else {
+    shim::select(receiver);
+    receiver.rxRssi = frame.rssi;
+    shim::injectReceive(frame.mac, frame.data, frame.len);
+    ReceiverFirmware::serviceControl();  // Steuer-Task läuft ohne Verzögerung an
+  }
+  freeFrames.push_back(e.arg);
+}
+
+void Simulation::sendStatus(const Event &e) {
+  const Frame &frame = frames[e.arg];
+  if (e.side == SENDER) {
+    // Nach einem Neustart gibt es den Frame für den Sender nicht mehr
+    if (!asleep && frame.generation == generation) {
+      shim::select(sender);
+      shim::deliverSendStatus(frame.mac, e.a != 0);
+    }
+  } else {
+    shim::select(receiver);
+    shim::deliverSendStatus(frame.mac, e.a != 0);
+  }
+  freeFrames.push_back(e.arg);
+}
+
+// =================== SENDER ===================
+
+void Simulation::bootSender(bool wake) {
+  shim::select(sender);
+  sender.bootMicros = shim::nowMicros();
+  sender.wakeupCause = wake ? ESP_SLEEP_WAKEUP_EXT1 : ESP_SLEEP_WAKEUP_UNDEFINED;
+  sender.ext1WakeupStatus = wake ? wakeStatus : 0;
+  asleep = false;
+  bootDue = false;
+  if (wake) result.senderBoots++;
+  SenderFirmware::setup();
+}
+
+// Tiefschlaf: was der Neustart auf dem ESP32 löscht (Interrupts, ESP-NOW,
+// Aufweckquellen des Light Sleep, Benachrichtigungen)
+void Simulation::sleepSender() {
+  generation++;
+  asleep = true;
+  shim::select(sender);
+  for (int pin = 0; pin < shim::PIN_COUNT; pin++) {
+    sender.isr[pin] = nullptr;
+    sender.pinWakeup[pin] = 0;
+    sender.pinIntrDisabled[pin] = false;
+  }
+  sender.gpioWakeup = false;
+  sender.sleepTimerUs = 0;
+  sender.espNowReady = false;
+  sender.sendCb = nullptr;
+  sender.recvCb = nullptr;
+  ulTaskNotifyTake(pdTRUE, 0);
+
+  // Ein noch gedrückter Taster weckt sofort wieder (ext1, Pegel LOW)
+  for (int i = 0; i < usedButtons; i++) {
+    if (sender.pinLevel[SenderFirmware::buttonPin(i)] == LOW) {
+      buttonLevel(i, LOW);
+      break;
+    }
+  }
+}
+
+void Simulation::buttonLevel(int button, int level) {
+  int pin = SenderFirmware::buttonPin(button);
+  if (!asleep) {
+    shim::select(sender);
+    if (level == LOW) {
+      shim::setInput(pin, LOW);
+    } else {
+      shim::releaseInput(pin);
+    }
+    return;
+  }
+
+  // Im Tiefschlaf: nur der Pegel, das erste LOW löst das Aufwecken aus
+  sender.pinDriven[pin] = true;
+  sender.pinLevel[pin] = (uint8_t)(level ? HIGH : LOW);
+  if (level == LOW && !bootPending) {
+    bootPending = true;
+    wakeStatus = 0;
+    for (int i = 0; i < SenderFirmware::buttonCount(); i++) {
+      int p = SenderFirmware::buttonPin(i);
+      if (sender.pinLevel[p] == LOW) wakeStatus |= 1ULL << p;
+    }
+    schedule(shim::nowMicros() + script.bootMs * 1000ULL, EventType::SenderBoot, SENDER);
+  }
+}
+
+// =================== TASTENSKRIPT ===================
+
+void Simulation::nextPress() {
+  uint64_t now = shim::nowMicros();
+  pressIndex++;
+  result.presses = pressIndex;
+
+  int button = (int)rng.between(0, usedButtons - 1);
+  uint32_t holdMs = rng.chance(script.longHold) ? SenderFirmware::holdTimeoutMs() + rng.between(200, 2000)
+                                                : rng.between(script.holdMinMs, script.holdMaxMs);
+  uint32_t holdUs = holdMs * 1000U;
+  uint64_t releaseUs = now + holdUs;
+  uint32_t bounceUs = std::min<uint32_t>(script.bounceMs * 1000U, holdUs / 2);
+
+  schedule(now, EventType::Intent, SENDER, 0, 1u << button);
+  pressEdge(now, button, LOW, bounceUs);
+  if (usedButtons > 1 && rng.chance(script.chord)) {
+    // Zweiter Taster während des Haltens, beide zusammen losgelassen
+    int second = (button + (int)rng.between(1, usedButtons - 1)) % usedButtons;
+    uint32_t offsetUs = rng.between(holdUs / 4, holdUs * 3 / 4);
+    schedule(now + offsetUs, EventType::Intent, SENDER, 0, (1u << button) | (1u << second));
+    pressEdge(now + offsetUs, second, LOW, std::min(bounceUs, (holdUs - offsetUs) / 2));
+    pressEdge(releaseUs, second, HIGH, bounceUs);
+  }
+  schedule(releaseUs, EventType::Intent, SENDER, 0, 0);
+  pressEdge(releaseUs, button, HIGH, bounceUs);
+
+  uint32_t gapMs = rng.chance(script.deepSleep) ? SenderFirmware::inactivityMs() + rng.between(500, 5000)
+                                                : rng.between(script.gapMinMs, script.gapMaxMs);
+  uint64_t nextUs = releaseUs + bounceUs + gapMs * 1000ULL;
+  if (pressIndex < script.presses) {
+    schedule(nextUs, EventType::NextPress, SENDER);
+  } else {
+    scriptDone = true;
+    endUs = releaseUs + bounceUs + std::max<uint64_t>(2ULL * offLimitUs, SIM_SETTLE_MS * 1000ULL);
+  }
+}
+
+// Eine Flanke, danach bis zu drei Preller innerhalb von maxBounceUs
+void Simulation::pressEdge(uint64_t timeUs, int button, int level, uint32_t maxBounceUs) {
+  schedule(timeUs, EventType::Button, SENDER, (uint8_t)button, (uint32_t)level);
+  if (maxBounceUs == 0) return;
+  uint32_t toggles = rng.between(1, 3);
+  uint32_t step = maxBounceUs / (2 * toggles);
+  if (step == 0) return;
+  uint64_t t = timeUs;
+  for (uint32_t i = 0; i < toggles; i++) {
+    t += rng.between(1, step);
+    schedule(t, EventType::Button, SENDER, (uint8_t)button, (uint32_t)!level);
+    t += rng.between(1, step);
+    schedule(t, EventType::Button, SENDER, (uint8_t)button, (uint32_t)level);
+  }
+}
+
+// =================== INVARIANTEN ===================
+
+void Simulation::setHeld(uint8_t mask) {
+  uint8_t before = held;
+  held = mask;
+  if (held == 0) {
+    blocked = false;  // wie waitForRelease im Sender
+  } else if ((held & (held - 1)) != 0) {
+    blocked = true;   // mehrere Taster: STOP bis alle losgelassen sind
+  } else if (before == 0) {
+    // Sicherheits-Timeout zählt ab dem Befehl (nach dem Aufwecken später)
+    holdGeneration++;
+    uint64_t startUs = shim::nowMicros() + (asleep ? script.bootMs * 1000ULL : 0);
+    schedule(startUs + SenderFirmware::holdTimeoutMs() * 1000ULL, EventType::HoldLimit, SENDER, 0,
+             holdGeneration);
+  }
+  updateAllowed(0);
+}
+
+// Welche Kanäle dürfen laufen? Wer nicht mehr darf, bekommt eine Frist
+void Simulation::updateAllowed(uint64_t slackUs) {
+  uint64_t now = shim::nowMicros();
+  uint64_t next = 0;
+  if (held != 0 && (held & (held - 1)) == 0 && !blocked) {
+    int button = __builtin_ctz(held);
+    if (button < usedButtons) next = 1ULL << (firstChannel + button);
+  }
+
+  uint64_t changed = next ^ allowed;
+  allowed = next;
+  while (changed != 0) {
+    int c = __builtin_ctzll(changed);
+    changed &= changed - 1;
+    if ((next >> c) & 1) {
+      allowedSinceUs[c] = now;
+      sawOn[c] = (outputs >> c) & 1;
+      measureOff[c] = 0;
+    } else {
+      forbiddenSinceUs[c] = now;
+      deadlineUs[c] = now + offLimitUs + slackUs;
+      deadlineGeneration[c]++;
+      measureOff[c] = slackUs == 0;  // nur Loslassen/zweiter Taster, nicht der Timeout
+      schedule(deadlineUs[c], EventType::Deadline, RECEIVER, (uint8_t)c, deadlineGeneration[c]);
+    }
+  }
+}
+
+// Nach jedem Schreiben eines Ausgangs im Empfänger (auch zwischen dem
+// Clear- und dem Set-Zugriff eines Umschaltens)
+void Simulation::checkOutputs() {
+  uint64_t level = 0;
+  for (int c = 0; c < channels; c++) {
+    if (receiver.pinLevel[ReceiverFirmware::channelPin(c)] == HIGH) level |= 1ULL << c;
+  }
+  uint64_t changed = level ^ outputs;
+  if (changed == 0) return;
+  outputs = level;
+  uint64_t now = shim::nowMicros();
+
+  for (uint64_t rising = changed & level; rising != 0; rising &= rising - 1) {
+    int c = __builtin_ctzll(rising);
+    if ((allowed >> c) & 1) {
+      if (!sawOn[c]) result.onLatencyUs.add((uint32_t)(now - allowedSinceUs[c]));
+      sawOn[c] = 1;
+    } else if (now <= deadlineUs[c]) {
+      sawOn[c] = 1;  // verspäteter Frame, innerhalb der Frist
+    } else {
+      violation(VIOLATION_SPURIOUS, c);
+    }
+  }
+  for (uint64_t falling = changed & ~level; falling != 0; falling &= falling - 1) {
+    int c = __builtin_ctzll(falling);
+    if ((allowed >> c) & 1) {
+      result.dropouts++;
+    } else if (measureOff[c]) {
+      result.offLatencyUs.add((uint32_t)(now - forbiddenSinceUs[c]));
+      measureOff[c] = 0;
+    }
+  }
+
+  // Kanal 2m und 2m+1 sind die beiden Richtungen von Motor m
+  for (int c = 0; c + 1 < channels; c += 2) {
+    if (((level >> c) & 3) == 3 && ((changed >> c) & 3) != 0) violation(VIOLATION_INTERLOCK, c);
+  }
+}
+
+void Simulation::violation(ViolationKind kind, int channel) {
+  result.violationCount[kind]++;
+  if (result.violations.size() < (size_t)SimReport::LISTED) {
+    Violation v;
+    v.timeUs = shim::nowMicros();
+    v.press = pressIndex;
+    v.kind = (uint8_t)kind;
+    v.channel = (uint8_t)channel;
+    result.violations.push_back(v);
+  }
+}
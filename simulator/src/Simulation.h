@@ -0,0 +1,230 @@
+/**
+ * Simulation – Sender und Empfänger über eine gestörte Funkstrecke
+ *
+ * Beide Firmwares laufen unverändert (Firmware.h) auf einer gemeinsamen
+ * virtuellen Uhr, ereignisgesteuert und ohne Threads:
+ * - Der Sender läuft als äußere Schleife (setup(), dann loop() immer
+ *   wieder). Jede Wartestelle (delay, ulTaskNotifyTake, Light Sleep) gibt
+ *   an den Scheduler ab (shim::Device::scheduler); der arbeitet die
+ *   Ereignisse bis zum Ende der Wartezeit ab und kehrt früher zurück,
+ *   sobald der Sender geweckt wird (Benachrichtigung, Taster-Pegel).
+ * - Der Empfänger läuft nur in Ereignissen: OnDataRecv bei der Ankunft
+ *   eines Frames, onFailsafeTimeout über den esp_timer des Shims (danach
+ *   jeweils sofort der Steuer-Task: serviceControl()) und loop() als
+ *   eigenes Ereignis. Sein delay() am Ende von loop() plant den
+ *   nächsten Durchlauf ein, kostet aber keine Zeit (Wartestellen mitten in
+ *   einem Callback dauern im Simulator also null).
+ * - Frames gehen über Radio (Verlust, Bursts, Laufzeit, Umsortieren,
+ *   Duplikate); der Zustellstatus kommt als eigenes Ereignis zurück.
+ * - Das Tastenskript entsteht beim Lauf aus dem Seed: Taster, Haltedauer,
+ *   Pausen, optional Prellen, zu lange gehaltene Taster, zweiter Taster
+ *   während des Haltens und Pausen bis in den Tiefschlaf.
+ *
+ * Tiefschlaf: esp_deep_sleep_start() wirft im Shim. Der Simulator legt den
+ * Sender still (keine Interrupts, kein Empfang) und ruft beim nächsten
+ * Tastendruck nach bootMs wieder setup() auf, mit ext1 als Wake-Ursache.
+ * Globale und statische Variablen der Firmware behalten dabei ihren Wert –
+ * anders als auf dem ESP32. Was die Firmware nach dem Aufwecken braucht,
+ * setzt sie in setup() bzw. holt sie aus der RTC-Sitzung, daher passt das
+ * für die Invarianten; Statistiken laufen über die Neustarts weiter.
+ *
+ * Invarianten (geprüft bei jedem Schreiben eines Ausgangs und zu Fristen):
+ * - Verriegelung: nie beide Ausgänge eines Motors gleichzeitig an, auch
+ *   nicht zwischen zwei Registerzugriffen eines Umschaltens
+ * - Abschaltung: spätestens offMs nach dem Loslassen (bzw. nach dem
+ *   zweiten Taster, nach BUTTON_HOLD_TIMEOUT) ist der Ausgang aus
+ * - kein Einschalten ohne gedrückten Taster (außer ein verspäteter Frame
+ *   innerhalb derselben Frist)
+ *
+ * Es gibt pro Prozess nur eine Firmware je Seite: nur eine Simulation je
+ * Prozess laufen lassen.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "LogHistogram.h"
+#include "NativeShim.h"
+#include "Radio.h"
+
+// =================== SKRIPT ===================
+
+struct Scenario {
+  uint64_t presses = 10000;
+  uint32_t holdMinMs = 30;
+  uint32_t holdMaxMs = 1500;
+  uint32_t gapMinMs = 50;
+  uint32_t gapMaxMs = 1000;
+  double longHold = 0.0;   // Anteil: länger als BUTTON_HOLD_TIMEOUT gehalten
+  double chord = 0.0;      // Anteil: zweiter Taster während des Haltens
+  double deepSleep = 0.0;  // Anteil: Pause bis in den Tiefschlaf
+  uint32_t bounceMs = 0;   // Prellen nach jeder Flanke (0 = sauber)
+  uint32_t bootMs = 30;    // Tastendruck im Tiefschlaf bis setup()
+  uint32_t offMs = 0;      // Frist für die Abschaltung, 0 = Lease + Funk + 10 ms
+};
+
+// =================== ERGEBNIS ===================
+
+enum ViolationKind {
+  VIOLATION_INTERLOCK,  // beide Richtungen eines Motors an
+  VIOLATION_LATE_OFF,   // Frist nach dem Loslassen überschritten
+  VIOLATION_SPURIOUS,   // eingeschaltet, ohne dass der Taster gedrückt ist
+  VIOLATION_KINDS
+};
+
+const char *violationName(int kind);
+
+struct Violation {
+  uint64_t timeUs;
+  uint64_t press;   // laufende Nummer des Tastendrucks
+  uint8_t kind;
+  uint8_t channel;
+};
+
+struct SimReport {
+  static constexpr int LISTED = 16;  // so viele Verletzungen mit Details
+
+  uint64_t seed;
+  uint64_t presses;
+  uint64_t simulatedUs;
+  uint64_t events;
+  uint64_t senderBoots;              // Aufwecken aus dem Tiefschlaf
+  uint64_t framesDropped;            // Frames an den schlafenden Sender
+  uint32_t offLimitMs;
+  RadioStats radio;
+
+  uint64_t missed;                   // Tastendruck ohne Ausgang
+  uint64_t dropouts;                 // Ausgang während des Haltens aus
+  LogHistogram<22> onLatencyUs;      // Taster -> Ausgang an
+  LogHistogram<22> offLatencyUs;     // Loslassen -> Ausgang aus
+
+  uint64_t violationCount[VIOLATION_KINDS];
+  std::vector<Violation> violations; // die ersten LISTED
+
+  uint64_t violationTotal() const;
+};
+
+// =================== SIMULATOR ===================
+
+class Simulation {
+public:
+  Simulation(const Scenario &scenario, const RadioConfig &radio, uint64_t seed);
+
+  // Spielt das ganze Skript; danach report()
+  void run();
+
+  // Serial-Ausgaben beider Firmwares auf stdout (nur für kurze Läufe)
+  void setVerbose(bool verbose);
+
+  const SimReport &report() const { return result; }
+
+private:
+  enum class EventType : uint8_t {
+    Deliver,       // Frame kommt an
+    SendStatus,    // Zustellstatus an den Absender
+    Button,        // Pegelwechsel an einem Taster (mit Prellen)
+    Intent,        // logischer Tasterzustand laut Skript (für die Invarianten)
+    ReceiverLoop,
+    Deadline,      // Frist: Kanal muss aus sein
+    HoldLimit,     // Sicherheits-Timeout des Senders erreicht
+    SenderBoot,
+    NextPress,
+  };
+
+  enum Side : uint8_t { SENDER = 0, RECEIVER = 1 };
+
+  struct Event {
+    uint64_t timeUs;
+    uint64_t order;    // gleiche Zeit: in der Reihenfolge des Einplanens
+    EventType type;
+    uint8_t side;
+    uint8_t a;         // Taster, Kanal, Pegel oder Zustellstatus
+    uint32_t arg;      // Frame-Index, Maske oder Generation
+
+    bool operator>(const Event &other) const {
+      return timeUs != other.timeUs ? timeUs > other.timeUs : order > other.order;
+    }
+  };
+
+  // Frame unterwegs (bzw. Adresse für den Zustellstatus)
+  struct Frame {
+    uint8_t mac[6];
+    uint8_t len;
+    int8_t rssi;
+    uint32_t generation;  // Sender-Neustart beim Senden
+    uint8_t data[ESP_NOW_MAX_DATA_LEN];
+  };
+
+  struct SimulationDone {};
+
+  void schedule(uint64_t timeUs, EventType type, uint8_t side, uint8_t a = 0, uint32_t arg = 0);
+  uint32_t allocFrame();
+  void pump(uint64_t untilUs, shim::Device *waiter, shim::Wait wait);
+  void dispatch(const Event &e);
+
+  esp_err_t transmit(Side from, const uint8_t *mac, const uint8_t *data, size_t len);
+  void deliver(const Event &e);
+  void sendStatus(const Event &e);
+
+  void bootSender(bool wake);
+  void sleepSender();
+  void buttonLevel(int button, int level);
+
+  void nextPress();
+  void pressEdge(uint64_t timeUs, int button, int level, uint32_t maxBounceUs);
+  void setHeld(uint8_t mask);
+  void updateAllowed(uint64_t slackUs);
+  void checkOutputs();
+  void violation(ViolationKind kind, int channel);
+
+  Scenario script;
+  Radio radio;
+  Rng rng;
+  SimReport result;
+
+  shim::Device sender;
+  shim::Device receiver;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+  uint64_t order = 0;
+  std::vector<Frame> frames;
+  std::vector<uint32_t> freeFrames;
+  bool pumping = false;
+  bool verbose = false;
+
+  // Sender
+  uint32_t generation = 0;      // zählt die Tiefschlaf-Neustarts
+  bool asleep = false;
+  bool bootPending = false;     // Taster im Tiefschlaf, SenderBoot eingeplant
+  bool bootDue = false;
+  uint64_t wakeStatus = 0;      // ext1: gedrückte Taster beim Aufwecken
+
+  // Empfänger
+  uint64_t receiverWakeUs = 0;  // nächster loop()-Durchlauf
+  int firstChannel = 0;
+  int channels = 0;
+  int usedButtons = 0;
+
+  // Skript
+  uint64_t pressIndex = 0;
+  bool scriptDone = false;
+  uint64_t endUs = 0;
+  uint32_t offLimitUs = 0;
+
+  // Invarianten
+  uint8_t held = 0;             // laut Skript gedrückte Taster
+  bool blocked = false;         // zweiter Taster oder Sicherheits-Timeout bis zum Loslassen
+  uint32_t holdGeneration = 0;
+  uint64_t outputs = 0;         // Ausgänge (Pins) beim letzten Schreiben
+  uint64_t allowed = 0;         // Kanäle, die gerade laufen dürfen
+  std::vector<uint64_t> allowedSinceUs;
+  std::vector<uint64_t> forbiddenSinceUs;
+  std::vector<uint64_t> deadlineUs;  // bis dahin darf der Kanal noch an sein
+  std::vector<uint32_t> deadlineGeneration;
+  std::vector<uint8_t> sawOn;
+  std::vector<uint8_t> measureOff;   // Abschaltzeit nach dem Loslassen messen
+};
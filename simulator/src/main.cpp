@@ -0,0 +1,164 @@
+/**
+ * Simulator für Sender und Empfänger (nur native-Build)
+ *
+ * Spielt ein zufälliges Tastenskript über eine gestörte Funkstrecke und
+ * prüft die Sicherheits-Invarianten (siehe Simulation.h). Gleicher Seed
+ * und gleiche Optionen ergeben denselben Lauf.
+ *
+ * Aufruf:  pio run -e native && .pio/build/native/program [Optionen]
+ *
+ * Skript:  --presses=N --seed=N --hold-min-ms=N --hold-max-ms=N
+ *          --gap-min-ms=N --gap-max-ms=N --long-hold=P --chord=P
+ *          --deep-sleep=P --bounce-ms=N --boot-ms=N --off-ms=N
+ * Funk:    --loss=P --burst-start=P --burst-len=N --burst-loss=P
+ *          --delay-us=N --jitter-us=N --reorder=P --reorder-us=N
+ *          --duplicate=P --rssi=N
+ * Ausgabe: --json (eine Zeile JSON auf stdout) --verbose (Serial beider Geräte)
+ *
+ * P ist eine Wahrscheinlichkeit (0 ... 1). Zeiten der Firmware (Lease,
+ * Entprellung, Timeouts) sind Compile-Zeit-Konstanten und werden über
+ * build_flags gesetzt, z.B. -DCOMMAND_LEASE_MS=120.
+ *
+ * Rückgabe: 0 = alle Invarianten gehalten, 1 = Verletzung, 2 = falsche Option
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "Simulation.h"
+
+// Liest "--name=wert"; Rückgabe: true, wenn arg diese Option ist
+static bool option(const char *arg, const char *name, const char **value) {
+  size_t len = strlen(name);
+  if (strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+  *value = arg + len + 1;
+  return true;
+}
+
+static bool parseArgs(int argc, char **argv, Scenario &script, RadioConfig &radio, uint64_t &seed,
+                      bool &json, bool &verbose) {
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = nullptr;
+    if (strcmp(a, "--json") == 0) json = true;
+    else if (strcmp(a, "--verbose") == 0) verbose = true;
+    else if (option(a, "--presses", &v)) script.presses = strtoull(v, nullptr, 10);
+    else if (option(a, "--seed", &v)) seed = strtoull(v, nullptr, 10);
+    else if (option(a, "--hold-min-ms", &v)) script.holdMinMs = (uint32_t)atol(v);
+    else if (option(a, "--hold-max-ms", &v)) script.holdMaxMs = (uint32_t)atol(v);
+    else if (option(a, "--gap-min-ms", &v)) script.gapMinMs = (uint32_t)atol(v);
+    else if (option(a, "--gap-max-ms", &v)) script.gapMaxMs = (uint32_t)atol(v);
+    else if (option(a, "--long-hold", &v)) script.longHold = atof(v);
+    else if (option(a, "--chord", &v)) script.chord = atof(v);
+    else if (option(a, "--deep-sleep", &v)) script.deepSleep = atof(v);
+    else if (option(a, "--bounce-ms", &v)) script.bounceMs = (uint32_t)atol(v);
+    else if (option(a, "--boot-ms", &v)) script.bootMs = (uint32_t)atol(v);
+    else if (option(a, "--off-ms", &v)) script.offMs = (uint32_t)atol(v);
+    else if (option(a, "--loss", &v)) radio.lossGood = atof(v);
+    else if (option(a, "--burst-start", &v)) radio.burstStart = atof(v);
+    else if (option(a, "--burst-len", &v)) radio.burstLength = atof(v);
+    else if (option(a, "--burst-loss", &v)) radio.lossBad = atof(v);
+    else if (option(a, "--delay-us", &v)) radio.delayUs = (uint32_t)atol(v);
+    else if (option(a, "--jitter-us", &v)) radio.jitterUs = (uint32_t)atol(v);
+    else if (option(a, "--reorder", &v)) radio.reorder = atof(v);
+    else if (option(a, "--reorder-us", &v)) radio.reorderUs = (uint32_t)atol(v);
+    else if (option(a, "--duplicate", &v)) radio.duplicate = atof(v);
+    else if (option(a, "--rssi", &v)) radio.rssi = (int8_t)atoi(v);
+    else {
+      fprintf(stderr, "Unbekannte Option: %s\n", a);
+      return false;
+    }
+  }
+  if (script.presses == 0 || script.holdMinMs == 0 || script.holdMaxMs < script.holdMinMs ||
+      script.gapMaxMs < script.gapMinMs) {
+    fprintf(stderr, "Ungültiges Skript (presses > 0, hold-min-ms > 0, min <= max)\n");
+    return false;
+  }
+  return true;
+}
+
+static double ms(uint32_t us) { return us / 1000.0; }
+
+static void printText(const SimReport &r, double wallSec) {
+  const RadioStats &radio = r.radio;
+  double frames = radio.frames != 0 ? (double)radio.frames : 1.0;
+  printf("Simulation: %llu Tastendrücke, Seed %llu, %.1f s simuliert in %.2f s (%.0f Drücke/s, %llu Ereignisse)\n",
+         (unsigned long long)r.presses, (unsigned long long)r.seed, r.simulatedUs / 1e6, wallSec,
+         r.presses / wallSec, (unsigned long long)r.events);
+  printf("Funk: %llu Frames, %.2f %% verloren (%llu Bursts), %llu umsortiert, %llu doppelt, "
+         "%llu Bestätigungen verloren\n",
+         (unsigned long long)radio.frames, 100.0 * radio.lost / frames, (unsigned long long)radio.bursts,
+         (unsigned long long)radio.reordered, (unsigned long long)radio.duplicated,
+         (unsigned long long)radio.acksLost);
+  printf("Sender: %llu-mal aus dem Tiefschlaf geweckt, %llu Frames im Schlaf verworfen\n",
+         (unsigned long long)r.senderBoots, (unsigned long long)r.framesDropped);
+  printf("Taster -> Ausgang an:  p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", ms(r.onLatencyUs.percentile(500)),
+         ms(r.onLatencyUs.percentile(990)), ms(r.onLatencyUs.max));
+  printf("Loslassen -> aus:      p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", ms(r.offLatencyUs.percentile(500)),
+         ms(r.offLatencyUs.percentile(990)), ms(r.offLatencyUs.max));
+  printf("Ohne Wirkung: %llu Tastendrücke, Unterbrechungen beim Halten: %llu\n",
+         (unsigned long long)r.missed, (unsigned long long)r.dropouts);
+
+  uint64_t total = r.violationTotal();
+  printf("Invarianten (Frist %u ms): %s", (unsigned)r.offLimitMs, total == 0 ? "OK\n" : "VERLETZT");
+  if (total != 0) {
+    printf(" %llu-mal (", (unsigned long long)total);
+    for (int k = 0; k < VIOLATION_KINDS; k++) {
+      printf("%s%s %llu", k == 0 ? "" : ", ", violationName(k), (unsigned long long)r.violationCount[k]);
+    }
+    printf(")\n");
+    for (const Violation &v : r.violations) {
+      printf("  %12.6f s  Druck #%llu  Kanal %u: %s\n", v.timeUs / 1e6, (unsigned long long)v.press,
+             (unsigned)v.channel + 1, violationName(v.kind));
+    }
+  }
+}
+
+static void printJson(const SimReport &r, const RadioConfig &radioConfig, double wallSec) {
+  const RadioStats &radio = r.radio;
+  printf("{\"seed\":%llu,\"presses\":%llu,\"simulated_s\":%.3f,\"wall_s\":%.3f,\"events\":%llu,",
+         (unsigned long long)r.seed, (unsigned long long)r.presses, r.simulatedUs / 1e6, wallSec,
+         (unsigned long long)r.events);
+  printf("\"loss\":%g,\"burst_start\":%g,\"delay_us\":%u,\"jitter_us\":%u,\"reorder\":%g,\"duplicate\":%g,",
+         radioConfig.lossGood, radioConfig.burstStart, (unsigned)radioConfig.delayUs,
+         (unsigned)radioConfig.jitterUs, radioConfig.reorder, radioConfig.duplicate);
+  printf("\"frames\":%llu,\"lost\":%llu,\"acks_lost\":%llu,\"sender_boots\":%llu,",
+         (unsigned long long)radio.frames, (unsigned long long)radio.lost, (unsigned long long)radio.acksLost,
+         (unsigned long long)r.senderBoots);
+  printf("\"on_p50_us\":%u,\"on_p99_us\":%u,\"on_max_us\":%u,\"off_p50_us\":%u,\"off_p99_us\":%u,\"off_max_us\":%u,",
+         (unsigned)r.onLatencyUs.percentile(500), (unsigned)r.onLatencyUs.percentile(990),
+         (unsigned)r.onLatencyUs.max, (unsigned)r.offLatencyUs.percentile(500),
+         (unsigned)r.offLatencyUs.percentile(990), (unsigned)r.offLatencyUs.max);
+  printf("\"missed\":%llu,\"dropouts\":%llu,\"off_limit_ms\":%u,", (unsigned long long)r.missed,
+         (unsigned long long)r.dropouts, (unsigned)r.offLimitMs);
+  printf("\"violations\":{\"interlock\":%llu,\"late_off\":%llu,\"spurious\":%llu}}\n",
+         (unsigned long long)r.violationCount[VIOLATION_INTERLOCK],
+         (unsigned long long)r.violationCount[VIOLATION_LATE_OFF],
+         (unsigned long long)r.violationCount[VIOLATION_SPURIOUS]);
+}
+
+int main(int argc, char **argv) {
+  Scenario script;
+  RadioConfig radio;
+  uint64_t seed = 1;
+  bool json = false;
+  bool verbose = false;
+  if (!parseArgs(argc, argv, script, radio, seed, json, verbose)) return 2;
+
+  Simulation sim(script, radio, seed);
+  sim.setVerbose(verbose);
+
+  auto start = std::chrono::steady_clock::now();
+  sim.run();
+  double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (json) {
+    printJson(sim.report(), radio, wallSec);
+  } else {
+    printText(sim.report(), wallSec);
+  }
+  return sim.report().violationTotal() == 0 ? 0 : 1;
+}